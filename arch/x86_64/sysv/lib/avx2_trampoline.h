@@ -1,24 +1,43 @@
 #ifndef AVX2_TRAMPOLINE_H
 #define AVX2_TRAMPOLINE_H
 
+# Determine the widest supported instruction set and
+# tail-call the corresponding function
+#
+# Params:
+#   \avx512: Function to call if avx512bw is supported
+#   \avx2:   Function to call if avx2 but not avx512bw is supported
+#   \sse2:   Function to call if sse2 but not avx2 is supported
+#   \nosupp: Function to call if none of the above is supported
+#
+# Return:
+#   Whatever the called function returns
+.macro simd_trampoline avx512, avx2, sse2, nosupp
+    movq    scc_simd_support@GOTPCREL(%rip), %rax
+    movl    (%rax), %eax
+    testl   %eax, %eax
+    jns     1f
+    call    scc_impl_simd_level
+1:
+    cmpl    $0x02, %eax
+    ja      \avx512
+    je      \avx2
+    cmpl    $0x01, %eax
+    je      \sse2
+    jmp     \nosupp
+.endm
+
 # Determine whether avx2 is supported. If it is,
 # tail-call \supp. If it is not, tail-call \nosupp
 #
 # Params:
 #   \supp:   Function to call if avx2 is supported
-#   \unsupp: Function to call if avx2 is not supported
+#   \nosupp: Function to call if avx2 is not supported
 #
 # Return:
-#   Whatever \supp or \unsupp return
+#   Whatever \supp or \nosupp return
 .macro avx2_trampoline supp, nosupp
-    movq    scc_simd_support@GOTPCREL(%rip), %rax
-    movl    (%rax), %eax
-    subl    $0x01, %eax
-    jz      \supp
-    jc      \nosupp
-    call    scc_impl_have_avx2
-    jz      \supp
-    jmp     \nosupp
+    simd_trampoline \supp, \supp, \nosupp, \nosupp
 .endm
 
 #endif /* AVX2_TRAMPOLINE_H */
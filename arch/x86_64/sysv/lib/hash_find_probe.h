@@ -1,7 +1,14 @@
 #ifndef HASH_FIND_PROBE_H
 #define HASH_FIND_PROBE_H
 
+#include <scc/config.h>
+
+#ifndef SCC_HWVEC_MAXSIZE
+#error "SCC_HWVEC_MAXSIZE determines the guard size shared with the C code"
+#endif
+
 #include "isolssb.h"
+#include "vecmask.h"
 
 # Wrap index of slot computation
 #
@@ -38,7 +45,7 @@
 .macro framesetup
     subq    $framesz, %rsp                  # Make space and align rsp
     movq    %r15, 0x28(%rsp)                # Use non-scratch registers to preserve data across calls
-    movl    %ecx, %r15d                     # Hash match mask
+    movq    %rcx, %r15                      # Hash match mask
 
     movq    %r14, 0x20(%rsp)                # Scratch
 
@@ -67,14 +74,14 @@
 .endm
 
 # Main eq loop. Calls eq on each slot whose corresponding
-# bit is set in %r15d.
+# bit is set in %r15.
 #
 # Prerequisites:
 #   %rbx:  Slot index
 #   %rbp:  Hashtab base address
 #   %r12:  Element size (or log2(element size) if \pwr2 == 1)
 #   %r13:  Address of ht_curr
-#   %r14d: 0-based index of low bit in %r15d (i.e. tzcntl %r15d, %r14d)
+#   %r14:  0-based index of low bit in %r15 (i.e. tzcntq %r15, %r14)
 #   %r15:  Hash match mask
 #
 # Params:
@@ -85,7 +92,7 @@
 #
 # Return:
 #   -
-.macro eqloop pwr2, map, label, dupl
+.macro eqloop pwr2, map, sse2, avx2, avx512, label, dupl
     leaq    (%rbx, %r14), %rax              # Array index
     wrapq   %rbp, %rax, %rcx                # Wrap index
 
@@ -117,10 +124,10 @@
     testb   %al, %al                        # Check return value
     jnz     \dupl
 
-    leal    -1(%r15d), %r14d                # Clear rightmost set bit
-    andl    %r14d, %r15d
-    tzcntl  %r15d, %r14d                    # Vector offset of next match
-    jnc     \label
+    leaq    -1(%r15), %r14                  # Clear rightmost set bit
+    andq    %r14, %r15
+    vctzq   \sse2, \avx2, \avx512, %r15, %r14 # Vector offset of next match
+    vjnz    \sse2, \avx2, \avx512, \label
 .endm
 
 # Actual probing logic
@@ -134,13 +141,16 @@
 # Params:
 #   \pwr2: 1 if element size is a power of 2, 0 otherwise
 #   \map:  1 if probing a map, 0 if probing a table
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
 #
 # Return:
 #   %rax: Index of slot, or -1 if element
-#         is already present
-.macro hash_find_probe pwr2, map
+#         is not found
+.macro hash_find_probe pwr2, map, sse2, avx2, avx512
 .if \pwr2
-    tzcntq  %rdx, %rdx                      # Element size power of 2, use bit index for efficient mult
+    bsfq    %rdx, %rdx                      # Element size power of 2, use bit index for efficient mult
 .endif
 
     movq    %rcx, %rax                      # Compute slot
@@ -149,50 +159,44 @@
     leaq    -1(%r10), %r10
     andq    %r10, %rax
 
-    shrq    $57, %rcx                       # Broadcast high 7 bits of hash to %ymm15
+    shrq    $57, %rcx                       # Broadcast high 7 bits of hash to v15
     orl     $0x80, %ecx                     # Set high bit for comparison with occupied slots
-    vmovd   %ecx, %xmm0
-    vpbroadcastb    %xmm0, %ymm15
-
-    vpxor   %ymm14, %ymm14, %ymm14          # All zeroes
+    vbcastmd    \sse2, \avx2, \avx512, %ecx
+    vconsts \sse2, \avx2, \avx512
 
     movq    mdoff(%rdi), %r11               # Load ht_mdoff
     leaq    (%rax, %r11), %rcx              # Offset of metadata entry relative base
 
-    vmovdqu (%rdi, %rcx), %ymm0             # Load ymmword's worth of metadata
-
-    vpcmpeqb    %ymm0, %ymm15, %ymm1        # All ones for occupied with match
-    vpmovmskb   %ymm1, %ecx                 # Extract bitmask
+    vldmd   \sse2, \avx2, \avx512, %rdi, %rcx # Load vector's worth of metadata
+    vmskeq  \sse2, \avx2, \avx512, %rcx     # Bitmask of occupied with match
+    vmskz   \sse2, \avx2, \avx512, %r8      # Bitmask of probe ends
 
-    vpcmpeqb    %ymm0, %ymm14, %ymm2        # All ones for probe end
-    vpmovmskb   %ymm2, %r8d                 # Extract bitmask
-
-    testl   %r8d, %r8d                      # Check for probe end
+    testq   %r8, %r8                        # Check for probe end
     jz      8f
 
-    isolssbl    %r8d, %r9d                  # Isolate rightmost set bit
-    leal    -1(%r9d), %r9d
-    andl    %r9d, %ecx                      # Mask out matches beyond probe end
+    isolssbq    %r8, %r9                    # Isolate rightmost set bit
+    leaq    -1(%r8), %r9
+    andq    %r9, %rcx                       # Mask out matches beyond probe end
     jz      1f
 
     framesetup                              # Prepare frame for eq calls
-    tzcntl  %r15d, %r14d                    # Vector offset of first match
+    vctzq   \sse2, \avx2, \avx512, %r15, %r14 # Vector offset of first match
 
 0: # Match exists, probe end in vector
-    eqloop  \pwr2, \map, 0b, 2f
+    eqloop  \pwr2, \map, \sse2, \avx2, \avx512, 0b, 2f
 
     framerst
 
 1: # No match
     movq    $-1, %rax
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 
 2: # Match found
     leaq    (%rbx, %r14), %rax              # Element index
     wrapq   %rbp, %rax, %rcx                # Wrap
     framerst
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 
 8: # No probe end
@@ -203,36 +207,32 @@
     movzbl  (%rdi, %r9), %r11d              # Preserve metadata entry
 
     movb    $0, (%rdi, %r9)                 # Ensure probe end exists
-    cmpq    $vecsize, %r8                   # Check if entry is mirrored
+    cmpq    $guardsz, %r8                   # Check if entry is mirrored
     jnb     6f
 
     leaq    1(%r9, %r10), %r10              # Offset of mirrored entry
     movb    $0, (%rdi, %r10)                # Clear mirrored entry
 
-    testl   %ecx, %ecx                      # Check for match
+    testq   %rcx, %rcx                      # Check for match
     jnz     9f
 
 7: # No probe end, no match
-    leaq    0x20(%rax), %rax                # Advance and wrap
+    vadv    \sse2, \avx2, \avx512, %rax     # Advance and wrap
     wrapq   %rdi, %rax, %rcx
 
     movq    mdoff(%rdi), %r10               # Load ht_mdoff
     leaq    (%rax, %r10), %rcx              # Offset of metadata entry relative base
 
-    vmovdqu (%rdi, %rcx), %ymm0             # Load ymmword's worth of metadata
-
-    vpcmpeqb    %ymm0, %ymm15, %ymm1        # All ones for occupied with match
-    vpmovmskb   %ymm1, %ecx                 # Extract bitmask
-
-    vpcmpeqb    %ymm0, %ymm14, %ymm2        # All ones for probe end
-    vpmovmskb   %ymm2, %r8d                 # Extract bitmask
+    vldmd   \sse2, \avx2, \avx512, %rdi, %rcx # Load vector's worth of metadata
+    vmskeq  \sse2, \avx2, \avx512, %rcx     # Bitmask of occupied with match
+    vmskz   \sse2, \avx2, \avx512, %r8      # Bitmask of probe ends
 
-    testl   %r8d, %r8d                      # Check for probe end
+    testq   %r8, %r8                        # Check for probe end
     jz      6f
 
-    isolssbl    %r8d, %r10d                 # Isolate rightmost set bit
-    leal    -1(%r10d), %r10d
-    andl    %r10d, %ecx                     # Mask out matches beyond probe end
+    isolssbq    %r8, %r10                   # Isolate rightmost set bit
+    leaq    -1(%r8), %r10
+    andq    %r10, %rcx                      # Mask out matches beyond probe end
     jnz     5f
 
     movq    $-1, %rax                       # No match
@@ -241,7 +241,7 @@
 
     movq    mdoff(%rdi), %rsi               # Offset of metadata
 
-    leaq    vecsize(%rsi), %rdx             # Check if entry is duplicated in guard
+    leaq    guardsz(%rsi), %rdx             # Check if entry is duplicated in guard
     cmpq    %rdx, %r9
     jnb     0f
 
@@ -250,11 +250,11 @@
 
     movb    %r11b, (%rdi, %rcx)
 0:
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 
 6: # No probe end
-    testl   %ecx, %ecx                      # Check for match
+    testq   %rcx, %rcx                      # Check for match
     jz      7b
 9: # No probe end, match exists
     framesetup                              # Must call eq
@@ -263,46 +263,41 @@
     orq     %r11, %r9
     movq    %r9, 0x30(%rsp)                 # Write to stack
 
-    vmovdqu %ymm15, 0x38(%rsp)              # Preserve broadcasted hash
+    vspill  \sse2, \avx2, \avx512, 0x38     # Preserve broadcasted hash
 
-    tzcntl  %r15d, %r14d                    # Vector index of first match
+    vctzq   \sse2, \avx2, \avx512, %r15, %r14 # Vector index of first match
 
 0: # No probe end, match exists
-    eqloop  \pwr2, \map, 0b, 4f
+    eqloop  \pwr2, \map, \sse2, \avx2, \avx512, 0b, 4f
 
-    vmovdqu 0x38(%rsp), %ymm15              # Restore hash
-    vpxor   %ymm14, %ymm14, %ymm14          # All zeroes
+    vfill   \sse2, \avx2, \avx512, 0x38     # Restore hash
 
 1:
-    leaq    0x20(%rbx), %rbx                # Advance
+    vadv    \sse2, \avx2, \avx512, %rbx     # Advance
     wrapq   %rbp, %rbx, %rcx
 
     movq    mdoff(%rbp), %rdi               # Load ht_mdoff
     leaq    (%rbx, %rdi), %rcx              # Offset of metadata entry relative base
 
-    vmovdqu (%rbp, %rcx), %ymm0             # Load ymmword's worth of metadata
-
-    vpcmpeqb    %ymm0, %ymm15, %ymm1        # All ones for occupied with match
-    vpmovmskb   %ymm1, %r15d                # Extract bitmask
-
-    vpcmpeqb    %ymm0, %ymm14, %ymm2        # All ones for probe end
-    vpmovmskb   %ymm2, %r8d                 # Extract bitmask
+    vldmd   \sse2, \avx2, \avx512, %rbp, %rcx # Load vector's worth of metadata
+    vmskeq  \sse2, \avx2, \avx512, %r15     # Bitmask of occupied with match
+    vmskz   \sse2, \avx2, \avx512, %r8      # Bitmask of probe ends
 
-    testl   %r8d, %r8d                      # Check for probe end
+    testq   %r8, %r8                        # Check for probe end
     jnz     3f
 
-    tzcntl  %r15d, %r14d                    # Vector index of match
-    jnc     0b
+    vctzq   \sse2, \avx2, \avx512, %r15, %r14 # Vector index of match
+    vjnz    \sse2, \avx2, \avx512, 0b
 
     jmp     1b
 
 3: # Probe end in vector
-    isolssbl    %r8d, %r9d                  # Isolate rightmost set bit
-    leal    -1(%r9d), %r9d
-    andl    %r9d, %r15d                     # Mask out matches beyond probe end
+    isolssbq    %r8, %r9                    # Isolate rightmost set bit
+    leaq    -1(%r8), %r9
+    andq    %r9, %r15                       # Mask out matches beyond probe end
     jz      3f
 
-    tzcntl  %r15d, %r14d                    # Vector offset of match
+    vctzq   \sse2, \avx2, \avx512, %r15, %r14 # Vector offset of match
     jmp     0f
 
 5: # Probe end and match in vector
@@ -312,9 +307,9 @@
     orq     %r11, %r9
     movq    %r9, 0x30(%rsp)                 # Write to stack
 
-    tzcntl  %r15d, %r14d                    # Vector index of first match
+    vctzq   \sse2, \avx2, \avx512, %r15, %r14 # Vector index of first match
 0:
-    eqloop  \pwr2, \map, 0b, 4f
+    eqloop  \pwr2, \map, \sse2, \avx2, \avx512, 0b, 4f
 
 3:
     movq    0x30(%rsp), %rcx                # Restore metadata
@@ -328,7 +323,7 @@
     movb    %dl, (%rbp, %rcx)               # Restore metadata offset
 
     movq    mdoff(%rbp), %rbx               # Offset of metadata relative base
-    leaq    vecsize(%rbx), %rbx
+    leaq    guardsz(%rbx), %rbx
 
     cmpq    %rbx, %rcx                      # Check if entry is duplicated in guard
     jnb     0f
@@ -340,7 +335,7 @@
 0:
     framerst                                # Restore frame
     movq    $-1, %rax                       # No match
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 
 4:
@@ -358,7 +353,7 @@
     movb    %dl, (%rbp, %rcx)               # Restore metadata offset
 
     movq    mdoff(%rbp), %rbx               # Offset of metadata relative base
-    leaq    vecsize(%rbx), %rbx
+    leaq    guardsz(%rbx), %rbx
 
     cmpq    %rbx, %rcx                      # Check if entry is duplicated in guard
     jnb     4f
@@ -369,7 +364,7 @@
     movb    %dl, (%rbp, %rdi)               # Restore guard entry
 4:
     framerst                                # Restore stack
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 .endm
 
@@ -1,7 +1,14 @@
 #ifndef HASH_INSERT_PROBE_H
 #define HASH_INSERT_PROBE_H
 
+#include <scc/config.h>
+
+#ifndef SCC_HWVEC_MAXSIZE
+#error "SCC_HWVEC_MAXSIZE determines the guard size shared with the C code"
+#endif
+
 #include "isolssb.h"
+#include "vecmask.h"
 
 # Wrap index of slot computation
 #
@@ -38,7 +45,7 @@
 .macro framesetup
     subq    $framesz, %rsp                  # Make space and align rsp
     movq    %r15, 0x28(%rsp)                # Use non-scratch registers to preserve data across calls
-    movl    %r8d, %r15d                     # Hash match mask
+    movq    %r8, %r15                       # Hash match mask
 
     movq    %r14, 0x20(%rsp)
     movq    %rcx, %r14                      # Vacant or vacant mask
@@ -68,10 +75,10 @@
 .endm
 
 # Main eq loop. Calls eq # on each slot whose
-# corresponding bit is set in %r15d.
+# corresponding bit is set in %r15.
 #
 # Prerequisites:
-#   %r9d: 0-based index of low bit in %r15d (i.e. tzcntl %r15d, %r9d)
+#   %r9:  0-based index of low bit in %r15 (i.e. tzcntq %r15, %r9)
 #   %rbx: Slot index
 #   %rbp: Container base address
 #   %r12: Element size (or log2(element size) if \pwr2 == 1)
@@ -86,7 +93,7 @@
 #
 # Return:
 #   -
-.macro eqloop pwr2, map, label, dupl
+.macro eqloop pwr2, map, sse2, avx2, avx512, label, dupl
     leaq    (%rbx, %r9), %rax               # Array index
     wrapq   %rbp, %rax, %rcx                # Wrap index
 
@@ -118,10 +125,10 @@
     testb   %al, %al                        # Check return value
     jnz     \dupl
 
-    leal    -1(%r15d), %r8d                 # Clear rightmost set bit
-    andl    %r8d, %r15d
-    tzcntl  %r15d, %r9d                     # Vector index of next matching slot
-    jnc     \label                          # Loop if more matches
+    leaq    -1(%r15), %r8                   # Clear rightmost set bit
+    andq    %r8, %r15
+    vctzq   \sse2, \avx2, \avx512, %r15, %r9 # Vector index of next matching slot
+    vjnz    \sse2, \avx2, \avx512, \label   # Loop if more matches
 .endm
 
 # The actual probing logic. The capacity of the container
@@ -137,13 +144,16 @@
 # Params:
 #   \pwr2: 1 if element size is a power of 2, 0 otherwise
 #   \map:  1 if probing a hash map, 0 if probing a hash table
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
 #
 # Return:
 #   %rax: Index of slot, or -1 if element
 #         is already present
-.macro hash_insert_probe pwr2, map
+.macro hash_insert_probe pwr2, map, sse2, avx2, avx512
 .if \pwr2
-    tzcntq  %rdx, %rdx                      # Element size power of 2, use bit index for efficient mult
+    bsfq    %rdx, %rdx                      # Element size power of 2, use bit index for efficient mult
 .endif
 
     movq    %rcx, %rax                      # Compute slot
@@ -152,61 +162,51 @@
     subq    $1, %r11                        # Wrap index
     andq    %r11, %rax
 
-    shrq    $57, %rcx                       # Broadcast high 7 bits of hash to ymm15
+    shrq    $57, %rcx                       # Broadcast high 7 bits of hash to v15
     orl     $0x80, %ecx                     # Set MSB for comparison with occupied slots
-    vmovd   %ecx, %xmm0
-    vpbroadcastb    %xmm0, %ymm15
-
-    vpcmpeqb    %ymm14, %ymm14, %ymm14      # All ones
-    vpxor   %ymm13, %ymm13, %ymm13          # All zeroes
+    vbcastmd    \sse2, \avx2, \avx512, %ecx
+    vconsts \sse2, \avx2, \avx512
 
     movq    mdoff(%rdi), %r10               # Load metadata offset
     leaq    (%rax, %r10), %rcx              # Offset of metadata entry relative base
 
-    vmovdqu (%rdi, %rcx), %ymm0             # Load ymmword's worth of metadata
-
-    vpxor   %ymm0, %ymm14, %ymm1            # MSB 1 for vacant slots
-    vpmovmskb   %ymm1, %ecx                 # Extract bitmask
+    vldmd   \sse2, \avx2, \avx512, %rdi, %rcx # Load vector's worth of metadata
+    vmskvac \sse2, \avx2, \avx512, %rcx     # Bitmask of vacant slots
+    vmskeq  \sse2, \avx2, \avx512, %r8      # Bitmask of occupied with matching hash
+    vmskz   \sse2, \avx2, \avx512, %r9      # Bitmask of probe ends
 
-    vpcmpeqb    %ymm0, %ymm15, %ymm2        # All ones for occupied with matching hash
-
-    vpcmpeqb    %ymm0, %ymm13, %ymm3        # All ones for probe end
-    vpmovmskb   %ymm3, %r9d                 # Extract bitmask
-
-    testl   %r9d, %r9d                      # Check for probe end
+    testq   %r9, %r9                        # Check for probe end
     jz      8f
 
-    isolssbl    %r9d, %r8d                  # Isolate rigthmost 1 bit
-
-    vpmovmskb   %ymm2, %r8d                 # Extract bitmask
+    isolssbq    %r9, %r10                   # Isolate rigthmost 1 bit
 
-    subl    $1, %r9d                        # Create mask
-    andl    %r9d, %r8d                      # Mask out matches beyond probe end
+    subq    $1, %r9                         # Create mask
+    andq    %r9, %r8                        # Mask out matches beyond probe end
     jz      7f
 
     framesetup                              # Must call eq at least once
-    tzcntl  %r8d, %r9d                      # Vector offset of first hash match
+    vctzq   \sse2, \avx2, \avx512, %r8, %r9 # Vector offset of first hash match
 
 0: # At least one match, end (and vacant) in vector
-    eqloop  \pwr2, \map, 0b, 6f             # Equality loop
+    eqloop  \pwr2, \map, \sse2, \avx2, \avx512, 0b, 6f # Equality loop
 
-    tzcntl  %r14d, %edx                     # No match, compute offset in vector
+    vctzq   \sse2, \avx2, \avx512, %r14, %rdx # No match, compute offset in vector
     leaq    (%rbx, %rdx), %rax              # Return value
     wrapq   %rbp, %rax, %rbx
     framerst
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 
 7: # Vacant found
-    tzcntl  %ecx, %edx                      # Offset in vector
+    vctzq   \sse2, \avx2, \avx512, %rcx, %rdx # Offset in vector
     leaq    (%rax, %rdx), %rax
     wrapq   %rdi, %rax, %rcx
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 
 6: # Duplicate found
 .if \map
-    tzcntl  %r15d, %ecx                     # Offset in vector
+    bsfq    %r15, %rcx                      # Offset in vector
     leaq    (%rbx, %rcx), %rax              # Compute and wrap index
     wrapq   %rbp, %rax, %rdi
 
@@ -216,16 +216,14 @@
     movq    $-1, %rax
 .endif
     framerst                                # Restore stack frame
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 
 8: # No probe end
-    vpmovmskb   %ymm2, %r8d                 # Extract bitmask
-
     leaq    -1(%rax), %r9                   # Compute index of entry to be probed last
     andq    %r11, %r9                       # Wrap
 
-    cmpq    $vecsize, %r9                   # Check if duplicate in guard
+    cmpq    $guardsz, %r9                   # Check if duplicate in guard
 
     leaq    (%r10, %r9), %r10               # Offset of metadata element to be probed last
     movzbl  (%rdi, %r10), %r9d              # Load last entry
@@ -236,37 +234,31 @@
     leaq    1(%r10, %r11), %r11             # Offset of guard entry relative base
     movb    $0, (%rdi, %r11)                # Clear entry in guard
 8:
-    testl   %ecx, %ecx                      # Check for vacant
+    testq   %rcx, %rcx                      # Check for vacant
     jnz     7f
 
-    testl   %r8d, %r8d                      # Check for match
+    testq   %r8, %r8                        # Check for match
     jnz     9f
 
 0:
-    leaq    0x20(%rax), %rax                # Advance
+    vadv    \sse2, \avx2, \avx512, %rax     # Advance
     wrapq   %rdi, %rax, %r8
 
     movq    mdoff(%rdi), %r11               # Offset of metadata array
     leaq    (%r11, %rax), %r8               # Offset of metadata entry
 
-    vmovdqu (%rdi, %r8), %ymm0              # Load ymmword
-
-    vpxor   %ymm0, %ymm14, %ymm1            # High bit set for vacant
-    vpmovmskb   %ymm1, %ecx                 # Extract bitmask
+    vldmd   \sse2, \avx2, \avx512, %rdi, %r8 # Load metadata
+    vmskvac \sse2, \avx2, \avx512, %rcx     # Bitmask of vacant slots
+    vmskeq  \sse2, \avx2, \avx512, %r8      # Bitmask of hash matches
+    vmskz   \sse2, \avx2, \avx512, %r11     # Bitmask of probe ends
 
-    vpcmpeqb    %ymm0, %ymm15, %ymm2        # All ones for hash match
-    vpmovmskb   %ymm2, %r8d                 # Bitmask
-
-    vpcmpeqb    %ymm0, %ymm13, %ymm3        # All ones for probe end
-    vpmovmskb   %ymm3, %r11d                # Bitmask
-
-    testl   %r11d, %r11d                    # Check for probe end
+    testq   %r11, %r11                      # Check for probe end
     jnz     8b
 
-    testl   %ecx, %ecx                      # Check for vacant
+    testq   %rcx, %rcx                      # Check for vacant
     jnz     7f
 
-    testl   %r8d, %r8d                      # Check for match
+    testq   %r8, %r8                        # Check for match
     jz      0b
 
 9: # Match, no vacant
@@ -275,46 +267,38 @@
     orq     %r10, %r9
     movq    %r9, 0x30(%rsp)                 # End byte and offset to stack
 
-    vmovdqu %ymm15, 0x38(%rsp)              # Preserve broadcasted hash mask
+    vspill  \sse2, \avx2, \avx512, 0x38     # Preserve broadcasted hash mask
 
 8:
-    tzcntl  %r15d, %r9d                     # Vector offset of first match
+    vctzq   \sse2, \avx2, \avx512, %r15, %r9 # Vector offset of first match
 0:
-    eqloop  \pwr2, \map, 0b, 1f
+    eqloop  \pwr2, \map, \sse2, \avx2, \avx512, 0b, 1f
 
-    vmovdqu 0x38(%rsp), %ymm15              # Restore broadcasted hash
-    vpcmpeqb    %ymm14, %ymm14, %ymm14      # All ones
-    vpxor   %ymm13, %ymm13, %ymm13          # All zeroes
+    vfill   \sse2, \avx2, \avx512, 0x38     # Restore broadcasted hash
 
 5:
-    leaq    0x20(%rbx), %rbx                # Advance
+    vadv    \sse2, \avx2, \avx512, %rbx     # Advance
     wrapq   %rbp, %rbx, %rcx
 
     movq    mdoff(%rbp), %r8                # Offset of metadata array relative base
     leaq    (%r8, %rbx), %rax               # Offset of slot relative base
 
-    vmovdqu (%rbp, %rax), %ymm0             # Load metadata
-
-    vpxor   %ymm0, %ymm14, %ymm1            # High bit set for vacant
-    vpmovmskb   %ymm1, %r14d                # Extract bitmask
-
-    vpcmpeqb    %ymm0, %ymm15, %ymm2        # All ones for hash match
-    vpmovmskb   %ymm2, %r15d                # Bitmask
-
-    vpcmpeqb    %ymm0, %ymm13, %ymm3        # All ones for probe end
-    vpmovmskb   %ymm3, %r8d                 # Bitmask
+    vldmd   \sse2, \avx2, \avx512, %rbp, %rax # Load metadata
+    vmskvac \sse2, \avx2, \avx512, %r14     # Bitmask of vacant slots
+    vmskeq  \sse2, \avx2, \avx512, %r15     # Bitmask of hash matches
+    vmskz   \sse2, \avx2, \avx512, %r8      # Bitmask of probe ends
 
-    testl   %r8d, %r8d                      # Check for probe end
+    testq   %r8, %r8                        # Check for probe end
     jz      3f
 
-    isolssbl    %r8d, %ecx                  # Isolate rigthmost 1 bit
-    subl    $1, %r8d                        # Create mask
-    andl    %r8d, %r15d                     # Mask out matches beyond probe end
+    isolssbq    %r8, %rcx                   # Isolate rigthmost 1 bit
+    subq    $1, %r8                         # Create mask
+    andq    %r8, %r15                       # Mask out matches beyond probe end
     jz      4f
 
-    tzcntl  %r15d, %r9d                     # Vector index of first match
+    vctzq   \sse2, \avx2, \avx512, %r15, %r9 # Vector index of first match
 2:
-    eqloop  \pwr2, \map, 2b, 1f
+    eqloop  \pwr2, \map, \sse2, \avx2, \avx512, 2b, 1f
 
 4: # End in vector, no match
     movq    0x30(%rsp), %rax                # End byte and offset
@@ -329,7 +313,7 @@
     movb    %dl, (%rdi)                     # Restore metadata byte
 
     movq    mdoff(%rbp), %rsi               # Metadata offset
-    leaq    vecsize(%rbp, %rsi), %rax       # Offset of first duplicated byte
+    leaq    guardsz(%rbp, %rsi), %rax       # Offset of first byte not duplicated
 
     cmpq    %rax, %rdi                      # Check if byte was duplicated
     jnb     4f
@@ -337,54 +321,50 @@
     movq    cap(%rbp), %rsi                 # Capacity
     movb    %dl, (%rdi, %rsi)               # Restore byte in guard
 4:
-    tzcntl  %r14d, %r9d                     # Index in vector
+    vctzq   \sse2, \avx2, \avx512, %r14, %r9 # Index in vector
     leaq    (%rbx, %r9), %rax
     wrapq   %rbp, %rax, %rcx
 
     framerst
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 
 2: # No vacant
-    tzcntl  %r15d, %r9d                     # Index in vector
-    jc      5b
+    vctzq   \sse2, \avx2, \avx512, %r15, %r9 # Index in vector
+    vjz     \sse2, \avx2, \avx512, 5b
     jmp     0b
 
 3: # No probe end
-    testl   %r14d, %r14d                    # Check for vacant
+    testq   %r14, %r14                      # Check for vacant
     jz      2b
 5:
-    tzcntl  %r14d, %ecx                     # Vector offset of vacant
+    vctzq   \sse2, \avx2, \avx512, %r14, %rcx # Vector offset of vacant
     leaq    (%rbx, %rcx), %r14              # Index
     wrapq   %rbp, %r14, %rcx
     jmp     5f
 
 6: # Vacant found, no probe end, no match
-    leaq    0x20(%rax), %rax                # Advance and wrap
+    vadv    \sse2, \avx2, \avx512, %rax     # Advance and wrap
     wrapq   %rdi, %rax, %r8
 
     movq    mdoff(%rdi), %r8                # Offset of metadata relative base
     leaq    (%r8, %rax), %r11               # Offset of entry relative base
 
-    vmovdqu (%rdi, %r11), %ymm0             # Load metadata
+    vldmd   \sse2, \avx2, \avx512, %rdi, %r11 # Load metadata
+    vmskeq  \sse2, \avx2, \avx512, %r8      # Bitmask of hash matches
+    vmskz   \sse2, \avx2, \avx512, %r11     # Bitmask of probe ends
 
-    vpcmpeqb    %ymm0, %ymm15, %ymm1        # All ones for matching hash
-    vpmovmskb   %ymm1, %r8                  # Extract bitmask
-
-    vpcmpeqb    %ymm0, %ymm13, %ymm2        # All ones for probe end
-    vpmovmskb   %ymm2, %r11                 # Extract bitmask
-
-    testl   %r11d, %r11d                    # Check for probe end
+    testq   %r11, %r11                      # Check for probe end
     jz      8f
 
-    testl   %r8d, %r8d                      # Check for match
+    testq   %r8, %r8                        # Check for match
     jnz     8f
 
     movq    %rcx, %rax                      # Return value
     movb    %r9b, (%rdi, %r10)              # Restore metadata entry
 
     movq    mdoff(%rdi), %rsi               # Offset of metadata
-    leaq    vecsize(%rsi), %rsi             # Offset of first byte not mirrored
+    leaq    guardsz(%rsi), %rsi             # Offset of first byte not mirrored
 
     movq    cap(%rdi), %rdx
     leaq    (%r10, %rdx), %rdx
@@ -393,15 +373,15 @@
     cmovbq  %rdx, %r10
 
     movb    %r9b, (%rdi, %r10)
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     retq
 
 7: # Vacant found, no probe end
-    tzcntl  %ecx, %r11d                     # Vector offset
+    vctzq   \sse2, \avx2, \avx512, %rcx, %r11 # Vector offset
     leaq    (%rax, %r11), %rcx              # Index of vacant
     wrapq   %rdi, %rcx, %r11
 
-    testl   %r8d, %r8d                      # Check for match
+    testq   %r8, %r8                        # Check for match
     jz  6b
 
 8:
@@ -411,39 +391,34 @@
     orq     %r10, %r9
     movq    %r9, 0x30(%rsp)                 # End byte and offset to stack
 
-    vmovdqu %ymm15, 0x38(%rsp)              # Preserve broadcasted hash mask
+    vspill  \sse2, \avx2, \avx512, 0x38     # Preserve broadcasted hash mask
 
 5:
-    tzcntl  %r15d, %r9d                     # Vector offset of first match
-    jc      6f
+    vctzq   \sse2, \avx2, \avx512, %r15, %r9 # Vector offset of first match
+    vjz     \sse2, \avx2, \avx512, 6f
 0:
-    eqloop  \pwr2, \map, 0b, 1f
+    eqloop  \pwr2, \map, \sse2, \avx2, \avx512, 0b, 1f
 
-    vmovdqu 0x38(%rsp), %ymm15              # Restore broadcasted hash
-    vpxor   %ymm13, %ymm13, %ymm13          # All zeroes
+    vfill   \sse2, \avx2, \avx512, 0x38     # Restore broadcasted hash
 6:
-    leaq    0x20(%rbx), %rbx                # Advance and wrap
+    vadv    \sse2, \avx2, \avx512, %rbx     # Advance and wrap
     wrapq   %rbp, %rbx, %rcx
 
     movq    mdoff(%rbp), %rdi               # Offset of metadata array relative base
     leaq    (%rdi, %rbx), %rsi              # Offset of metadata entry relative base
 
-    vmovdqu (%rbp, %rsi), %ymm0             # Load metadata
-
-    vpcmpeqb    %ymm0, %ymm15, %ymm1        # All ones for occupied with matching hash
-    vpmovmskb   %ymm1, %r15d                # Extract bitmask
-
-    vpcmpeqb    %ymm0, %ymm13, %ymm2        # All ones for probe end
-    vpmovmskb   %ymm2, %r9d                 # Extract bitmask
+    vldmd   \sse2, \avx2, \avx512, %rbp, %rsi # Load metadata
+    vmskeq  \sse2, \avx2, \avx512, %r15     # Bitmask of occupied with matching hash
+    vmskz   \sse2, \avx2, \avx512, %r9      # Bitmask of probe ends
 
-    testl   %r9d, %r9d                      # Check for probe end
+    testq   %r9, %r9                        # Check for probe end
     jz      5b
 
-    tzcntl  %r15d, %r9d                     # Offset of first match in vector
-    jc      6f
+    vctzq   \sse2, \avx2, \avx512, %r15, %r9 # Offset of first match in vector
+    vjz     \sse2, \avx2, \avx512, 6f
 
 0: # Last eq iteration
-    eqloop  \pwr2, \map, 0b, 1f
+    eqloop  \pwr2, \map, \sse2, \avx2, \avx512, 0b, 1f
 
 6: # No match, index in %r14
     movq    0x30(%rsp), %rax                # End byte and offset
@@ -458,7 +433,7 @@
     movb    %dl, (%rdi)                     # Restore metadata byte
 
     movq    mdoff(%rbp), %rsi               # Metadata offset
-    leaq    vecsize(%rbp, %rsi), %rax       # Offset of first duplicated byte
+    leaq    guardsz(%rbp, %rsi), %rax       # Offset of first byte not duplicated
 
     cmpq    %rax, %rdi                      # Check if byte was duplicated
     jnb     4f
@@ -468,7 +443,7 @@
 4:
     movq    %r14, %rax                      # Return value
     framerst                                # Restore stack
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     ret
 
 1: # Duplicate found
@@ -484,7 +459,7 @@
     movb    %dl, (%rdi)                     # Restore metadata byte
 
     movq    mdoff(%rbp), %rsi               # Metadata offset
-    leaq    vecsize(%rbp, %rsi), %rax       # Offset of first duplicated byte
+    leaq    guardsz(%rbp, %rsi), %rax       # Offset of first byte not duplicated
 
     cmpq    %rax, %rdi                      # Check if byte was duplicated
     jnb     4f
@@ -493,7 +468,7 @@
     movb    %dl, (%rdi, %rsi)               # Restore byte in guard
 4:
 .if \map
-    tzcntl  %r15d, %ecx                     # Offset in vector
+    bsfq    %r15, %rcx                      # Offset in vector
     leaq    (%rbx, %rcx), %rax              # Return value
     wrapq   %rbp, %rax, %rdi
 
@@ -503,7 +478,7 @@
     movq    $-1, %rax
 .endif
     framerst                                # Restore stack
-    vzeroupper
+    vzupper \sse2, \avx2, \avx512
     ret
 .endm
 
@@ -0,0 +1,155 @@
+#ifndef HASH_SHARED_PROBE_H
+#define HASH_SHARED_PROBE_H
+
+#include "isolssb.h"
+#include "vecmask.h"
+
+# Probing of hash maps read by several threads at once. Unlike
+# hash_find_probe, no sentinel is written to the metadata to
+# bound the probe, nor is the key copied to hm_curr. The probe
+# instead stops after having wrapped around to the start slot,
+# meaning that nothing but the stack is ever written to. The
+# perf counters are left untouched for the same reason.
+#
+# Stack frame:
+#   0x00(%rsp): Spilled broadcasted hash, up to a zmmword
+#   0x40(%rsp): Start slot
+#   0x48(%rsp): Slot passed to the most recent eq call
+#
+# Register usage:
+#   %rbx: Slot index of current vector
+#   %rbp: Base address of hash map
+#   %r12: Address of key array
+#   %r13: Address of key being probed for
+#   %r14: Key size
+#   %r15: Bitmask of matching hashes
+
+# Call eq on each slot whose corresponding bit is set in %r15
+#
+# Prerequisites:
+#   %r15: Non-zero bitmask of hash matches
+#
+# Params:
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
+#   \match:  Label to jump to on equal keys
+#
+# Return:
+#   0x48(%rsp): Index of slot holding the key if jumping to \match
+.macro sharedeq sse2, avx2, avx512, match
+    vspill  \sse2, \avx2, \avx512, 0x00     # Vector registers clobbered by eq
+0:
+    vctzq   \sse2, \avx2, \avx512, %r15, %rax # Vector offset of match
+    addq    %rbx, %rax                      # Wrap index
+    movq    cap(%rbp), %rcx
+    subq    $1, %rcx
+    andq    %rcx, %rax
+    movq    %rax, 0x48(%rsp)
+
+    imulq   %r14, %rax                      # Address of key in slot
+    leaq    (%r12, %rax), %rdi
+    movq    %r13, %rsi                      # Address of key being probed for
+    call    *(%rbp)                         # Call eq
+
+    testb   %al, %al
+    jnz     \match
+
+    leaq    -1(%r15), %rax                  # Clear rightmost set bit
+    andq    %rax, %r15
+    jnz     0b
+    vfill   \sse2, \avx2, \avx512, 0x00     # Restore hash and constants
+.endm
+
+# Probe for key in hash map read by several threads at once
+#
+# Prerequisites:
+#   %rdi: Base address of hash map
+#   %rsi: Address of hm_curr
+#   %rdx: Address of key
+#   %rcx: Key size
+#   %r8:  Hash of key
+#
+# Params:
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
+#
+# Return:
+#   %rax: Index of slot, or -1 if not found
+.macro hashmap_find_shared sse2, avx2, avx512
+    pushq   %rbp                            # Preserve non-scratch registers
+    pushq   %rbx
+    pushq   %r12
+    pushq   %r13
+    pushq   %r14
+    pushq   %r15
+    subq    $shframesz, %rsp                # Make space and align rsp
+
+    movq    %rdi, %rbp                      # Base address
+    movq    pairsz(%rdi), %r12              # Address of key array
+    addq    %rsi, %r12
+    movq    %rdx, %r13                      # Address of key
+    movq    %rcx, %r14                      # Key size
+
+    movq    %r8, %rbx                       # Compute start slot
+    movq    cap(%rbp), %rcx
+    subq    $1, %rcx
+    andq    %rcx, %rbx
+    movq    %rbx, 0x40(%rsp)
+
+    shrq    $57, %r8                        # Broadcast high 7 bits of hash to v15
+    orl     $0x80, %r8d                     # Set high bit for comparison with occupied slots
+    vbcastmd    \sse2, \avx2, \avx512, %r8d
+    vconsts \sse2, \avx2, \avx512
+
+1: # Probe vector
+    movq    mdoff(%rbp), %rcx               # Offset of metadata entry relative base
+    addq    %rbx, %rcx
+    vldmd   \sse2, \avx2, \avx512, %rbp, %rcx # Load vector's worth of metadata
+    vmskeq  \sse2, \avx2, \avx512, %r15     # Bitmask of occupied with match
+    vmskz   \sse2, \avx2, \avx512, %r8      # Bitmask of probe ends
+
+    testq   %r8, %r8                        # Check for probe end
+    jnz     3f
+
+    testq   %r15, %r15                      # Check for match
+    jz      2f
+    sharedeq \sse2, \avx2, \avx512, 4f
+
+2: # No probe end
+    vadv    \sse2, \avx2, \avx512, %rbx     # Advance and wrap
+    movq    cap(%rbp), %rcx
+    subq    $1, %rcx
+    andq    %rcx, %rbx
+    cmpq    0x40(%rsp), %rbx                # Check for start slot
+    jne     1b
+    jmp     5f
+
+3: # Probe end in vector
+    isolssbq    %r8, %r9                    # Isolate rightmost set bit
+    leaq    -1(%r8), %r9
+    andq    %r9, %r15                       # Mask out matches beyond probe end
+    jz      5f
+    sharedeq \sse2, \avx2, \avx512, 4f
+    jmp     5f
+
+4: # Match found
+    movq    0x48(%rsp), %rax
+    jmp     6f
+
+5: # No match
+    movq    $-1, %rax
+6:
+    addq    $shframesz, %rsp                # Restore registers
+    popq    %r15
+    popq    %r14
+    popq    %r13
+    popq    %r12
+    popq    %rbx
+    popq    %rbp
+    vzupper \sse2, \avx2, \avx512
+    retq
+.endm
+
+#endif /* HASH_SHARED_PROBE_H */
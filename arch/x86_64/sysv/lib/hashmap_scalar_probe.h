@@ -0,0 +1,298 @@
+#ifndef HASHMAP_SCALAR_PROBE_H
+#define HASHMAP_SCALAR_PROBE_H
+
+#include "isolssb.h"
+#include "vecmask.h"
+
+# Probing of hash maps whose keys are integers or pointers, i.e.
+# maps created using scc_hashmap_new_scalar. Keys are compared
+# inline rather than through hm_eq, meaning that the kernels
+# never call out and get by without a stack frame.
+#
+# A key of n bytes is compared by loading 8 bytes, xoring with
+# the key being probed for and shifting out the 64 - 8n most
+# significant bits. For 8-byte keys, the shift count is 0 and
+# the flags set by the xor are left untouched. The load may
+# read past the end of the key but never past the end of the
+# map, as the keys are always followed by values and metadata
+#
+# Register usage:
+#   %rax: Slot index of current vector
+#   %rcx: Shift count for key comparison in %cl
+#   %rdx: Key size
+#   %rsi: Address of key array
+#   %rdi: Base address of hash map
+#   %r8:  Bitmask of matching hashes
+#   %r9:  Key being probed for, 8 bytes
+#   %r10: Scratch
+#   %r11: Scratch
+
+# Set up registers for probing
+#
+# Prerequisites:
+#   %rdi: Base address of hash map
+#   %rsi: Address of hm_curr
+#   %rdx: Key size
+#   %rcx: Hash of hm_curr->hp_key
+#
+# If \shared is 1, the key is probed for in place instead:
+#   %rdi: Base address of hash map
+#   %rsi: Address of hm_curr
+#   %rdx: Address of key, followed by at least 8 readable bytes
+#   %rcx: Key size
+#   %r8:  Hash of key
+#
+# Params:
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
+#   \shared: 1 if the key is passed by address, 0 if in hm_curr
+#
+# Return:
+#   -
+.macro scalarsetup sse2, avx2, avx512, shared=0
+.if \shared
+    movq    (%rdx), %r9                     # Key being probed for
+    movq    %rcx, %rdx                      # Key size
+    movq    %r8, %rcx                       # Hash
+.endif
+    movq    %rcx, %rax                      # Compute start slot
+    movq    cap(%rdi), %r10
+    leaq    -1(%r10), %r10
+    andq    %r10, %rax
+    movq    %rax, -0x08(%rsp)               # Store start slot in red zone
+
+    shrq    $57, %rcx                       # Broadcast high 7 bits of hash to v15
+    orl     $0x80, %ecx                     # Set high bit for comparison with occupied slots
+    vbcastmd    \sse2, \avx2, \avx512, %ecx
+    vconsts \sse2, \avx2, \avx512
+
+.if !\shared
+    movq    (%rsi), %r9                     # Key being probed for
+.endif
+    addq    pairsz(%rdi), %rsi              # Address of key array
+
+    leal    (, %rdx, 8), %ecx               # Key size in bits
+    negl    %ecx                            # Shift count, (64 - bits) mod 64
+.endm
+
+# Load vector's worth of metadata and compute
+# bitmasks of hash matches and probe ends
+#
+# Params:
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
+#
+# Return:
+#   %r8:  Bitmask of hash matches
+#   %r10: Bitmask of probe ends
+.macro scalarld sse2, avx2, avx512
+    movq    mdoff(%rdi), %r11               # Offset of metadata entry relative base
+    addq    %rax, %r11
+    vldmd   \sse2, \avx2, \avx512, %rdi, %r11 # Load vector's worth of metadata
+    vmskeq  \sse2, \avx2, \avx512, %r8      # Bitmask of occupied with match
+    vmskz   \sse2, \avx2, \avx512, %r10     # Bitmask of probe ends
+.endm
+
+# Mask out matches beyond the first probe end
+#
+# Prerequisites:
+#   %r8:  Bitmask of hash matches
+#   %r10: Non-zero bitmask of probe ends
+#
+# Sets ZF if no matches remain
+#
+# Return:
+#   %r8: Bitmask of hash matches before the probe end
+.macro scalarend
+    isolssbq    %r10, %r11                  # Isolate rightmost set bit
+    leaq    -1(%r10), %r11
+    andq    %r11, %r8                       # Mask out matches beyond probe end
+.endm
+
+# Compare keys in each slot whose corresponding bit is
+# set in %r8 to the one being probed for
+#
+# Prerequisites:
+#   %r8: Non-zero bitmask of hash matches
+#
+# Params:
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
+#   \match:  Label to jump to on equal keys
+#
+# Return:
+#   %r11: Index of slot holding the key if jumping to \match
+.macro scalareq sse2, avx2, avx512, match
+0:
+    vctzq   \sse2, \avx2, \avx512, %r8, %r11 # Vector offset of match
+    addq    %rax, %r11                      # Wrap index
+    movq    cap(%rdi), %r10
+    subq    $1, %r10
+    andq    %r10, %r11
+
+    movq    %r11, %r10                      # Offset of key
+    imulq   %rdx, %r10
+    movq    (%rsi, %r10), %r10              # Compare keys
+    xorq    %r9, %r10
+    shlq    %cl, %r10
+    jz      \match
+
+    leaq    -1(%r8), %r10                   # Clear rightmost set bit
+    andq    %r10, %r8
+    jnz     0b
+.endm
+
+# Advance to next vector and check whether all slots
+# have been probed
+#
+# Params:
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
+#
+# Sets ZF if back at the start slot
+#
+# Return:
+#   %rax: Slot index of next vector
+.macro scalaradv sse2, avx2, avx512
+    vadv    \sse2, \avx2, \avx512, %rax     # Advance and wrap
+    movq    cap(%rdi), %r10
+    subq    $1, %r10
+    andq    %r10, %rax
+    cmpq    -0x08(%rsp), %rax               # Check for start slot
+.endm
+
+# Probe for key in hash map with scalar keys. Nothing but the
+# red zone is written to, see scalarsetup for the registers
+# expected when \shared is 1
+#
+# Prerequisites:
+#   %rdi: Base address of hash map
+#   %rsi: Address of hm_curr
+#   %rdx: Key size, 1, 2, 4 or 8
+#   %rcx: Hash of hm_curr->hp_key
+#
+# Params:
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
+#   \shared: 1 if the key is passed by address, 0 if in hm_curr
+#
+# Return:
+#   %rax: Index of slot, or -1 if not found
+.macro hashmap_find_scalar sse2, avx2, avx512, shared=0
+    scalarsetup \sse2, \avx2, \avx512, \shared
+
+1: # Probe vector
+    scalarld \sse2, \avx2, \avx512
+    testq   %r10, %r10                      # Check for probe end
+    jnz     3f
+
+    testq   %r8, %r8                        # Check for match
+    jz      2f
+    scalareq \sse2, \avx2, \avx512, 4f
+
+2: # No probe end
+    scalaradv \sse2, \avx2, \avx512
+    jne     1b
+    jmp     5f
+
+3: # Probe end in vector
+    scalarend
+    jz      5f
+    scalareq \sse2, \avx2, \avx512, 4f
+    jmp     5f
+
+4: # Match found
+    movq    %r11, %rax
+    vzupper \sse2, \avx2, \avx512
+    retq
+
+5: # No match
+    movq    $-1, %rax
+    vzupper \sse2, \avx2, \avx512
+    retq
+.endm
+
+# Probe for slot to insert key in, in hash map with scalar keys.
+# The hash map is assumed to have at least two vacant slots.
+#
+# Prerequisites:
+#   %rdi: Base address of hash map
+#   %rsi: Address of hm_curr
+#   %rdx: Key size, 1, 2, 4 or 8
+#   %rcx: Hash of hm_curr->hp_key
+#
+# Params:
+#   \sse2:   1 to probe an xmmword at a time, 0 otherwise
+#   \avx2:   1 to probe a ymmword at a time, 0 otherwise
+#   \avx512: 1 to probe a zmmword at a time, 0 otherwise
+#
+# Return:
+#   %rax: Index of slot. If the key is already present,
+#         its index is returned with the high bit set
+.macro hashmap_insert_scalar sse2, avx2, avx512
+    scalarsetup \sse2, \avx2, \avx512
+    movq    $-1, -0x10(%rsp)                # No vacant slot found yet
+
+1: # Probe vector
+    scalarld \sse2, \avx2, \avx512
+    testq   %r10, %r10                      # Check for probe end
+    jnz     3f
+
+    testq   %r8, %r8                        # Check for match
+    jz      2f
+    scalareq \sse2, \avx2, \avx512, 6f
+
+2: # No probe end
+    cmpq    $-1, -0x10(%rsp)                # Check if vacant slot already found
+    jne     7f
+
+    vmskvac \sse2, \avx2, \avx512, %r10     # Bitmask of vacant slots
+    vctzq   \sse2, \avx2, \avx512, %r10, %r11 # Vector offset of first vacant slot
+    vjz     \sse2, \avx2, \avx512, 7f
+
+    addq    %rax, %r11                      # Wrap index
+    movq    cap(%rdi), %r10
+    subq    $1, %r10
+    andq    %r10, %r11
+    movq    %r11, -0x10(%rsp)               # Store in red zone
+7:
+    scalaradv \sse2, \avx2, \avx512
+    jne     1b
+    jmp     5f
+
+3: # Probe end in vector
+    scalarend
+    jz      4f
+    scalareq \sse2, \avx2, \avx512, 6f
+
+4: # No duplicate
+    cmpq    $-1, -0x10(%rsp)                # Check if vacant slot already found
+    jne     5f
+
+    vmskvac \sse2, \avx2, \avx512, %r10     # Bitmask of vacant slots, non-zero as the probe end is vacant
+    vctzq   \sse2, \avx2, \avx512, %r10, %r11 # Vector offset of first vacant slot
+    addq    %r11, %rax                      # Wrap index
+    movq    cap(%rdi), %r10
+    subq    $1, %r10
+    andq    %r10, %rax
+    vzupper \sse2, \avx2, \avx512
+    retq
+
+5: # Return first vacant slot
+    movq    -0x10(%rsp), %rax
+    vzupper \sse2, \avx2, \avx512
+    retq
+
+6: # Duplicate found
+    movq    $0x8000000000000000, %rax       # Set high bit for duplicate
+    orq     %r11, %rax
+    vzupper \sse2, \avx2, \avx512
+    retq
+.endm
+
+#endif /* HASHMAP_SCALAR_PROBE_H */
@@ -18,5 +18,21 @@
     andl    \r1, \r0
 .endm
 
+# Isolate rightmost 1-bit in non-zero 64-bit
+# register \r0. \r1 is used as scratch
+#
+# Sets ZF if the result is 0
+#
+# Params:
+#   \r0: Register to isolate the rightmost set bit in
+#   \r1: Scratch
+#
+# Return:
+#   \r0: The result of \r0 & ~(\r0 - 1)
+.macro isolssbq  r0, r1
+    leaq    -1(\r0), \r1
+    notq    \r1
+    andq    \r1, \r0
+.endm
 
 #endif /* ISOLSSB_H */
@@ -0,0 +1,326 @@
+#ifndef VECMASK_H
+#define VECMASK_H
+
+# Vector operations on metadata shared by the probing
+# kernels. Each macro takes three flags of which exactly
+# one must be set, selecting between xmmwords (\sse2),
+# ymmwords (\avx2) and zmmwords (\avx512). All bitmasks
+# are zero-extended to 64 bits, allowing the surrounding
+# logic to be shared.
+#
+# Register usage:
+#   v0:  Metadata
+#   v1:  Scratch
+#   v2:  Scratch
+#   v13: All zeroes (xmmword and ymmword only)
+#   v14: All ones (xmmword and ymmword only)
+#   v15: Broadcasted hash
+
+# Initialize constant vectors
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#
+# Return:
+#   -
+.macro vconsts  sse2, avx2, avx512
+.if \sse2
+    pcmpeqb %xmm14, %xmm14                  # All ones
+    pxor    %xmm13, %xmm13                  # All zeroes
+.endif
+.if \avx2
+    vpcmpeqb    %ymm14, %ymm14, %ymm14      # All ones
+    vpxor   %ymm13, %ymm13, %ymm13          # All zeroes
+.endif
+.endm
+
+# Broadcast low byte of 32-bit register \r0 to v15
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \r0:     Register holding the byte to broadcast
+#
+# Return:
+#   -
+.macro vbcastmd sse2, avx2, avx512, r0
+.if \sse2
+    movd    \r0, %xmm15
+    punpcklbw   %xmm15, %xmm15              # Byte to word
+    pshuflw $0x00, %xmm15, %xmm15           # Word to low qword
+    pshufd  $0x00, %xmm15, %xmm15           # Dword to xmmword
+.endif
+.if \avx2
+    vmovd   \r0, %xmm0
+    vpbroadcastb    %xmm0, %ymm15
+.endif
+.if \avx512
+    vpbroadcastb    \r0, %zmm15
+.endif
+.endm
+
+# Load vector's worth of metadata to v0
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \base:   Base address
+#   \off:    Offset of first entry relative \base
+#
+# Return:
+#   -
+.macro vldmd    sse2, avx2, avx512, base, off
+.if \sse2
+    movdqu  (\base, \off), %xmm0
+.endif
+.if \avx2
+    vmovdqu (\base, \off), %ymm0
+.endif
+.if \avx512
+    vmovdqu8    (\base, \off), %zmm0
+.endif
+.endm
+
+# Bitmask of entries in v0 equal to the broadcasted hash
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \r0:     64-bit destination register
+#
+# Return:
+#   \r0: Bit i set if entry i matches
+.macro vmskeq   sse2, avx2, avx512, r0
+.if \sse2
+    movdqa  %xmm0, %xmm1
+    pcmpeqb %xmm15, %xmm1
+    pmovmskb    %xmm1, \r0
+.endif
+.if \avx2
+    vpcmpeqb    %ymm0, %ymm15, %ymm1
+    vpmovmskb   %ymm1, \r0
+.endif
+.if \avx512
+    vpcmpeqb    %zmm0, %zmm15, %k1
+    kmovq   %k1, \r0
+.endif
+.endm
+
+# Bitmask of probe ends, i.e. empty entries, in v0
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \r0:     64-bit destination register
+#
+# Return:
+#   \r0: Bit i set if entry i is empty
+.macro vmskz    sse2, avx2, avx512, r0
+.if \sse2
+    movdqa  %xmm0, %xmm2
+    pcmpeqb %xmm13, %xmm2
+    pmovmskb    %xmm2, \r0
+.endif
+.if \avx2
+    vpcmpeqb    %ymm0, %ymm13, %ymm2
+    vpmovmskb   %ymm2, \r0
+.endif
+.if \avx512
+    vptestnmb   %zmm0, %zmm0, %k2
+    kmovq   %k2, \r0
+.endif
+.endm
+
+# Bitmask of vacant entries, i.e. those with the most
+# significant bit cleared, in v0
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \r0:     64-bit destination register
+#
+# Return:
+#   \r0: Bit i set if entry i is vacant
+.macro vmskvac  sse2, avx2, avx512, r0
+.if \sse2
+    movdqa  %xmm0, %xmm1
+    pxor    %xmm14, %xmm1
+    pmovmskb    %xmm1, \r0
+.endif
+.if \avx2
+    vpxor   %ymm0, %ymm14, %ymm1
+    vpmovmskb   %ymm1, \r0
+.endif
+.if \avx512
+    vpmovb2m    %zmm0, %k1
+    kmovq   %k1, \r0
+    notq    \r0
+.endif
+.endm
+
+# Advance slot index by one vector
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \r0:     Register holding the index
+#
+# Return:
+#   \r0: The index advanced by the vector size
+.macro vadv     sse2, avx2, avx512, r0
+.if \sse2
+    leaq    0x10(\r0), \r0
+.endif
+.if \avx2
+    leaq    0x20(\r0), \r0
+.endif
+.if \avx512
+    leaq    0x40(\r0), \r0
+.endif
+.endm
+
+# Spill broadcasted hash to the stack
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \off:    Offset relative %rsp
+#
+# Return:
+#   -
+.macro vspill   sse2, avx2, avx512, off
+.if \sse2
+    movdqu  %xmm15, \off(%rsp)
+.endif
+.if \avx2
+    vmovdqu %ymm15, \off(%rsp)
+.endif
+.if \avx512
+    vmovdqu64   %zmm15, \off(%rsp)
+.endif
+.endm
+
+# Restore broadcasted hash spilled by vspill and
+# reinitialize constant vectors
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \off:    Offset relative %rsp
+#
+# Return:
+#   -
+.macro vfill    sse2, avx2, avx512, off
+.if \sse2
+    movdqu  \off(%rsp), %xmm15
+.endif
+.if \avx2
+    vmovdqu \off(%rsp), %ymm15
+.endif
+.if \avx512
+    vmovdqu64   \off(%rsp), %zmm15
+.endif
+    vconsts \sse2, \avx2, \avx512
+.endm
+
+# Clear upper vector state before returning. Not
+# needed, nor available, for xmmwords
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#
+# Return:
+#   -
+.macro vzupper  sse2, avx2, avx512
+.if \avx2
+    vzeroupper
+.endif
+.if \avx512
+    vzeroupper
+.endif
+.endm
+
+# Count trailing zeroes of 64-bit register \r0. The
+# tzcnt instruction is not part of the x86-64 baseline,
+# xmmword kernels use bsf instead. Use vjz and vjnz for
+# checking whether \r0 was zero
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \r0:     Source register
+#   \r1:     Destination register
+#
+# Return:
+#   \r1: Number of trailing zeroes in \r0, undefined
+#        for zero input
+.macro vctzq    sse2, avx2, avx512, r0, r1
+.if \sse2
+    bsfq    \r0, \r1
+.endif
+.if \avx2
+    tzcntq  \r0, \r1
+.endif
+.if \avx512
+    tzcntq  \r0, \r1
+.endif
+.endm
+
+# Jump to \label if the source of the preceding vctzq was zero
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \label:  Jump target
+#
+# Return:
+#   -
+.macro vjz      sse2, avx2, avx512, label
+.if \sse2
+    jz      \label
+.endif
+.if \avx2
+    jc      \label
+.endif
+.if \avx512
+    jc      \label
+.endif
+.endm
+
+# Jump to \label if the source of the preceding vctzq was non-zero
+#
+# Params:
+#   \sse2:   1 if operating on xmmwords
+#   \avx2:   1 if operating on ymmwords
+#   \avx512: 1 if operating on zmmwords
+#   \label:  Jump target
+#
+# Return:
+#   -
+.macro vjnz     sse2, avx2, avx512, label
+.if \sse2
+    jnz     \label
+.endif
+.if \avx2
+    jnc     \label
+.endif
+.if \avx512
+    jnc     \label
+.endif
+.endm
+
+#endif /* VECMASK_H */
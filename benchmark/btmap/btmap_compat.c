@@ -12,6 +12,25 @@ void *btmap_new(void) {
     return scc_btmap_new_dyn(bm_type, bm_type, compare);
 }
 
+/* Opaque values of the sizes benchmarked */
+struct value32 { unsigned char bytes[32]; };
+struct value128 { unsigned char bytes[128]; };
+struct value512 { unsigned char bytes[512]; };
+
+void *btmap_new_valsize(size_t valsize) {
+    switch(valsize) {
+        case sizeof(struct value32):
+            return scc_btmap_new_dyn(bm_type, struct value32, compare);
+        case sizeof(struct value128):
+            return scc_btmap_new_dyn(bm_type, struct value128, compare);
+        case sizeof(struct value512):
+            return scc_btmap_new_dyn(bm_type, struct value512, compare);
+        default:
+            break;
+    }
+    return 0;
+}
+
 void btmap_free(void *btmap) {
     scc_btmap_free(btmap);
 }
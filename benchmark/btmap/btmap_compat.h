@@ -1,11 +1,14 @@
 #ifndef BTMAP_COMPAT_H
 #define BTMAP_COMPAT_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 void *btmap_new(void);
+void *btmap_new_valsize(size_t valsize);
 void btmap_free(void *btmap);
 
 #ifdef __cplusplus
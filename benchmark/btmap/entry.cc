@@ -13,4 +13,19 @@ BENCHMARK(btmap_find)->
     Setup(btmap_find_setup)->
     Teardown(btmap_find_teardown);
 
+BENCHMARK_TEMPLATE(btmap_find_valsize, 32)->
+    Range(4, 4 << 16)->
+    Setup(btmap_find_valsize_setup<32>)->
+    Teardown(btmap_find_valsize_teardown);
+
+BENCHMARK_TEMPLATE(btmap_find_valsize, 128)->
+    Range(4, 4 << 16)->
+    Setup(btmap_find_valsize_setup<128>)->
+    Teardown(btmap_find_valsize_teardown);
+
+BENCHMARK_TEMPLATE(btmap_find_valsize, 512)->
+    Range(4, 4 << 16)->
+    Setup(btmap_find_valsize_setup<512>)->
+    Teardown(btmap_find_valsize_teardown);
+
 BENCHMARK_MAIN();
@@ -11,8 +11,17 @@ static struct {
     bm_type key;
     bm_type value;
 } *map;
+static void *valmap;
 static std::vector<bm_type> data;
 
+template <std::size_t Valsize>
+struct valsize_pair {
+    bm_type key;
+    struct {
+        unsigned char bytes[Valsize];
+    } value;
+};
+
 void btmap_find_setup(benchmark::State const& state) {
     map = static_cast<decltype(map)>(btmap_new());
     if(!map) {
@@ -21,7 +30,7 @@ void btmap_find_setup(benchmark::State const& state) {
     data = rng::shuffled_iota(state);
     for(auto const v : data) {
         map->key = v;
-        map->key = v + 1;
+        map->value = v + 1;
         scc_btmap_impl_insert(&map);
     }
 }
@@ -40,3 +49,42 @@ void btmap_find(benchmark::State& state) {
     state.SetBytesProcessed(static_cast<long long>(state.iterations()) *
                             static_cast<long long>(state.range(0)));
 }
+
+template <std::size_t Valsize>
+void btmap_find_valsize_setup(benchmark::State const& state) {
+    auto *vmap = static_cast<valsize_pair<Valsize> *>(btmap_new_valsize(Valsize));
+    if(!vmap) {
+        std::abort();
+    }
+    data = rng::shuffled_iota(state);
+    for(auto const v : data) {
+        vmap->key = v;
+        vmap->value = {};
+        scc_btmap_impl_insert(&vmap);
+    }
+    valmap = vmap;
+}
+
+void btmap_find_valsize_teardown(benchmark::State const&) noexcept {
+    btmap_free(valmap);
+}
+
+template <std::size_t Valsize>
+void btmap_find_valsize(benchmark::State& state) {
+    auto *vmap = static_cast<valsize_pair<Valsize> *>(valmap);
+    for(auto _ : state) {
+        for(auto const v : data) {
+            vmap->key = v;
+            scc_btmap_impl_find(vmap);
+        }
+    }
+    state.SetBytesProcessed(static_cast<long long>(state.iterations()) *
+                            static_cast<long long>(state.range(0)));
+}
+
+template void btmap_find_valsize_setup<32>(benchmark::State const&);
+template void btmap_find_valsize_setup<128>(benchmark::State const&);
+template void btmap_find_valsize_setup<512>(benchmark::State const&);
+template void btmap_find_valsize<32>(benchmark::State&);
+template void btmap_find_valsize<128>(benchmark::State&);
+template void btmap_find_valsize<512>(benchmark::State&);
@@ -3,8 +3,16 @@
 
 #include <benchmark/benchmark.h>
 
+#include <cstddef>
+
 void btmap_find_setup(benchmark::State const& state);
 void btmap_find_teardown(benchmark::State const& state) noexcept;
 void btmap_find(benchmark::State& state);
 
+template <std::size_t Valsize>
+void btmap_find_valsize_setup(benchmark::State const& state);
+void btmap_find_valsize_teardown(benchmark::State const& state) noexcept;
+template <std::size_t Valsize>
+void btmap_find_valsize(benchmark::State& state);
+
 #endif /* FIND_HPP */
@@ -12,6 +12,37 @@ void *btree_new(void) {
     return scc_btree_new_dyn(bm_type, compare);
 }
 
+/* Builtin comparator matching bm_type, enabling the vectorized
+ * node search. Falls back to compare for other types */
+static scc_btcompare builtin_compare(void) {
+    if((bm_type)0.5 > (bm_type)0) {
+        return sizeof(bm_type) == sizeof(float) ? scc_btcompare_f32 : scc_btcompare_f64;
+    }
+    if((bm_type)-1 < (bm_type)0) {
+        switch(sizeof(bm_type)) {
+            case 4:
+                return scc_btcompare_i32;
+            case 8:
+                return scc_btcompare_i64;
+            default:
+                break;
+        }
+    }
+    return compare;
+}
+
+void *btree_new_builtin(void) {
+    return scc_btree_new_dyn(bm_type, builtin_compare());
+}
+
 void btree_free(void *btree) {
     scc_btree_free(btree);
 }
+
+void *btree_freeze(void *btree) {
+    return scc_btree_freeze((bm_type *)btree);
+}
+
+void btfrozen_free(void *frozen) {
+    scc_btfrozen_free(frozen);
+}
@@ -6,7 +6,10 @@ extern "C" {
 #endif
 
 void *btree_new(void);
+void *btree_new_builtin(void);
 void btree_free(void *btree);
+void *btree_freeze(void *btree);
+void btfrozen_free(void *frozen);
 
 #ifdef __cplusplus
 }
@@ -13,4 +13,15 @@ BENCHMARK(btree_find)->
     Setup(btree_find_setup)->
     Teardown(btree_find_teardown);
 
+BENCHMARK(btree_find)->
+    Name("btree_find_builtin")->
+    Range(4, 4 << 16)->
+    Setup(btree_find_builtin_setup)->
+    Teardown(btree_find_teardown);
+
+BENCHMARK(btree_find_frozen)->
+    Range(4, 4 << 16)->
+    Setup(btree_find_frozen_setup)->
+    Teardown(btree_find_frozen_teardown);
+
 BENCHMARK_MAIN();
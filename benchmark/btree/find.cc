@@ -6,12 +6,14 @@
 
 extern "C" void const *scc_btree_impl_find(void const *btree, size_t elemsize);
 extern "C" bool scc_btree_impl_insert(void *btree, size_t elemsize);
+extern "C" void const *scc_btfrozen_impl_find(void const *frozen, size_t elemsize);
 
 static bm_type *tree;
+static bm_type *frozen;
 static std::vector<bm_type> data;
 
-void btree_find_setup(benchmark::State const& state) {
-    tree = static_cast<bm_type *>(btree_new());
+static void btree_find_populate(benchmark::State const& state, void *btree) {
+    tree = static_cast<bm_type *>(btree);
     if(!tree) {
         std::abort();
     }
@@ -22,6 +24,14 @@ void btree_find_setup(benchmark::State const& state) {
     }
 }
 
+void btree_find_setup(benchmark::State const& state) {
+    btree_find_populate(state, btree_new());
+}
+
+void btree_find_builtin_setup(benchmark::State const& state) {
+    btree_find_populate(state, btree_new_builtin());
+}
+
 void btree_find_teardown(benchmark::State const&) noexcept {
     btree_free(tree);
 }
@@ -36,3 +46,27 @@ void btree_find(benchmark::State& state) {
     state.SetBytesProcessed(static_cast<long long>(state.iterations()) *
                             static_cast<long long>(state.range(0)));
 }
+
+void btree_find_frozen_setup(benchmark::State const& state) {
+    btree_find_populate(state, btree_new_builtin());
+    frozen = static_cast<bm_type *>(btree_freeze(tree));
+    if(!frozen) {
+        std::abort();
+    }
+}
+
+void btree_find_frozen_teardown(benchmark::State const& state) noexcept {
+    btree_find_teardown(state);
+    btfrozen_free(frozen);
+}
+
+void btree_find_frozen(benchmark::State& state) {
+    for(auto _ : state) {
+        for(auto const v : data) {
+            *frozen = v;
+            scc_btfrozen_impl_find(frozen, sizeof(*frozen));
+        }
+    }
+    state.SetBytesProcessed(static_cast<long long>(state.iterations()) *
+                            static_cast<long long>(state.range(0)));
+}
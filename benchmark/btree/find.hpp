@@ -4,7 +4,11 @@
 #include <benchmark/benchmark.h>
 
 void btree_find_setup(benchmark::State const& state);
+void btree_find_builtin_setup(benchmark::State const& state);
 void btree_find_teardown(benchmark::State const& state) noexcept;
 void btree_find(benchmark::State& state);
+void btree_find_frozen_setup(benchmark::State const& state);
+void btree_find_frozen_teardown(benchmark::State const& state) noexcept;
+void btree_find_frozen(benchmark::State& state);
 
 #endif /* FIND_HPP */
@@ -0,0 +1,37 @@
+#include <benchmark/benchmark.h>
+
+#include "find.hpp"
+#include "insert.hpp"
+
+/* Throughput of the shardmap as the number of threads increases, compared
+ * to that of a single hashmap guarded by one mutex */
+
+BENCHMARK(shardmap_insert)->
+    Arg(1 << 16)->
+    ThreadRange(1, 64)->
+    UseRealTime()->
+    Setup(shardmap_insert_setup)->
+    Teardown(shardmap_insert_teardown);
+
+BENCHMARK(lockedmap_insert)->
+    Arg(1 << 16)->
+    ThreadRange(1, 64)->
+    UseRealTime()->
+    Setup(lockedmap_insert_setup)->
+    Teardown(lockedmap_insert_teardown);
+
+BENCHMARK(shardmap_find)->
+    Arg(1 << 16)->
+    ThreadRange(1, 64)->
+    UseRealTime()->
+    Setup(shardmap_find_setup)->
+    Teardown(shardmap_find_teardown);
+
+BENCHMARK(lockedmap_find)->
+    Arg(1 << 16)->
+    ThreadRange(1, 64)->
+    UseRealTime()->
+    Setup(lockedmap_find_setup)->
+    Teardown(lockedmap_find_teardown);
+
+BENCHMARK_MAIN();
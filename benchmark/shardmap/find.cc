@@ -0,0 +1,77 @@
+#include <instrumentation/rng.hpp>
+#include <instrumentation/types.h>
+
+#include "shardmap_compat.h"
+#include "find.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+
+static void *smap;
+static void *lmap;
+static std::vector<bm_type> data;
+
+/* Threads start at different offsets in the data so as
+ * not to hit the same shards in lockstep */
+static std::size_t start_offset(benchmark::State const& state) {
+    return data.size() * static_cast<std::size_t>(state.thread_index()) /
+           static_cast<std::size_t>(state.threads());
+}
+
+void shardmap_find_setup(benchmark::State const& state) {
+    smap = shardmap_new();
+    if(!smap) {
+        std::abort();
+    }
+    data = rng::shuffled_iota(state);
+    for(auto const v : data) {
+        shardmap_put(smap, v);
+    }
+}
+
+void shardmap_find_teardown(benchmark::State const&) noexcept {
+    shardmap_free(smap);
+}
+
+void shardmap_find(benchmark::State& state) {
+    void *handle = shardmap_attach(smap);
+    if(!handle) {
+        state.SkipWithError("Could not attach to shardmap");
+        return;
+    }
+    std::size_t const off = start_offset(state);
+    for(auto _ : state) {
+        for(std::size_t i = 0u; i < data.size(); ++i) {
+            benchmark::DoNotOptimize(shardmap_get(handle, data[(i + off) % data.size()]));
+        }
+    }
+    shardmap_detach(handle);
+    state.SetItemsProcessed(static_cast<long long>(state.iterations()) *
+                            static_cast<long long>(state.range(0)));
+}
+
+void lockedmap_find_setup(benchmark::State const& state) {
+    lmap = lockedmap_new();
+    if(!lmap) {
+        std::abort();
+    }
+    data = rng::shuffled_iota(state);
+    for(auto const v : data) {
+        lockedmap_put(lmap, v);
+    }
+}
+
+void lockedmap_find_teardown(benchmark::State const&) noexcept {
+    lockedmap_free(lmap);
+}
+
+void lockedmap_find(benchmark::State& state) {
+    std::size_t const off = start_offset(state);
+    for(auto _ : state) {
+        for(std::size_t i = 0u; i < data.size(); ++i) {
+            benchmark::DoNotOptimize(lockedmap_get(lmap, data[(i + off) % data.size()]));
+        }
+    }
+    state.SetItemsProcessed(static_cast<long long>(state.iterations()) *
+                            static_cast<long long>(state.range(0)));
+}
@@ -0,0 +1,14 @@
+#ifndef FIND_HPP
+#define FIND_HPP
+
+#include <benchmark/benchmark.h>
+
+void shardmap_find_setup(benchmark::State const& state);
+void shardmap_find_teardown(benchmark::State const& state) noexcept;
+void shardmap_find(benchmark::State& state);
+
+void lockedmap_find_setup(benchmark::State const& state);
+void lockedmap_find_teardown(benchmark::State const& state) noexcept;
+void lockedmap_find(benchmark::State& state);
+
+#endif /* FIND_HPP */
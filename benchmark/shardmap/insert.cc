@@ -0,0 +1,67 @@
+#include <instrumentation/rng.hpp>
+#include <instrumentation/types.h>
+
+#include "shardmap_compat.h"
+#include "insert.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+
+static void *smap;
+static void *lmap;
+static std::vector<bm_type> data;
+
+/* Each thread inserts a disjoint slice of the keys, repeated
+ * iterations replace the values of already present keys */
+template <typename Insert>
+static void insert_slice(benchmark::State& state, void *map, Insert insert) {
+    std::size_t const nthreads = static_cast<std::size_t>(state.threads());
+    std::size_t const index = static_cast<std::size_t>(state.thread_index());
+    std::size_t const begin = data.size() * index / nthreads;
+    std::size_t const end = data.size() * (index + 1u) / nthreads;
+    for(auto _ : state) {
+        for(std::size_t i = begin; i < end; ++i) {
+            benchmark::DoNotOptimize(insert(map, data[i]));
+        }
+    }
+    state.SetItemsProcessed(static_cast<long long>(state.iterations()) *
+                            static_cast<long long>(end - begin));
+}
+
+void shardmap_insert_setup(benchmark::State const& state) noexcept {
+    smap = shardmap_new();
+    if(!smap) {
+        std::abort();
+    }
+    data = rng::shuffled_iota(state);
+}
+
+void shardmap_insert_teardown(benchmark::State const&) noexcept {
+    shardmap_free(smap);
+}
+
+void shardmap_insert(benchmark::State& state) {
+    void *handle = shardmap_attach(smap);
+    if(!handle) {
+        state.SkipWithError("Could not attach to shardmap");
+        return;
+    }
+    insert_slice(state, handle, shardmap_put);
+    shardmap_detach(handle);
+}
+
+void lockedmap_insert_setup(benchmark::State const& state) noexcept {
+    lmap = lockedmap_new();
+    if(!lmap) {
+        std::abort();
+    }
+    data = rng::shuffled_iota(state);
+}
+
+void lockedmap_insert_teardown(benchmark::State const&) noexcept {
+    lockedmap_free(lmap);
+}
+
+void lockedmap_insert(benchmark::State& state) {
+    insert_slice(state, lmap, lockedmap_put);
+}
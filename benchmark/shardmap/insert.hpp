@@ -0,0 +1,14 @@
+#ifndef INSERT_HPP
+#define INSERT_HPP
+
+#include <benchmark/benchmark.h>
+
+void shardmap_insert_setup(benchmark::State const& state) noexcept;
+void shardmap_insert_teardown(benchmark::State const& state) noexcept;
+void shardmap_insert(benchmark::State& state);
+
+void lockedmap_insert_setup(benchmark::State const& state) noexcept;
+void lockedmap_insert_teardown(benchmark::State const& state) noexcept;
+void lockedmap_insert(benchmark::State& state);
+
+#endif /* INSERT_HPP */
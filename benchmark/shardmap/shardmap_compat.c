@@ -0,0 +1,90 @@
+#include "shardmap_compat.h"
+
+#include <instrumentation/types.h>
+
+#include <scc/hashmap.h>
+#include <scc/shardmap.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+enum { NSHARDS = 64 };
+
+/* Baseline, a single hashmap behind one mutex */
+struct lockedmap {
+    pthread_mutex_t lock;
+    void *map;
+};
+
+static bool eq(void const *l, void const *r) {
+    return *(bm_type const *)l == *(bm_type const *)r;
+}
+
+void *shardmap_new(void) {
+    return scc_shardmap_new(bm_type, bm_type, eq, NSHARDS);
+}
+
+void shardmap_free(void *shardmap) {
+    scc_shardmap(bm_type, bm_type) smap = shardmap;
+    scc_shardmap_free(smap);
+}
+
+void *shardmap_attach(void *shardmap) {
+    scc_shardmap(bm_type, bm_type) smap = shardmap;
+    return scc_shardmap_attach(smap);
+}
+
+void shardmap_detach(void *shardmap) {
+    scc_shardmap_detach(shardmap);
+}
+
+bool shardmap_put(void *shardmap, bm_type key) {
+    scc_shardmap(bm_type, bm_type) smap = shardmap;
+    return scc_shardmap_insert(smap, key, key);
+}
+
+bool shardmap_get(void *shardmap, bm_type key) {
+    scc_shardmap(bm_type, bm_type) smap = shardmap;
+    return scc_shardmap_find(smap, key);
+}
+
+void *lockedmap_new(void) {
+    struct lockedmap *lmap = malloc(sizeof(*lmap));
+    if (!lmap) {
+        return 0;
+    }
+    lmap->map = scc_hashmap_new_dyn(bm_type, bm_type, eq);
+    if (!lmap->map) {
+        free(lmap);
+        return 0;
+    }
+    pthread_mutex_init(&lmap->lock, 0);
+    return lmap;
+}
+
+void lockedmap_free(void *lockedmap) {
+    struct lockedmap *lmap = lockedmap;
+    pthread_mutex_destroy(&lmap->lock);
+    scc_hashmap_free(lmap->map);
+    free(lmap);
+}
+
+bool lockedmap_put(void *lockedmap, bm_type key) {
+    struct lockedmap *lmap = lockedmap;
+    pthread_mutex_lock(&lmap->lock);
+    scc_hashmap(bm_type, bm_type) map = lmap->map;
+    bool const inserted = scc_hashmap_insert(&map, key, key);
+    lmap->map = map;
+    pthread_mutex_unlock(&lmap->lock);
+    return inserted;
+}
+
+bool lockedmap_get(void *lockedmap, bm_type key) {
+    struct lockedmap *lmap = lockedmap;
+    pthread_mutex_lock(&lmap->lock);
+    scc_hashmap(bm_type, bm_type) map = lmap->map;
+    bool const found = scc_hashmap_find(map, key);
+    pthread_mutex_unlock(&lmap->lock);
+    return found;
+}
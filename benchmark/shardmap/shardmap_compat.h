@@ -0,0 +1,28 @@
+#ifndef SHARDMAP_COMPAT_H
+#define SHARDMAP_COMPAT_H
+
+#include <instrumentation/types.h>
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *shardmap_new(void);
+void shardmap_free(void *shardmap);
+void *shardmap_attach(void *shardmap);
+void shardmap_detach(void *shardmap);
+bool shardmap_put(void *shardmap, bm_type key);
+bool shardmap_get(void *shardmap, bm_type key);
+
+void *lockedmap_new(void);
+void lockedmap_free(void *lockedmap);
+bool lockedmap_put(void *lockedmap, bm_type key);
+bool lockedmap_get(void *lockedmap, bm_type key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHARDMAP_COMPAT_H */
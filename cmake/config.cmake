@@ -37,6 +37,7 @@ add_custom_target(.config.u64.cmake.stamp
 add_custom_target (.config.simd.cmake.stamp
     COMMAND ${Python3_EXECUTABLE} ${SCCONFIG} ${CONFOPTS} add SCC_SIMD_ISA ${SCC_SIMD_ISA} -C "SIMD instruction set architecture"
     COMMAND ${Python3_EXECUTABLE} ${SCCONFIG} ${CONFOPTS} add SCC_HWVEC_SIZE ${SCC_VECSIZE} -C "Size of hardware SIMD vectors"
+    COMMAND ${Python3_EXECUTABLE} ${SCCONFIG} ${CONFOPTS} add SCC_HWVEC_MAXSIZE ${SCC_VECSIZE_MAX} -C "Size of widest hardware SIMD vectors selectable at runtime"
     DEPENDS .config.u64.cmake.stamp
 )
 
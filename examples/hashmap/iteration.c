@@ -0,0 +1,69 @@
+/* Example of hashmap iteration */
+
+#include <scc/hashmap.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef NDEBUG
+#error assert has not effect
+#endif
+
+/*
+ * Int comparator
+ */
+static _Bool int_eq(void const *l, void const *r) {
+    return *(int const *)l == *(int const *)r;
+}
+
+/*
+ * Use the key itself as its hash. This makes the pairs
+ * traversed in ascending order for small, non-negative keys
+ */
+static uint_fast64_t int_hash(void const *p, size_t sz) {
+    (void)sz;
+    return *(int const *)p;
+}
+
+int main(void) {
+    extern _Bool int_eq(void const *l, void const *r);
+    extern uint_fast64_t int_hash(void const *p, size_t sz);
+
+    scc_hashmap(int, int) map = scc_hashmap_with_hash(int, int, int_eq, int_hash);
+
+    /* Map each key to its square */
+    _Bool inserted = true;
+    for (int i = 1; i < 6; ++i)
+        inserted &= scc_hashmap_insert(&map, i, i * i);
+    assert(inserted);
+
+    /* Iterator instance */
+    scc_hashmap_iter(int, int) it;
+
+    /* Values may be modified through the iterator */
+    scc_hashmap_foreach(it, map)
+        *it.value += 1;
+
+    /* it.key and it.value refer to the key and value of each pair */
+    scc_hashmap_foreach(it, map)
+        printf("%d: %d\n", *it.key, *it.value);
+
+    /* Need to free the map */
+    scc_hashmap_free(map);
+}
+
+/* ============= OUTPUT =============== */
+// STDOUT:1: 2
+// STDOUT:2: 5
+// STDOUT:3: 10
+// STDOUT:4: 17
+// STDOUT:5: 26
+/* ==================================== */
+
+// RUN: %cc %s %dynamic -o %t
+// RUN: %t | %filecheck %s --dump-input=fail --strict-whitespace --match-full-lines --check-prefix=STDOUT
+
+// RUN: %cc %s %static -o %t
+// RUN: %t | %filecheck %s --dump-input=fail --strict-whitespace --match-full-lines --check-prefix=STDOUT
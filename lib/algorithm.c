@@ -46,3 +46,29 @@ size_t scc_algo_lower_bound_eq(void const *key, void const *base, size_t nmemb,
 
     return begin | (eq << SIZE_SHIFT);
 }
+
+size_t scc_algo_upper_bound(void const *key, void const *base, size_t nmemb, size_t size, int(*compare)(void const *, void const *)) {
+    size_t begin = 0u;
+    size_t end = nmemb;
+    size_t middle;
+    if (scc_algo_impl_lower_bound_is_linear(nmemb)) {
+        for (; begin < nmemb; ++begin) {
+            if (compare(key, (unsigned char const *)base + begin * size) < 0) {
+                break;
+            }
+        }
+    }
+    else {
+        while (begin != end) {
+            middle = begin + ((end - begin) >> 1u);
+            if (compare(key, (unsigned char const *)base + middle * size) < 0) {
+                end = middle;
+            }
+            else {
+                begin = middle + 1u;
+            }
+        }
+    }
+
+    return begin;
+}
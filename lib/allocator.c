@@ -0,0 +1,37 @@
+#include <scc/allocator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+void *scc_allocator_alloc(struct scc_allocator const *allocator, size_t size) {
+    if (!allocator) {
+        return malloc(size);
+    }
+    return allocator->al_alloc(allocator->al_ctx, size);
+}
+
+void *scc_allocator_zalloc(struct scc_allocator const *allocator, size_t size) {
+    if (!allocator) {
+        return calloc(size, sizeof(unsigned char));
+    }
+    void *addr = allocator->al_alloc(allocator->al_ctx, size);
+    if (addr) {
+        memset(addr, 0, size);
+    }
+    return addr;
+}
+
+void *scc_allocator_realloc(struct scc_allocator const *allocator, void *addr, size_t size) {
+    if (!allocator) {
+        return realloc(addr, size);
+    }
+    return allocator->al_realloc(allocator->al_ctx, addr, size);
+}
+
+void scc_allocator_free(struct scc_allocator const *allocator, void *addr) {
+    if (!allocator) {
+        free(addr);
+        return;
+    }
+    allocator->al_free(allocator->al_ctx, addr);
+}
@@ -1,19 +1,72 @@
 #include <scc/arch.h>
 
 unsigned long long scc_hashmap_impl_probe_insert(
-    struct scc_hashmap_base const *base,
+    struct scc_hashmap_base *base,
     void const *map,
     size_t keysize,
     unsigned long long hash
 );
 
 long long scc_hashmap_impl_probe_find(
-    struct scc_hashmap_base const *base,
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+);
+
+void scc_hashmap_impl_probe_find_batch(
+    struct scc_hashmap_base *base,
+    void *map,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+);
+
+unsigned long long scc_hashmap_impl_probe_insert_scalar(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+);
+
+long long scc_hashmap_impl_probe_find_scalar(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+);
+
+void scc_hashmap_impl_probe_find_scalar_batch(
+    struct scc_hashmap_base *base,
+    void *map,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+);
+
+long long scc_hashmap_impl_probe_find_shared(
+    struct scc_hashmap_base *base,
+    void const *map,
+    void const *key,
+    size_t keysize,
+    unsigned long long hash
+);
+
+long long scc_hashmap_impl_probe_find_shared_scalar(
+    struct scc_hashmap_base *base,
     void const *map,
+    void const *key,
     size_t keysize,
     unsigned long long hash
 );
 
+long long scc_hashmap_impl_next_occupied(
+    struct scc_hashmap_base const *base,
+    size_t start
+);
+
 long long scc_hashtab_impl_probe_insert(
     struct scc_hashtab_base const *base,
     void const *tab,
@@ -27,3 +80,8 @@ long long scc_hashtab_impl_probe_find(
     size_t elemsize,
     unsigned long long hash
 );
+
+size_t scc_btkey_impl_lower_bound_i32(void const *keys, size_t nkeys, void const *key);
+size_t scc_btkey_impl_lower_bound_i64(void const *keys, size_t nkeys, void const *key);
+size_t scc_btkey_impl_lower_bound_f32(void const *keys, size_t nkeys, void const *key);
+size_t scc_btkey_impl_lower_bound_f64(void const *keys, size_t nkeys, void const *key);
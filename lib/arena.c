@@ -1,132 +1,319 @@
+#if defined __unix__ || defined __APPLE__
+/* posix_memalign */
+#define _DEFAULT_SOURCE
+#define SCC_ARENA_POSIX
+#endif
+
 #include <scc/arena.h>
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef SCC_ARENA_POSIX
 #include <stdlib.h>
+#endif
 
 void scc_arena_reset(struct scc_arena *arena);
+size_t scc_arena_nchunks(struct scc_arena const *arena);
+
+enum {
+    /* Size in bytes above which chunks are split into several segments */
+    SCC_ARENA_SEGSIZE = 4096,
+    /* Minimum number of elements in each segment of a split chunk */
+    SCC_ARENA_SEGELEMS = 16
+};
+
+/* Size of the next chunk allocated on demand, doubling
+ * with each chunk in the arena up to the cap */
+static size_t scc_arena_growsize(struct scc_arena const *arena) {
+    size_t size = arena->ar_chunksize;
+    for (size_t i = 0u; i < arena->ar_nchunks && size < SCC_ARENA_MAX_CHUNKSIZE; ++i) {
+        size <<= 1u;
+    }
+    return size < SCC_ARENA_MAX_CHUNKSIZE ? size : SCC_ARENA_MAX_CHUNKSIZE;
+}
+
+/* Smallest segment able to hold a header and ar_chunksize elements. Chunks
+ * exceeding SCC_ARENA_SEGSIZE bytes are instead split into segments of at
+ * least that size holding SCC_ARENA_SEGELEMS elements or more, bounding the
+ * memory lost to aligning each chunk on a segment boundary */
+static unsigned char scc_arena_segshift(struct scc_arena *arena) {
+    if (!arena->ar_segshift) {
+        size_t size = arena->ar_baseoff + (size_t)arena->ar_chunksize * arena->ar_elemsize;
+        if (size > SCC_ARENA_SEGSIZE && arena->ar_chunksize > SCC_ARENA_SEGELEMS) {
+            size = arena->ar_baseoff + (size_t)SCC_ARENA_SEGELEMS * arena->ar_elemsize;
+            if (size < SCC_ARENA_SEGSIZE) {
+                size = SCC_ARENA_SEGSIZE;
+            }
+        }
+        unsigned char shift = 6u;
+        while (((size_t)1u << shift) < size) {
+            ++shift;
+        }
+        arena->ar_segshift = shift;
+    }
+    return arena->ar_segshift;
+}
+
+static inline size_t scc_arena_segsize(struct scc_arena const *arena) {
+    return (size_t)1u << arena->ar_segshift;
+}
+
+/* Number of elements fitting in a single segment */
+static inline size_t scc_arena_segelems(struct scc_arena const *arena) {
+    return (scc_arena_segsize(arena) - arena->ar_baseoff) / arena->ar_elemsize;
+}
+
+/* Index of the element at the given offset in a chunk */
+static inline size_t scc_arena_index(struct scc_arena const *arena, size_t offset) {
+    size_t const segmask = scc_arena_segsize(arena) - 1u;
+    return (offset >> arena->ar_segshift) * scc_arena_segelems(arena) +
+        ((offset & segmask) - arena->ar_baseoff) / arena->ar_elemsize;
+}
+
+/* Offset of the element with the given index in a chunk */
+static inline size_t scc_arena_offset(struct scc_arena const *arena, size_t index) {
+    size_t const segelems = scc_arena_segelems(arena);
+    return (index / segelems) * scc_arena_segsize(arena) + arena->ar_baseoff +
+        (index % segelems) * arena->ar_elemsize;
+}
+
+/* Obtain memory for a chunk aligned on a segment boundary */
+static void *scc_arena_alloc_aligned(struct scc_arena const *arena, size_t size, void **mem) {
+    size_t const segsize = scc_arena_segsize(arena);
+#ifdef SCC_ARENA_POSIX
+    if (!arena->ar_allocator) {
+        if (posix_memalign(mem, segsize, size)) {
+            return 0;
+        }
+        return *mem;
+    }
+#endif
+    /* Over-allocate and align manually */
+    *mem = scc_allocator_alloc(arena->ar_allocator, size + segsize - 1u);
+    if (!*mem) {
+        return 0;
+    }
+    return (void *)scc_align((uintptr_t)*mem, (uintptr_t)segsize);
+}
+
+static struct scc_chunk *scc_chunk_new(struct scc_arena *arena, size_t nelems) {
+    size_t const segshift = scc_arena_segshift(arena);
+    size_t const end = scc_arena_offset(arena, nelems - 1u);
 
-static struct scc_chunk *scc_chunk_new(size_t chunksize, size_t elemsize, size_t baseoff) {
-    size_t const size = chunksize * elemsize + baseoff;
-    struct scc_chunk *chunk = malloc(size);
+    void *mem;
+    struct scc_chunk *chunk = scc_arena_alloc_aligned(arena, end + arena->ar_elemsize, &mem);
     if (!chunk) {
         return 0;
     }
-    /* Assume chunk is to be used immediately */
-    chunk->ch_refcount = 1;
-    /* Offset of second element */
-    chunk->ch_offset = baseoff;
-    /* Offset of last element in chunk */
-    chunk->ch_end = chunk->ch_offset - elemsize + chunksize * elemsize;
+
+    chunk->ch_owner = chunk;
+    chunk->ch_refcount = 0u;
+    chunk->ch_offset = 0u;
+    chunk->ch_end = end;
+    chunk->ch_free = 0;
     chunk->ch_next = 0;
+    chunk->ch_prev = 0;
+    chunk->ch_nextavail = 0;
+    chunk->ch_prevavail = 0;
+    chunk->ch_mem = mem;
+
+    /* Back-pointers in subsequent segments */
+    for (size_t seg = 1u; seg <= end >> segshift; ++seg) {
+        *(struct scc_chunk **)((unsigned char *)chunk + (seg << segshift)) = chunk;
+    }
     return chunk;
 }
 
-static inline bool scc_chunk_contains_addr(struct scc_chunk const *chunk, void const *addr) {
-    return addr <= (void const *)((unsigned char const *)chunk + chunk->ch_end) &&
-           (void const *)chunk < addr;
+static void scc_arena_push_chunk(struct scc_arena *arena, struct scc_chunk *chunk) {
+    if (!arena->ar_current) {
+        arena->ar_first = chunk;
+    }
+    else {
+        arena->ar_current->ch_next = chunk;
+        chunk->ch_prev = arena->ar_current;
+    }
+    arena->ar_current = chunk;
+    ++arena->ar_nchunks;
+}
+
+static void scc_arena_unlink_avail(struct scc_arena *arena, struct scc_chunk *chunk) {
+    if (chunk->ch_prevavail) {
+        chunk->ch_prevavail->ch_nextavail = chunk->ch_nextavail;
+    }
+    else {
+        arena->ar_avail = chunk->ch_nextavail;
+    }
+    if (chunk->ch_nextavail) {
+        chunk->ch_nextavail->ch_prevavail = chunk->ch_prevavail;
+    }
+    chunk->ch_nextavail = 0;
+    chunk->ch_prevavail = 0;
+}
+
+static void scc_arena_release_chunk(struct scc_arena *arena, struct scc_chunk *chunk) {
+    if (chunk->ch_free) {
+        scc_arena_unlink_avail(arena, chunk);
+    }
+    if (chunk->ch_prev) {
+        chunk->ch_prev->ch_next = chunk->ch_next;
+    }
+    else {
+        arena->ar_first = chunk->ch_next;
+    }
+    if (chunk->ch_next) {
+        chunk->ch_next->ch_prev = chunk->ch_prev;
+    }
+    else {
+        arena->ar_current = chunk->ch_prev;
+    }
+    --arena->ar_nchunks;
+    scc_allocator_free(arena->ar_allocator, chunk->ch_mem);
 }
 
 void scc_arena_release(struct scc_arena *arena) {
     struct scc_chunk *iter;
     struct scc_chunk *hare;
     scc_arena_foreach_chunk_safe(iter, hare, arena) {
-        free(iter);
+        scc_allocator_free(arena->ar_allocator, iter->ch_mem);
     }
 }
 
 void *scc_arena_alloc(struct scc_arena *arena) {
-    size_t const chunksize = arena->ar_chunksize;
-    size_t const elemsize = arena->ar_elemsize;
-    size_t const baseoff = arena->ar_baseoff;
-    struct scc_chunk *chunk;
-
-    if (!arena->ar_current) {
-        /* No chunks in arena */
-        chunk = scc_chunk_new(chunksize, elemsize, baseoff);
-        if (!chunk) {
-            return 0;
+    struct scc_chunk *chunk = arena->ar_avail;
+    if (chunk) {
+        /* Reuse most recently freed element */
+        void *elem = chunk->ch_free;
+        memcpy(&chunk->ch_free, elem, sizeof(chunk->ch_free));
+        if (!chunk->ch_free) {
+            scc_arena_unlink_avail(arena, chunk);
         }
-
-        arena->ar_current = chunk;
-        arena->ar_first = chunk;
+        ++chunk->ch_refcount;
+        return elem;
     }
-    else if (arena->ar_current->ch_offset == arena->ar_current->ch_end) {
-        /* Chunk full */
-        chunk = scc_chunk_new(chunksize, elemsize, baseoff);
+
+    chunk = arena->ar_current;
+    if (!chunk || chunk->ch_offset == chunk->ch_end) {
+        /* No chunks in arena or chunk full */
+        chunk = scc_chunk_new(arena, scc_arena_growsize(arena));
         if (!chunk) {
             return 0;
         }
-        arena->ar_current->ch_next = chunk;
-        arena->ar_current = chunk;
+        scc_arena_push_chunk(arena, chunk);
+    }
+
+    if (!chunk->ch_offset) {
+        chunk->ch_offset = arena->ar_baseoff;
     }
     else {
-        chunk = arena->ar_current;
-        ++chunk->ch_refcount;
-        chunk->ch_offset += elemsize;
+        size_t const segmask = scc_arena_segsize(arena) - 1u;
+        size_t offset = chunk->ch_offset + arena->ar_elemsize;
+        if ((offset & segmask) + arena->ar_elemsize > segmask + 1u) {
+            /* Element would straddle segments */
+            offset = (offset & ~segmask) + segmask + 1u + arena->ar_baseoff;
+        }
+        else if ((offset & segmask) < arena->ar_baseoff) {
+            /* Previous element ended on a segment boundary */
+            offset = (offset & ~segmask) + arena->ar_baseoff;
+        }
+        chunk->ch_offset = offset;
     }
 
+    ++chunk->ch_refcount;
     return (unsigned char *)chunk + chunk->ch_offset;
 }
 
 _Bool scc_arena_reserve(struct scc_arena *arena, size_t nelems) {
-    if (arena->ar_current && arena->ar_current->ch_end - arena->ar_current->ch_offset >= nelems * arena->ar_elemsize) {
-        /* Enough space in chunk */
-        return true;
+    struct scc_chunk *chunk = arena->ar_current;
+    if (chunk) {
+        size_t const last = scc_arena_index(arena, chunk->ch_end);
+        size_t const used = chunk->ch_offset ? scc_arena_index(arena, chunk->ch_offset) + 1u : 0u;
+        if (last + 1u - used >= nelems) {
+            /* Enough space in chunk */
+            return true;
+        }
     }
 
-    if (nelems < arena->ar_chunksize) {
+    /* Requests larger than the next chunk get a chunk of
+     * exactly the requested size, smaller ones a full chunk */
+    size_t const growsize = scc_arena_growsize(arena);
+    if (nelems < growsize) {
         /* HACK: Make mull die on mutation from < to <=.
          * The behavior is correct either way */
-        assert(nelems != arena->ar_chunksize);
-        nelems = arena->ar_chunksize;
+        assert(nelems != growsize);
+        nelems = growsize;
     }
 
-    struct scc_chunk *chunk = scc_chunk_new(nelems, arena->ar_elemsize, arena->ar_baseoff);
+    chunk = scc_chunk_new(arena, nelems);
     if (!chunk) {
         return false;
     }
-
-    if (!arena->ar_current) {
-        arena->ar_current = chunk;
-        arena->ar_first = chunk;
-    }
-    else {
-        arena->ar_current->ch_next = chunk;
-        arena->ar_current = chunk;
-    }
-
+    scc_arena_push_chunk(arena, chunk);
     return true;
 }
 
-_Bool scc_arena_try_free(struct scc_arena *restrict arena, void const *restrict addr) {
+/* Whether addr lies within one of the chunks of the arena. The segment
+ * header preceding addr may only be read once this has been verified */
+static bool scc_arena_owns(struct scc_arena const *restrict arena, void const *restrict addr) {
     struct scc_chunk *iter;
-    struct scc_chunk *tortoise;
-    scc_arena_foreach_chunk_lagging(iter, tortoise, arena) {
-        if (scc_chunk_contains_addr(iter, addr)) {
-            break;
+    scc_arena_foreach_chunk(iter, arena) {
+        if ((uintptr_t)addr >= (uintptr_t)iter && (uintptr_t)addr - (uintptr_t)iter <= iter->ch_end) {
+            return true;
         }
     }
-    if (!iter) {
+    return false;
+}
+
+/* Return element at addr, which must lie within a chunk of the arena */
+static bool scc_arena_put(struct scc_arena *restrict arena, void const *restrict addr) {
+    if (!arena->ar_current) {
+        return false;
+    }
+
+    /* Segment containing addr starts with a pointer to its chunk */
+    uintptr_t const segmask = scc_arena_segsize(arena) - 1u;
+    struct scc_chunk *const *seg = (void *)((uintptr_t)addr & ~segmask);
+    if (((uintptr_t)addr & segmask) < arena->ar_baseoff) {
         return false;
     }
-    --iter->ch_refcount;
-    if (iter->ch_offset == iter->ch_end && !iter->ch_refcount) {
-        if (!tortoise) {
-            /* First chunk */
-            arena->ar_first = iter->ch_next;
-        }
-        else {
-            tortoise->ch_next = iter->ch_next;
-        }
-        if (iter == arena->ar_current) {
-            arena->ar_current = tortoise;
+
+    struct scc_chunk *chunk = *seg;
+    size_t const offset = (unsigned char const *)addr - (unsigned char const *)chunk;
+    if (!chunk->ch_offset || offset > chunk->ch_offset) {
+        return false;
+    }
+
+    --chunk->ch_refcount;
+    /* Chunks other than the current one are never bump allocated from */
+    if (!chunk->ch_refcount && (chunk->ch_offset == chunk->ch_end || chunk != arena->ar_current)) {
+        scc_arena_release_chunk(arena, chunk);
+        return true;
+    }
+
+    /* Cast is fine, addr was handed out by scc_arena_alloc */
+    void *elem = (void *)(uintptr_t)addr;
+    assert(arena->ar_elemsize >= sizeof(chunk->ch_free));
+    memcpy(elem, &chunk->ch_free, sizeof(chunk->ch_free));
+    if (!chunk->ch_free) {
+        chunk->ch_nextavail = arena->ar_avail;
+        if (arena->ar_avail) {
+            arena->ar_avail->ch_prevavail = chunk;
         }
-        free(iter);
+        arena->ar_avail = chunk;
     }
+    chunk->ch_free = elem;
     return true;
 }
 
+_Bool scc_arena_try_free(struct scc_arena *restrict arena, void const *restrict addr) {
+    if (!scc_arena_owns(arena, addr)) {
+        return false;
+    }
+    return scc_arena_put(arena, addr);
+}
+
 void scc_arena_free(struct scc_arena *restrict arena, void const *restrict addr) {
-    scc_bug_on(!scc_arena_try_free(arena, addr));
+    scc_bug_on(!scc_arena_put(arena, addr));
 }
@@ -6,7 +6,6 @@
 #include <math.h>
 #endif
 #include <stdbool.h>
-#include <stdlib.h>
 #include <string.h>
 
 #if defined SCC_HAVE_UINT32_T || defined SCC_HAVE_UINT64_T
@@ -36,24 +35,25 @@ void *scc_bloom_impl_new(struct scc_bloom_base *base, size_t offset, unsigned m,
 }
 
 void *scc_bloom_impl_with_hash_dyn(size_t size, size_t offset, unsigned m,
-        unsigned k, scc_bloom_hash hash) {
-    struct scc_bloom_base *base = calloc(1u, size);
+        unsigned k, scc_bloom_hash hash, struct scc_allocator const *allocator) {
+    struct scc_bloom_base *base = scc_allocator_zalloc(allocator, size);
     if (!base)
         return 0;
 
+    base->bm_allocator = allocator;
     unsigned char *tmp = scc_bloom_impl_with_hash(base, offset, m, k, hash);
     tmp[-1] = 1;
     return tmp;
 }
 
-void *scc_bloom_impl_new_dyn(size_t size, size_t offset, unsigned m, unsigned k) {
-    return scc_bloom_impl_with_hash_dyn(size, offset, m, k, scc_hash_murmur128);
+void *scc_bloom_impl_new_dyn(size_t size, size_t offset, unsigned m, unsigned k, struct scc_allocator const *allocator) {
+    return scc_bloom_impl_with_hash_dyn(size, offset, m, k, scc_hash_murmur128, allocator);
 }
 
 void scc_bloom_free(void *flt) {
     struct scc_bloom_base *base = scc_bloom_impl_base(flt);
     if (scc_bloom_is_allocd(flt))
-        free(base);
+        scc_allocator_free(base->bm_allocator, base);
 }
 
 static inline unsigned char *scc_bloom_bitset(void *flt, size_t elemsize) {
@@ -159,7 +159,7 @@ void *scc_bloom_impl_clone(void const *flt, size_t elemsize) {
     unsigned nbytes = obase->bm_nbits >> 3u;
     size_t sz = offset + elemsize + nbytes;
     unsigned char *tmp = scc_bloom_impl_with_hash_dyn(sz, offset,
-                            obase->bm_nbits, obase->bm_nhashes, obase->bm_hash);
+                            obase->bm_nbits, obase->bm_nhashes, obase->bm_hash, obase->bm_allocator);
     if (!tmp)
         return 0;
     memcpy((unsigned char *)tmp + elemsize,
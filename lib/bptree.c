@@ -0,0 +1,767 @@
+#include <scc/algorithm.h>
+#include <scc/bptree.h>
+#include <scc/mem.h>
+#include <scc/stack.h>
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+void *scc_bptree_impl_with_order(void *base, size_t coff, size_t rootoff);
+void *scc_bptree_impl_with_order_dyn(void *sbase, size_t basesz, size_t coff, size_t rootoff);
+size_t scc_bptree_impl_npad(void const *bptree);
+size_t scc_bptree_order(void const *bptree);
+size_t scc_bptree_size(void const *bptree);
+
+enum {
+    SCC_BPTREE_FLAG_LEAF = 0x01,
+    /* Root node stored in the bptree base rather than the arena */
+    SCC_BPTREE_FLAG_EMBEDDED = 0x02
+};
+
+/* Leaves store links to their neighbours in the link array */
+enum {
+    SCC_BPTREE_LINK_NEXT = 0,
+    SCC_BPTREE_LINK_PREV = 1
+};
+
+/* Node and child index on the path from the root to a leaf */
+struct scc_bppath {
+    struct scc_bpnode_base *node;
+    size_t index;
+};
+
+static inline void scc_bptree_set_bkoff(void *bptree, unsigned char bkoff) {
+    ((unsigned char *)bptree)[-1] = bkoff;
+}
+
+static inline void scc_bptree_root_init(struct scc_bptree_base *base, void *root) {
+    base->bp_root = root;
+    base->bp_root->bp_flags |= SCC_BPTREE_FLAG_LEAF | SCC_BPTREE_FLAG_EMBEDDED;
+}
+
+static inline _Bool scc_bpnode_is_leaf(struct scc_bpnode_base const *node) {
+    return node->bp_flags & SCC_BPTREE_FLAG_LEAF;
+}
+
+static inline _Bool scc_bpnode_full(struct scc_bptree_base const *base, struct scc_bpnode_base const *node) {
+    assert(node->bp_nkeys < base->bp_order);
+    return node->bp_nkeys == base->bp_order - 1u;
+}
+
+/* Minimum number of keys in any node but the root */
+static inline size_t scc_bptree_minkeys(struct scc_bptree_base const *base) {
+    return (base->bp_order - 1u) >> 1u;
+}
+
+static inline void scc_bpnode_free(struct scc_bptree_base *restrict base, struct scc_bpnode_base *restrict node) {
+    if (!(node->bp_flags & SCC_BPTREE_FLAG_EMBEDDED)) {
+        scc_arena_free(&base->bp_arena, node);
+    }
+}
+
+static inline struct scc_bpnode_base **scc_bpnode_links(struct scc_bptree_base const *restrict base, struct scc_bpnode_base const *restrict node) {
+    return (void *)((unsigned char *)(uintptr_t)node + base->bp_linkoff);
+}
+
+static inline struct scc_bpnode_base *scc_bpnode_child(struct scc_bptree_base const *restrict base, struct scc_bpnode_base const *restrict node, size_t index) {
+    return scc_bpnode_links(base, node)[index];
+}
+
+static inline struct scc_bpnode_base *scc_bpnode_next(struct scc_bptree_base const *restrict base, struct scc_bpnode_base const *restrict leaf) {
+    return scc_bpnode_links(base, leaf)[SCC_BPTREE_LINK_NEXT];
+}
+
+static inline struct scc_bpnode_base *scc_bpnode_prev(struct scc_bptree_base const *restrict base, struct scc_bpnode_base const *restrict leaf) {
+    return scc_bpnode_links(base, leaf)[SCC_BPTREE_LINK_PREV];
+}
+
+static inline void *scc_bpnode_data(struct scc_bptree_base const *restrict base, struct scc_bpnode_base const *restrict node) {
+    return (unsigned char *)(uintptr_t)node + base->bp_dataoff;
+}
+
+static inline void *scc_bpnode_value(
+    struct scc_bptree_base const *restrict base,
+    struct scc_bpnode_base const *restrict node,
+    size_t index,
+    size_t elemsize
+) {
+    return (unsigned char *)scc_bpnode_data(base, node) + index * elemsize;
+}
+
+static inline size_t scc_bpnode_lower_bound(
+    struct scc_bptree_base const *base,
+    struct scc_bpnode_base const *node,
+    void const *restrict value,
+    size_t elemsize
+) {
+    return scc_algo_lower_bound(value, scc_bpnode_data(base, node), node->bp_nkeys, elemsize, base->bp_compare);
+}
+
+/* Move n consecutive elements of the given size, no-op if n is 0 */
+static inline void scc_bpnode_move(void *dst, void const *src, size_t n, size_t size) {
+    if (n) {
+        scc_memmove(dst, src, n * size);
+    }
+}
+
+static void scc_bpnode_insert_value(
+    struct scc_bptree_base const *restrict base,
+    struct scc_bpnode_base *restrict node,
+    size_t index,
+    void const *restrict value,
+    size_t elemsize
+) {
+    unsigned char *slot = scc_bpnode_value(base, node, index, elemsize);
+    scc_bpnode_move(slot + elemsize, slot, node->bp_nkeys - index, elemsize);
+    scc_memcpy(slot, value, elemsize);
+    ++node->bp_nkeys;
+}
+
+static void scc_bpnode_remove_value(
+    struct scc_bptree_base const *restrict base,
+    struct scc_bpnode_base *restrict node,
+    size_t index,
+    size_t elemsize
+) {
+    unsigned char *slot = scc_bpnode_value(base, node, index, elemsize);
+    --node->bp_nkeys;
+    scc_bpnode_move(slot, slot + elemsize, node->bp_nkeys - index, elemsize);
+}
+
+/* Insert separator at index along with the child to its right */
+static void scc_bpnode_insert_sep(
+    struct scc_bptree_base const *restrict base,
+    struct scc_bpnode_base *restrict node,
+    size_t index,
+    void const *restrict sep,
+    struct scc_bpnode_base *restrict child,
+    size_t elemsize
+) {
+    struct scc_bpnode_base **links = scc_bpnode_links(base, node);
+    scc_bpnode_move(links + index + 2u, links + index + 1u, node->bp_nkeys - index, sizeof(*links));
+    links[index + 1u] = child;
+    scc_bpnode_insert_value(base, node, index, sep, elemsize);
+}
+
+/* Remove separator at index along with the child to its right */
+static void scc_bpnode_remove_sep(
+    struct scc_bptree_base const *restrict base,
+    struct scc_bpnode_base *restrict node,
+    size_t index,
+    size_t elemsize
+) {
+    struct scc_bpnode_base **links = scc_bpnode_links(base, node);
+    scc_bpnode_move(links + index + 1u, links + index + 2u, node->bp_nkeys - index - 1u, sizeof(*links));
+    scc_bpnode_remove_value(base, node, index, elemsize);
+}
+
+/* Split the full leaf while inserting value at bound. Both halves
+ * end up with at least half of the elements */
+static struct scc_bpnode_base *scc_bpnode_split_leaf(
+    struct scc_bptree_base *restrict base,
+    struct scc_bpnode_base *restrict node,
+    size_t bound,
+    void const *restrict value,
+    size_t elemsize
+) {
+    struct scc_bpnode_base *right = scc_arena_alloc(&base->bp_arena);
+    /* Cannot fail thanks to reserve */
+    assert(right);
+    right->bp_flags = SCC_BPTREE_FLAG_LEAF;
+
+    size_t const nelems = node->bp_nkeys;
+    size_t const nleft = (nelems + 2u) >> 1u;
+    if (bound < nleft) {
+        right->bp_nkeys = nelems - nleft + 1u;
+        scc_memcpy(scc_bpnode_data(base, right), scc_bpnode_value(base, node, nleft - 1u, elemsize), right->bp_nkeys * elemsize);
+        node->bp_nkeys = nleft - 1u;
+        scc_bpnode_insert_value(base, node, bound, value, elemsize);
+    }
+    else {
+        right->bp_nkeys = nelems - nleft;
+        scc_bpnode_move(scc_bpnode_data(base, right), scc_bpnode_value(base, node, nleft, elemsize), right->bp_nkeys, elemsize);
+        node->bp_nkeys = nleft;
+        scc_bpnode_insert_value(base, right, bound - nleft, value, elemsize);
+    }
+
+    struct scc_bpnode_base **llinks = scc_bpnode_links(base, node);
+    struct scc_bpnode_base **rlinks = scc_bpnode_links(base, right);
+    rlinks[SCC_BPTREE_LINK_NEXT] = llinks[SCC_BPTREE_LINK_NEXT];
+    rlinks[SCC_BPTREE_LINK_PREV] = node;
+    if (rlinks[SCC_BPTREE_LINK_NEXT]) {
+        scc_bpnode_links(base, rlinks[SCC_BPTREE_LINK_NEXT])[SCC_BPTREE_LINK_PREV] = right;
+    }
+    llinks[SCC_BPTREE_LINK_NEXT] = right;
+    return right;
+}
+
+/* Split the full internal node while inserting sep and child at index. The
+ * separator to be pushed to the parent is stored in the first unused slot
+ * of the returned node */
+static struct scc_bpnode_base *scc_bpnode_split_internal(
+    struct scc_bptree_base *restrict base,
+    struct scc_bpnode_base *restrict node,
+    size_t index,
+    void const *restrict sep,
+    struct scc_bpnode_base *restrict child,
+    size_t elemsize
+) {
+    struct scc_bpnode_base *right = scc_arena_alloc(&base->bp_arena);
+    assert(right);
+    right->bp_flags = 0u;
+
+    /* Keys and links of node as if sep and child had been inserted */
+#define vkey(i) ((i) < index ? scc_bpnode_value(base, node, (i), elemsize) :                          \
+                 (i) == index ? sep : scc_bpnode_value(base, node, (i) - 1u, elemsize))
+#define vlink(i) ((i) <= index ? llinks[i] : (i) == index + 1u ? child : llinks[(i) - 1u])
+
+    struct scc_bpnode_base **llinks = scc_bpnode_links(base, node);
+    struct scc_bpnode_base **rlinks = scc_bpnode_links(base, right);
+
+    size_t const nkeys = node->bp_nkeys;
+    size_t const nleft = (nkeys + 1u) >> 1u;
+    right->bp_nkeys = nkeys - nleft;
+
+    for (size_t i = 0u; i < right->bp_nkeys; ++i) {
+        scc_memcpy(scc_bpnode_value(base, right, i, elemsize), vkey(nleft + 1u + i), elemsize);
+    }
+    scc_memcpy(scc_bpnode_value(base, right, right->bp_nkeys, elemsize), vkey(nleft), elemsize);
+    for (size_t i = 0u; i <= right->bp_nkeys; ++i) {
+        rlinks[i] = vlink(nleft + 1u + i);
+    }
+
+#undef vlink
+#undef vkey
+
+    if (index < nleft) {
+        size_t const nmov = nleft - 1u - index;
+        unsigned char *slot = scc_bpnode_value(base, node, index, elemsize);
+        scc_bpnode_move(slot + elemsize, slot, nmov, elemsize);
+        scc_memcpy(slot, sep, elemsize);
+        scc_bpnode_move(llinks + index + 2u, llinks + index + 1u, nmov, sizeof(*llinks));
+        llinks[index + 1u] = child;
+    }
+    node->bp_nkeys = nleft;
+    return right;
+}
+
+static inline void scc_bptree_new_root(
+    struct scc_bptree_base *restrict base,
+    struct scc_bpnode_base *restrict left,
+    void const *restrict sep,
+    struct scc_bpnode_base *restrict right,
+    size_t elemsize
+) {
+    struct scc_bpnode_base *root = scc_arena_alloc(&base->bp_arena);
+    assert(root);
+    root->bp_flags = 0u;
+    root->bp_nkeys = 1u;
+    scc_memcpy(scc_bpnode_data(base, root), sep, elemsize);
+    struct scc_bpnode_base **links = scc_bpnode_links(base, root);
+    links[0] = left;
+    links[1] = right;
+    base->bp_root = root;
+}
+
+static void scc_bptree_balance_leaf(
+    struct scc_bptree_base *restrict base,
+    struct scc_bpnode_base *restrict node,
+    struct scc_bpnode_base *restrict p,
+    size_t index,
+    size_t elemsize
+) {
+    size_t const minkeys = scc_bptree_minkeys(base);
+    struct scc_bpnode_base *sibling;
+    if (index) {
+        sibling = scc_bpnode_child(base, p, index - 1u);
+        if (sibling->bp_nkeys > minkeys) {
+            /* Borrow largest element from left sibling */
+            scc_bpnode_insert_value(base, node, 0u, scc_bpnode_value(base, sibling, sibling->bp_nkeys - 1u, elemsize), elemsize);
+            --sibling->bp_nkeys;
+            scc_memcpy(scc_bpnode_value(base, p, index - 1u, elemsize), scc_bpnode_data(base, node), elemsize);
+            return;
+        }
+    }
+
+    if (index < p->bp_nkeys) {
+        sibling = scc_bpnode_child(base, p, index + 1u);
+        if (sibling->bp_nkeys > minkeys) {
+            /* Borrow smallest element from right sibling */
+            scc_memcpy(scc_bpnode_value(base, node, node->bp_nkeys++, elemsize), scc_bpnode_data(base, sibling), elemsize);
+            scc_bpnode_remove_value(base, sibling, 0u, elemsize);
+            scc_memcpy(scc_bpnode_value(base, p, index, elemsize), scc_bpnode_data(base, sibling), elemsize);
+            return;
+        }
+    }
+    else {
+        /* Rightmost child, merge into left sibling */
+        sibling = node;
+        node = scc_bpnode_child(base, p, --index);
+    }
+
+    scc_bpnode_move(
+        scc_bpnode_value(base, node, node->bp_nkeys, elemsize),
+        scc_bpnode_data(base, sibling),
+        sibling->bp_nkeys,
+        elemsize
+    );
+    node->bp_nkeys += sibling->bp_nkeys;
+    assert(node->bp_nkeys < base->bp_order);
+
+    struct scc_bpnode_base *next = scc_bpnode_next(base, sibling);
+    scc_bpnode_links(base, node)[SCC_BPTREE_LINK_NEXT] = next;
+    if (next) {
+        scc_bpnode_links(base, next)[SCC_BPTREE_LINK_PREV] = node;
+    }
+
+    scc_bpnode_remove_sep(base, p, index, elemsize);
+    scc_bpnode_free(base, sibling);
+}
+
+static void scc_bptree_balance_internal(
+    struct scc_bptree_base *restrict base,
+    struct scc_bpnode_base *restrict node,
+    struct scc_bpnode_base *restrict p,
+    size_t index,
+    size_t elemsize
+) {
+    size_t const minkeys = scc_bptree_minkeys(base);
+    struct scc_bpnode_base **nlinks = scc_bpnode_links(base, node);
+    struct scc_bpnode_base **slinks;
+    struct scc_bpnode_base *sibling;
+    if (index) {
+        sibling = scc_bpnode_child(base, p, index - 1u);
+        if (sibling->bp_nkeys > minkeys) {
+            /* Rotate right through the parent */
+            slinks = scc_bpnode_links(base, sibling);
+            scc_memmove(nlinks + 1u, nlinks, (node->bp_nkeys + 1u) * sizeof(*nlinks));
+            nlinks[0] = slinks[sibling->bp_nkeys];
+            scc_bpnode_insert_value(base, node, 0u, scc_bpnode_value(base, p, index - 1u, elemsize), elemsize);
+            scc_memcpy(
+                scc_bpnode_value(base, p, index - 1u, elemsize),
+                scc_bpnode_value(base, sibling, sibling->bp_nkeys - 1u, elemsize),
+                elemsize
+            );
+            --sibling->bp_nkeys;
+            return;
+        }
+    }
+
+    if (index < p->bp_nkeys) {
+        sibling = scc_bpnode_child(base, p, index + 1u);
+        slinks = scc_bpnode_links(base, sibling);
+        if (sibling->bp_nkeys > minkeys) {
+            /* Rotate left through the parent */
+            scc_memcpy(scc_bpnode_value(base, node, node->bp_nkeys, elemsize), scc_bpnode_value(base, p, index, elemsize), elemsize);
+            nlinks[++node->bp_nkeys] = slinks[0];
+            scc_memcpy(scc_bpnode_value(base, p, index, elemsize), scc_bpnode_data(base, sibling), elemsize);
+            scc_memmove(slinks, slinks + 1u, sibling->bp_nkeys * sizeof(*slinks));
+            scc_bpnode_remove_value(base, sibling, 0u, elemsize);
+            return;
+        }
+    }
+    else {
+        /* Rightmost child, merge into left sibling */
+        sibling = node;
+        node = scc_bpnode_child(base, p, --index);
+        slinks = scc_bpnode_links(base, sibling);
+        nlinks = scc_bpnode_links(base, node);
+    }
+
+    /* Pull separator down and append sibling */
+    scc_memcpy(scc_bpnode_value(base, node, node->bp_nkeys, elemsize), scc_bpnode_value(base, p, index, elemsize), elemsize);
+    scc_bpnode_move(
+        scc_bpnode_value(base, node, node->bp_nkeys + 1u, elemsize),
+        scc_bpnode_data(base, sibling),
+        sibling->bp_nkeys,
+        elemsize
+    );
+    scc_memcpy(nlinks + node->bp_nkeys + 1u, slinks, (sibling->bp_nkeys + 1u) * sizeof(*nlinks));
+    node->bp_nkeys += sibling->bp_nkeys + 1u;
+    assert(node->bp_nkeys < base->bp_order);
+
+    scc_bpnode_remove_sep(base, p, index, elemsize);
+    scc_bpnode_free(base, sibling);
+}
+
+static void scc_bptree_balance(
+    struct scc_bptree_base *restrict base,
+    struct scc_bpnode_base *node,
+    scc_stack(struct scc_bppath) path,
+    size_t elemsize
+) {
+    size_t const minkeys = scc_bptree_minkeys(base);
+    struct scc_bppath top;
+    while (!scc_stack_empty(path) && node->bp_nkeys < minkeys) {
+        top = scc_stack_top(path);
+        (void)scc_stack_pop(path);
+        if (scc_bpnode_is_leaf(node)) {
+            scc_bptree_balance_leaf(base, node, top.node, top.index, elemsize);
+        }
+        else {
+            scc_bptree_balance_internal(base, node, top.node, top.index, elemsize);
+        }
+        node = top.node;
+    }
+
+    node = base->bp_root;
+    if (!scc_bpnode_is_leaf(node) && !node->bp_nkeys) {
+        base->bp_root = *scc_bpnode_links(base, node);
+        scc_bpnode_free(base, node);
+    }
+}
+
+/* Move path to the leftmost leaf to the right of the current one */
+static struct scc_bpnode_base *scc_bptree_path_next_leaf(
+    struct scc_bptree_base const *restrict base,
+    scc_stack(struct scc_bppath) *path
+) {
+    struct scc_bppath *top;
+    while (!scc_stack_empty((*path))) {
+        top = &scc_stack_top((*path));
+        if (top->index < top->node->bp_nkeys) {
+            break;
+        }
+        (void)scc_stack_pop((*path));
+    }
+    if (scc_stack_empty((*path))) {
+        return 0;
+    }
+
+    struct scc_bpnode_base *curr = scc_bpnode_child(base, top->node, ++top->index);
+    while (!scc_bpnode_is_leaf(curr)) {
+        if (!scc_stack_push(path, (struct scc_bppath) { .node = curr, .index = 0u })) {
+            return 0;
+        }
+        curr = scc_bpnode_child(base, curr, 0u);
+    }
+    return curr;
+}
+
+static inline void scc_bptree_impl_free(struct scc_bptree_base *base) {
+    scc_arena_release(&base->bp_arena);
+    if (base->bp_dynalloc) {
+        scc_allocator_free(base->bp_arena.ar_allocator, base);
+    }
+}
+
+void *scc_bptree_impl_new(void *base, size_t coff, size_t rootoff) {
+#define base ((struct scc_bptree_base *)base)
+    size_t fwoff = coff - offsetof(struct scc_bptree_base, bp_fwoff) - sizeof(base->bp_fwoff);
+    assert(fwoff <= UCHAR_MAX);
+    base->bp_fwoff = (unsigned char)fwoff;
+    scc_bptree_root_init(base, (unsigned char *)base + rootoff);
+    unsigned char *bptree = (unsigned char *)base + coff;
+    scc_bptree_set_bkoff(bptree, fwoff);
+    return bptree;
+#undef base
+}
+
+void *scc_bptree_impl_new_dyn(void *sbase, size_t basesz, size_t coff, size_t rootoff) {
+    struct scc_bptree_base *base = scc_allocator_alloc(((struct scc_bptree_base *)sbase)->bp_arena.ar_allocator, basesz);
+    if (!base) {
+        return 0;
+    }
+
+    scc_memcpy(base, sbase, basesz);
+    void *bptree = scc_bptree_impl_new(base, coff, rootoff);
+    base->bp_dynalloc = 1;
+    return bptree;
+}
+
+void scc_bptree_free(void *bptree) {
+    struct scc_bptree_base *base = scc_bptree_impl_base(bptree);
+    scc_bptree_impl_free(base);
+}
+
+_Bool scc_bptree_impl_insert(void *bptreeaddr, size_t elemsize) {
+    struct scc_bptree_base *base = scc_bptree_impl_base(*(void **)bptreeaddr);
+    void const *value = *(void **)bptreeaddr;
+    bool success = false;
+
+    scc_stack(struct scc_bppath) path = scc_stack_new(struct scc_bppath);
+
+    /* Splitting a full root requires a new root */
+    size_t req_allocs = 1u;
+    size_t bound;
+    struct scc_bpnode_base *curr = base->bp_root;
+    while (!scc_bpnode_is_leaf(curr)) {
+        req_allocs = scc_bpnode_full(base, curr) ? req_allocs + 1u : 0u;
+        bound = scc_bpnode_lower_bound(base, curr, value, elemsize);
+        if (!scc_stack_push(&path, (struct scc_bppath) { .node = curr, .index = bound })) {
+            goto epilogue;
+        }
+        curr = scc_bpnode_child(base, curr, bound);
+    }
+
+    bound = scc_bpnode_lower_bound(base, curr, value, elemsize);
+    if (!scc_bpnode_full(base, curr)) {
+        scc_bpnode_insert_value(base, curr, bound, value, elemsize);
+        ++base->bp_size;
+        success = true;
+        goto epilogue;
+    }
+
+    /* Make sure tree can't end up in invalid state due to
+     * allocation failures */
+    if (!scc_arena_reserve(&base->bp_arena, req_allocs + 1u)) {
+        goto epilogue;
+    }
+
+    struct scc_bpnode_base *right = scc_bpnode_split_leaf(base, curr, bound, value, elemsize);
+    /* Separators in internal nodes are copies of the first element in the right leaf */
+    void const *sep = scc_bpnode_data(base, right);
+
+    struct scc_bppath top;
+    while (1) {
+        if (scc_stack_empty(path)) {
+            scc_bptree_new_root(base, curr, sep, right, elemsize);
+            break;
+        }
+
+        top = scc_stack_top(path);
+        (void)scc_stack_pop(path);
+        if (!scc_bpnode_full(base, top.node)) {
+            scc_bpnode_insert_sep(base, top.node, top.index, sep, right, elemsize);
+            break;
+        }
+
+        right = scc_bpnode_split_internal(base, top.node, top.index, sep, right, elemsize);
+        sep = scc_bpnode_value(base, right, right->bp_nkeys, elemsize);
+        curr = top.node;
+    }
+
+    ++base->bp_size;
+    success = true;
+
+epilogue:
+    scc_stack_free(path);
+    return success;
+}
+
+void const *scc_bptree_impl_find(void const *bptree, size_t elemsize) {
+    void const *leaf;
+    void const *addr = scc_bptree_impl_lower_bound(bptree, &leaf, elemsize);
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    if (!addr || base->bp_compare(addr, bptree)) {
+        return 0;
+    }
+    return addr;
+}
+
+_Bool scc_bptree_impl_remove(void *bptree, size_t elemsize) {
+    struct scc_bptree_base *base = scc_bptree_impl_base(bptree);
+    bool success = false;
+
+    scc_stack(struct scc_bppath) path = scc_stack_new(struct scc_bppath);
+
+    size_t bound;
+    struct scc_bpnode_base *curr = base->bp_root;
+    while (!scc_bpnode_is_leaf(curr)) {
+        bound = scc_bpnode_lower_bound(base, curr, bptree, elemsize);
+        if (!scc_stack_push(&path, (struct scc_bppath) { .node = curr, .index = bound })) {
+            goto epilogue;
+        }
+        curr = scc_bpnode_child(base, curr, bound);
+    }
+
+    bound = scc_bpnode_lower_bound(base, curr, bptree, elemsize);
+    if (bound == curr->bp_nkeys) {
+        /* Separators are not updated on removal, the value may
+         * be the first in the next leaf */
+        curr = scc_bptree_path_next_leaf(base, &path);
+        if (!curr) {
+            goto epilogue;
+        }
+        bound = 0u;
+    }
+
+    if (base->bp_compare(scc_bpnode_value(base, curr, bound, elemsize), bptree)) {
+        goto epilogue;
+    }
+
+    scc_bpnode_remove_value(base, curr, bound, elemsize);
+    --base->bp_size;
+    success = true;
+
+    scc_bptree_balance(base, curr, path, elemsize);
+
+epilogue:
+    scc_stack_free(path);
+    return success;
+}
+
+void *scc_bptree_impl_clone(void const *bptree, size_t elemsize) {
+    struct scc_bptree_base const *obase = scc_bptree_impl_base_qual(bptree, const);
+    size_t basesz = (unsigned char const *)bptree - (unsigned char const *)obase;
+
+    size_t bytesz = basesz + elemsize;
+    scc_when_mutating(assert(bytesz > basesz));
+
+    struct scc_bptree_base *nbase = scc_allocator_alloc(obase->bp_arena.ar_allocator, bytesz);
+    if (!nbase) {
+        return 0;
+    }
+    scc_memcpy(nbase, obase, basesz);
+    nbase->bp_arena = scc_arena_clone(&obase->bp_arena);
+    nbase->bp_dynalloc = 1;
+
+    struct stage {
+        unsigned index;
+        struct scc_bpnode_base const *old;
+        struct scc_bpnode_base **new;
+    };
+
+    void *nbptree = 0;
+    /* Leaves are visited in order, chain each to the previous one */
+    struct scc_bpnode_base *prev = 0;
+
+    scc_stack(struct stage) stack = scc_stack_new(struct stage);
+    if (!scc_stack_push(&stack, (struct stage){ .old = obase->bp_root, .new = &nbase->bp_root })) {
+        goto epilogue;
+    }
+
+    struct stage *s;
+    struct scc_bpnode_base *node;
+    struct scc_bpnode_base **links;
+    while (!scc_stack_empty(stack)) {
+        s = &scc_stack_top(stack);
+
+        if (!s->index) {
+            node = scc_arena_alloc(&nbase->bp_arena);
+            if (!node) {
+                goto epilogue;
+            }
+            *s->new = node;
+            /* Copy everything up to the link array */
+            scc_memcpy(node, s->old, nbase->bp_linkoff);
+            node->bp_flags &= ~SCC_BPTREE_FLAG_EMBEDDED;
+
+            if (scc_bpnode_is_leaf(node)) {
+                links = scc_bpnode_links(nbase, node);
+                links[SCC_BPTREE_LINK_NEXT] = 0;
+                links[SCC_BPTREE_LINK_PREV] = prev;
+                if (prev) {
+                    scc_bpnode_links(nbase, prev)[SCC_BPTREE_LINK_NEXT] = node;
+                }
+                prev = node;
+                (void)scc_stack_pop(stack);
+                continue;
+            }
+        }
+
+        if (s->index == s->old->bp_nkeys + 1u) {
+            (void)scc_stack_pop(stack);
+            continue;
+        }
+
+        links = scc_bpnode_links(nbase, *s->new);
+        struct stage next = {
+            .old = scc_bpnode_child(obase, s->old, s->index),
+            .new = &links[s->index]
+        };
+        ++s->index;
+        if (!scc_stack_push(&stack, next)) {
+            goto epilogue;
+        }
+    }
+
+    nbptree = (unsigned char *)nbase + offsetof(struct scc_bptree_base, bp_fwoff) + nbase->bp_fwoff + sizeof(nbase->bp_fwoff);
+epilogue:
+    scc_stack_free(stack);
+    if (!nbptree) {
+        scc_bptree_impl_free(nbase);
+    }
+
+    return nbptree;
+}
+
+void const *scc_bptree_impl_leftmost(void const *bptree, void const **leaf) {
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    struct scc_bpnode_base const *curr = base->bp_root;
+    while (!scc_bpnode_is_leaf(curr)) {
+        curr = scc_bpnode_child(base, curr, 0u);
+    }
+
+    *leaf = curr;
+    return curr->bp_nkeys ? scc_bpnode_data(base, curr) : 0;
+}
+
+void const *scc_bptree_impl_rightmost(void const *bptree, void const **leaf, size_t elemsize) {
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    struct scc_bpnode_base const *curr = base->bp_root;
+    while (!scc_bpnode_is_leaf(curr)) {
+        curr = scc_bpnode_child(base, curr, curr->bp_nkeys);
+    }
+
+    *leaf = curr;
+    return curr->bp_nkeys ? scc_bpnode_value(base, curr, curr->bp_nkeys - 1u, elemsize) : 0;
+}
+
+void const *scc_bptree_impl_lower_bound(void const *bptree, void const **leaf, size_t elemsize) {
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    struct scc_bpnode_base const *curr = base->bp_root;
+    while (!scc_bpnode_is_leaf(curr)) {
+        curr = scc_bpnode_child(base, curr, scc_bpnode_lower_bound(base, curr, bptree, elemsize));
+    }
+
+    size_t bound = scc_bpnode_lower_bound(base, curr, bptree, elemsize);
+    if (bound == curr->bp_nkeys) {
+        /* All elements in the leaf are smaller, any larger
+         * ones start the next leaf */
+        curr = scc_bpnode_next(base, curr);
+        if (!curr) {
+            return 0;
+        }
+        bound = 0u;
+    }
+
+    *leaf = curr;
+    return scc_bpnode_value(base, curr, bound, elemsize);
+}
+
+void const *scc_bptree_impl_range_begin(void const *bptree, void const **leaf, void const *end, size_t elemsize) {
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    /* Empty range if the lower bound exceeds the first element not in it */
+    if (end && base->bp_compare(bptree, end) > 0) {
+        return end;
+    }
+    return scc_bptree_impl_lower_bound(bptree, leaf, elemsize);
+}
+
+void const *scc_bptree_impl_successor(void const *bptree, void const **leaf, void const *iter, size_t elemsize) {
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    struct scc_bpnode_base const *curr = *leaf;
+
+    unsigned char const *next = (unsigned char const *)iter + elemsize;
+    if (next < (unsigned char const *)scc_bpnode_value(base, curr, curr->bp_nkeys, elemsize)) {
+        return next;
+    }
+
+    curr = scc_bpnode_next(base, curr);
+    if (!curr) {
+        return 0;
+    }
+    *leaf = curr;
+    return scc_bpnode_data(base, curr);
+}
+
+void const *scc_bptree_impl_predecessor(void const *bptree, void const **leaf, void const *iter, size_t elemsize) {
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    struct scc_bpnode_base const *curr = *leaf;
+
+    unsigned char const *prev = iter;
+    if (prev > (unsigned char const *)scc_bpnode_data(base, curr)) {
+        return prev - elemsize;
+    }
+
+    curr = scc_bpnode_prev(base, curr);
+    if (!curr) {
+        return 0;
+    }
+    *leaf = curr;
+    return scc_bpnode_value(base, curr, curr->bp_nkeys - 1u, elemsize);
+}
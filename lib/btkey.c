@@ -0,0 +1,62 @@
+#include <scc/arch.h>
+#include <scc/btree.h>
+
+#include <stdint.h>
+
+#define scc_btkey_compare(type, left, right)                                \
+    ((*(type const *)(left) > *(type const *)(right)) -                     \
+        (*(type const *)(left) < *(type const *)(right)))
+
+/* Portable lower bound counting the keys ordered before key. There
+ * are no branches on the keys, allowing the loop to be vectorized */
+#define scc_btkey_define_lower_bound(suffix, type)                          \
+    size_t scc_btkey_impl_lower_bound_##suffix##_swar(                      \
+        void const *keys,                                                   \
+        size_t nkeys,                                                       \
+        void const *key                                                     \
+    ) {                                                                     \
+        type const *k = keys;                                               \
+        type const value = *(type const *)key;                              \
+        size_t bound = 0u;                                                  \
+        for (size_t i = 0u; i < nkeys; ++i) {                               \
+            bound += k[i] < value;                                          \
+        }                                                                   \
+        return bound;                                                       \
+    }
+
+int scc_btcompare_i32(void const *left, void const *right) {
+    return scc_btkey_compare(int32_t, left, right);
+}
+
+int scc_btcompare_i64(void const *left, void const *right) {
+    return scc_btkey_compare(int64_t, left, right);
+}
+
+int scc_btcompare_f32(void const *left, void const *right) {
+    return scc_btkey_compare(float, left, right);
+}
+
+int scc_btcompare_f64(void const *left, void const *right) {
+    return scc_btkey_compare(double, left, right);
+}
+
+unsigned char scc_btkey_impl_kind(scc_btcompare compare) {
+    if (compare == scc_btcompare_i32) {
+        return SCC_BTKEY_I32;
+    }
+    if (compare == scc_btcompare_i64) {
+        return SCC_BTKEY_I64;
+    }
+    if (compare == scc_btcompare_f32) {
+        return SCC_BTKEY_F32;
+    }
+    if (compare == scc_btcompare_f64) {
+        return SCC_BTKEY_F64;
+    }
+    return SCC_BTKEY_GENERIC;
+}
+
+scc_btkey_define_lower_bound(i32, int32_t)
+scc_btkey_define_lower_bound(i64, int64_t)
+scc_btkey_define_lower_bound(f32, float)
+scc_btkey_define_lower_bound(f64, double)
@@ -1,4 +1,5 @@
 #include <scc/algorithm.h>
+#include <scc/arch.h>
 #include <scc/bits.h>
 #include <scc/btmap.h>
 #include <scc/stack.h>
@@ -6,7 +7,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <stdbool.h>
-#include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 
 size_t scc_btmap_order(void const *btmap);
@@ -17,7 +18,17 @@ size_t scc_btmap_size(void const *btmap);
 
 #define BOUND_MASK ((~(size_t)0u) >> 1u)
 
-enum { SCC_BTMAP_FLAG_LEAF = 0x01 };
+/* Whether the key at the lower bound in a node with keys of a builtin
+ * type matches value. The key is not ordered before value, so the two
+ * are equal unless value is ordered before the key */
+#define scc_btmnode_bound_eq(type, keys, nkeys, value, bound)                                       \
+    ((bound) < (nkeys) && !(*(type const *)(value) < ((type const *)(keys))[bound]))
+
+enum {
+    SCC_BTMAP_FLAG_LEAF = 0x01,
+    /* Root node stored in the btmap base rather than the arena */
+    SCC_BTMAP_FLAG_EMBEDDED = 0x02
+};
 
 static inline void scc_btmap_set_bkoff(void *btmap, unsigned char bkoff) {
     ((unsigned char *)btmap)[-1] = bkoff;
@@ -25,7 +36,7 @@ static inline void scc_btmap_set_bkoff(void *btmap, unsigned char bkoff) {
 
 static inline void scc_btmap_root_init(struct scc_btmap_base *base, void *root) {
     base->btm_root = root;
-    base->btm_root->btm_flags |= SCC_BTMAP_FLAG_LEAF;
+    base->btm_root->btm_flags |= SCC_BTMAP_FLAG_LEAF | SCC_BTMAP_FLAG_EMBEDDED;
 }
 
 static inline _Bool scc_btmnode_full(struct scc_btmap_base const *base, struct scc_btmnode_base const *node) {
@@ -41,6 +52,12 @@ static inline void scc_btmnode_flags_clear(struct scc_btmnode_base *node) {
     node->btm_flags = 0;
 }
 
+static inline void scc_btmnode_free(struct scc_btmap_base *restrict base, struct scc_btmnode_base *restrict node) {
+    if (!(node->btm_flags & SCC_BTMAP_FLAG_EMBEDDED)) {
+        scc_arena_free(&base->btm_arena, node);
+    }
+}
+
 static inline void *scc_btmnode_keys(struct scc_btmap_base const *restrict base, struct scc_btmnode_base *restrict node) {
     return (unsigned char *)node + base->btm_keyoff;
 }
@@ -86,7 +103,35 @@ static inline size_t scc_btmnode_lower_bound(struct scc_btmap_base const *base,
     if (!node->btm_nkeys) {
         return 0u;
     }
-    return scc_algo_lower_bound_eq(value, scc_btmnode_keys(base, node), node->btm_nkeys, base->btm_keysize, base->btm_compare);
+    void const *keys = scc_btmnode_keys(base, node);
+    size_t const nkeys = node->btm_nkeys;
+    size_t bound;
+    _Bool eq;
+    switch (base->btm_keykind) {
+        case SCC_BTKEY_I32:
+            bound = scc_btkey_impl_lower_bound_i32(keys, nkeys, value);
+            eq = scc_btmnode_bound_eq(int32_t, keys, nkeys, value, bound);
+            break;
+        case SCC_BTKEY_I64:
+            bound = scc_btkey_impl_lower_bound_i64(keys, nkeys, value);
+            eq = scc_btmnode_bound_eq(int64_t, keys, nkeys, value, bound);
+            break;
+        case SCC_BTKEY_F32:
+            bound = scc_btkey_impl_lower_bound_f32(keys, nkeys, value);
+            eq = scc_btmnode_bound_eq(float, keys, nkeys, value, bound);
+            break;
+        case SCC_BTKEY_F64:
+            bound = scc_btkey_impl_lower_bound_f64(keys, nkeys, value);
+            eq = scc_btmnode_bound_eq(double, keys, nkeys, value, bound);
+            break;
+        default:
+            return scc_algo_lower_bound_eq(value, keys, nkeys, base->btm_keysize, base->btm_compare);
+    }
+    return eq ? bound | ~BOUND_MASK : bound;
+}
+
+static inline size_t scc_btmnode_upper_bound(struct scc_btmap_base const *base, struct scc_btmnode_base *node, void const *restrict value) {
+    return scc_algo_upper_bound(value, scc_btmnode_keys(base, node), node->btm_nkeys, base->btm_keysize, base->btm_compare);
 }
 
 static inline _Bool scc_btmnode_keyeq(size_t bound) {
@@ -202,7 +247,7 @@ static struct scc_btmnode_base *scc_btmnode_split_preemptive(
     node->btm_nkeys >>= 1u;
     right->btm_nkeys = node->btm_nkeys;
 
-    right->btm_flags = node->btm_flags;
+    right->btm_flags = node->btm_flags & ~SCC_BTMAP_FLAG_EMBEDDED;
 
     scc_memcpy(rkeys, lkeys + (node->btm_nkeys + 1u) * base->btm_keysize, right->btm_nkeys * base->btm_keysize);
     scc_memcpy(rvals, lvals + (node->btm_nkeys + 1u) * base->btm_valsize, right->btm_nkeys * base->btm_valsize);
@@ -258,7 +303,7 @@ static struct scc_btmnode_base *scc_btmnode_split_non_preemptive(
 
     node->btm_nkeys >>= 1u;
     right->btm_nkeys = node->btm_nkeys;
-    right->btm_flags = node->btm_flags;
+    right->btm_flags = node->btm_flags & ~SCC_BTMAP_FLAG_EMBEDDED;
 
     unsigned char *rkeys = scc_btmnode_keys(base, right);
     unsigned char *rvals = scc_btmnode_vals(base, right);
@@ -622,7 +667,7 @@ static inline void scc_btmnode_merge_left_non_preemptive(
 ) {
     (void)scc_btmnode_merge(base, node, sibling, p, bound - 1u);
     assert(p->btm_nkeys < bound);
-    scc_arena_try_free(&base->btm_arena, node);
+    scc_btmnode_free(base, node);
 }
 
 static inline void scc_btmnode_merge_left_preemptive(
@@ -634,7 +679,7 @@ static inline void scc_btmnode_merge_left_preemptive(
 ) {
     scc_btmnode_merge_left_non_preemptive(base, node, sibling, p, bound);
     if (!p->btm_nkeys) {
-        scc_arena_try_free(&base->btm_arena, p);
+        scc_btmnode_free(base, p);
     }
 }
 
@@ -651,7 +696,7 @@ static inline void scc_btmnode_merge_right_non_preemptive(
         struct scc_btmnode_base **plinks = scc_btmnode_links(base, p);
         scc_memmove(plinks + bound + 1u, plinks + bound + 2u, nmov * sizeof(*plinks));
     }
-    scc_arena_try_free(&base->btm_arena, sibling);
+    scc_btmnode_free(base, sibling);
 }
 
 static inline void scc_btmnode_merge_right_preemptive(
@@ -663,7 +708,7 @@ static inline void scc_btmnode_merge_right_preemptive(
 ) {
     scc_btmnode_merge_right_non_preemptive(base, node, sibling, p, bound);
     if (!p->btm_nkeys) {
-        scc_arena_try_free(&base->btm_arena, p);
+        scc_btmnode_free(base, p);
     }
 }
 
@@ -852,7 +897,7 @@ static void scc_btmap_balance_non_preemptive(
 
     if (!base->btm_root->btm_nkeys) {
         child = *scc_btmnode_links(base, base->btm_root);
-        scc_arena_try_free(&base->btm_arena, base->btm_root);
+        scc_btmnode_free(base, base->btm_root);
         base->btm_root = child;
     }
 }
@@ -930,7 +975,7 @@ epilogue:
 static inline void scc_btmap_impl_free(struct scc_btmap_base *base) {
     scc_arena_release(&base->btm_arena);
     if (base->btm_dynalloc) {
-        free(base);
+        scc_allocator_free(base->btm_arena.ar_allocator, base);
     }
 }
 
@@ -939,6 +984,7 @@ void *scc_btmap_impl_new(void *base, size_t coff, size_t rootoff) {
     size_t fwoff = coff - offsetof(struct scc_btmap_base, btm_fwoff) - sizeof(base->btm_fwoff);
     assert(fwoff <= UCHAR_MAX);
     base->btm_fwoff = (unsigned char)fwoff;
+    base->btm_keykind = scc_btkey_impl_kind(base->btm_compare);
     scc_btmap_root_init(base, (unsigned char *)base + rootoff);
     unsigned char *btmap = (unsigned char *)base + coff;
     scc_btmap_set_bkoff(btmap, fwoff);
@@ -947,7 +993,7 @@ void *scc_btmap_impl_new(void *base, size_t coff, size_t rootoff) {
 }
 
 void *scc_btmap_impl_new_dyn(void *sbase, size_t basesz, size_t coff, size_t rootoff) {
-    struct scc_btmap_base *base = malloc(basesz);
+    struct scc_btmap_base *base = scc_allocator_alloc(((struct scc_btmap_base *)sbase)->btm_arena.ar_allocator, basesz);
     if (!base) {
         return 0;
     }
@@ -962,6 +1008,129 @@ void scc_btmap_free(void *btmap) {
     scc_btmap_impl_free(scc_btmap_impl_base(btmap));
 }
 
+/* Shape of one level of a map built from sorted keys */
+struct scc_btmbuild_level {
+    struct scc_btmnode_base *node;  /* Node currently being filled */
+    size_t index;                   /* Index of node on the level */
+    size_t nkeys;                   /* Keys in each node, save for the first nextra */
+    size_t nextra;                  /* Number of nodes holding one extra key */
+};
+
+static inline size_t scc_btmbuild_quota(struct scc_btmbuild_level const *level) {
+    return level->nkeys + (level->index < level->nextra);
+}
+
+/* Compute the shape of each level of a map of n pairs, bottom up.
+ * Nodes on a level hold the same number of keys, give or take one,
+ * and pairs separating them are moved up a level. Returns the total
+ * number of nodes */
+static size_t scc_btmbuild_plan(struct scc_btmbuild_level *levels, size_t *height, size_t n, size_t order) {
+    size_t total = 0u;
+    size_t h = 0u;
+    size_t nnodes;
+    do {
+        assert(h < SCC_BTREE_MAX_HEIGHT);
+        nnodes = (n + order) / order;
+        levels[h] = (struct scc_btmbuild_level) {
+            .nkeys = (n - nnodes + 1u) / nnodes,
+            .nextra = (n - nnodes + 1u) % nnodes
+        };
+        total += nnodes;
+        n = nnodes - 1u;
+        ++h;
+    } while (nnodes > 1u);
+
+    *height = h;
+    return total;
+}
+
+static struct scc_btmnode_base *scc_btmbuild_node(struct scc_btmap_base *base, size_t level) {
+    struct scc_btmnode_base *node = scc_arena_alloc(&base->btm_arena);
+    /* Reserved up front */
+    assert(node);
+    node->btm_flags = level ? 0u : SCC_BTMAP_FLAG_LEAF;
+    node->btm_nkeys = 0u;
+    return node;
+}
+
+/* Move a pair separating two leaves to the lowest level with room for
+ * it, then start a new node on each of the levels below */
+static void scc_btmbuild_separate(
+    struct scc_btmap_base *restrict base,
+    struct scc_btmbuild_level *restrict levels,
+    void const *restrict key,
+    void const *restrict value
+) {
+    size_t h = 1u;
+    while (levels[h].node->btm_nkeys == scc_btmbuild_quota(&levels[h])) {
+        ++h;
+    }
+
+    struct scc_btmnode_base *node = levels[h].node;
+    scc_memcpy(scc_btmnode_key(base, node, node->btm_nkeys), key, base->btm_keysize);
+    scc_memcpy(scc_btmnode_value(base, node, node->btm_nkeys), value, base->btm_valsize);
+    ++node->btm_nkeys;
+
+    struct scc_btmnode_base *parent;
+    while (h--) {
+        parent = levels[h + 1u].node;
+        node = scc_btmbuild_node(base, h);
+        scc_btmnode_links(base, parent)[parent->btm_nkeys] = node;
+        levels[h].node = node;
+        ++levels[h].index;
+    }
+}
+
+void *scc_btmap_impl_from_sorted(void *btmap, void const *keys, void const *vals, size_t n) {
+    if (!btmap || !n) {
+        return btmap;
+    }
+
+    struct scc_btmap_base *base = scc_btmap_impl_base(btmap);
+    assert(!base->btm_size);
+
+    struct scc_btmbuild_level levels[SCC_BTREE_MAX_HEIGHT];
+    size_t height;
+    size_t nnodes = scc_btmbuild_plan(levels, &height, n, base->btm_order);
+    /* The root is embedded in the base */
+    if (nnodes > 1u && !scc_arena_reserve(&base->btm_arena, nnodes - 1u)) {
+        scc_btmap_free(btmap);
+        return 0;
+    }
+
+    /* First node on each level, the leftmost child of the one above */
+    levels[height - 1u].node = base->btm_root;
+    if (height > 1u) {
+        base->btm_root->btm_flags &= ~SCC_BTMAP_FLAG_LEAF;
+    }
+    for (size_t h = height - 1u; h--;) {
+        levels[h].node = scc_btmbuild_node(base, h);
+        scc_btmnode_links(base, levels[h + 1u].node)[0] = levels[h].node;
+    }
+
+    unsigned char const *ksrc = keys;
+    unsigned char const *vsrc = vals;
+    struct scc_btmnode_base *leaf;
+    size_t count;
+    for (size_t i = 0u; ; ++i) {
+        /* Pairs in a leaf are contiguous in the input */
+        leaf = levels[0].node;
+        count = scc_btmbuild_quota(&levels[0]);
+        assert(count && count <= n - i);
+        scc_memcpy(scc_btmnode_keys(base, leaf), ksrc + i * base->btm_keysize, count * base->btm_keysize);
+        scc_memcpy(scc_btmnode_vals(base, leaf), vsrc + i * base->btm_valsize, count * base->btm_valsize);
+        leaf->btm_nkeys = count;
+        i += count;
+        if (i == n) {
+            break;
+        }
+        scc_btmbuild_separate(base, levels, ksrc + i * base->btm_keysize, vsrc + i * base->btm_valsize);
+    }
+
+    base->btm_size = n;
+    return btmap;
+}
+
 _Bool scc_btmap_impl_insert(void *btmapaddr) {
     struct scc_btmap_base *base = scc_btmap_impl_base(*(void **)btmapaddr);
     if (scc_bits_is_even(base->btm_order)) {
@@ -1010,14 +1179,14 @@ void *scc_btmap_clone(void const *btmap) {
     size_t bytesz = basesz + kvsz;
     scc_when_mutating(assert(bytesz > basesz));
 
-    struct scc_btmap_base *nbase = malloc(bytesz);
+    struct scc_btmap_base *nbase = scc_allocator_alloc(obase->btm_arena.ar_allocator, bytesz);
     if (!nbase) {
         return 0;
     }
     scc_memcpy(nbase, obase, basesz);
     nbase->btm_arena = scc_arena_clone(&obase->btm_arena);
     if (!scc_arena_reserve(&nbase->btm_arena, obase->btm_size)) {
-        free(nbase);
+        scc_allocator_free(nbase->btm_arena.ar_allocator, nbase);
         return 0;
     }
     nbase->btm_dynalloc = 1;
@@ -1048,8 +1217,16 @@ void *scc_btmap_clone(void const *btmap) {
             *s->new = scc_arena_alloc(&nbase->btm_arena);
             assert(*s->new);
             assert(s->old);
-            /* Copy everything up to the link array */
+            /* Copy the keys and, separately, the values following the links */
             scc_memcpy(*s->new, s->old, nbase->btm_linkoff);
+            if (s->old->btm_nkeys) {
+                scc_memcpy(
+                    scc_btmnode_vals(nbase, *s->new),
+                    scc_btmnode_vals(obase, s->old),
+                    s->old->btm_nkeys * nbase->btm_valsize
+                );
+            }
+            (*s->new)->btm_flags &= ~SCC_BTMAP_FLAG_EMBEDDED;
         }
 
         if (!scc_btmnode_is_leaf(s->old)) {
@@ -1077,3 +1254,126 @@ epilogue:
 
     return nbtmap;
 }
+
+static inline void scc_btmap_iter_push(struct scc_btmap_iter *iter, struct scc_btmnode_base *node, size_t index) {
+    assert(iter->it_depth < SCC_BTREE_MAX_HEIGHT);
+    iter->it_nodes[iter->it_depth] = node;
+    iter->it_index[iter->it_depth] = index;
+    ++iter->it_depth;
+}
+
+static inline void const *scc_btmap_iter_current(struct scc_btmap_base const *restrict base, struct scc_btmap_iter const *restrict iter) {
+    if (!iter->it_depth) {
+        return 0;
+    }
+    unsigned top = iter->it_depth - 1u;
+    void const *key = scc_btmnode_key(base, iter->it_nodes[top], iter->it_index[top]);
+    return key == iter->it_end ? 0 : key;
+}
+
+/* Push node and its leftmost descendants down to the leaf level */
+static void scc_btmap_iter_descend(
+    struct scc_btmap_base const *restrict base,
+    struct scc_btmap_iter *restrict iter,
+    struct scc_btmnode_base *node
+) {
+    while (1) {
+        scc_btmap_iter_push(iter, node, 0u);
+        if (scc_btmnode_is_leaf(node)) {
+            break;
+        }
+        node = scc_btmnode_child(base, node, 0u);
+    }
+}
+
+/* Pop exhausted nodes until the top frame refers to a pair */
+static inline void scc_btmap_iter_ascend(struct scc_btmap_iter *iter) {
+    while (iter->it_depth && iter->it_index[iter->it_depth - 1u] == iter->it_nodes[iter->it_depth - 1u]->btm_nkeys) {
+        --iter->it_depth;
+    }
+}
+
+void const *scc_btmap_impl_leftmost(void const *btmap, struct scc_btmap_iter *iter) {
+    struct scc_btmap_base const *base = scc_btmap_impl_base_qual(btmap, const);
+    iter->it_depth = 0u;
+    iter->it_end = 0;
+    scc_btmap_iter_descend(base, iter, base->btm_root);
+    scc_btmap_iter_ascend(iter);
+    return scc_btmap_iter_current(base, iter);
+}
+
+static void const *scc_btmap_iter_bound(void const *btmap, struct scc_btmap_iter *iter, bool upper) {
+    struct scc_btmap_base const *base = scc_btmap_impl_base_qual(btmap, const);
+    iter->it_depth = 0u;
+    iter->it_end = 0;
+
+    struct scc_btmnode_base *curr = base->btm_root;
+    size_t bound;
+    while (1) {
+        bound = upper ?
+            scc_btmnode_upper_bound(base, curr, btmap) :
+            scc_btmnode_lower_bound(base, curr, btmap) & BOUND_MASK;
+        /* Pairs in the subtree at the bound are visited before the one at the bound */
+        scc_btmap_iter_push(iter, curr, bound);
+        if (scc_btmnode_is_leaf(curr)) {
+            break;
+        }
+        curr = scc_btmnode_child(base, curr, bound);
+    }
+
+    scc_btmap_iter_ascend(iter);
+    return scc_btmap_iter_current(base, iter);
+}
+
+void const *scc_btmap_impl_lower_bound(void const *btmap, struct scc_btmap_iter *iter) {
+    return scc_btmap_iter_bound(btmap, iter, false);
+}
+
+void const *scc_btmap_impl_upper_bound(void const *btmap, struct scc_btmap_iter *iter) {
+    return scc_btmap_iter_bound(btmap, iter, true);
+}
+
+void const *scc_btmap_impl_range_end(void const *btmap, struct scc_btmap_iter *iter) {
+    iter->it_end = scc_btmap_iter_bound(btmap, iter, false);
+    return iter->it_end;
+}
+
+void const *scc_btmap_impl_range_begin(void const *btmap, struct scc_btmap_iter *iter) {
+    struct scc_btmap_base const *base = scc_btmap_impl_base_qual(btmap, const);
+    void const *end = iter->it_end;
+    if (end && base->btm_compare(btmap, end) >= 0) {
+        /* Empty or inverted range */
+        iter->it_depth = 0u;
+        return 0;
+    }
+
+    void const *key = scc_btmap_iter_bound(btmap, iter, false);
+    iter->it_end = end;
+    return key == end ? 0 : key;
+}
+
+void const *scc_btmap_impl_iter_next(void const *btmap, struct scc_btmap_iter *iter) {
+    struct scc_btmap_base const *base = scc_btmap_impl_base_qual(btmap, const);
+    if (!iter->it_depth) {
+        return 0;
+    }
+
+    unsigned top = iter->it_depth - 1u;
+    struct scc_btmnode_base *node = iter->it_nodes[top];
+    size_t index = ++iter->it_index[top];
+    if (scc_btmnode_is_leaf(node)) {
+        scc_btmap_iter_ascend(iter);
+    }
+    else {
+        /* Successor is the leftmost pair in the right subtree */
+        scc_btmap_iter_descend(base, iter, scc_btmnode_child(base, node, index));
+    }
+    return scc_btmap_iter_current(base, iter);
+}
+
+void *scc_btmap_impl_iter_value(void const *btmap, struct scc_btmap_iter const *iter) {
+    struct scc_btmap_base const *base = scc_btmap_impl_base_qual(btmap, const);
+    assert(iter->it_depth);
+    unsigned top = iter->it_depth - 1u;
+    return scc_btmnode_value(base, iter->it_nodes[top], iter->it_index[top]);
+}
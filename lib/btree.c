@@ -1,4 +1,5 @@
 #include <scc/algorithm.h>
+#include <scc/arch.h>
 #include <scc/btree.h>
 #include <scc/mem.h>
 #include <scc/stack.h>
@@ -6,7 +7,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <stdbool.h>
-#include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 
 void *scc_btree_impl_with_order(void *base, size_t coff, size_t rootoff);
@@ -14,8 +15,14 @@ void *scc_btree_impl_with_order_dyn(void *sbase, size_t basesz, size_t coff, siz
 size_t scc_btree_impl_npad(void const *btree);
 size_t scc_btree_order(void const *btree);
 size_t scc_btree_size(void const *btree);
+size_t scc_btfrozen_impl_npad(void const *frozen);
+size_t scc_btfrozen_size(void const *frozen);
 
-enum { SCC_BTREE_FLAG_LEAF = 0x01 };
+enum {
+    SCC_BTREE_FLAG_LEAF = 0x01,
+    /* Root node stored in the btree base rather than the arena */
+    SCC_BTREE_FLAG_EMBEDDED = 0x02
+};
 
 static inline void scc_btree_set_bkoff(void *btree, unsigned char bkoff) {
     ((unsigned char *)btree)[-1] = bkoff;
@@ -23,7 +30,7 @@ static inline void scc_btree_set_bkoff(void *btree, unsigned char bkoff) {
 
 static inline void scc_btree_root_init(struct scc_btree_base *base, void *root) {
     base->bt_root = root;
-    base->bt_root->bt_flags |= SCC_BTREE_FLAG_LEAF;
+    base->bt_root->bt_flags |= SCC_BTREE_FLAG_LEAF | SCC_BTREE_FLAG_EMBEDDED;
 }
 
 static inline _Bool scc_btnode_full(struct scc_btree_base const *base, struct scc_btnode_base const *node) {
@@ -39,6 +46,12 @@ static inline void scc_btnode_flags_clear(struct scc_btnode_base *node) {
     node->bt_flags = 0u;
 }
 
+static inline void scc_btnode_free(struct scc_btree_base *restrict base, struct scc_btnode_base *restrict node) {
+    if (!(node->bt_flags & SCC_BTREE_FLAG_EMBEDDED)) {
+        scc_arena_free(&base->bt_arena, node);
+    }
+}
+
 static inline struct scc_btnode_base **scc_btnode_links(struct scc_btree_base const *restrict base, struct scc_btnode_base *restrict node) {
     return (void *)((unsigned char *)node + base->bt_linkoff);
 }
@@ -61,13 +74,129 @@ static inline void *scc_btnode_value(
     return (unsigned char *)scc_btnode_data(base, node) + index * elemsize;
 }
 
+static inline _Bool scc_btree_counted(struct scc_btree_base const *base) {
+    return base->bt_cntoff;
+}
+
+/* Number of elements in the subtree rooted at node, only
+ * present in order-statistic trees */
+static inline size_t *scc_btnode_count(struct scc_btree_base const *restrict base, struct scc_btnode_base *restrict node) {
+    assert(scc_btree_counted(base));
+    return (void *)((unsigned char *)node + base->bt_cntoff);
+}
+
+/* Recompute the count of the node from those of its children */
+static void scc_btnode_recount(struct scc_btree_base const *restrict base, struct scc_btnode_base *restrict node) {
+    if (!scc_btree_counted(base)) {
+        return;
+    }
+
+    size_t count = node->bt_nkeys;
+    if (!scc_btnode_is_leaf(node)) {
+        struct scc_btnode_base **links = scc_btnode_links(base, node);
+        for (unsigned i = 0u; i <= node->bt_nkeys; ++i) {
+            count += *scc_btnode_count(base, links[i]);
+        }
+    }
+    *scc_btnode_count(base, node) = count;
+}
+
+/* Account for a value and, unless the nodes are leaves, the subtree
+ * to one side of it being rotated from one sibling to another */
+static inline void scc_btnode_count_rotate(
+    struct scc_btree_base const *restrict base,
+    struct scc_btnode_base *restrict from,
+    struct scc_btnode_base *restrict to,
+    struct scc_btnode_base *restrict subtree
+) {
+    if (!scc_btree_counted(base)) {
+        return;
+    }
+
+    size_t moved = 1u + (scc_btnode_is_leaf(to) ? 0u : *scc_btnode_count(base, subtree));
+    *scc_btnode_count(base, from) -= moved;
+    *scc_btnode_count(base, to) += moved;
+}
+
+/* Adjust the count of each node on a path from the root by delta */
+static inline void scc_btree_count_path(
+    struct scc_btree_base const *restrict base,
+    struct scc_btnode_base *const *restrict path,
+    size_t depth,
+    int delta
+) {
+    if (!scc_btree_counted(base)) {
+        return;
+    }
+
+    for (size_t i = 0u; i < depth; ++i) {
+        if (path[i]) {
+            *scc_btnode_count(base, path[i]) += delta;
+        }
+    }
+}
+
 static inline size_t scc_btnode_lower_bound(
     struct scc_btree_base const *base,
     struct scc_btnode_base *node,
     void const *restrict value,
     size_t elemsize
 ) {
-    return scc_algo_lower_bound(value, scc_btnode_data(base, node), node->bt_nkeys, elemsize, base->bt_compare);
+    void const *data = scc_btnode_data(base, node);
+    switch (base->bt_keykind) {
+        case SCC_BTKEY_I32:
+            return scc_btkey_impl_lower_bound_i32(data, node->bt_nkeys, value);
+        case SCC_BTKEY_I64:
+            return scc_btkey_impl_lower_bound_i64(data, node->bt_nkeys, value);
+        case SCC_BTKEY_F32:
+            return scc_btkey_impl_lower_bound_f32(data, node->bt_nkeys, value);
+        case SCC_BTKEY_F64:
+            return scc_btkey_impl_lower_bound_f64(data, node->bt_nkeys, value);
+        default:
+            break;
+    }
+    return scc_algo_lower_bound(value, data, node->bt_nkeys, elemsize, base->bt_compare);
+}
+
+/* Whether the element at the lower bound in a node with values of a builtin
+ * type matches value. The element is not ordered before value, so the two
+ * are equal unless value is ordered before the element */
+#define scc_btnode_typed_bound_eq(type, data, value, bound)                                         \
+    (!(*(type const *)(value) < ((type const *)(data))[bound]))
+
+static inline _Bool scc_btnode_bound_eq(
+    struct scc_btree_base const *base,
+    struct scc_btnode_base *node,
+    size_t bound,
+    void const *restrict value,
+    size_t elemsize
+) {
+    if (bound >= node->bt_nkeys) {
+        return false;
+    }
+    void const *data = scc_btnode_data(base, node);
+    switch (base->bt_keykind) {
+        case SCC_BTKEY_I32:
+            return scc_btnode_typed_bound_eq(int32_t, data, value, bound);
+        case SCC_BTKEY_I64:
+            return scc_btnode_typed_bound_eq(int64_t, data, value, bound);
+        case SCC_BTKEY_F32:
+            return scc_btnode_typed_bound_eq(float, data, value, bound);
+        case SCC_BTKEY_F64:
+            return scc_btnode_typed_bound_eq(double, data, value, bound);
+        default:
+            break;
+    }
+    return !base->bt_compare((unsigned char const *)data + bound * elemsize, value);
+}
+
+static inline size_t scc_btnode_upper_bound(
+    struct scc_btree_base const *base,
+    struct scc_btnode_base *node,
+    void const *restrict value,
+    size_t elemsize
+) {
+    return scc_algo_upper_bound(value, scc_btnode_data(base, node), node->bt_nkeys, elemsize, base->bt_compare);
 }
 
 static size_t scc_btnode_emplace_leaf(
@@ -140,11 +269,12 @@ static struct scc_btnode_base *scc_btnode_split_preemptive(
     struct scc_btnode_base *p,
     size_t elemsize
 ) {
+    _Bool const newroot = !p;
     struct scc_btnode_base *right = scc_arena_alloc(&base->bt_arena);
     if (!right) {
         return 0;
     }
-    if (!p) {
+    if (newroot) {
         p = scc_arena_alloc(&base->bt_arena);
         if (!p) {
             scc_arena_free(&base->bt_arena, right);
@@ -163,7 +293,7 @@ static struct scc_btnode_base *scc_btnode_split_preemptive(
     node->bt_nkeys >>= 1u;
     right->bt_nkeys = node->bt_nkeys;
 
-    right->bt_flags = node->bt_flags;
+    right->bt_flags = node->bt_flags & ~SCC_BTREE_FLAG_EMBEDDED;
 
     scc_memcpy(rdata, ldata + (node->bt_nkeys + 1u) * elemsize, right->bt_nkeys * elemsize);
     if (!scc_btnode_is_leaf(node)) {
@@ -183,6 +313,13 @@ static struct scc_btnode_base *scc_btnode_split_preemptive(
     plinks[bound + 1u] = right;
     ++p->bt_nkeys;
 
+    /* Count of an existing parent is unaffected */
+    scc_btnode_recount(base, node);
+    scc_btnode_recount(base, right);
+    if (newroot) {
+        scc_btnode_recount(base, p);
+    }
+
     return right;
 }
 
@@ -213,7 +350,7 @@ static struct scc_btnode_base *scc_btnode_split_non_preemptive(
 
     node->bt_nkeys >>= 1u;
     right->bt_nkeys = node->bt_nkeys;
-    right->bt_flags = node->bt_flags;
+    right->bt_flags = node->bt_flags & ~SCC_BTREE_FLAG_EMBEDDED;
 
     unsigned char *rdata = scc_btnode_data(base, right);
     struct scc_btnode_base **rlinks = scc_btnode_links(base, right);
@@ -274,6 +411,10 @@ static struct scc_btnode_base *scc_btnode_split_non_preemptive(
         }
     }
 
+    /* A new root is counted once the value is emplaced in it */
+    scc_btnode_recount(base, node);
+    scc_btnode_recount(base, right);
+
     return right;
 }
 
@@ -281,6 +422,10 @@ static _Bool scc_btree_insert_preemptive(struct scc_btree_base *base, void *btre
     struct scc_btnode_base *curr = base->bt_root;
     struct scc_btnode_base *p = 0;
 
+    /* Nodes whose counts are to be incremented once the value is in place */
+    struct scc_btnode_base *path[SCC_BTREE_MAX_HEIGHT];
+    size_t depth = 0u;
+
     struct scc_btnode_base *right;
     size_t bound;
     while (true) {
@@ -290,11 +435,16 @@ static _Bool scc_btree_insert_preemptive(struct scc_btree_base *base, void *btre
             if (!right) {
                 return false;
             }
+            if (!p) {
+                path[depth++] = base->bt_root;
+            }
 
             if (bound > curr->bt_nkeys) {
                 curr = right;
             }
         }
+        assert(depth < SCC_BTREE_MAX_HEIGHT);
+        path[depth++] = curr;
         if (scc_btnode_is_leaf(curr)) {
             break;
         }
@@ -305,6 +455,7 @@ static _Bool scc_btree_insert_preemptive(struct scc_btree_base *base, void *btre
     }
 
     scc_btnode_emplace_leaf(base, curr, *(void **)btreeaddr, elemsize);
+    scc_btree_count_path(base, path, depth, 1);
     ++base->bt_size;
     return true;
 }
@@ -345,6 +496,8 @@ static _Bool scc_btree_insert_non_preemptive(struct scc_btree_base *base, void *
 
     if (!scc_btnode_full(base, curr)) {
         scc_btnode_emplace_leaf(base, curr, *(void **)btreeaddr, elemsize);
+        scc_btree_count_path(base, stack, scc_stack_size(stack), 1);
+        scc_btree_count_path(base, &curr, 1u, 1);
         ++base->bt_size;
         success = true;
         goto epilogue;
@@ -357,6 +510,9 @@ static _Bool scc_btree_insert_non_preemptive(struct scc_btree_base *base, void *
         goto epilogue;
     }
 
+    /* Nodes split on the way up are recounted from their children */
+    scc_btree_count_path(base, stack, scc_stack_size(stack), 1);
+
     struct scc_btnode_base *p;
     struct scc_btnode_base *right = 0;
     void *value = *(void **)btreeaddr;
@@ -381,6 +537,7 @@ static _Bool scc_btree_insert_non_preemptive(struct scc_btree_base *base, void *
     }
 
     scc_btnode_emplace(base, curr, right, value, elemsize);
+    scc_btnode_recount(base, curr);
     ++base->bt_size;
     success = true;
 
@@ -413,6 +570,7 @@ static void scc_btnode_rotate_right(
     ++node->bt_nkeys;
     scc_memmove(nlinks + 1u, nlinks, node->bt_nkeys * sizeof(*nlinks));
     nlinks[0] = subtree;
+    scc_btnode_count_rotate(base, sibling, node, subtree);
 }
 
 static void scc_btnode_rotate_left(
@@ -437,6 +595,7 @@ static void scc_btnode_rotate_left(
     scc_memmove(slinks, slinks + 1u, sibling->bt_nkeys * sizeof(*slinks));
     --sibling->bt_nkeys;
     scc_memmove(sslot, sslot + elemsize, sibling->bt_nkeys * elemsize);
+    scc_btnode_count_rotate(base, sibling, node, nlinks[node->bt_nkeys]);
 }
 
 static size_t scc_btnode_merge(
@@ -465,6 +624,9 @@ static size_t scc_btnode_merge(
 
     sibling->bt_nkeys += node->bt_nkeys + 1u;
     assert(sibling->bt_nkeys < base->bt_order);
+    if (scc_btree_counted(base)) {
+        *scc_btnode_count(base, sibling) += *scc_btnode_count(base, node) + 1u;
+    }
 
     size_t nmov = p->bt_nkeys - bound - 1u;
     if (nmov) {
@@ -489,7 +651,7 @@ static inline void scc_btnode_merge_left_non_preemptive(
 ) {
     (void)scc_btnode_merge(base, node, sibling, p, bound - 1u, elemsize);
     assert(p->bt_nkeys < bound);
-    scc_arena_try_free(&base->bt_arena, node);
+    scc_btnode_free(base, node);
 }
 
 static inline void scc_btnode_merge_left_preemptive(
@@ -502,7 +664,7 @@ static inline void scc_btnode_merge_left_preemptive(
 ) {
     scc_btnode_merge_left_non_preemptive(base, node, sibling, p, bound, elemsize);
     if (!p->bt_nkeys) {
-        scc_arena_try_free(&base->bt_arena, p);
+        scc_btnode_free(base, p);
     }
 }
 
@@ -521,7 +683,7 @@ static inline void scc_btnode_merge_right_non_preemptive(
         struct scc_btnode_base **plinks = scc_btnode_links(base, p);
         scc_memmove(plinks + bound + 1u, plinks + bound + 2u, nmov * sizeof(*plinks));
     }
-    scc_arena_try_free(&base->bt_arena, sibling);
+    scc_btnode_free(base, sibling);
 }
 
 static inline void scc_btnode_merge_right_preemptive(
@@ -534,7 +696,7 @@ static inline void scc_btnode_merge_right_preemptive(
 ) {
     scc_btnode_merge_right_non_preemptive(base, node, sibling, p, bound, elemsize);
     if (!p->bt_nkeys) {
-        scc_arena_try_free(&base->bt_arena, p);
+        scc_btnode_free(base, p);
     }
 }
 
@@ -616,11 +778,21 @@ static _Bool scc_btree_remove_preemptive(struct scc_btree_base *restrict base, v
 
     struct scc_btnode_base *curr = base->bt_root;
 
+    /* Nodes whose counts are to be decremented once the value is removed */
+    struct scc_btnode_base *path[SCC_BTREE_MAX_HEIGHT];
+    size_t depth = 0u;
+
     size_t bound;
-    unsigned char *value;
     struct scc_btnode_base *next;
 
     while (1) {
+        /* Previous root freed if merged into curr */
+        if (curr == base->bt_root) {
+            depth = 0u;
+        }
+        assert(depth < SCC_BTREE_MAX_HEIGHT);
+        path[depth++] = curr;
+
         if (!found) {
             bound = scc_btnode_lower_bound(base, curr, btree, elemsize);
         }
@@ -633,8 +805,7 @@ static _Bool scc_btree_remove_preemptive(struct scc_btree_base *restrict base, v
 
         next = scc_btnode_child(base, curr, bound);
 
-        value = scc_btnode_value(base, curr, bound, elemsize);
-        if (!found && bound < curr->bt_nkeys && !base->bt_compare(value, btree)) {
+        if (!found && scc_btnode_bound_eq(base, curr, bound, btree, elemsize)) {
             fbound = bound;
             found = curr;
             if (scc_btnode_is_leaf(curr)) {
@@ -663,8 +834,7 @@ static _Bool scc_btree_remove_preemptive(struct scc_btree_base *restrict base, v
             /* Found value may be rotated into next node when balancing. If it is,
              * the value is always in the next node */
             if (curr == found) {
-                value = scc_btnode_value(base, found, fbound, elemsize);
-                if (found->bt_nkeys <= fbound || base->bt_compare(value, btree)) {
+                if (!scc_btnode_bound_eq(base, found, fbound, btree, elemsize)) {
                     found = next;
                     fbound = scc_btnode_lower_bound(base, found, btree, elemsize);
                 }
@@ -685,6 +855,7 @@ static _Bool scc_btree_remove_preemptive(struct scc_btree_base *restrict base, v
         scc_btnode_overwrite(base, curr, found, fbound, elemsize, swap_pred);
     }
 
+    scc_btree_count_path(base, path, depth, -1);
     --base->bt_size;
     return true;
 }
@@ -739,7 +910,7 @@ static void scc_btree_balance_non_preemptive(
 
     if (!base->bt_root->bt_nkeys) {
         child = *scc_btnode_links(base, base->bt_root);
-        scc_arena_try_free(&base->bt_arena, base->bt_root);
+        scc_btnode_free(base, base->bt_root);
         base->bt_root = child;
     }
 }
@@ -758,8 +929,6 @@ static _Bool scc_btree_remove_non_preemptive(struct scc_btree_base *restrict bas
     struct scc_btnode_base *curr = base->bt_root;
     struct scc_btnode_base *next;
 
-    unsigned char const *value = 0;
-
     /* Root has parent NULL */
     if (!scc_stack_push(&nodes, 0) || !scc_stack_push(&bounds, 0u)) {
         goto epilogue;
@@ -774,8 +943,7 @@ static _Bool scc_btree_remove_non_preemptive(struct scc_btree_base *restrict bas
         }
 
         next = scc_btnode_child(base, curr, bound);
-        value = scc_btnode_value(base, curr, bound, elemsize);
-        if (!found && bound < curr->bt_nkeys && !base->bt_compare(value, btree)) {
+        if (!found && scc_btnode_bound_eq(base, curr, bound, btree, elemsize)) {
             found = curr;
             fbound = bound;
 
@@ -804,6 +972,9 @@ static _Bool scc_btree_remove_non_preemptive(struct scc_btree_base *restrict bas
     else {
         scc_btnode_overwrite(base, curr, found, fbound, elemsize, true);
     }
+    /* Counts must be up to date before rebalancing */
+    scc_btree_count_path(base, nodes, scc_stack_size(nodes), -1);
+    scc_btree_count_path(base, &curr, 1u, -1);
     --base->bt_size;
     success = true;
 
@@ -821,7 +992,7 @@ epilogue:
 static inline void scc_btree_impl_free(struct scc_btree_base *base) {
     scc_arena_release(&base->bt_arena);
     if (base->bt_dynalloc) {
-        free(base);
+        scc_allocator_free(base->bt_arena.ar_allocator, base);
     }
 }
 
@@ -830,6 +1001,7 @@ void *scc_btree_impl_new(void *base, size_t coff, size_t rootoff) {
     size_t fwoff = coff - offsetof(struct scc_btree_base, bt_fwoff) - sizeof(base->bt_fwoff);
     assert(fwoff <= UCHAR_MAX);
     base->bt_fwoff = (unsigned char)fwoff;
+    base->bt_keykind = scc_btkey_impl_kind(base->bt_compare);
     scc_btree_root_init(base, (unsigned char *)base + rootoff);
     unsigned char *btree = (unsigned char *)base + coff;
     scc_btree_set_bkoff(btree, fwoff);
@@ -838,7 +1010,7 @@ void *scc_btree_impl_new(void *base, size_t coff, size_t rootoff) {
 }
 
 void *scc_btree_impl_new_dyn(void *sbase, size_t basesz, size_t coff, size_t rootoff) {
-    struct scc_btree_base *base = malloc(basesz);
+    struct scc_btree_base *base = scc_allocator_alloc(((struct scc_btree_base *)sbase)->bt_arena.ar_allocator, basesz);
     if (!base) {
         return 0;
     }
@@ -854,6 +1026,199 @@ void scc_btree_free(void *btree) {
     scc_btree_impl_free(base);
 }
 
+/* Shape of one level of a tree built from sorted values */
+struct scc_btbuild_level {
+    struct scc_btnode_base *node;   /* Node currently being filled */
+    size_t index;                   /* Index of node on the level */
+    size_t nkeys;                   /* Keys in each node, save for the first nextra */
+    size_t nextra;                  /* Number of nodes holding one extra key */
+};
+
+static inline size_t scc_btbuild_quota(struct scc_btbuild_level const *level) {
+    return level->nkeys + (level->index < level->nextra);
+}
+
+/* Compute the shape of each level of a tree of n values, bottom
+ * up. Nodes on a level hold the same number of keys, give or take
+ * one, and values separating them are moved up a level. Returns the
+ * total number of nodes */
+static size_t scc_btbuild_plan(struct scc_btbuild_level *levels, size_t *height, size_t n, size_t order) {
+    size_t total = 0u;
+    size_t h = 0u;
+    size_t nnodes;
+    do {
+        assert(h < SCC_BTREE_MAX_HEIGHT);
+        nnodes = (n + order) / order;
+        levels[h] = (struct scc_btbuild_level) {
+            .nkeys = (n - nnodes + 1u) / nnodes,
+            .nextra = (n - nnodes + 1u) % nnodes
+        };
+        total += nnodes;
+        n = nnodes - 1u;
+        ++h;
+    } while (nnodes > 1u);
+
+    *height = h;
+    return total;
+}
+
+static struct scc_btnode_base *scc_btbuild_node(struct scc_btree_base *base, size_t level) {
+    struct scc_btnode_base *node = scc_arena_alloc(&base->bt_arena);
+    /* Reserved up front */
+    assert(node);
+    node->bt_flags = level ? 0u : SCC_BTREE_FLAG_LEAF;
+    node->bt_nkeys = 0u;
+    return node;
+}
+
+/* Move a value separating two leaves to the lowest level with room for
+ * it, then start a new node on each of the levels below */
+static void scc_btbuild_separate(
+    struct scc_btree_base *restrict base,
+    struct scc_btbuild_level *restrict levels,
+    void const *restrict value,
+    size_t elemsize
+) {
+    size_t h = 1u;
+    while (levels[h].node->bt_nkeys == scc_btbuild_quota(&levels[h])) {
+        ++h;
+    }
+
+    struct scc_btnode_base *node = levels[h].node;
+    scc_memcpy(scc_btnode_value(base, node, node->bt_nkeys, elemsize), value, elemsize);
+    ++node->bt_nkeys;
+
+    struct scc_btnode_base *parent;
+    while (h--) {
+        parent = levels[h + 1u].node;
+        node = scc_btbuild_node(base, h);
+        scc_btnode_links(base, parent)[parent->bt_nkeys] = node;
+        levels[h].node = node;
+        ++levels[h].index;
+    }
+}
+
+/* Count the subtree rooted at node bottom up, returning its size */
+static size_t scc_btbuild_count(struct scc_btree_base const *restrict base, struct scc_btnode_base *restrict node) {
+    size_t count = node->bt_nkeys;
+    if (!scc_btnode_is_leaf(node)) {
+        struct scc_btnode_base **links = scc_btnode_links(base, node);
+        for (unsigned i = 0u; i <= node->bt_nkeys; ++i) {
+            count += scc_btbuild_count(base, links[i]);
+        }
+    }
+    *scc_btnode_count(base, node) = count;
+    return count;
+}
+
+/* Tree being built from values appended in sorted order */
+struct scc_btbuild {
+    struct scc_btbuild_level levels[SCC_BTREE_MAX_HEIGHT];
+    size_t height;
+};
+
+/* Prepare for replacing the contents of the tree with n sorted values.
+ * All nodes are reserved in a new arena before the current one is
+ * released, leaving the tree untouched on failure. An embedded root is
+ * reused */
+static bool scc_btbuild_init(struct scc_btbuild *restrict build, struct scc_btree_base *restrict base, size_t n) {
+    struct scc_btbuild_level *levels = build->levels;
+    size_t nnodes = scc_btbuild_plan(levels, &build->height, n, base->bt_order);
+    size_t const height = build->height;
+
+    struct scc_btnode_base *root = base->bt_root;
+    bool const embedded = root && (root->bt_flags & SCC_BTREE_FLAG_EMBEDDED);
+    struct scc_arena arena = scc_arena_clone(&base->bt_arena);
+    if (nnodes > embedded && !scc_arena_reserve(&arena, nnodes - embedded)) {
+        scc_arena_release(&arena);
+        return false;
+    }
+    scc_arena_release(&base->bt_arena);
+    base->bt_arena = arena;
+
+    if (!embedded) {
+        root = scc_arena_alloc(&base->bt_arena);
+        assert(root);
+        root->bt_flags = 0u;
+    }
+    root->bt_flags = (root->bt_flags & SCC_BTREE_FLAG_EMBEDDED) | (height > 1u ? 0u : SCC_BTREE_FLAG_LEAF);
+    root->bt_nkeys = 0u;
+    base->bt_root = root;
+    base->bt_size = n;
+
+    /* First node on each level, the leftmost child of the one above */
+    levels[height - 1u].node = root;
+    for (size_t h = height - 1u; h--;) {
+        levels[h].node = scc_btbuild_node(base, h);
+        scc_btnode_links(base, levels[h + 1u].node)[0] = levels[h].node;
+    }
+    return true;
+}
+
+/* Append n sorted values, ordered after any appended before them. Values
+ * are copied to the current leaf until it reaches its quota, the one
+ * following it then separates it from the next leaf */
+static void scc_btbuild_append(
+    struct scc_btbuild *restrict build,
+    struct scc_btree_base *restrict base,
+    void const *restrict values,
+    size_t n,
+    size_t elemsize
+) {
+    unsigned char const *src = values;
+    struct scc_btnode_base *leaf;
+    size_t count;
+    while (n) {
+        leaf = build->levels[0].node;
+        count = scc_btbuild_quota(&build->levels[0]) - leaf->bt_nkeys;
+        if (!count) {
+            scc_btbuild_separate(base, build->levels, src, elemsize);
+            src += elemsize;
+            --n;
+            continue;
+        }
+        if (count > n) {
+            count = n;
+        }
+        scc_memcpy(scc_btnode_value(base, leaf, leaf->bt_nkeys, elemsize), src, count * elemsize);
+        leaf->bt_nkeys += count;
+        src += count * elemsize;
+        n -= count;
+    }
+}
+
+static inline void scc_btbuild_finish(struct scc_btree_base *base) {
+    if (scc_btree_counted(base)) {
+        (void)scc_btbuild_count(base, base->bt_root);
+    }
+}
+
+/* Replace the contents of the tree with n sorted values, see
+ * scc_btbuild_init */
+static bool scc_btree_build(struct scc_btree_base *base, void const *values, size_t n, size_t elemsize) {
+    struct scc_btbuild build;
+    if (!scc_btbuild_init(&build, base, n)) {
+        return false;
+    }
+    scc_btbuild_append(&build, base, values, n, elemsize);
+    scc_btbuild_finish(base);
+    return true;
+}
+
+void *scc_btree_impl_from_sorted(void *btree, void const *values, size_t n, size_t elemsize) {
+    if (!btree || !n) {
+        return btree;
+    }
+
+    struct scc_btree_base *base = scc_btree_impl_base(btree);
+    assert(!base->bt_size);
+    if (!scc_btree_build(base, values, n, elemsize)) {
+        scc_btree_free(btree);
+        return 0;
+    }
+    return btree;
+}
+
 _Bool scc_btree_impl_insert(void *btreeaddr, size_t elemsize) {
     struct scc_btree_base *base = scc_btree_impl_base(*(void **)btreeaddr);
     if (scc_bits_is_even(base->bt_order)) {
@@ -869,14 +1234,10 @@ void const *scc_btree_impl_find(void const *btree, size_t elemsize) {
     struct scc_btnode_base *curr = base->bt_root;
 
     size_t bound;
-    void *addr;
     while (true) {
         bound = scc_btnode_lower_bound(base, curr, btree, elemsize);
-        if (bound < curr->bt_nkeys) {
-            addr = (unsigned char *)scc_btnode_data(base, curr) + bound * elemsize;
-            if (!base->bt_compare(addr, btree)) {
-                return addr;
-            }
+        if (scc_btnode_bound_eq(base, curr, bound, btree, elemsize)) {
+            return (unsigned char *)scc_btnode_data(base, curr) + bound * elemsize;
         }
 
         if (scc_btnode_is_leaf(curr)) {
@@ -897,24 +1258,42 @@ _Bool scc_btree_impl_remove(void *btree, size_t elemsize) {
     return scc_btree_remove_non_preemptive(base, btree, elemsize);
 }
 
-void *scc_btree_impl_clone(void const *btree, size_t elemsize) {
+/* Allocate an empty base configured like that of the given btree. The
+ * root is not embedded and must be allocated from the arena */
+static struct scc_btree_base *scc_btree_alloc_like(void const *btree, size_t elemsize) {
     struct scc_btree_base const *obase = scc_btree_impl_base_qual(btree, const);
     size_t basesz = (unsigned char const *)btree - (unsigned char const *)obase;
 
     size_t bytesz = basesz + elemsize;
     scc_when_mutating(assert(bytesz > basesz));
 
-    struct scc_btree_base *nbase = malloc(bytesz);
+    struct scc_btree_base *nbase = scc_allocator_alloc(obase->bt_arena.ar_allocator, bytesz);
     if (!nbase) {
         return 0;
     }
     scc_memcpy(nbase, obase, basesz);
     nbase->bt_arena = scc_arena_clone(&obase->bt_arena);
+    nbase->bt_size = 0u;
+    nbase->bt_root = 0;
+    nbase->bt_dynalloc = 1;
+    return nbase;
+}
+
+static inline void *scc_btree_handle(struct scc_btree_base *base) {
+    return (unsigned char *)base + offsetof(struct scc_btree_base, bt_fwoff) + base->bt_fwoff + sizeof(base->bt_fwoff);
+}
+
+void *scc_btree_impl_clone(void const *btree, size_t elemsize) {
+    struct scc_btree_base const *obase = scc_btree_impl_base_qual(btree, const);
+    struct scc_btree_base *nbase = scc_btree_alloc_like(btree, elemsize);
+    if (!nbase) {
+        return 0;
+    }
     if (!scc_arena_reserve(&nbase->bt_arena, obase->bt_size)) {
-        free(nbase);
+        scc_allocator_free(nbase->bt_arena.ar_allocator, nbase);
         return 0;
     }
-    nbase->bt_dynalloc = 1;
+    nbase->bt_size = obase->bt_size;
 
     struct stage {
         unsigned index;
@@ -944,6 +1323,10 @@ void *scc_btree_impl_clone(void const *btree, size_t elemsize) {
             assert(s->old);
             /* Copy everything up to the link array */
             scc_memcpy(*s->new, s->old, nbase->bt_linkoff);
+            (*s->new)->bt_flags &= ~SCC_BTREE_FLAG_EMBEDDED;
+            if (scc_btree_counted(nbase)) {
+                *scc_btnode_count(nbase, *s->new) = *scc_btnode_count(obase, s->old);
+            }
         }
 
         if (!scc_btnode_is_leaf(s->old)) {
@@ -962,7 +1345,7 @@ void *scc_btree_impl_clone(void const *btree, size_t elemsize) {
         ++s->index;
     }
 
-    nbtree = (unsigned char *)nbase + offsetof(struct scc_btree_base, bt_fwoff) + nbase->bt_fwoff + sizeof(nbase->bt_fwoff);
+    nbtree = scc_btree_handle(nbase);
 epilogue:
     scc_stack_free(stack);
     if (!nbtree) {
@@ -971,3 +1354,1239 @@ epilogue:
 
     return nbtree;
 }
+
+/* Ways of combining the sorted contents of two trees, counting duplicates
+ * as distinct elements */
+enum scc_btree_setop {
+    SCC_BTREE_MERGE,            /* Every element in either */
+    SCC_BTREE_UNION,            /* Largest number of copies in either */
+    SCC_BTREE_INTERSECTION,     /* Smallest number of copies in either */
+    SCC_BTREE_DIFFERENCE        /* Copies in the left not matched in the right */
+};
+
+/* Append value to the tree being built, if any */
+static inline void scc_btree_emit(
+    struct scc_btbuild *restrict build,
+    struct scc_btree_base *restrict out,
+    void const *restrict value,
+    size_t *restrict n,
+    size_t elemsize
+) {
+    if (build) {
+        scc_btbuild_append(build, out, value, 1u, elemsize);
+    }
+    ++*n;
+}
+
+/* Append the sorted result of combining the trees to the tree being built
+ * in out, returning the number of elements in the result. With a NULL
+ * build, the elements are only counted */
+static size_t scc_btree_combine(
+    void const *left,
+    void const *right,
+    struct scc_btree_base *restrict out,
+    struct scc_btbuild *restrict build,
+    enum scc_btree_setop op,
+    size_t elemsize
+) {
+    struct scc_btree_base const *base = scc_btree_impl_base_qual(left, const);
+    struct scc_btree_iter liter;
+    struct scc_btree_iter riter;
+    void const *l = scc_btree_impl_leftmost(left, &liter, elemsize);
+    void const *r = scc_btree_impl_leftmost(right, &riter, elemsize);
+
+    bool const keep_left = op != SCC_BTREE_INTERSECTION;
+    bool const keep_right = op == SCC_BTREE_MERGE || op == SCC_BTREE_UNION;
+
+    size_t n = 0u;
+    int rel;
+    while (l && r) {
+        rel = base->bt_compare(l, r);
+        if (rel < 0) {
+            if (keep_left) {
+                scc_btree_emit(build, out, l, &n, elemsize);
+            }
+            l = scc_btree_impl_iter_next(left, &liter, elemsize);
+        }
+        else if (rel > 0) {
+            if (keep_right) {
+                scc_btree_emit(build, out, r, &n, elemsize);
+            }
+            r = scc_btree_impl_iter_next(right, &riter, elemsize);
+        }
+        else {
+            /* Left first for stability. Merging keeps the right copy for later */
+            if (op != SCC_BTREE_DIFFERENCE) {
+                scc_btree_emit(build, out, l, &n, elemsize);
+            }
+            l = scc_btree_impl_iter_next(left, &liter, elemsize);
+            if (op != SCC_BTREE_MERGE) {
+                r = scc_btree_impl_iter_next(right, &riter, elemsize);
+            }
+        }
+    }
+
+    for (; l && keep_left; l = scc_btree_impl_iter_next(left, &liter, elemsize)) {
+        scc_btree_emit(build, out, l, &n, elemsize);
+    }
+    for (; r && keep_right; r = scc_btree_impl_iter_next(right, &riter, elemsize)) {
+        scc_btree_emit(build, out, r, &n, elemsize);
+    }
+    return n;
+}
+
+/* Build a new tree, configured like the left one, from the combination
+ * of the two. The result is counted in a first pass and streamed into
+ * the nodes in a second, without an intermediate buffer */
+static void *scc_btree_setop(void const *left, void const *right, enum scc_btree_setop op, size_t elemsize) {
+    assert(scc_btree_impl_base_qual(left, const)->bt_compare == scc_btree_impl_base_qual(right, const)->bt_compare);
+
+    struct scc_btree_base *base = scc_btree_alloc_like(left, elemsize);
+    if (!base) {
+        return 0;
+    }
+
+    struct scc_btbuild build;
+    size_t const n = scc_btree_combine(left, right, 0, 0, op, elemsize);
+    if (!scc_btbuild_init(&build, base, n)) {
+        scc_btree_impl_free(base);
+        return 0;
+    }
+    (void)scc_btree_combine(left, right, base, &build, op, elemsize);
+    scc_btbuild_finish(base);
+    return scc_btree_handle(base);
+}
+
+/* Minimum number of keys in a non-root node */
+static inline size_t scc_btree_minkeys(struct scc_btree_base const *base) {
+    return (base->bt_order >> 1u) - scc_bits_is_even(base->bt_order);
+}
+
+/* Height of the subtree rooted at node, 0 for an empty tree */
+static size_t scc_btnode_height(struct scc_btree_base const *restrict base, struct scc_btnode_base *restrict node) {
+    size_t height = 0u;
+    for (; node; node = scc_btnode_is_leaf(node) ? 0 : scc_btnode_child(base, node, 0u)) {
+        ++height;
+    }
+    return height;
+}
+
+/* Number of elements in the subtree rooted at node, the number of nodes
+ * in it is added to nnodes */
+static size_t scc_btnode_census(
+    struct scc_btree_base const *restrict base,
+    struct scc_btnode_base *restrict node,
+    size_t *restrict nnodes
+) {
+    ++*nnodes;
+    size_t count = node->bt_nkeys;
+    if (!scc_btnode_is_leaf(node)) {
+        struct scc_btnode_base **links = scc_btnode_links(base, node);
+        for (unsigned i = 0u; i <= node->bt_nkeys; ++i) {
+            count += scc_btnode_census(base, links[i], nnodes);
+        }
+    }
+    return count;
+}
+
+/* Copy the subtree rooted at node, in the tree described by obase, to
+ * arena. Nodes are reserved up front */
+static struct scc_btnode_base *scc_btnode_copy(
+    struct scc_btree_base const *restrict obase,
+    struct scc_arena *restrict arena,
+    struct scc_btnode_base *restrict node
+) {
+    struct scc_btnode_base *copy = scc_arena_alloc(arena);
+    assert(copy);
+    scc_memcpy(copy, node, arena->ar_elemsize);
+    copy->bt_flags &= ~SCC_BTREE_FLAG_EMBEDDED;
+    if (!scc_btnode_is_leaf(node)) {
+        struct scc_btnode_base **olinks = scc_btnode_links(obase, node);
+        struct scc_btnode_base **nlinks = scc_btnode_links(obase, copy);
+        for (unsigned i = 0u; i <= node->bt_nkeys; ++i) {
+            nlinks[i] = scc_btnode_copy(obase, arena, olinks[i]);
+        }
+    }
+    return copy;
+}
+
+/* Move the subtree rooted at node from the arena of the tree to another
+ * one. An embedded node, only ever found on the leftmost spine, stays
+ * in place. Nodes are reserved up front */
+static struct scc_btnode_base *scc_btnode_move(
+    struct scc_btree_base *restrict base,
+    struct scc_arena *restrict arena,
+    struct scc_btnode_base *node
+) {
+    if (!(node->bt_flags & SCC_BTREE_FLAG_EMBEDDED)) {
+        struct scc_btnode_base *moved = scc_arena_alloc(arena);
+        assert(moved);
+        scc_memcpy(moved, node, arena->ar_elemsize);
+        scc_btnode_free(base, node);
+        node = moved;
+    }
+    if (!scc_btnode_is_leaf(node)) {
+        struct scc_btnode_base **links = scc_btnode_links(base, node);
+        for (unsigned i = 0u; i <= node->bt_nkeys; ++i) {
+            links[i] = scc_btnode_move(base, arena, links[i]);
+        }
+    }
+    return node;
+}
+
+/* Allocate an empty leaf. Reserved up front */
+static struct scc_btnode_base *scc_btnode_new_leaf(struct scc_btree_base *base) {
+    struct scc_btnode_base *leaf = scc_arena_alloc(&base->bt_arena);
+    assert(leaf);
+    leaf->bt_flags = SCC_BTREE_FLAG_LEAF;
+    leaf->bt_nkeys = 0u;
+    scc_btnode_recount(base, leaf);
+    return leaf;
+}
+
+/* Subtree taking part in a join, an empty one has a NULL root and
+ * height 0 */
+struct scc_btjoin_tree {
+    struct scc_btnode_base *root;
+    size_t height;
+};
+
+/* Recount the nodes above the given height on the rightmost or leftmost
+ * spine of the tree, bottom up */
+static void scc_btjoin_recount(
+    struct scc_btree_base const *restrict base,
+    struct scc_btjoin_tree const *restrict tree,
+    size_t height,
+    bool rightmost
+) {
+    if (!scc_btree_counted(base)) {
+        return;
+    }
+
+    struct scc_btnode_base *path[SCC_BTREE_MAX_HEIGHT];
+    size_t depth = 0u;
+    struct scc_btnode_base *node = tree->root;
+    for (size_t h = tree->height; h > height; --h) {
+        path[depth++] = node;
+        if (!scc_btnode_is_leaf(node)) {
+            node = scc_btnode_child(base, node, rightmost ? node->bt_nkeys : 0u);
+        }
+    }
+    while (depth) {
+        scc_btnode_recount(base, path[--depth]);
+    }
+}
+
+/* Insert value at the given index in a node with room for it, followed by
+ * the link to child */
+static void scc_btnode_emplace_at(
+    struct scc_btree_base *restrict base,
+    struct scc_btnode_base *restrict node,
+    size_t index,
+    void const *restrict value,
+    struct scc_btnode_base *restrict child,
+    size_t elemsize
+) {
+    assert(!scc_btnode_full(base, node));
+    unsigned char *slot = scc_btnode_value(base, node, index, elemsize);
+    if (index < node->bt_nkeys) {
+        scc_memmove(slot + elemsize, slot, (node->bt_nkeys - index) * elemsize);
+    }
+    scc_memcpy(slot, value, elemsize);
+    if (!scc_btnode_is_leaf(node)) {
+        struct scc_btnode_base **links = scc_btnode_links(base, node);
+        if (index < node->bt_nkeys) {
+            scc_memmove(links + index + 2u, links + index + 1u, (node->bt_nkeys - index) * sizeof(*links));
+        }
+        links[index + 1u] = child;
+    }
+    ++node->bt_nkeys;
+}
+
+/* Insert value at the given index in a node without room for it, along with
+ * the link to child following it. The node keeps the lower half and the
+ * returned new node the upper one. The median is stored past the last key
+ * of the new node. Only used on spines, the value is never the median */
+static struct scc_btnode_base *scc_btnode_split_at(
+    struct scc_btree_base *restrict base,
+    struct scc_btnode_base *restrict node,
+    size_t index,
+    void const *restrict value,
+    struct scc_btnode_base *restrict child,
+    size_t elemsize
+) {
+    struct scc_btnode_base *right = scc_arena_alloc(&base->bt_arena);
+    /* Reserved up front */
+    assert(right);
+    right->bt_flags = node->bt_flags & ~SCC_BTREE_FLAG_EMBEDDED;
+
+    /* Of the order keys, the lower half of those besides the median are
+     * kept in the node, which satisfies the minimum for both parities */
+    size_t const nkeys = node->bt_nkeys;
+    size_t const nleft = nkeys >> 1u;
+    right->bt_nkeys = nkeys - nleft;
+
+    unsigned char *ldata = scc_btnode_data(base, node);
+    unsigned char *rdata = scc_btnode_data(base, right);
+    struct scc_btnode_base **llinks = scc_btnode_links(base, node);
+    struct scc_btnode_base **rlinks = scc_btnode_links(base, right);
+    bool const leaf = scc_btnode_is_leaf(node);
+    void *median = scc_btnode_value(base, right, right->bt_nkeys, elemsize);
+
+    if (index < nleft) {
+        scc_memcpy(median, ldata + (nleft - 1u) * elemsize, elemsize);
+        scc_memcpy(rdata, ldata + nleft * elemsize, right->bt_nkeys * elemsize);
+        if (!leaf) {
+            scc_memcpy(rlinks, llinks + nleft, (right->bt_nkeys + 1u) * sizeof(*rlinks));
+        }
+        node->bt_nkeys = nleft - 1u;
+        scc_btnode_emplace_at(base, node, index, value, child, elemsize);
+    }
+    else {
+        assert(index > nleft);
+        scc_memcpy(median, ldata + nleft * elemsize, elemsize);
+        right->bt_nkeys = nkeys - nleft - 1u;
+        if (right->bt_nkeys) {
+            scc_memcpy(rdata, ldata + (nleft + 1u) * elemsize, right->bt_nkeys * elemsize);
+        }
+        if (!leaf) {
+            scc_memcpy(rlinks, llinks + nleft + 1u, (right->bt_nkeys + 1u) * sizeof(*rlinks));
+        }
+        node->bt_nkeys = nleft;
+        scc_btnode_emplace_at(base, right, index - nleft - 1u, value, child, elemsize);
+    }
+
+    scc_btnode_recount(base, node);
+    scc_btnode_recount(base, right);
+    return right;
+}
+
+/* Append sep and the contents of right to left */
+static void scc_btnode_concat(
+    struct scc_btree_base *restrict base,
+    struct scc_btnode_base *restrict left,
+    void const *restrict sep,
+    struct scc_btnode_base *restrict right,
+    size_t elemsize
+) {
+    assert(left->bt_nkeys + right->bt_nkeys + 1u < base->bt_order);
+    unsigned char *slot = scc_btnode_value(base, left, left->bt_nkeys, elemsize);
+    scc_memcpy(slot, sep, elemsize);
+    if (right->bt_nkeys) {
+        scc_memcpy(slot + elemsize, scc_btnode_data(base, right), right->bt_nkeys * elemsize);
+    }
+    if (!scc_btnode_is_leaf(left)) {
+        struct scc_btnode_base **llinks = scc_btnode_links(base, left);
+        scc_memcpy(llinks + left->bt_nkeys + 1u, scc_btnode_links(base, right), (right->bt_nkeys + 1u) * sizeof(*llinks));
+    }
+    left->bt_nkeys += right->bt_nkeys + 1u;
+    scc_btnode_recount(base, left);
+}
+
+/* Insert value at the given index in the last node on a path down the
+ * rightmost or leftmost spine of the tree, followed by the link to child.
+ * Full nodes are split, their medians inserted in the parent at the index
+ * of the link to the node. Returns the node the value ended up in */
+static struct scc_btnode_base *scc_btjoin_insert(
+    struct scc_btree_base *restrict base,
+    struct scc_btjoin_tree *restrict tree,
+    struct scc_btnode_base *const *restrict path,
+    size_t depth,
+    size_t index,
+    void const *value,
+    struct scc_btnode_base *child,
+    bool rightmost,
+    size_t elemsize
+) {
+    struct scc_btnode_base *dst = 0;
+    struct scc_btnode_base *node;
+    struct scc_btnode_base *right;
+    while (depth) {
+        node = path[--depth];
+        if (!scc_btnode_full(base, node)) {
+            scc_btnode_emplace_at(base, node, index, value, child, elemsize);
+            return dst ? dst : node;
+        }
+
+        right = scc_btnode_split_at(base, node, index, value, child, elemsize);
+        if (!dst) {
+            /* Order is at least 3, the index of a spine link is never the median */
+            dst = rightmost ? right : node;
+        }
+        value = scc_btnode_value(base, right, right->bt_nkeys, elemsize);
+        child = right;
+        index = depth && rightmost ? path[depth - 1u]->bt_nkeys : 0u;
+    }
+
+    struct scc_btnode_base *root = scc_arena_alloc(&base->bt_arena);
+    /* Reserved up front */
+    assert(root);
+    scc_btree_new_root(base, root, tree->root, child);
+    scc_memcpy(scc_btnode_data(base, root), value, elemsize);
+    root->bt_nkeys = 1u;
+    tree->root = root;
+    ++tree->height;
+    return dst;
+}
+
+/* Join left, sep and right into a single tree stored in left, every
+ * element in left being ordered before sep and sep before every element
+ * of right. At most one of the two may be empty. The shorter tree is
+ * attached at the matching height on the spine of the taller one, then
+ * either concatenated with its neighbour or topped up by rotating values
+ * from it. Allocates at most one node more than the height of the
+ * taller tree, reserved up front */
+static void scc_btjoin(
+    struct scc_btree_base *restrict base,
+    struct scc_btjoin_tree *restrict left,
+    void const *restrict sep,
+    struct scc_btjoin_tree right,
+    size_t elemsize
+) {
+    size_t const minkeys = scc_btree_minkeys(base);
+    struct scc_btnode_base *lroot = left->root;
+    struct scc_btnode_base *rroot = right.root;
+
+    if (left->height == right.height) {
+        assert(lroot && rroot);
+        if (lroot->bt_nkeys + rroot->bt_nkeys + 1u < base->bt_order) {
+            scc_btnode_concat(base, lroot, sep, rroot, elemsize);
+            scc_btnode_free(base, rroot);
+            return;
+        }
+
+        struct scc_btnode_base *root = scc_arena_alloc(&base->bt_arena);
+        /* Reserved up front */
+        assert(root);
+        scc_btree_new_root(base, root, lroot, rroot);
+        scc_memcpy(scc_btnode_data(base, root), sep, elemsize);
+        root->bt_nkeys = 1u;
+        while (lroot->bt_nkeys < minkeys) {
+            scc_btnode_rotate_left(base, lroot, rroot, root, 0u, elemsize);
+        }
+        while (rroot->bt_nkeys < minkeys) {
+            scc_btnode_rotate_right(base, rroot, lroot, root, 1u, elemsize);
+        }
+        scc_btnode_recount(base, root);
+        left->root = root;
+        ++left->height;
+        return;
+    }
+
+    /* Attach to the rightmost spine of left if it is taller */
+    bool const append = left->height > right.height;
+    struct scc_btjoin_tree tree = append ? *left : right;
+    struct scc_btnode_base *shorter = append ? rroot : lroot;
+    size_t const height = append ? right.height : left->height;
+
+    struct scc_btnode_base *path[SCC_BTREE_MAX_HEIGHT];
+    size_t depth = 0u;
+    struct scc_btnode_base *p = tree.root;
+    for (size_t h = tree.height; h > height + 1u; --h) {
+        path[depth++] = p;
+        p = scc_btnode_child(base, p, append ? p->bt_nkeys : 0u);
+    }
+    path[depth++] = p;
+
+    if (!shorter) {
+        /* Value goes directly in a leaf */
+        (void)scc_btjoin_insert(base, &tree, path, depth, append ? p->bt_nkeys : 0u, sep, 0, append, elemsize);
+    }
+    else {
+        struct scc_btnode_base **plinks = scc_btnode_links(base, p);
+        struct scc_btnode_base *neighbour = plinks[append ? p->bt_nkeys : 0u];
+        struct scc_btnode_base *l = append ? neighbour : shorter;
+        struct scc_btnode_base *r = append ? shorter : neighbour;
+        if (l->bt_nkeys + r->bt_nkeys + 1u < base->bt_order) {
+            scc_btnode_concat(base, l, sep, r, elemsize);
+            if (!append) {
+                plinks[0] = l;
+            }
+            scc_btnode_free(base, r);
+        }
+        else if (append) {
+            p = scc_btjoin_insert(base, &tree, path, depth, p->bt_nkeys, sep, shorter, true, elemsize);
+            while (shorter->bt_nkeys < minkeys) {
+                scc_btnode_rotate_right(base, shorter, neighbour, p, p->bt_nkeys, elemsize);
+            }
+        }
+        else {
+            /* Neighbour becomes the link following sep */
+            plinks[0] = shorter;
+            p = scc_btjoin_insert(base, &tree, path, depth, 0u, sep, neighbour, false, elemsize);
+            while (shorter->bt_nkeys < minkeys) {
+                scc_btnode_rotate_left(base, shorter, neighbour, p, 0u, elemsize);
+            }
+        }
+    }
+
+    scc_btjoin_recount(base, &tree, height, append);
+    *left = tree;
+}
+
+/* Remove the last element of a non-empty tree, copying it to out. Nodes
+ * left short on the rightmost spine are topped up from, or concatenated
+ * with, their left sibling */
+static void scc_btjoin_pop_max(
+    struct scc_btree_base *restrict base,
+    struct scc_btjoin_tree *restrict tree,
+    void *restrict out,
+    size_t elemsize
+) {
+    struct scc_btnode_base *path[SCC_BTREE_MAX_HEIGHT];
+    size_t depth = 0u;
+    struct scc_btnode_base *node = tree->root;
+    while (true) {
+        path[depth++] = node;
+        if (scc_btnode_is_leaf(node)) {
+            break;
+        }
+        node = scc_btnode_child(base, node, node->bt_nkeys);
+    }
+
+    scc_memcpy(out, scc_btnode_value(base, node, --node->bt_nkeys, elemsize), elemsize);
+
+    size_t const minkeys = scc_btree_minkeys(base);
+    struct scc_btnode_base *p;
+    struct scc_btnode_base *sibling;
+    for (size_t d = depth - 1u; d && path[d]->bt_nkeys < minkeys; --d) {
+        node = path[d];
+        p = path[d - 1u];
+        sibling = scc_btnode_child(base, p, p->bt_nkeys - 1u);
+        if (sibling->bt_nkeys > minkeys) {
+            scc_btnode_rotate_right(base, node, sibling, p, p->bt_nkeys, elemsize);
+        }
+        else {
+            scc_btnode_concat(base, sibling, scc_btnode_value(base, p, p->bt_nkeys - 1u, elemsize), node, elemsize);
+            --p->bt_nkeys;
+            scc_btnode_free(base, node);
+        }
+    }
+
+    node = tree->root;
+    if (!node->bt_nkeys) {
+        tree->root = scc_btnode_is_leaf(node) ? 0 : scc_btnode_child(base, node, 0u);
+        --tree->height;
+        scc_btnode_free(base, node);
+    }
+    scc_btjoin_recount(base, tree, 0u, true);
+}
+
+/* Replace the embedded node on the leftmost spine of the tree, if any,
+ * with a copy allocated from the arena. Values joined to the left of the
+ * tree would otherwise push it off the spine. Reserved up front */
+static void scc_btree_evict_embedded(struct scc_btree_base *base) {
+    struct scc_btnode_base *p = 0;
+    struct scc_btnode_base *node = base->bt_root;
+    while (!(node->bt_flags & SCC_BTREE_FLAG_EMBEDDED)) {
+        if (scc_btnode_is_leaf(node)) {
+            return;
+        }
+        p = node;
+        node = scc_btnode_child(base, node, 0u);
+    }
+
+    struct scc_btnode_base *copy = scc_arena_alloc(&base->bt_arena);
+    assert(copy);
+    scc_memcpy(copy, node, base->bt_arena.ar_elemsize);
+    copy->bt_flags &= ~SCC_BTREE_FLAG_EMBEDDED;
+    if (p) {
+        scc_btnode_links(base, p)[0] = copy;
+    }
+    else {
+        base->bt_root = copy;
+    }
+}
+
+static inline void const *scc_btree_min(struct scc_btree_base const *base) {
+    struct scc_btnode_base *node = base->bt_root;
+    while (!scc_btnode_is_leaf(node)) {
+        node = scc_btnode_child(base, node, 0u);
+    }
+    return scc_btnode_data(base, node);
+}
+
+static inline void const *scc_btree_max(struct scc_btree_base const *base, size_t elemsize) {
+    struct scc_btnode_base *node = base->bt_root;
+    while (!scc_btnode_is_leaf(node)) {
+        node = scc_btnode_child(base, node, node->bt_nkeys);
+    }
+    return scc_btnode_value(base, node, node->bt_nkeys - 1u, elemsize);
+}
+
+/* Cut the tree along a path from the root to a leaf, bottom up, joining
+ * the nodes on either side of the path to the parts of the tree below.
+ * Keys before the bound in each node on the path end up in left, the rest
+ * in right. Only nodes on the path are modified, the left part keeps them
+ * while the right part gets new ones. The sep buffer serves as scratch
+ * space for separators. Allocates at most height + (height + 1) *
+ * (height + 2) nodes, reserved up front */
+static void scc_btjoin_cut(
+    struct scc_btree_base *restrict base,
+    struct scc_btnode_base *const *restrict path,
+    size_t const *restrict bounds,
+    size_t height,
+    unsigned char *restrict sep,
+    struct scc_btjoin_tree *restrict left,
+    struct scc_btjoin_tree *restrict right,
+    size_t elemsize
+) {
+    struct scc_btjoin_tree ltree = { 0 };
+    struct scc_btjoin_tree rtree = { 0 };
+    struct scc_btjoin_tree frag;
+    struct scc_btnode_base *node;
+    struct scc_btnode_base **links;
+    unsigned char *data;
+    size_t b;
+    size_t nkeys;
+    for (size_t d = height; d--;) {
+        node = path[d];
+        b = bounds[d];
+        nkeys = node->bt_nkeys;
+        data = scc_btnode_data(base, node);
+        links = scc_btnode_links(base, node);
+        size_t const h = height - d;
+
+        if (h == 1u) {
+            if (b < nkeys) {
+                frag.root = scc_btnode_new_leaf(base);
+                scc_memcpy(scc_btnode_data(base, frag.root), data + b * elemsize, (nkeys - b) * elemsize);
+                frag.root->bt_nkeys = nkeys - b;
+                scc_btnode_recount(base, frag.root);
+                rtree = (struct scc_btjoin_tree) { frag.root, 1u };
+            }
+            if (b) {
+                node->bt_nkeys = b;
+                scc_btnode_recount(base, node);
+                ltree = (struct scc_btjoin_tree) { node, 1u };
+            }
+            else {
+                scc_btnode_free(base, node);
+            }
+            continue;
+        }
+
+        /* Keys following the bound and the links between them */
+        if (b < nkeys) {
+            if (b + 1u < nkeys) {
+                frag.root = scc_arena_alloc(&base->bt_arena);
+                assert(frag.root);
+                frag.root->bt_flags = 0u;
+                frag.root->bt_nkeys = nkeys - b - 1u;
+                scc_memcpy(scc_btnode_data(base, frag.root), data + (b + 1u) * elemsize, frag.root->bt_nkeys * elemsize);
+                scc_memcpy(scc_btnode_links(base, frag.root), links + b + 1u, (nkeys - b) * sizeof(*links));
+                scc_btnode_recount(base, frag.root);
+                frag.height = h;
+            }
+            else {
+                frag = (struct scc_btjoin_tree) { links[nkeys], h - 1u };
+            }
+            scc_memcpy(sep, data + b * elemsize, elemsize);
+            scc_btjoin(base, &rtree, sep, frag, elemsize);
+        }
+
+        /* Keys preceding the bound and the links between them */
+        if (b) {
+            scc_memcpy(sep, data + (b - 1u) * elemsize, elemsize);
+            if (b > 1u) {
+                node->bt_nkeys = b - 1u;
+                scc_btnode_recount(base, node);
+                frag = (struct scc_btjoin_tree) { node, h };
+            }
+            else {
+                frag = (struct scc_btjoin_tree) { links[0], h - 1u };
+                scc_btnode_free(base, node);
+            }
+            scc_btjoin(base, &frag, sep, ltree, elemsize);
+            ltree = frag;
+        }
+        else {
+            scc_btnode_free(base, node);
+        }
+    }
+
+    *left = ltree;
+    *right = rtree;
+}
+
+/* Merge by rebuilding the tree from a single in-order pass over both,
+ * streamed into a new arena before the current one is released */
+static bool scc_btree_merge_rebuild(void *dst, void const *src, size_t elemsize) {
+    struct scc_btree_base *base = scc_btree_impl_base(dst);
+    struct scc_btree_base *nbase = scc_btree_alloc_like(dst, elemsize);
+    if (!nbase) {
+        return false;
+    }
+
+    struct scc_btbuild build;
+    if (!scc_btbuild_init(&build, nbase, base->bt_size + scc_btree_size(src))) {
+        scc_btree_impl_free(nbase);
+        return false;
+    }
+    (void)scc_btree_combine(dst, src, nbase, &build, SCC_BTREE_MERGE, elemsize);
+    scc_btbuild_finish(nbase);
+
+    scc_arena_release(&base->bt_arena);
+    base->bt_arena = nbase->bt_arena;
+    base->bt_root = nbase->bt_root;
+    base->bt_size = nbase->bt_size;
+    scc_allocator_free(base->bt_arena.ar_allocator, nbase);
+    return true;
+}
+
+/* Record the path from the root to the leaf where the first element ordered
+ * after value would be, along with the upper bound of value in each node.
+ * Returns the length of the path */
+static size_t scc_btree_upper_path(
+    struct scc_btree_base const *restrict base,
+    void const *restrict value,
+    struct scc_btnode_base **restrict path,
+    size_t *restrict bounds,
+    size_t elemsize
+) {
+    size_t height = 0u;
+    struct scc_btnode_base *node = base->bt_root;
+    while (true) {
+        path[height] = node;
+        bounds[height] = scc_btnode_upper_bound(base, node, value, elemsize);
+        if (scc_btnode_is_leaf(node)) {
+            return height + 1u;
+        }
+        node = scc_btnode_child(base, node, bounds[height++]);
+    }
+}
+
+/* Merge src into the gap of dst following the last element not ordered
+ * after the smallest one in src. The tree is cut along the path to the
+ * gap and the two parts joined on either side of a copy of src, leaving
+ * all nodes off the path in place. Falls back to rebuilding if an element
+ * in dst is ordered between the smallest and largest ones in src */
+static bool scc_btree_merge_splice(void *dst, void const *src, size_t elemsize) {
+    struct scc_btree_base *base = scc_btree_impl_base(dst);
+    struct scc_btree_base const *sbase = scc_btree_impl_base_qual(src, const);
+
+    struct scc_btnode_base *path[SCC_BTREE_MAX_HEIGHT];
+    size_t bounds[SCC_BTREE_MAX_HEIGHT];
+    size_t height = scc_btree_upper_path(base, scc_btree_min(sbase), path, bounds, elemsize);
+
+    /* The first element following the gap is at the bound in the deepest
+     * node on the path not bounded past its last key */
+    for (size_t d = height; d--;) {
+        if (bounds[d] < path[d]->bt_nkeys) {
+            void const *next = scc_btnode_value(base, path[d], bounds[d], elemsize);
+            if (base->bt_compare(next, scc_btree_max(sbase, elemsize)) <= 0) {
+                return scc_btree_merge_rebuild(dst, src, elemsize);
+            }
+            break;
+        }
+    }
+
+    size_t const sheight = scc_btnode_height(sbase, sbase->bt_root);
+    size_t const taller = height > sheight ? height : sheight;
+    size_t nnodes = 0u;
+    (void)scc_btnode_census(sbase, sbase->bt_root, &nnodes);
+    /* Copy of src, the cut, the two joins and the evicted embedded node */
+    nnodes += height + (height + 1u) * (height + 2u) + 2u * taller + 4u;
+    if (!scc_arena_reserve(&base->bt_arena, nnodes)) {
+        return false;
+    }
+
+    /* The embedded node may be on the path, descend anew once evicted */
+    scc_btree_evict_embedded(base);
+    height = scc_btree_upper_path(base, scc_btree_min(sbase), path, bounds, elemsize);
+
+    /* The handle serves as scratch space for separators */
+    struct scc_btjoin_tree ltree;
+    struct scc_btjoin_tree rtree;
+    scc_btjoin_cut(base, path, bounds, height, dst, &ltree, &rtree, elemsize);
+    struct scc_btjoin_tree stree = { scc_btnode_copy(sbase, &base->bt_arena, sbase->bt_root), sheight };
+
+    scc_btjoin_pop_max(base, &ltree, dst, elemsize);
+    scc_btjoin(base, &ltree, dst, stree, elemsize);
+    scc_btjoin_pop_max(base, &ltree, dst, elemsize);
+    scc_btjoin(base, &ltree, dst, rtree, elemsize);
+
+    base->bt_root = ltree.root;
+    base->bt_size += sbase->bt_size;
+    return true;
+}
+
+_Bool scc_btree_impl_merge(void *dst, void const *src, size_t elemsize) {
+    struct scc_btree_base *base = scc_btree_impl_base(dst);
+    struct scc_btree_base const *sbase = scc_btree_impl_base_qual(src, const);
+    assert(base->bt_compare == sbase->bt_compare);
+
+    if (!sbase->bt_size) {
+        return true;
+    }
+
+    /* Copies from dst come first, src may only be prepended if strictly smaller */
+    bool const append = !base->bt_size || base->bt_compare(scc_btree_max(base, elemsize), scc_btree_min(sbase)) <= 0;
+    if (!append && base->bt_compare(scc_btree_max(sbase, elemsize), scc_btree_min(base)) >= 0) {
+        return scc_btree_merge_splice(dst, src, elemsize);
+    }
+
+    struct scc_btjoin_tree dtree = { base->bt_root, scc_btnode_height(base, base->bt_root) };
+    struct scc_btjoin_tree stree = { 0, scc_btnode_height(sbase, sbase->bt_root) };
+    size_t nnodes = 0u;
+    (void)scc_btnode_census(sbase, sbase->bt_root, &nnodes);
+    /* Copy of src, the join and the evicted embedded node */
+    nnodes += (dtree.height > stree.height ? dtree.height : stree.height) + 2u;
+    if (!scc_arena_reserve(&base->bt_arena, nnodes)) {
+        return false;
+    }
+    stree.root = scc_btnode_copy(sbase, &base->bt_arena, sbase->bt_root);
+
+    if (!base->bt_size) {
+        scc_btnode_free(base, dtree.root);
+        dtree = stree;
+    }
+    else if (append) {
+        /* The handle serves as scratch space for the separator */
+        scc_btjoin_pop_max(base, &dtree, dst, elemsize);
+        scc_btjoin(base, &dtree, dst, stree, elemsize);
+    }
+    else {
+        scc_btree_evict_embedded(base);
+        dtree.root = base->bt_root;
+        scc_btjoin_pop_max(base, &stree, dst, elemsize);
+        scc_btjoin(base, &stree, dst, dtree, elemsize);
+        dtree = stree;
+    }
+
+    base->bt_root = dtree.root;
+    base->bt_size += sbase->bt_size;
+    return true;
+}
+
+_Bool scc_btree_impl_split(void *btree, void *rightaddr, size_t elemsize) {
+    struct scc_btree_base *base = scc_btree_impl_base(btree);
+    struct scc_btree_base *rbase = scc_btree_alloc_like(btree, elemsize);
+    if (!rbase) {
+        return false;
+    }
+
+    /* Path to the leaf holding the lower bound of the key */
+    struct scc_btnode_base *path[SCC_BTREE_MAX_HEIGHT];
+    size_t bounds[SCC_BTREE_MAX_HEIGHT];
+    size_t height = 0u;
+    size_t rank = 0u;
+    struct scc_btnode_base *node = base->bt_root;
+    while (true) {
+        path[height] = node;
+        bounds[height] = scc_btnode_lower_bound(base, node, btree, elemsize);
+        rank += bounds[height];
+        if (scc_btnode_is_leaf(node)) {
+            ++height;
+            break;
+        }
+        if (scc_btree_counted(base)) {
+            for (size_t i = 0u; i < bounds[height]; ++i) {
+                rank += *scc_btnode_count(base, scc_btnode_child(base, node, i));
+            }
+        }
+        node = scc_btnode_child(base, node, bounds[height++]);
+    }
+
+    /* The nodes on one side of the path are moved to the arena of the other
+     * side, pick the one likely to be smaller. Without counts, guess from the
+     * position of the path in the root */
+    size_t const n = base->bt_size;
+    bool const moveleft = scc_btree_counted(base) ?
+        rank < n - rank :
+        bounds[0] < base->bt_root->bt_nkeys - bounds[0];
+
+    /* Elements and nodes on the moved side */
+    size_t nmoved = 0u;
+    size_t nnodes = 0u;
+    size_t b;
+    size_t nkeys;
+    for (size_t d = 0u; d < height; ++d) {
+        b = bounds[d];
+        nkeys = path[d]->bt_nkeys;
+        nmoved += moveleft ? b : nkeys - b;
+        if (scc_btnode_is_leaf(path[d])) {
+            continue;
+        }
+        for (size_t i = moveleft ? 0u : b + 1u; i < (moveleft ? b : nkeys + 1u); ++i) {
+            nmoved += scc_btnode_census(base, scc_btnode_child(base, path[d], i), &nnodes);
+        }
+    }
+    size_t const lsize = moveleft ? nmoved : n - nmoved;
+
+    /* Nodes cut off the path, those allocated by joins, two per level,
+     * and an empty root */
+    size_t const nalloc = height + (height + 1u) * (height + 2u) + 1u;
+    struct scc_arena arena = scc_arena_clone(&base->bt_arena);
+    struct scc_arena *dst = moveleft ? &arena : &rbase->bt_arena;
+    if (!scc_arena_reserve(&base->bt_arena, nalloc) || !scc_arena_reserve(dst, nnodes + height + nalloc)) {
+        scc_arena_release(&arena);
+        scc_btree_impl_free(rbase);
+        return false;
+    }
+
+    /* The handle serves as scratch space for separators */
+    struct scc_btjoin_tree ltree;
+    struct scc_btjoin_tree rtree;
+    scc_btjoin_cut(base, path, bounds, height, btree, &ltree, &rtree, elemsize);
+
+    if (moveleft) {
+        if (ltree.root) {
+            ltree.root = scc_btnode_move(base, &arena, ltree.root);
+        }
+        rbase->bt_arena = base->bt_arena;
+        base->bt_arena = arena;
+    }
+    else if (rtree.root) {
+        rtree.root = scc_btnode_move(base, &rbase->bt_arena, rtree.root);
+    }
+
+    base->bt_root = ltree.root ? ltree.root : scc_btnode_new_leaf(base);
+    base->bt_size = lsize;
+    rbase->bt_root = rtree.root ? rtree.root : scc_btnode_new_leaf(rbase);
+    rbase->bt_size = n - lsize;
+
+    *(void **)rightaddr = scc_btree_handle(rbase);
+    return true;
+}
+
+void *scc_btree_impl_union(void const *left, void const *right, size_t elemsize) {
+    return scc_btree_setop(left, right, SCC_BTREE_UNION, elemsize);
+}
+
+void *scc_btree_impl_intersection(void const *left, void const *right, size_t elemsize) {
+    return scc_btree_setop(left, right, SCC_BTREE_INTERSECTION, elemsize);
+}
+
+void *scc_btree_impl_difference(void const *left, void const *right, size_t elemsize) {
+    return scc_btree_setop(left, right, SCC_BTREE_DIFFERENCE, elemsize);
+}
+
+size_t scc_btree_impl_rank(void const *btree, size_t elemsize) {
+    struct scc_btree_base const *base = scc_btree_impl_base_qual(btree, const);
+    assert(scc_btree_counted(base));
+
+    struct scc_btnode_base *curr = base->bt_root;
+    struct scc_btnode_base **links;
+    size_t rank = 0u;
+    size_t bound;
+    while (1) {
+        /* Every key before the bound, and the subtree to the left of each */
+        bound = scc_btnode_lower_bound(base, curr, btree, elemsize);
+        rank += bound;
+        if (scc_btnode_is_leaf(curr)) {
+            break;
+        }
+
+        links = scc_btnode_links(base, curr);
+        for (size_t i = 0u; i < bound; ++i) {
+            rank += *scc_btnode_count(base, links[i]);
+        }
+        curr = links[bound];
+    }
+
+    return rank;
+}
+
+void const *scc_btree_impl_select(void const *btree, size_t k, size_t elemsize) {
+    struct scc_btree_base const *base = scc_btree_impl_base_qual(btree, const);
+    assert(scc_btree_counted(base));
+    if (k >= base->bt_size) {
+        return 0;
+    }
+
+    struct scc_btnode_base *curr = base->bt_root;
+    struct scc_btnode_base **links;
+    size_t count;
+    size_t i;
+    while (!scc_btnode_is_leaf(curr)) {
+        links = scc_btnode_links(base, curr);
+        for (i = 0u; i < curr->bt_nkeys; ++i) {
+            count = *scc_btnode_count(base, links[i]);
+            if (k < count) {
+                break;
+            }
+            if (k == count) {
+                return scc_btnode_value(base, curr, i, elemsize);
+            }
+            k -= count + 1u;
+        }
+        curr = links[i];
+    }
+
+    assert(k < curr->bt_nkeys);
+    return scc_btnode_value(base, curr, k, elemsize);
+}
+
+void const *scc_btree_impl_quantile(void const *btree, double q, size_t elemsize) {
+    size_t const size = scc_btree_size(btree);
+    if (!size) {
+        return 0;
+    }
+
+    /* Nearest rank, ceil(q * n) - 1. q outside of [0, 1] or NaN is clamped */
+    size_t k = 0u;
+    if (q >= 1.0) {
+        k = size - 1u;
+    }
+    else if (q > 0.0) {
+        double const rank = q * (double)size;
+        k = (size_t)rank;
+        /* (size_t)rank is floor(rank), already ceil(rank) - 1 unless integral */
+        if ((double)k >= rank && k) {
+            --k;
+        }
+    }
+    return scc_btree_impl_select(btree, k, elemsize);
+}
+
+static inline void scc_btree_iter_push(struct scc_btree_iter *iter, struct scc_btnode_base *node, size_t index) {
+    assert(iter->it_depth < SCC_BTREE_MAX_HEIGHT);
+    iter->it_nodes[iter->it_depth] = node;
+    iter->it_index[iter->it_depth] = index;
+    ++iter->it_depth;
+}
+
+static inline void const *scc_btree_iter_current(
+    struct scc_btree_base const *restrict base,
+    struct scc_btree_iter const *restrict iter,
+    size_t elemsize
+) {
+    if (!iter->it_depth) {
+        return 0;
+    }
+    unsigned top = iter->it_depth - 1u;
+    return scc_btnode_value(base, iter->it_nodes[top], iter->it_index[top], elemsize);
+}
+
+/* Push node and its leftmost descendants down to the leaf level */
+static void scc_btree_iter_descend(
+    struct scc_btree_base const *restrict base,
+    struct scc_btree_iter *restrict iter,
+    struct scc_btnode_base *node
+) {
+    while (1) {
+        scc_btree_iter_push(iter, node, 0u);
+        if (scc_btnode_is_leaf(node)) {
+            break;
+        }
+        node = scc_btnode_child(base, node, 0u);
+    }
+}
+
+/* Pop exhausted nodes until the top frame refers to an element */
+static inline void scc_btree_iter_ascend(struct scc_btree_iter *iter) {
+    while (iter->it_depth && iter->it_index[iter->it_depth - 1u] == iter->it_nodes[iter->it_depth - 1u]->bt_nkeys) {
+        --iter->it_depth;
+    }
+}
+
+void const *scc_btree_impl_leftmost(void const *btree, struct scc_btree_iter *iter, size_t elemsize) {
+    struct scc_btree_base const *base = scc_btree_impl_base_qual(btree, const);
+    iter->it_depth = 0u;
+    scc_btree_iter_descend(base, iter, base->bt_root);
+    scc_btree_iter_ascend(iter);
+    return scc_btree_iter_current(base, iter, elemsize);
+}
+
+static void const *scc_btree_iter_bound(void const *btree, struct scc_btree_iter *iter, size_t elemsize, bool upper) {
+    struct scc_btree_base const *base = scc_btree_impl_base_qual(btree, const);
+    iter->it_depth = 0u;
+
+    struct scc_btnode_base *curr = base->bt_root;
+    size_t bound;
+    while (1) {
+        bound = upper ?
+            scc_btnode_upper_bound(base, curr, btree, elemsize) :
+            scc_btnode_lower_bound(base, curr, btree, elemsize);
+        /* Elements in the subtree at the bound are visited before the one at the bound */
+        scc_btree_iter_push(iter, curr, bound);
+        if (scc_btnode_is_leaf(curr)) {
+            break;
+        }
+        curr = scc_btnode_child(base, curr, bound);
+    }
+
+    scc_btree_iter_ascend(iter);
+    return scc_btree_iter_current(base, iter, elemsize);
+}
+
+void const *scc_btree_impl_lower_bound(void const *btree, struct scc_btree_iter *iter, size_t elemsize) {
+    return scc_btree_iter_bound(btree, iter, elemsize, false);
+}
+
+void const *scc_btree_impl_upper_bound(void const *btree, struct scc_btree_iter *iter, size_t elemsize) {
+    return scc_btree_iter_bound(btree, iter, elemsize, true);
+}
+
+void const *scc_btree_impl_iter_next(void const *btree, struct scc_btree_iter *iter, size_t elemsize) {
+    struct scc_btree_base const *base = scc_btree_impl_base_qual(btree, const);
+    if (!iter->it_depth) {
+        return 0;
+    }
+
+    unsigned top = iter->it_depth - 1u;
+    struct scc_btnode_base *node = iter->it_nodes[top];
+    size_t index = ++iter->it_index[top];
+    if (scc_btnode_is_leaf(node)) {
+        scc_btree_iter_ascend(iter);
+    }
+    else {
+        /* Successor is the leftmost element in the right subtree */
+        scc_btree_iter_descend(base, iter, scc_btnode_child(base, node, index));
+    }
+    return scc_btree_iter_current(base, iter, elemsize);
+}
+
+/* Map the index one past the last step of a search to the index of the
+ * bound, 0 if there is none. Each step right appends a set bit to k */
+static inline size_t scc_btfrozen_settle(size_t k) {
+    while (k & 1u) {
+        k >>= 1u;
+    }
+    return k >> 1u;
+}
+
+/* Index of the in-order successor of k in an implicit tree of size n */
+static inline size_t scc_btfrozen_successor(size_t k, size_t n) {
+    if (2u * k + 1u > n) {
+        /* Climb until arriving from a left child */
+        return scc_btfrozen_settle(k);
+    }
+    /* Leftmost element in the right subtree */
+    k = 2u * k + 1u;
+    while (2u * k <= n) {
+        k *= 2u;
+    }
+    return k;
+}
+
+void *scc_btree_impl_freeze(void const *btree, size_t elemsize) {
+    struct scc_btree_base const *base = scc_btree_impl_base_qual(btree, const);
+    size_t const coff = (unsigned char const *)btree - (unsigned char const *)base;
+
+    /* The alignment of the type divides both its size and the offset of the
+     * handle in the btree, the lowest bit set in either is therefore suitable */
+    size_t const align = (coff | elemsize) & ~((coff | elemsize) - 1u);
+    size_t const fwpos = offsetof(struct scc_btfrozen_base, bf_fwoff) + sizeof(unsigned char);
+    size_t const foff = scc_align(fwpos + sizeof(unsigned char), align);
+    size_t const fwoff = foff - fwpos;
+    assert(fwoff <= UCHAR_MAX);
+
+    /* The handle doubles as the unused element at index 0 */
+    size_t const bytesz = foff + (base->bt_size + 1u) * elemsize;
+    struct scc_btfrozen_base *fbase = scc_allocator_alloc(base->bt_arena.ar_allocator, bytesz);
+    if (!fbase) {
+        return 0;
+    }
+
+    fbase->bf_size = base->bt_size;
+    fbase->bf_compare = base->bt_compare;
+    fbase->bf_allocator = base->bt_arena.ar_allocator;
+    fbase->bf_keykind = base->bt_keykind;
+    fbase->bf_fwoff = (unsigned char)fwoff;
+
+    unsigned char *frozen = (unsigned char *)fbase + foff;
+    scc_btree_set_bkoff(frozen, fwoff);
+
+    size_t const n = fbase->bf_size;
+    if (!n) {
+        return frozen;
+    }
+
+    /* Visit the implicit tree in order while traversing the btree */
+    size_t k = 1u;
+    while (2u * k <= n) {
+        k *= 2u;
+    }
+
+    struct scc_btree_iter iter;
+    for (void const *elem = scc_btree_impl_leftmost(btree, &iter, elemsize); elem;
+            elem = scc_btree_impl_iter_next(btree, &iter, elemsize)) {
+        assert(k);
+        scc_memcpy(frozen + k * elemsize, elem, elemsize);
+        k = scc_btfrozen_successor(k, n);
+    }
+    assert(!k);
+
+    return frozen;
+}
+
+void scc_btfrozen_free(void *frozen) {
+    struct scc_btfrozen_base *base = scc_btfrozen_impl_base(frozen);
+    scc_allocator_free(base->bf_allocator, base);
+}
+
+/* Descend the implicit tree, computing the next index without branching on
+ * the result of the comparison. The prefetched line holds the descendants
+ * SCC_BTFROZEN_PREFETCH_DEPTH levels down */
+#define scc_btfrozen_descend(keys, n, lt)                                                           \
+    do {                                                                                            \
+        while (k <= (n)) {                                                                          \
+            scc_prefetch((keys) + (k << SCC_BTFROZEN_PREFETCH_DEPTH));                              \
+            k = 2u * k + (size_t)(lt);                                                              \
+        }                                                                                           \
+    } while (0)
+
+#define scc_btfrozen_define_lower_bound(suffix, type)                                               \
+    static size_t scc_btfrozen_lower_bound_ ## suffix(void const *frozen, size_t n) {               \
+        type const *keys = frozen;                                                                  \
+        type const key = keys[0];                                                                   \
+        size_t k = 1u;                                                                              \
+        scc_btfrozen_descend(keys, n, keys[k] < key);                                               \
+        return scc_btfrozen_settle(k);                                                              \
+    }
+
+scc_btfrozen_define_lower_bound(i32, int32_t)
+scc_btfrozen_define_lower_bound(i64, int64_t)
+scc_btfrozen_define_lower_bound(f32, float)
+scc_btfrozen_define_lower_bound(f64, double)
+
+static size_t scc_btfrozen_lower_bound_generic(
+    struct scc_btfrozen_base const *base,
+    void const *frozen,
+    size_t elemsize
+) {
+    unsigned char const *data = frozen;
+    size_t const n = base->bf_size;
+    size_t k = 1u;
+    while (k <= n) {
+        scc_prefetch(data + (k << SCC_BTFROZEN_PREFETCH_DEPTH) * elemsize);
+        k = 2u * k + (size_t)(base->bf_compare(data + k * elemsize, frozen) < 0);
+    }
+    return scc_btfrozen_settle(k);
+}
+
+static size_t scc_btfrozen_search(struct scc_btfrozen_base const *base, void const *frozen, size_t elemsize) {
+    switch (base->bf_keykind) {
+        case SCC_BTKEY_I32:
+            return scc_btfrozen_lower_bound_i32(frozen, base->bf_size);
+        case SCC_BTKEY_I64:
+            return scc_btfrozen_lower_bound_i64(frozen, base->bf_size);
+        case SCC_BTKEY_F32:
+            return scc_btfrozen_lower_bound_f32(frozen, base->bf_size);
+        case SCC_BTKEY_F64:
+            return scc_btfrozen_lower_bound_f64(frozen, base->bf_size);
+        default:
+            break;
+    }
+    return scc_btfrozen_lower_bound_generic(base, frozen, elemsize);
+}
+
+void const *scc_btfrozen_impl_lower_bound(void const *frozen, size_t elemsize) {
+    struct scc_btfrozen_base const *base = scc_btfrozen_impl_base_qual(frozen, const);
+    size_t k = scc_btfrozen_search(base, frozen, elemsize);
+    if (!k) {
+        return 0;
+    }
+    return (unsigned char const *)frozen + k * elemsize;
+}
+
+void const *scc_btfrozen_impl_find(void const *frozen, size_t elemsize) {
+    struct scc_btfrozen_base const *base = scc_btfrozen_impl_base_qual(frozen, const);
+    void const *elem = scc_btfrozen_impl_lower_bound(frozen, elemsize);
+    if (!elem || base->bf_compare(elem, frozen)) {
+        return 0;
+    }
+    return elem;
+}
@@ -2,7 +2,6 @@
 
 #include <assert.h>
 #include <stdbool.h>
-#include <stdlib.h>
 #include <string.h>
 
 size_t scc_deque_impl_npad(void const *deque);
@@ -30,12 +29,13 @@ static inline size_t scc_deque_bytesize(size_t capacity, size_t elemsize, size_t
     return capacity * elemsize + sizeof(struct scc_deque_base) + npad;
 }
 
-static struct scc_deque_base *scc_deque_alloc(size_t capacity, size_t size, size_t elemsize, size_t npad) {
+static struct scc_deque_base *scc_deque_alloc(struct scc_allocator const *allocator, size_t capacity, size_t size, size_t elemsize, size_t npad) {
     size_t const nbytes = scc_deque_bytesize(capacity, elemsize, npad);
-    struct scc_deque_base *base = malloc(nbytes);
+    struct scc_deque_base *base = scc_allocator_alloc(allocator, nbytes);
     if (!base) {
         return 0;
     }
+    base->rd_allocator = allocator;
     assert((unsigned char *)base + nbytes == &base->rd_buffer[npad] + capacity * elemsize);
     base->rd_size = size;
     base->rd_capacity = capacity;
@@ -47,7 +47,7 @@ static struct scc_deque_base *scc_deque_alloc(size_t capacity, size_t size, size
 static bool scc_deque_grow(void **dequeaddr, size_t newcap, size_t elemsize) {
     size_t const npad = scc_deque_impl_npad(*dequeaddr);
     struct scc_deque_base *prev = scc_deque_impl_base(*dequeaddr);
-    struct scc_deque_base *base = scc_deque_alloc(newcap, prev->rd_size, elemsize, npad);
+    struct scc_deque_base *base = scc_deque_alloc(prev->rd_allocator, newcap, prev->rd_size, elemsize, npad);
     if (!base) {
         return false;
     }
@@ -65,7 +65,7 @@ static bool scc_deque_grow(void **dequeaddr, size_t newcap, size_t elemsize) {
     base->rd_end = base->rd_size;
 
     if (scc_deque_get_dynalloc(*dequeaddr)) {
-        free(prev);
+        scc_allocator_free(prev->rd_allocator, prev);
     }
 
     *dequeaddr = data;
@@ -79,12 +79,13 @@ void *scc_deque_impl_new(struct scc_deque_base *base, size_t offset, size_t capa
     return handle;
 }
 
-void *scc_deque_impl_new_dyn(size_t dequesz, size_t offset, size_t capacity) {
-    struct scc_deque_base *base = calloc(dequesz, sizeof(unsigned char));
+void *scc_deque_impl_new_dyn(size_t dequesz, size_t offset, size_t capacity, struct scc_allocator const *allocator) {
+    struct scc_deque_base *base = scc_allocator_zalloc(allocator, dequesz);
     if (!base) {
         return 0;
     }
 
+    base->rd_allocator = allocator;
     void *deque = scc_deque_impl_new(base, offset, capacity);
     scc_deque_set_dynalloc(deque);
     return deque;
@@ -92,7 +93,8 @@ void *scc_deque_impl_new_dyn(size_t dequesz, size_t offset, size_t capacity) {
 
 void scc_deque_free(void *deque) {
     if (scc_deque_get_dynalloc(deque)) {
-        free(scc_deque_impl_base(deque));
+        struct scc_deque_base *base = scc_deque_impl_base(deque);
+        scc_allocator_free(base->rd_allocator, base);
     }
 }
 
@@ -125,7 +127,7 @@ void *scc_deque_impl_clone(void const *deque, size_t elemsize) {
     size_t const basesz = (unsigned char const *)deque - (unsigned char const *)obase;
     size_t const bytesz = obase->rd_capacity * elemsize + basesz;
     scc_when_mutating(assert(bytesz > obase->rd_capacity * elemsize));
-    struct scc_deque_base *nbase = malloc(bytesz);
+    struct scc_deque_base *nbase = scc_allocator_alloc(obase->rd_allocator, bytesz);
     if (!nbase) {
         return 0;
     }
@@ -1,9 +1,11 @@
 #include <scc/arch.h>
 #include <scc/hashmap.h>
+#include <scc/pages.h>
 
 #include <assert.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -14,6 +16,8 @@ enum { SCC_HASHMAP_HASHSHIFT = 57 };
 size_t scc_hashmap_impl_bkpad(void const *map);
 size_t scc_hashmap_capacity(void const *map);
 size_t scc_hashmap_size(void const *map);
+void scc_hashmap_set_incremental(void *map, bool enable);
+void *scc_hashmap_impl_iter_value(void *map, void const *key, size_t keysize, size_t valsize);
 
 static inline void scc_hashmap_set_mdent(
     scc_hashmap_metatype *md,
@@ -39,17 +43,63 @@ static inline void scc_hashmap_set_bkoff(void *map, unsigned char bkoff) {
     ((unsigned char *)map)[-1] = bkoff;
 }
 
+static inline size_t scc_hashmap_lineal(size_t align) {
+    return align > SCC_PAGES_LINESZ ? align : SCC_PAGES_LINESZ;
+}
+
+/* Size of the allocation backing a dynamically allocated map */
+static inline size_t scc_hashmap_bytesz(struct scc_hashmap_base const *base) {
+    if (base->hm_hashoff) {
+        return base->hm_hashoff + base->hm_capacity * sizeof(scc_hash_type);
+    }
+    scc_static_assert(sizeof(scc_hashmap_metatype) == 1);
+    size_t sz = base->hm_mdoff + base->hm_capacity + SCC_HASHMAP_GUARDSZ;
+    scc_when_mutating(assert(sz > base->hm_mdoff + base->hm_capacity));
+#ifdef SCC_CANARY_ENABLED
+    sz += SCC_HASHMAP_CANARYSZ;
+#endif
+    return sz;
+}
+
+static inline size_t scc_hashmap_load_limit(size_t capacity) {
+    /* 87.5% */
+    return (capacity >> 1u) +
+           (capacity >> 2u) +
+           (capacity >> 3u);
+}
+
 static inline bool scc_hashmap_should_rehash(struct scc_hashmap_base const *base) {
-    /* Rehash at 87.5% */
-    return base->hm_size > (base->hm_capacity >> 1u) +
-                           (base->hm_capacity >> 2u) +
-                           (base->hm_capacity >> 3u);
+    return base->hm_size > scc_hashmap_load_limit(base->hm_capacity);
+}
+
+static inline bool scc_hashmap_should_compact(struct scc_hashmap_base const *base) {
+    /* Too many tombstones or too few empty slots left to terminate probing */
+    return base->hm_tombs * 100u > base->hm_capacity * SCC_HASHMAP_TOMBSTONE_PERCENT ||
+           base->hm_size + base->hm_tombs > scc_hashmap_load_limit(base->hm_capacity);
+}
+
+static inline void scc_hashmap_set_tombs(struct scc_hashmap_base *base, size_t tombs) {
+    base->hm_tombs = tombs;
+    SCC_ON_PERFTRACK(base->hm_perf.ev_n_tombstones = tombs);
 }
 
 static inline size_t scc_hashmap_sizeup(struct scc_hashmap_base const *base) {
     return base->hm_capacity << 1u;
 }
 
+/* Smallest capacity able to hold n pairs without exceeding
+ * the load limit, or 0 if there is no such capacity */
+static inline size_t scc_hashmap_fitcap(size_t n) {
+    size_t cap = SCC_HASHMAP_STACKCAP;
+    while (scc_hashmap_load_limit(cap) < n) {
+        if (cap > (SIZE_MAX >> 1u)) {
+            return 0u;
+        }
+        cap <<= 1u;
+    }
+    return cap;
+}
+
 static inline void *scc_hashmap_vals(struct scc_hashmap_base *base) {
     return (unsigned char *)base + base->hm_valoff;
 }
@@ -58,9 +108,58 @@ static inline scc_hashmap_metatype *scc_hashmap_metadata(struct scc_hashmap_base
     return (void *)((unsigned char *)base + base->hm_mdoff);
 }
 
-bool scc_hashmap_emplace(void *map, struct scc_hashmap_base *base, size_t keysize, size_t valsize) {
-    scc_hash_type hash = base->hm_hash(map, keysize);
-    unsigned long long index = scc_hashmap_impl_probe_insert(base, map, keysize, hash);
+static inline scc_hash_type *scc_hashmap_hashes(struct scc_hashmap_base *base) {
+    assert(base->hm_hashoff);
+    return (void *)((unsigned char *)base + base->hm_hashoff);
+}
+
+static inline scc_hash_type scc_hashmap_hash_key(struct scc_hashmap_base *base, void const *key, size_t keysize) {
+    SCC_ON_PERFTRACK(++base->hm_perf.ev_n_hash);
+    return base->hm_hash(key, keysize);
+}
+
+static inline unsigned long long scc_hashmap_probe_insert(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    scc_hash_type hash
+) {
+    if (!base->hm_eq) {
+        /* Scalar keys, compared inline */
+        return scc_hashmap_impl_probe_insert_scalar(base, map, keysize, hash);
+    }
+    return scc_hashmap_impl_probe_insert(base, map, keysize, hash);
+}
+
+static inline long long scc_hashmap_probe_find(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    scc_hash_type hash
+) {
+    if (!base->hm_eq) {
+        return scc_hashmap_impl_probe_find_scalar(base, map, keysize, hash);
+    }
+    return scc_hashmap_impl_probe_find(base, map, keysize, hash);
+}
+
+static inline void scc_hashmap_probe_find_batch(
+    struct scc_hashmap_base *base,
+    void *map,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+) {
+    if (!base->hm_eq) {
+        scc_hashmap_impl_probe_find_scalar_batch(base, map, keysize, keys, hashes, n);
+        return;
+    }
+    scc_hashmap_impl_probe_find_batch(base, map, keysize, keys, hashes, n);
+}
+
+bool scc_hashmap_emplace(void *map, struct scc_hashmap_base *base, size_t keysize, size_t valsize, scc_hash_type hash) {
+    unsigned long long index = scc_hashmap_probe_insert(base, map, keysize, hash);
     bool duplicate = index & SCC_HASHMAP_DUPLICATE;
     index &= ~SCC_HASHMAP_DUPLICATE;
 
@@ -75,26 +174,106 @@ bool scc_hashmap_emplace(void *map, struct scc_hashmap_base *base, size_t keysiz
     void const *src = (unsigned char *)map + keysize + base->hm_valpad;
     memcpy(dst, src, valsize);
 
+    if (base->hm_hashoff) {
+        scc_hashmap_hashes(base)[index] = hash;
+    }
+
     scc_hashmap_metatype ent = (scc_hashmap_metatype)(SCC_HASHMAP_OCCUPIED | (hash >> SCC_HASHMAP_HASHSHIFT));
     scc_hashmap_metatype *md = scc_hashmap_metadata(base);
+    if (md[index] == SCC_HASHMAP_VACATED) {
+        /* Tombstone reused */
+        scc_hashmap_set_tombs(base, base->hm_tombs - 1u);
+    }
     scc_hashmap_set_mdent(md, index, ent, base->hm_capacity);
     return duplicate;
 }
 
-static struct scc_hashmap_base *scc_hashmap_realloc(
+static void scc_hashmap_swap(unsigned char *restrict left, unsigned char *restrict right, size_t size) {
+    unsigned char tmp;
+    for (size_t i = 0u; i < size; ++i) {
+        tmp = left[i];
+        left[i] = right[i];
+        right[i] = tmp;
+    }
+}
+
+/* Rehash all pairs without changing the capacity, dropping all tombstones in
+ * the process. Pairs are moved within the arrays they already reside in, no
+ * allocation takes place.
+ *
+ * All pairs are first marked as pending by reusing the vacated marker, after
+ * which each pending pair is placed in the first slot of its probe sequence not
+ * holding an already placed pair. Should that slot hold another pending pair,
+ * the two are swapped and the displaced one is processed next. Placed pairs are
+ * never moved again, meaning that their probe sequences remain intact. */
+static void scc_hashmap_compact(void *map, struct scc_hashmap_base *base, size_t keysize, size_t valsize) {
+    size_t const cap = base->hm_capacity;
+    scc_hashmap_metatype *md = scc_hashmap_metadata(base);
+    unsigned char *keybase = (unsigned char *)map + base->hm_pairsize;
+    unsigned char *valbase = scc_hashmap_vals(base);
+    scc_hash_type *hashes = base->hm_hashoff ? scc_hashmap_hashes(base) : 0;
+
+    for (size_t i = 0u; i < cap; ++i) {
+        scc_hashmap_metatype const ent = (md[i] & SCC_HASHMAP_OCCUPIED) ? SCC_HASHMAP_VACATED : 0u;
+        scc_hashmap_set_mdent(md, i, ent, cap);
+    }
+
+    scc_hash_type hash;
+    scc_hashmap_metatype ent;
+    size_t slot;
+    for (size_t i = 0u; i < cap; ++i) {
+        while (md[i] == SCC_HASHMAP_VACATED) {
+            hash = hashes ? hashes[i] : scc_hashmap_hash_key(base, keybase + i * keysize, keysize);
+            ent = (scc_hashmap_metatype)(SCC_HASHMAP_OCCUPIED | (hash >> SCC_HASHMAP_HASHSHIFT));
+
+            /* Slot i is pending, so probing stops there at the latest */
+            slot = hash & (cap - 1u);
+            while (md[slot] & SCC_HASHMAP_OCCUPIED) {
+                slot = (slot + 1u) & (cap - 1u);
+            }
+
+            if (slot == i) {
+                scc_hashmap_set_mdent(md, i, ent, cap);
+                continue;
+            }
+
+            if (!md[slot]) {
+                memcpy(keybase + slot * keysize, keybase + i * keysize, keysize);
+                memcpy(valbase + slot * valsize, valbase + i * valsize, valsize);
+                if (hashes) {
+                    hashes[slot] = hashes[i];
+                }
+                scc_hashmap_set_mdent(md, i, 0u, cap);
+            }
+            else {
+                /* Displace pending pair into slot i */
+                scc_hashmap_swap(keybase + slot * keysize, keybase + i * keysize, keysize);
+                scc_hashmap_swap(valbase + slot * valsize, valbase + i * valsize, valsize);
+                if (hashes) {
+                    hashes[i] = hashes[slot];
+                    hashes[slot] = hash;
+                }
+            }
+            scc_hashmap_set_mdent(md, slot, ent, cap);
+        }
+    }
+
+    scc_hashmap_set_tombs(base, 0u);
+    SCC_ON_PERFTRACK(++base->hm_perf.ev_n_compactions);
+}
+
+/* Allocate an empty map with the given capacity, inheriting the properties of
+ * base. hdrsize is the size of the map up to and including hm_curr */
+static struct scc_hashmap_base *scc_hashmap_alloc(
     void *restrict *newmap,
-    void const *map,
     struct scc_hashmap_base const *base,
+    size_t hdrsize,
     size_t keysize,
     size_t valsize,
     size_t cap
 ) {
     assert(scc_bits_is_power_of_2(cap));
 
-    /* Size of map up to and including hm_curr */
-    size_t const hdrsize =
-        (unsigned char const *)map - (unsigned char const *)base + base->hm_pairsize;
-
     /* Offset of key array, no padding possible between hm_curr
      * and key array (although struct may contain trailing bytes) */
     size_t keyoff = scc_align(hdrsize, base->hm_keyalign);
@@ -107,12 +286,13 @@ static struct scc_hashmap_base *scc_hashmap_realloc(
      * underflow */
     assert(valoff != keyoff - cap * keysize);
 
-    valoff = scc_align(valoff, base->hm_valalign);
+    /* Start the value and metadata arrays on separate lines */
+    valoff = scc_align(valoff, scc_hashmap_lineal(base->hm_valalign));
     assert((valoff & ~(base->hm_valalign - 1u)) == valoff);
 
     /* Offset of metadata array */
     size_t mdoff = valoff + cap * valsize;
-    mdoff = scc_align(mdoff, scc_alignof(scc_hashmap_metatype));
+    mdoff = scc_align(mdoff, (size_t)SCC_PAGES_LINESZ);
     assert((mdoff & ~(scc_alignof(scc_hashmap_metatype) - 1u)) == mdoff);
 
     scc_static_assert(sizeof(scc_hashmap_metatype) == 1u);
@@ -122,9 +302,16 @@ static struct scc_hashmap_base *scc_hashmap_realloc(
     size += SCC_HASHMAP_CANARYSZ;
 #endif
 
-    /* Allocate new map, ignore clang tidy being scared by scc_hashmap_base being
-     * larger than unsigned char */
-    struct scc_hashmap_base *newbase = calloc(size, sizeof(unsigned char)); /* NOLINT */
+    /* Offset of stored hashes, if any */
+    size_t hashoff = 0u;
+    if (base->hm_hashoff) {
+        hashoff = scc_align(size, scc_alignof(scc_hash_type));
+        size = hashoff + cap * sizeof(scc_hash_type);
+    }
+
+    /* Allocate new map, large ones are mapped directly */
+    unsigned char dynalloc;
+    struct scc_hashmap_base *newbase = scc_pages_alloc(base->hm_allocator, size, true, &dynalloc);
     if (!newbase) {
         return 0;
     }
@@ -136,19 +323,37 @@ static struct scc_hashmap_base *scc_hashmap_realloc(
     newbase->hm_size = base->hm_size;
     newbase->hm_capacity = cap;
     newbase->hm_pairsize = base->hm_pairsize;
+    newbase->hm_hashoff = hashoff;
     newbase->hm_keyalign = base->hm_keyalign;
     newbase->hm_valalign = base->hm_valalign;
-    newbase->hm_dynalloc = 1;
+    newbase->hm_allocator = base->hm_allocator;
+    newbase->hm_dynalloc = dynalloc;
     newbase->hm_valpad = base->hm_valpad;
+    newbase->hm_incremental = base->hm_incremental;
     newbase->hm_fwoff = base->hm_fwoff;
     SCC_ON_PERFTRACK(newbase->hm_perf = base->hm_perf);
     SCC_ON_PERFTRACK(newbase->hm_perf.ev_bytesz = size);
+    SCC_ON_PERFTRACK(newbase->hm_perf.ev_n_tombstones = 0u);
 
     *newmap = (unsigned char *)newbase + hdrsize - base->hm_pairsize;
     scc_hashmap_set_bkoff(*newmap, base->hm_fwoff);
     return newbase;
 }
 
+static struct scc_hashmap_base *scc_hashmap_realloc(
+    void *restrict *newmap,
+    void const *map,
+    struct scc_hashmap_base const *base,
+    size_t keysize,
+    size_t valsize,
+    size_t cap
+) {
+    /* Size of map up to and including hm_curr */
+    size_t const hdrsize =
+        (unsigned char const *)map - (unsigned char const *)base + base->hm_pairsize;
+    return scc_hashmap_alloc(newmap, base, hdrsize, keysize, valsize, cap);
+}
+
 static bool scc_hashmap_rehash(
     void **map,
     struct scc_hashmap_base *base,
@@ -174,7 +379,10 @@ static bool scc_hashmap_rehash(
             memcpy(newmap, keybase + i * keysize, keysize);
             /* Copy value */
             memcpy((unsigned char *)newmap + keysize + base->hm_valpad, valbase + i * valsize, valsize);
-            (void)scc_hashmap_emplace(newmap, newbase, keysize, valsize);
+            scc_hash_type const hash = base->hm_hashoff ?
+                scc_hashmap_hashes(base)[i] :
+                scc_hashmap_hash_key(newbase, newmap, keysize);
+            (void)scc_hashmap_emplace(newmap, newbase, keysize, valsize, hash);
             --base->hm_size;
         }
     }
@@ -188,6 +396,124 @@ static bool scc_hashmap_rehash(
     return true;
 }
 
+static bool scc_hashmap_rehash_incremental(
+    void **map,
+    struct scc_hashmap_base *base,
+    size_t keysize,
+    size_t valsize,
+    size_t cap
+) {
+    assert(!base->hm_oldmap);
+    void *newmap;
+    struct scc_hashmap_base *newbase = scc_hashmap_realloc(&newmap, *map, base, keysize, valsize, cap);
+    if (!newbase) {
+        return false;
+    }
+
+    /* Pairs are moved lazily by scc_hashmap_migrate, the old
+     * map retains its size until then */
+    newbase->hm_oldmap = *map;
+    newbase->hm_migrated = 0u;
+
+    SCC_ON_PERFTRACK(++newbase->hm_perf.ev_n_rehashes);
+    SCC_ON_PERFTRACK(++newbase->hm_perf.ev_n_migrations);
+
+    memcpy(newmap, *map, base->hm_pairsize);
+    *map = newmap;
+    return true;
+}
+
+static void scc_hashmap_migrate(
+    void *map,
+    struct scc_hashmap_base *base,
+    size_t keysize,
+    size_t valsize,
+    size_t nslots
+) {
+    void *oldmap = base->hm_oldmap;
+    struct scc_hashmap_base *obase = scc_hashmap_impl_base(oldmap);
+    assert(obase->hm_capacity < base->hm_capacity);
+
+    scc_hashmap_metatype *md = scc_hashmap_metadata(obase);
+    unsigned char *keybase = (unsigned char *)oldmap + obase->hm_pairsize;
+    unsigned char *valbase = scc_hashmap_vals(obase);
+
+    /* hm_curr of the old map is unused, stash the pending
+     * pair there while hm_curr is used for emplacing */
+    memcpy(oldmap, map, base->hm_pairsize);
+
+    size_t end = obase->hm_capacity;
+    if (nslots < end - base->hm_migrated) {
+        end = base->hm_migrated + nslots;
+    }
+
+    size_t i;
+    for (i = base->hm_migrated; i < end && obase->hm_size; ++i) {
+        if (md[i] & SCC_HASHMAP_OCCUPIED) {
+            memcpy(map, keybase + i * keysize, keysize);
+            memcpy((unsigned char *)map + keysize + base->hm_valpad, valbase + i * valsize, valsize);
+            scc_hash_type const hash = obase->hm_hashoff ?
+                scc_hashmap_hashes(obase)[i] :
+                scc_hashmap_hash_key(base, map, keysize);
+            (void)scc_hashmap_emplace(map, base, keysize, valsize, hash);
+            /* Vacate rather than clear to keep probe sequences intact */
+            scc_hashmap_set_mdent(md, i, SCC_HASHMAP_VACATED, obase->hm_capacity);
+            --obase->hm_size;
+            SCC_ON_PERFTRACK(++base->hm_perf.ev_n_migrated);
+        }
+    }
+    base->hm_migrated = i;
+
+    memcpy(map, oldmap, base->hm_pairsize);
+
+    if (!obase->hm_size) {
+        scc_hashmap_free(oldmap);
+        base->hm_oldmap = 0;
+    }
+}
+
+static long long scc_hashmap_probe_old(
+    struct scc_hashmap_base *base,
+    void const *key,
+    size_t keysize,
+    scc_hash_type hash
+) {
+    void *oldmap = base->hm_oldmap;
+    if (!oldmap) {
+        return -1ll;
+    }
+
+    struct scc_hashmap_base *obase = scc_hashmap_impl_base(oldmap);
+    if (!obase->hm_size) {
+        return -1ll;
+    }
+
+    /* Probing compares against hm_curr */
+    memcpy(oldmap, key, keysize);
+    return scc_hashmap_probe_find(obase, oldmap, keysize, hash);
+}
+
+static void scc_hashmap_vacate_old(struct scc_hashmap_base *base, long long index) {
+    void *oldmap = base->hm_oldmap;
+    struct scc_hashmap_base *obase = scc_hashmap_impl_base(oldmap);
+    assert(index >= 0ll && (size_t)index < obase->hm_capacity);
+
+    scc_hashmap_set_mdent(scc_hashmap_metadata(obase), index, SCC_HASHMAP_VACATED, obase->hm_capacity);
+    --obase->hm_size;
+    --base->hm_size;
+
+    if (!obase->hm_size) {
+        scc_hashmap_free(oldmap);
+        base->hm_oldmap = 0;
+    }
+}
+
+static inline void *scc_hashmap_old_value(struct scc_hashmap_base *base, long long index, size_t valsize) {
+    struct scc_hashmap_base *obase = scc_hashmap_impl_base(base->hm_oldmap);
+    assert(index >= 0ll && (size_t)index < obase->hm_capacity);
+    return (unsigned char *)scc_hashmap_vals(obase) + index * valsize;
+}
+
 void *scc_hashmap_impl_new(struct scc_hashmap_base *base, size_t coff, size_t valoff, size_t keysize) {
     scc_static_assert(sizeof(scc_hashmap_metatype) == 1u);
     scc_canary_init((unsigned char *)base + base->hm_mdoff + base->hm_capacity + SCC_HASHMAP_GUARDSZ, SCC_HASHMAP_CANARYSZ);
@@ -196,13 +522,22 @@ void *scc_hashmap_impl_new(struct scc_hashmap_base *base, size_t coff, size_t va
     assert(valpad <= UCHAR_MAX);
     base->hm_valpad = valpad;
     base->hm_fwoff = scc_hashmap_calcpad(coff);
+#ifdef SCC_PERFEVTS
+    base->hm_perf.ev_bytesz = base->hm_mdoff + base->hm_capacity + SCC_HASHMAP_GUARDSZ;
+#ifdef SCC_CANARY_ENABLED
+    base->hm_perf.ev_bytesz += SCC_HASHMAP_CANARYSZ;
+#endif
+    if (base->hm_hashoff) {
+        base->hm_perf.ev_bytesz = base->hm_hashoff + base->hm_capacity * sizeof(scc_hash_type);
+    }
+#endif
     unsigned char *map = (unsigned char *)base + coff;
     scc_hashmap_set_bkoff(map, base->hm_fwoff);
     return map;
 }
 
 void *scc_hashmap_impl_new_dyn(struct scc_hashmap_base const *sbase, size_t mapsize, size_t coff, size_t valoff, size_t keysize) {
-    struct scc_hashmap_base *base = calloc(mapsize, sizeof(unsigned char));
+    struct scc_hashmap_base *base = scc_allocator_zalloc(sbase->hm_allocator, mapsize);
     if (!base) {
         return 0;
     }
@@ -210,29 +545,124 @@ void *scc_hashmap_impl_new_dyn(struct scc_hashmap_base const *sbase, size_t maps
     scc_memcpy(base, sbase, sizeof(*sbase));
 
     void *map = scc_hashmap_impl_new(base, coff, valoff, keysize);
-    base->hm_dynalloc = 1;
+    base->hm_dynalloc = SCC_PAGES_HEAP;
+    return map;
+}
+
+void *scc_hashmap_impl_from(
+    struct scc_hashmap_base *sbase,
+    size_t coff,
+    size_t valoff,
+    size_t keysize,
+    size_t valsize,
+    void const *keys,
+    void const *vals,
+    size_t n
+) {
+    size_t const cap = scc_hashmap_fitcap(n);
+    if (!cap) {
+        return 0;
+    }
+
+    size_t const valpad = valoff - keysize;
+    assert(valpad <= UCHAR_MAX);
+    sbase->hm_valpad = valpad;
+    sbase->hm_fwoff = scc_hashmap_calcpad(coff);
+
+    void *map;
+    struct scc_hashmap_base *base = scc_hashmap_alloc(&map, sbase, coff + sbase->hm_pairsize, keysize, valsize, cap);
+    if (!base) {
+        return 0;
+    }
+
+    scc_hashmap_metatype *md = scc_hashmap_metadata(base);
+    unsigned char *keybase = (unsigned char *)map + base->hm_pairsize;
+    unsigned char *valbase = scc_hashmap_vals(base);
+    unsigned char const *key = keys;
+    unsigned char const *val = vals;
+
+    scc_hash_type hashes[SCC_HASHMAP_BATCHSZ];
+    scc_hashmap_metatype ent;
+    size_t nbatch;
+    size_t slot;
+    for (size_t i = 0u; i < n; i += nbatch) {
+        nbatch = n - i < SCC_HASHMAP_BATCHSZ ? n - i : SCC_HASHMAP_BATCHSZ;
+
+        /* Hash the whole batch up front, allowing the
+         * metadata cache misses to overlap */
+        for (size_t j = 0u; j < nbatch; ++j) {
+            hashes[j] = scc_hashmap_hash_key(base, key + (i + j) * keysize, keysize);
+            scc_prefetch(md + (hashes[j] & (cap - 1u)));
+        }
+
+        /* Keys are distinct and the map holds nothing but empty
+         * and occupied slots, the first empty one is the target */
+        for (size_t j = 0u; j < nbatch; ++j) {
+            slot = hashes[j] & (cap - 1u);
+            while (md[slot]) {
+                slot = (slot + 1u) & (cap - 1u);
+            }
+
+            memcpy(keybase + slot * keysize, key + (i + j) * keysize, keysize);
+            memcpy(valbase + slot * valsize, val + (i + j) * valsize, valsize);
+            ent = (scc_hashmap_metatype)(SCC_HASHMAP_OCCUPIED | (hashes[j] >> SCC_HASHMAP_HASHSHIFT));
+            scc_hashmap_set_mdent(md, slot, ent, cap);
+        }
+    }
+
+    base->hm_size = n;
     return map;
 }
 
 void scc_hashmap_free(void *map) {
     struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    if (base->hm_oldmap) {
+        scc_hashmap_free(base->hm_oldmap);
+    }
     if (base->hm_dynalloc) {
-        free(base);
+        scc_pages_free(base->hm_allocator, base, scc_hashmap_bytesz(base), base->hm_dynalloc);
     }
 }
 
 bool scc_hashmap_impl_insert(void *mapaddr, size_t keysize, size_t valsize) {
     struct scc_hashmap_base *base = scc_hashmap_impl_base(*(void **)mapaddr);
+    scc_hash_type const hash = scc_hashmap_hash_key(base, *(void **)mapaddr, keysize);
+    return scc_hashmap_impl_insert_hashed(mapaddr, keysize, valsize, hash);
+}
+
+bool scc_hashmap_impl_insert_hashed(void *mapaddr, size_t keysize, size_t valsize, scc_hash_type hash) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(*(void **)mapaddr);
+    if (base->hm_oldmap) {
+        scc_hashmap_migrate(*(void **)mapaddr, base, keysize, valsize, SCC_HASHMAP_MIGRATESZ);
+    }
     if (scc_hashmap_should_rehash(base)) {
+        if (base->hm_oldmap) {
+            /* Never keep more than two tables around */
+            scc_hashmap_migrate(*(void **)mapaddr, base, keysize, valsize, SIZE_MAX);
+        }
+
         size_t const newcap = scc_hashmap_sizeup(base);
-        if (!scc_hashmap_rehash(mapaddr, base, keysize, valsize, newcap)) {
+        bool const rehashed = base->hm_incremental ?
+            scc_hashmap_rehash_incremental(mapaddr, base, keysize, valsize, newcap) :
+            scc_hashmap_rehash(mapaddr, base, keysize, valsize, newcap);
+        if (!rehashed) {
             return false;
         }
 
         /* Map has been reallocated */
         base = scc_hashmap_impl_base(*(void **)mapaddr);
     }
-    if (!scc_hashmap_emplace(*(void **)mapaddr, base, keysize, valsize)) {
+    else if (scc_hashmap_should_compact(base)) {
+        scc_hashmap_compact(*(void **)mapaddr, base, keysize, valsize);
+    }
+    if (base->hm_oldmap) {
+        long long const index = scc_hashmap_probe_old(base, *(void **)mapaddr, keysize, hash);
+        if (index != -1ll) {
+            /* Key not yet migrated, replace it by inserting in the new map */
+            scc_hashmap_vacate_old(base, index);
+        }
+    }
+    if (!scc_hashmap_emplace(*(void **)mapaddr, base, keysize, valsize, hash)) {
         ++base->hm_size;
     }
     return true;
@@ -243,12 +673,26 @@ void *scc_hashmap_impl_find(void *map, size_t keysize, size_t valsize) {
     if (!base->hm_size) {
         return 0;
     }
+    return scc_hashmap_impl_find_hashed(map, keysize, valsize, scc_hashmap_hash_key(base, map, keysize));
+}
 
-    scc_hash_type hash = base->hm_hash(map, keysize);
-    long long const index = scc_hashmap_impl_probe_find(base, map, keysize, hash);
-    if (index == -1ll) {
+void *scc_hashmap_impl_find_hashed(void *map, size_t keysize, size_t valsize, scc_hash_type hash) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    if (!base->hm_size) {
         return 0;
     }
+    if (base->hm_oldmap) {
+        scc_hashmap_migrate(map, base, keysize, valsize, SCC_HASHMAP_MIGRATESZ);
+    }
+
+    long long index = scc_hashmap_probe_find(base, map, keysize, hash);
+    if (index == -1ll) {
+        index = scc_hashmap_probe_old(base, map, keysize, hash);
+        if (index == -1ll) {
+            return 0;
+        }
+        return scc_hashmap_old_value(base, index, valsize);
+    }
     assert(base->hm_size);
     assert(index >= 0ll && (size_t)index < base->hm_capacity);
 
@@ -256,17 +700,167 @@ void *scc_hashmap_impl_find(void *map, size_t keysize, size_t valsize) {
     return (void *)(valbase + index * valsize);
 }
 
-bool scc_hashmap_impl_remove(void *map, size_t keysize) {
+void *scc_hashmap_impl_find_shared(void *map, void const *key, size_t keysize, size_t valsize) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    return scc_hashmap_impl_find_shared_hashed(map, key, keysize, valsize, base->hm_hash(key, keysize));
+}
+
+void *scc_hashmap_impl_find_shared_hashed(void *map, void const *key, size_t keysize, size_t valsize, scc_hash_type hash) {
     struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    /* Shared maps are never migrating, see scc_hashmap_impl_settle */
+    assert(!base->hm_oldmap);
     if (!base->hm_size) {
-        return false;
+        return 0;
     }
 
-    scc_hash_type const hash = base->hm_hash(map, keysize);
-    long long const index = scc_hashmap_impl_probe_find(base, map, keysize, hash);
+    long long const index = base->hm_eq ?
+        scc_hashmap_impl_probe_find_shared(base, map, key, keysize, hash) :
+        scc_hashmap_impl_probe_find_shared_scalar(base, map, key, keysize, hash);
     if (index == -1ll) {
+        return 0;
+    }
+    assert(index >= 0ll && (size_t)index < base->hm_capacity);
+
+    unsigned char *valbase = scc_hashmap_vals(base);
+    return (void *)(valbase + index * valsize);
+}
+
+void scc_hashmap_impl_settle(void *map, size_t keysize, size_t valsize) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    if (base->hm_oldmap) {
+        scc_hashmap_migrate(map, base, keysize, valsize, SIZE_MAX);
+    }
+}
+
+/* Whether the next insertion reallocates the map */
+bool scc_hashmap_impl_should_rehash(void *map) {
+    return scc_hashmap_should_rehash(scc_hashmap_impl_base(map));
+}
+
+size_t scc_hashmap_impl_find_batch(
+    void *map,
+    void const *keys,
+    size_t n,
+    void **vals,
+    size_t keysize,
+    size_t valsize
+) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    if (!base->hm_size) {
+        for (size_t i = 0u; i < n; ++i) {
+            vals[i] = 0;
+        }
+        return 0u;
+    }
+    if (base->hm_oldmap) {
+        scc_hashmap_migrate(map, base, keysize, valsize, SCC_HASHMAP_MIGRATESZ);
+    }
+
+    unsigned long long slots[SCC_HASHMAP_BATCHSZ];
+    scc_hash_type hashes[SCC_HASHMAP_BATCHSZ];
+    unsigned char const *key = keys;
+    unsigned char *valbase = scc_hashmap_vals(base);
+
+    size_t nfound = 0u;
+    size_t nbatch;
+    for (size_t off = 0u; off < n; off += nbatch) {
+        nbatch = n - off < SCC_HASHMAP_BATCHSZ ? n - off : SCC_HASHMAP_BATCHSZ;
+
+        /* Hash entire batch up front, keeping the hashes around
+         * for keys that have yet to be migrated */
+        for (size_t i = 0u; i < nbatch; ++i) {
+            hashes[i] = scc_hashmap_hash_key(base, key + i * keysize, keysize);
+            slots[i] = hashes[i];
+        }
+
+        /* Hashes are replaced by slot indices */
+        scc_hashmap_probe_find_batch(base, map, keysize, key, slots, nbatch);
+
+        for (size_t i = 0u; i < nbatch; ++i) {
+            long long const index = (long long)slots[i];
+            if (index == -1ll) {
+                vals[off + i] = 0;
+                if (base->hm_oldmap) {
+                    long long const oindex = scc_hashmap_probe_old(base, key + i * keysize, keysize, hashes[i]);
+                    if (oindex != -1ll) {
+                        vals[off + i] = scc_hashmap_old_value(base, oindex, valsize);
+                        ++nfound;
+                    }
+                }
+                continue;
+            }
+
+            assert(index >= 0ll && (size_t)index < base->hm_capacity);
+            vals[off + i] = valbase + index * valsize;
+            ++nfound;
+        }
+
+        key += nbatch * keysize;
+    }
+
+    return nfound;
+}
+
+bool scc_hashmap_impl_reserve(void *mapaddr, size_t capacity, size_t keysize, size_t valsize) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(*(void **)mapaddr);
+    if (base->hm_oldmap) {
+        scc_hashmap_migrate(*(void **)mapaddr, base, keysize, valsize, SIZE_MAX);
+    }
+
+    size_t const cap = scc_hashmap_fitcap(capacity);
+    if (!cap) {
         return false;
     }
+    if (cap <= base->hm_capacity) {
+        return true;
+    }
+    return scc_hashmap_rehash(mapaddr, base, keysize, valsize, cap);
+}
+
+bool scc_hashmap_impl_shrink_to_fit(void *mapaddr, size_t keysize, size_t valsize) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(*(void **)mapaddr);
+    if (base->hm_oldmap) {
+        scc_hashmap_migrate(*(void **)mapaddr, base, keysize, valsize, SIZE_MAX);
+    }
+
+    size_t const cap = scc_hashmap_fitcap(base->hm_size);
+    assert(cap);
+    if (cap >= base->hm_capacity) {
+        /* Already minimal, still drop any tombstones */
+        if (base->hm_tombs) {
+            scc_hashmap_compact(*(void **)mapaddr, base, keysize, valsize);
+        }
+        return true;
+    }
+    return scc_hashmap_rehash(mapaddr, base, keysize, valsize, cap);
+}
+
+bool scc_hashmap_impl_remove(void *map, size_t keysize, size_t valsize) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    if (!base->hm_size) {
+        return false;
+    }
+    return scc_hashmap_impl_remove_hashed(map, keysize, valsize, scc_hashmap_hash_key(base, map, keysize));
+}
+
+bool scc_hashmap_impl_remove_hashed(void *map, size_t keysize, size_t valsize, scc_hash_type hash) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    if (!base->hm_size) {
+        return false;
+    }
+    if (base->hm_oldmap) {
+        scc_hashmap_migrate(map, base, keysize, valsize, SCC_HASHMAP_MIGRATESZ);
+    }
+
+    long long const index = scc_hashmap_probe_find(base, map, keysize, hash);
+    if (index == -1ll) {
+        long long const oindex = scc_hashmap_probe_old(base, map, keysize, hash);
+        if (oindex == -1ll) {
+            return false;
+        }
+        scc_hashmap_vacate_old(base, oindex);
+        return true;
+    }
 
     assert(base->hm_size);
     assert(index >= 0ll && (size_t)index < base->hm_capacity);
@@ -274,30 +868,72 @@ bool scc_hashmap_impl_remove(void *map, size_t keysize) {
     scc_hashmap_metatype *md = scc_hashmap_metadata(base);
     scc_hashmap_set_mdent(md, index, SCC_HASHMAP_VACATED, base->hm_capacity);
     --base->hm_size;
+    scc_hashmap_set_tombs(base, base->hm_tombs + 1u);
+    if (scc_hashmap_should_compact(base)) {
+        scc_hashmap_compact(map, base, keysize, valsize);
+    }
     return true;
 }
 
 void scc_hashmap_clear(void *map) {
     struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    if (base->hm_oldmap) {
+        scc_hashmap_free(base->hm_oldmap);
+        base->hm_oldmap = 0;
+    }
     scc_hashmap_metatype *md = scc_hashmap_metadata(base);
     scc_static_assert(sizeof(*md) == 1u);
     memset(md, 0, (base->hm_capacity + SCC_HASHMAP_GUARDSZ));
     base->hm_size = 0u;
+    scc_hashmap_set_tombs(base, 0u);
 }
 
 void *scc_hashmap_clone(void const *map) {
     struct scc_hashmap_base const *obase = scc_hashmap_impl_base_qual(map, const);
-    scc_static_assert(sizeof(scc_hashmap_metatype) == 1);
-    size_t sz = obase->hm_mdoff + obase->hm_capacity + SCC_HASHMAP_GUARDSZ;
-    scc_when_mutating(assert(sz > obase->hm_mdoff + obase->hm_capacity));
-#ifdef SCC_CANARY_ENABLED
-    sz += SCC_HASHMAP_CANARYSZ;
-#endif
-    struct scc_hashmap_base *nbase = malloc(sz);
+    size_t const sz = scc_hashmap_bytesz(obase);
+    unsigned char dynalloc;
+    struct scc_hashmap_base *nbase = scc_pages_alloc(obase->hm_allocator, sz, false, &dynalloc);
     if (!nbase) {
         return 0;
     }
     scc_memcpy(nbase, obase, sz);
-    nbase->hm_dynalloc = 1;
+    nbase->hm_dynalloc = dynalloc;
+    if (obase->hm_oldmap) {
+        nbase->hm_oldmap = scc_hashmap_clone(obase->hm_oldmap);
+        if (!nbase->hm_oldmap) {
+            scc_pages_free(nbase->hm_allocator, nbase, sz, dynalloc);
+            return 0;
+        }
+    }
     return (unsigned char *)nbase + offsetof(struct scc_hashmap_base, hm_fwoff) + nbase->hm_fwoff + sizeof(nbase->hm_fwoff);
 }
+
+void const *scc_hashmap_impl_iter_begin(void *map, size_t keysize, size_t valsize) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    if (base->hm_oldmap) {
+        /* Iteration requires all pairs to be in the same map */
+        scc_hashmap_migrate(map, base, keysize, valsize, SIZE_MAX);
+    }
+    if (!base->hm_size) {
+        return 0;
+    }
+
+    long long slot = scc_hashmap_impl_next_occupied(base, 0u);
+    if (slot == -1ll) {
+        return 0;
+    }
+    return (unsigned char const *)map + base->hm_pairsize + (size_t)slot * keysize;
+}
+
+void const *scc_hashmap_impl_iter_next(void *map, size_t keysize, void const *key) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    unsigned char const *keybase = (unsigned char const *)map + base->hm_pairsize;
+
+    ptrdiff_t pslot = ((unsigned char const *)key - keybase) / (ptrdiff_t)keysize;
+    assert(pslot >= 0);
+    long long slot = scc_hashmap_impl_next_occupied(base, (size_t)pslot + 1u);
+    if (slot == -1ll) {
+        return 0;
+    }
+    return keybase + (size_t)slot * keysize;
+}
@@ -1,20 +1,76 @@
 #include <scc/arch.h>
 #include <scc/bug.h>
 #include <scc/hashmap.h>
+#include <scc/mem.h>
 #include <scc/swar.h>
 
 #include <assert.h>
 #include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 static inline scc_vectype scc_hashmap_gen_metamask(unsigned long long hash) {
     return scc_swar_bcast(0x80u | (hash >> (sizeof(scc_vectype) * CHAR_BIT - (CHAR_BIT - 1u))));
 }
 
-long long scc_hashmap_impl_probe_find_swar(
-    struct scc_hashmap_base const *base,
+/* Inline comparison of integer and pointer keys, used for maps
+ * created using scc_hashmap_new_scalar. The constant sizes allow
+ * the compiler to replace each memcmp with a single compare */
+static inline bool scc_hashmap_scalar_eq(void const *left, void const *right, size_t keysize) {
+    switch (keysize) {
+        case sizeof(uint8_t):
+            return !memcmp(left, right, sizeof(uint8_t));
+        case sizeof(uint16_t):
+            return !memcmp(left, right, sizeof(uint16_t));
+        case sizeof(uint32_t):
+            return !memcmp(left, right, sizeof(uint32_t));
+        default:
+            break;
+    }
+    assert(keysize == sizeof(uint64_t));
+    return !memcmp(left, right, sizeof(uint64_t));
+}
+
+static inline bool scc_hashmap_slot_eq(
+    struct scc_hashmap_base *base,
     void const *handle,
+    void const *key,
     size_t keysize,
-    unsigned long long hash
+    size_t slot,
+    unsigned long long hash,
+    bool scalar,
+    bool shared
+) {
+    if (base->hm_hashoff) {
+        /* Full hashes differ, no need to compare keys */
+        scc_hash_type const *hashes = (void const *)((unsigned char const *)base + base->hm_hashoff);
+        if (hashes[slot] != (scc_hash_type)hash) {
+            return false;
+        }
+    }
+
+    /* Key array */
+    unsigned char const *keys = (unsigned char const *)handle + base->hm_pairsize;
+    if (scalar) {
+        return scc_hashmap_scalar_eq(keys + slot * keysize, key, keysize);
+    }
+
+    /* Shared maps are probed concurrently, leave them untouched */
+    if (!shared) {
+        SCC_ON_PERFTRACK(++base->hm_perf.ev_n_eqs);
+    }
+    return base->hm_eq(keys + slot * keysize, key);
+}
+
+static inline long long scc_hashmap_probe_find_swar(
+    struct scc_hashmap_base *base,
+    void const *handle,
+    void const *key,
+    size_t keysize,
+    unsigned long long hash,
+    bool scalar,
+    bool shared
 ) {
     scc_static_assert(sizeof(scc_vectype) < SCC_HASHMAP_STACKCAP);
 
@@ -22,8 +78,6 @@ long long scc_hashmap_impl_probe_find_swar(
     scc_vectype metamask = scc_hashmap_gen_metamask(hash);
     /* Metadata array */
     unsigned char const *meta = (unsigned char const *)base + base->hm_mdoff;
-    /* Value array */
-    unsigned char const *keys = (unsigned char const *)handle + base->hm_pairsize;
 
     /* Start slot */
     size_t sslot = hash & (base->hm_capacity - 1u);
@@ -47,7 +101,7 @@ long long scc_hashmap_impl_probe_find_swar(
         if (!scc_swar_read_byte(probe_end, i)) {
             return -1ll;
         }
-        if (!scc_swar_read_byte(occ_match, i) && base->hm_eq(keys + (start + i) * keysize, handle)) {
+        if (!scc_swar_read_byte(occ_match, i) && scc_hashmap_slot_eq(base, handle, key, keysize, start + i, hash, scalar, shared)) {
             return (long long)(start + i);
         }
     }
@@ -66,7 +120,7 @@ long long scc_hashmap_impl_probe_find_swar(
             if (!scc_swar_read_byte(probe_end, i)) {
                 return -1ll;
             }
-            if (!scc_swar_read_byte(occ_match, i) && base->hm_eq(keys + (slot + i) * keysize, handle)) {
+            if (!scc_swar_read_byte(occ_match, i) && scc_hashmap_slot_eq(base, handle, key, keysize, slot + i, hash, scalar, shared)) {
                 return (long long)(slot + i);
             }
         }
@@ -84,7 +138,7 @@ long long scc_hashmap_impl_probe_find_swar(
             if (!scc_swar_read_byte(probe_end, i)) {
                 return -1ll;
             }
-            if (!scc_swar_read_byte(occ_match, i) && base->hm_eq(keys + (slot + i) * keysize, handle)) {
+            if (!scc_swar_read_byte(occ_match, i) && scc_hashmap_slot_eq(base, handle, key, keysize, slot + i, hash, scalar, shared)) {
                 return (long long)(slot + i);
             }
         }
@@ -93,19 +147,105 @@ long long scc_hashmap_impl_probe_find_swar(
     return -1ll;
 }
 
-unsigned long long scc_hashmap_impl_probe_insert_swar(
-    struct scc_hashmap_base const *base,
+long long scc_hashmap_impl_probe_find_swar(
+    struct scc_hashmap_base *base,
+    void const *handle,
+    size_t keysize,
+    unsigned long long hash
+) {
+    return scc_hashmap_probe_find_swar(base, handle, handle, keysize, hash, false, false);
+}
+
+long long scc_hashmap_impl_probe_find_scalar_swar(
+    struct scc_hashmap_base *base,
     void const *handle,
     size_t keysize,
     unsigned long long hash
+) {
+    return scc_hashmap_probe_find_swar(base, handle, handle, keysize, hash, true, false);
+}
+
+long long scc_hashmap_impl_probe_find_shared_swar(
+    struct scc_hashmap_base *base,
+    void const *handle,
+    void const *key,
+    size_t keysize,
+    unsigned long long hash
+) {
+    /* Neither hm_curr nor the metadata is written to, making the
+     * probe safe for any number of concurrent readers */
+    return scc_hashmap_probe_find_swar(base, handle, key, keysize, hash, false, true);
+}
+
+long long scc_hashmap_impl_probe_find_shared_scalar_swar(
+    struct scc_hashmap_base *base,
+    void const *handle,
+    void const *key,
+    size_t keysize,
+    unsigned long long hash
+) {
+    return scc_hashmap_probe_find_swar(base, handle, key, keysize, hash, true, true);
+}
+
+static inline void scc_hashmap_probe_find_batch_swar(
+    struct scc_hashmap_base *base,
+    void *handle,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n,
+    bool scalar
+) {
+    /* Metadata array */
+    unsigned char const *meta = (unsigned char const *)base + base->hm_mdoff;
+
+    /* Issue loads for all start slots before probing any of them */
+    for (size_t i = 0u; i < n; ++i) {
+        scc_prefetch(meta + (hashes[i] & (base->hm_capacity - 1u)));
+    }
+
+    unsigned char const *key = keys;
+    for (size_t i = 0u; i < n; ++i, key += keysize) {
+        /* Probe compares against hm_curr */
+        memcpy(handle, key, keysize);
+        hashes[i] = (unsigned long long)scc_hashmap_probe_find_swar(base, handle, handle, keysize, hashes[i], scalar, false);
+    }
+}
+
+void scc_hashmap_impl_probe_find_batch_swar(
+    struct scc_hashmap_base *base,
+    void *handle,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+) {
+    scc_hashmap_probe_find_batch_swar(base, handle, keysize, keys, hashes, n, false);
+}
+
+void scc_hashmap_impl_probe_find_scalar_batch_swar(
+    struct scc_hashmap_base *base,
+    void *handle,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+) {
+    scc_hashmap_probe_find_batch_swar(base, handle, keysize, keys, hashes, n, true);
+}
+
+static inline unsigned long long scc_hashmap_probe_insert_swar(
+    struct scc_hashmap_base *base,
+    void const *handle,
+    size_t keysize,
+    unsigned long long hash,
+    bool scalar
 ) {
     /* 7 high bits of hash, packed */
     scc_vectype metamask = scc_hashmap_gen_metamask(hash);
     scc_vectype ones = ~(scc_vectype)0u;
     /* Metadata array */
     unsigned char const *meta = (unsigned char const *)base + base->hm_mdoff;
-    /* Value array */
-    unsigned char const *keys = (unsigned char const *)handle + base->hm_pairsize;
 
     /* Start slot */
     size_t sslot = hash & (base->hm_capacity - 1u);
@@ -129,13 +269,11 @@ unsigned long long scc_hashmap_impl_probe_insert_swar(
     unsigned long long empty_slot = ~0ull;
     unsigned i;
     for (i = slot_adj; i < sizeof(curr); ++i) {
-        if (empty_slot == ~0ull) {
-            if (!scc_swar_read_byte(occ_match, i) && base->hm_eq(keys + (i + start) * keysize, handle)) {
-                empty_slot = (i + start) | SCC_HASHMAP_DUPLICATE;
-            }
-            else if (scc_swar_read_byte(vacant, i) & 0x80u) {
-                empty_slot = i + start;
-            }
+        if (!scc_swar_read_byte(occ_match, i) && scc_hashmap_slot_eq(base, handle, handle, keysize, i + start, hash, scalar, false)) {
+            return (i + start) | SCC_HASHMAP_DUPLICATE;
+        }
+        if (empty_slot == ~0ull && scc_swar_read_byte(vacant, i) & 0x80u) {
+            empty_slot = i + start;
         }
         if (!scc_swar_read_byte(probe_end, i)) {
             /* Found end, done probing */
@@ -154,13 +292,11 @@ unsigned long long scc_hashmap_impl_probe_insert_swar(
         probe_end = curr ^ 0u;
 
         for (i = 0u; i < sizeof(curr); ++i) {
-            if (empty_slot == ~0ull) {
-                if (!scc_swar_read_byte(occ_match, i) && base->hm_eq(keys + (slot + i) * keysize, handle)) {
-                    return (slot + i) | SCC_HASHMAP_DUPLICATE;
-                }
-                else if (scc_swar_read_byte(vacant, i) & 0x80u) {
-                    empty_slot = slot + i;
-                }
+            if (!scc_swar_read_byte(occ_match, i) && scc_hashmap_slot_eq(base, handle, handle, keysize, slot + i, hash, scalar, false)) {
+                return (slot + i) | SCC_HASHMAP_DUPLICATE;
+            }
+            if (empty_slot == ~0ull && scc_swar_read_byte(vacant, i) & 0x80u) {
+                empty_slot = slot + i;
             }
             if (!scc_swar_read_byte(probe_end, i)) {
                 /* Found end, done probing */
@@ -180,13 +316,11 @@ unsigned long long scc_hashmap_impl_probe_insert_swar(
         probe_end = curr ^ 0u;
         for (i = 0u; i < slot_adj; ++i) {
             scc_when_mutating(assert(i < slot_adj));
-            if (empty_slot == ~0ull) {
-                if (!scc_swar_read_byte(occ_match, i) && base->hm_eq(keys + (slot + i) * keysize, handle)) {
-                    return (slot + i) | SCC_HASHMAP_DUPLICATE;
-                }
-                else if (scc_swar_read_byte(vacant, i) & 0x80u) {
-                    empty_slot = (long long)(slot + i);
-                }
+            if (!scc_swar_read_byte(occ_match, i) && scc_hashmap_slot_eq(base, handle, handle, keysize, slot + i, hash, scalar, false)) {
+                return (slot + i) | SCC_HASHMAP_DUPLICATE;
+            }
+            if (empty_slot == ~0ull && scc_swar_read_byte(vacant, i) & 0x80u) {
+                empty_slot = slot + i;
             }
             if (!scc_swar_read_byte(probe_end, i)) {
                 /* Found end, done probing */
@@ -198,3 +332,62 @@ unsigned long long scc_hashmap_impl_probe_insert_swar(
     assert(empty_slot != ~0ull);
     return empty_slot;
 }
+
+unsigned long long scc_hashmap_impl_probe_insert_swar(
+    struct scc_hashmap_base *base,
+    void const *handle,
+    size_t keysize,
+    unsigned long long hash
+) {
+    return scc_hashmap_probe_insert_swar(base, handle, keysize, hash, false);
+}
+
+unsigned long long scc_hashmap_impl_probe_insert_scalar_swar(
+    struct scc_hashmap_base *base,
+    void const *handle,
+    size_t keysize,
+    unsigned long long hash
+) {
+    return scc_hashmap_probe_insert_swar(base, handle, keysize, hash, true);
+}
+
+long long scc_hashmap_impl_next_occupied_swar(
+    struct scc_hashmap_base const *base,
+    size_t start
+) {
+    if (start >= base->hm_capacity) {
+        return -1ll;
+    }
+
+    /* Occupied bit in each byte */
+    scc_vectype const occmask = scc_swar_bcast(0x80u);
+    /* Metadata array */
+    unsigned char const *meta = (unsigned char const *)base + base->hm_mdoff;
+
+    scc_vectype const *ldaddr = scc_swar_align_load(meta + start);
+    /* Bytes preceding start in the first vector */
+    unsigned const skip = (unsigned)((meta + start) - (unsigned char const *)ldaddr);
+    assert(skip < sizeof(scc_vectype));
+
+    /* May wrap if the metadata is unaligned, slot + i never
+     * does for any i >= skip */
+    size_t slot = start - skip;
+    scc_vectype occ = *ldaddr & occmask & (~(scc_vectype)0u << skip * CHAR_BIT);
+
+    /* Skip a full vector of unoccupied slots at a time. The
+     * guard keeps the loads in bounds */
+    while (!occ) {
+        slot += sizeof(occ);
+        if (slot >= base->hm_capacity) {
+            return -1ll;
+        }
+        occ = *++ldaddr & occmask;
+    }
+
+    unsigned i;
+    for (i = 0u; !scc_swar_read_byte(occ, i); ++i);
+    slot += i;
+
+    /* Guard mirrors the start of the metadata array */
+    return slot < base->hm_capacity ? (long long)slot : -1ll;
+}
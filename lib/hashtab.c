@@ -2,21 +2,25 @@
 #include <scc/bug.h>
 #include <scc/hashtab.h>
 #include <scc/mem.h>
+#include <scc/pages.h>
 #include <scc/perf.h>
 
 #include <assert.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 enum { SCC_HASHTAB_OCCUPIED = 0x80 };
 enum { SCC_HASHTAB_VACATED = 0x7f };
 enum { SCC_HASHTAB_HASHSHIFT = 57 };
+enum { SCC_HASHTAB_BATCHSZ = 16 };
 
 size_t scc_hashtab_capacity(void const *tab);
 size_t scc_hashtab_size(void const *tab);
 size_t scc_hashtab_impl_bkpad(void const *tab);
+void scc_hashtab_set_incremental(void *tab, bool enable);
 
 static inline void scc_hashtab_set_mdent(scc_hashtab_metatype *md, size_t index, scc_hashtab_metatype val, size_t capacity) {
     md[index] = val;
@@ -37,17 +41,45 @@ static inline void scc_hashtab_set_bkoff(void *tab, unsigned char bkoff) {
     ((unsigned char *)tab)[-1] = bkoff;
 }
 
+/* Size of the allocation backing a dynamically allocated table */
+static inline size_t scc_hashtab_bytesz(struct scc_hashtab_base const *base) {
+    scc_static_assert(sizeof(scc_hashtab_metatype) == 1);
+    size_t sz = base->ht_mdoff + base->ht_capacity + SCC_HASHTAB_GUARDSZ;
+    scc_when_mutating(assert(sz > base->ht_mdoff + base->ht_capacity));
+#ifdef SCC_CANARY_ENABLED
+    sz += SCC_HASHTAB_CANARYSZ;
+#endif
+    return sz;
+}
+
+static inline size_t scc_hashtab_load_limit(size_t capacity) {
+    /* 87.5% */
+    return (capacity >> 1u) +
+           (capacity >> 2u) +
+           (capacity >> 3u);
+}
+
 static inline bool scc_hashtab_should_rehash(struct scc_hashtab_base const *base) {
-    /* Rehash at 87.5% */
-    return base->ht_size > (base->ht_capacity >> 1u) +
-                           (base->ht_capacity >> 2u) +
-                           (base->ht_capacity >> 3u);
+    return base->ht_size > scc_hashtab_load_limit(base->ht_capacity);
 }
 
 static inline size_t scc_hashtab_sizeup(struct scc_hashtab_base const *base) {
     return base->ht_capacity << 1u;
 }
 
+/* Smallest capacity able to hold n elements without exceeding
+ * the load limit, or 0 if there is no such capacity */
+static inline size_t scc_hashtab_fitcap(size_t n) {
+    size_t cap = SCC_HASHTAB_STACKCAP;
+    while (scc_hashtab_load_limit(cap) < n) {
+        if (cap > (SIZE_MAX >> 1u)) {
+            return 0u;
+        }
+        cap <<= 1u;
+    }
+    return cap;
+}
+
 static inline scc_hashtab_metatype *scc_hashtab_metadata(struct scc_hashtab_base *base) {
     return (void *)((unsigned char *)base + base->ht_mdoff);
 }
@@ -73,28 +105,26 @@ static bool scc_hashtab_emplace(void *tab, struct scc_hashtab_base *base, size_t
     return true;
 }
 
-static struct scc_hashtab_base *scc_hashtab_realloc(
+/* Allocate an empty table with the given capacity, inheriting the properties of
+ * base. hdrsize is the size of the table up to and including ht_curr */
+static struct scc_hashtab_base *scc_hashtab_alloc(
     void *restrict *newtab,
-    void const *tab,
     struct scc_hashtab_base const *base,
+    size_t hdrsize,
     size_t elemsize,
     size_t cap
 ) {
     assert(scc_bits_is_power_of_2(cap));
 
-    /* Size of table up to and including ht_curr */
-    size_t const hdrsize =
-        (unsigned char const *)tab - (unsigned char const *)base + elemsize;
-
     /* Size of ht_data for new table */
     size_t const datasize = cap * elemsize;
-    size_t const align = scc_alignof(scc_hashtab_metatype);
+    size_t const align = SCC_PAGES_LINESZ;
 
     /* Initial metadata offset, no padding allowed between
      * ht_curr and ht_data */
     size_t mdoff = hdrsize + datasize;
 
-    /* Align metadata */
+    /* Start metadata on a line of its own */
     mdoff = (mdoff + align - 1) & ~(align - 1);
     assert((mdoff & ~(align - 1)) == mdoff);
 
@@ -106,10 +136,9 @@ static struct scc_hashtab_base *scc_hashtab_realloc(
     size += SCC_HASHTAB_CANARYSZ;
 #endif
 
-    /* Allocate new hash table
-     * Ignore clang tidy complaining about struct scc_hashtab_base being
-     * larger than unsigned char */
-    struct scc_hashtab_base *newbase = calloc(size, sizeof(unsigned char)); /* NOLINT */
+    /* Allocate new hash table, large ones are mapped directly */
+    unsigned char dynalloc;
+    struct scc_hashtab_base *newbase = scc_pages_alloc(base->ht_allocator, size, true, &dynalloc);
     if (!newbase) {
         return 0;
     }
@@ -119,7 +148,9 @@ static struct scc_hashtab_base *scc_hashtab_realloc(
     newbase->ht_mdoff = mdoff;
     newbase->ht_size = base->ht_size;
     newbase->ht_capacity = cap;
-    newbase->ht_dynalloc = 1;
+    newbase->ht_allocator = base->ht_allocator;
+    newbase->ht_dynalloc = dynalloc;
+    newbase->ht_incremental = base->ht_incremental;
     newbase->ht_fwoff = base->ht_fwoff;
 
     SCC_ON_PERFTRACK(newbase->ht_perf = base->ht_perf);
@@ -130,6 +161,19 @@ static struct scc_hashtab_base *scc_hashtab_realloc(
     return newbase;
 }
 
+static struct scc_hashtab_base *scc_hashtab_realloc(
+    void *restrict *newtab,
+    void const *tab,
+    struct scc_hashtab_base const *base,
+    size_t elemsize,
+    size_t cap
+) {
+    /* Size of table up to and including ht_curr */
+    size_t const hdrsize =
+        (unsigned char const *)tab - (unsigned char const *)base + elemsize;
+    return scc_hashtab_alloc(newtab, base, hdrsize, elemsize, cap);
+}
+
 static bool scc_hashtab_rehash(void **tab, struct scc_hashtab_base *base, size_t elemsize, size_t cap) {
     void *newtab;
     struct scc_hashtab_base *newbase = scc_hashtab_realloc(&newtab, *tab, base, elemsize, cap);
@@ -157,6 +201,95 @@ static bool scc_hashtab_rehash(void **tab, struct scc_hashtab_base *base, size_t
     return true;
 }
 
+static bool scc_hashtab_rehash_incremental(void **tab, struct scc_hashtab_base *base, size_t elemsize, size_t cap) {
+    assert(!base->ht_oldtab);
+    void *newtab;
+    struct scc_hashtab_base *newbase = scc_hashtab_realloc(&newtab, *tab, base, elemsize, cap);
+    if (!newbase) {
+        return false;
+    }
+
+    /* Elements are moved lazily by scc_hashtab_migrate, the old
+     * table retains its size until then */
+    newbase->ht_oldtab = *tab;
+    newbase->ht_migrated = 0u;
+
+    SCC_ON_PERFTRACK(++newbase->ht_perf.ev_n_rehashes);
+    SCC_ON_PERFTRACK(++newbase->ht_perf.ev_n_migrations);
+
+    memcpy(newtab, *tab, elemsize);
+    *tab = newtab;
+    return true;
+}
+
+static void scc_hashtab_migrate(void *tab, struct scc_hashtab_base *base, size_t elemsize, size_t nslots) {
+    void *oldtab = base->ht_oldtab;
+    struct scc_hashtab_base *obase = scc_hashtab_impl_base(oldtab);
+    assert(obase->ht_capacity < base->ht_capacity);
+
+    scc_hashtab_metatype *md = scc_hashtab_metadata(obase);
+
+    /* ht_curr of the old table is unused, stash the pending
+     * element there while ht_curr is used for emplacing */
+    memcpy(oldtab, tab, elemsize);
+
+    size_t end = obase->ht_capacity;
+    if (nslots < end - base->ht_migrated) {
+        end = base->ht_migrated + nslots;
+    }
+
+    size_t i;
+    for (i = base->ht_migrated; i < end && obase->ht_size; ++i) {
+        if (md[i] & SCC_HASHTAB_OCCUPIED) {
+            memcpy(tab, (unsigned char *)oldtab + (i + 1u) * elemsize, elemsize);
+            scc_bug_on(!scc_hashtab_emplace(tab, base, elemsize));
+            /* Vacate rather than clear to keep probe sequences intact */
+            scc_hashtab_set_mdent(md, i, SCC_HASHTAB_VACATED, obase->ht_capacity);
+            --obase->ht_size;
+            SCC_ON_PERFTRACK(++base->ht_perf.ev_n_migrated);
+        }
+    }
+    base->ht_migrated = i;
+
+    memcpy(tab, oldtab, elemsize);
+
+    if (!obase->ht_size) {
+        scc_hashtab_free(oldtab);
+        base->ht_oldtab = 0;
+    }
+}
+
+static long long scc_hashtab_probe_old(struct scc_hashtab_base const *base, void const *tab, size_t elemsize, scc_hash_type hash) {
+    void *oldtab = base->ht_oldtab;
+    if (!oldtab) {
+        return -1ll;
+    }
+
+    struct scc_hashtab_base *obase = scc_hashtab_impl_base(oldtab);
+    if (!obase->ht_size) {
+        return -1ll;
+    }
+
+    /* Probing compares against ht_curr */
+    memcpy(oldtab, tab, elemsize);
+    return scc_hashtab_impl_probe_find(obase, oldtab, elemsize, hash);
+}
+
+static void scc_hashtab_vacate_old(struct scc_hashtab_base *base, long long index) {
+    void *oldtab = base->ht_oldtab;
+    struct scc_hashtab_base *obase = scc_hashtab_impl_base(oldtab);
+    assert(index >= 0ll && (size_t)index < obase->ht_capacity);
+
+    scc_hashtab_set_mdent(scc_hashtab_metadata(obase), index, SCC_HASHTAB_VACATED, obase->ht_capacity);
+    --obase->ht_size;
+    --base->ht_size;
+
+    if (!obase->ht_size) {
+        scc_hashtab_free(oldtab);
+        base->ht_oldtab = 0;
+    }
+}
+
 static inline void const *scc_hashtab_impl_iter_next_occupied(
     struct scc_hashtab_base *base,
     void *tab,
@@ -175,15 +308,33 @@ static inline void const *scc_hashtab_impl_iter_next_occupied(
 
 bool scc_hashtab_impl_insert(void *tabaddr, size_t elemsize) {
     struct scc_hashtab_base *base = scc_hashtab_impl_base(*(void **)tabaddr);
+    if (base->ht_oldtab) {
+        scc_hashtab_migrate(*(void **)tabaddr, base, elemsize, SCC_HASHTAB_MIGRATESZ);
+    }
     if (scc_hashtab_should_rehash(base)) {
+        if (base->ht_oldtab) {
+            /* Never keep more than two tables around */
+            scc_hashtab_migrate(*(void **)tabaddr, base, elemsize, SIZE_MAX);
+        }
+
         size_t const newcap = scc_hashtab_sizeup(base);
-        if (!scc_hashtab_rehash(tabaddr, base, elemsize, newcap)) {
+        bool const rehashed = base->ht_incremental ?
+            scc_hashtab_rehash_incremental(tabaddr, base, elemsize, newcap) :
+            scc_hashtab_rehash(tabaddr, base, elemsize, newcap);
+        if (!rehashed) {
             return false;
         }
 
         /* Table has been reallocated */
         base = scc_hashtab_impl_base(*(void **)tabaddr);
     }
+    if (base->ht_oldtab) {
+        scc_hash_type const hash = base->ht_hash(*(void **)tabaddr, elemsize);
+        SCC_ON_PERFTRACK(++base->ht_perf.ev_n_hash);
+        if (scc_hashtab_probe_old(base, *(void **)tabaddr, elemsize, hash) != -1ll) {
+            return false;
+        }
+    }
     if (!scc_hashtab_emplace(*(void **)tabaddr, base, elemsize)) {
         return false;
     }
@@ -201,7 +352,11 @@ void const *scc_hashtab_impl_find(void const *tab, size_t elemsize) {
     scc_hash_type const hash = base->ht_hash(tab, elemsize);
     long long const index = scc_hashtab_impl_probe_find(base, tab, elemsize, hash);
     if (index == -1ll) {
-        return 0;
+        long long const oindex = scc_hashtab_probe_old(base, tab, elemsize, hash);
+        if (oindex == -1ll) {
+            return 0;
+        }
+        return (void const *)((unsigned char const *)base->ht_oldtab + (oindex + 1ull) * elemsize);
     }
     assert(base->ht_size);
     assert(index >= 0ll && (size_t)index < base->ht_capacity);
@@ -224,8 +379,16 @@ void *scc_hashtab_impl_new(struct scc_hashtab_base *base, size_t coff, size_t md
     return tab;
 }
 
-void *scc_hashtab_impl_new_dyn(scc_hashtab_eq eq, scc_hashtab_hash hash, size_t cap, size_t tabsz, size_t coff, size_t mdoff) {
-    struct scc_hashtab_base *base = calloc(tabsz, sizeof(unsigned char));
+void *scc_hashtab_impl_new_dyn(
+    scc_hashtab_eq eq,
+    scc_hashtab_hash hash,
+    size_t cap,
+    size_t tabsz,
+    size_t coff,
+    size_t mdoff,
+    struct scc_allocator const *allocator
+) {
+    struct scc_hashtab_base *base = scc_allocator_zalloc(allocator, tabsz);
     if (!base) {
         return 0;
     }
@@ -233,20 +396,90 @@ void *scc_hashtab_impl_new_dyn(scc_hashtab_eq eq, scc_hashtab_hash hash, size_t
     base->ht_eq = eq;
     base->ht_hash = hash;
     base->ht_capacity = cap;
+    base->ht_allocator = allocator;
     void *tab = scc_hashtab_impl_new(base, coff, mdoff);
-    base->ht_dynalloc = 1;
+    base->ht_dynalloc = SCC_PAGES_HEAP;
+    return tab;
+}
+
+void *scc_hashtab_impl_from(
+    scc_hashtab_eq eq,
+    scc_hashtab_hash hash,
+    size_t coff,
+    size_t elemsize,
+    void const *values,
+    size_t n
+) {
+    size_t const cap = scc_hashtab_fitcap(n);
+    if (!cap) {
+        return 0;
+    }
+
+    struct scc_hashtab_base sbase = {
+        .ht_eq = eq,
+        .ht_hash = hash,
+        .ht_fwoff = scc_hashtab_calcpad(coff)
+    };
+
+    void *tab;
+    struct scc_hashtab_base *base = scc_hashtab_alloc(&tab, &sbase, coff + elemsize, elemsize, cap);
+    if (!base) {
+        return 0;
+    }
+
+    scc_hashtab_metatype *md = scc_hashtab_metadata(base);
+    /* tab holds address of base->ht_data[-1] */
+    unsigned char *data = (unsigned char *)tab + elemsize;
+    unsigned char const *value = values;
+
+    scc_hash_type hashes[SCC_HASHTAB_BATCHSZ];
+    scc_hashtab_metatype ent;
+    size_t nbatch;
+    size_t slot;
+    for (size_t i = 0u; i < n; i += nbatch) {
+        nbatch = n - i < SCC_HASHTAB_BATCHSZ ? n - i : SCC_HASHTAB_BATCHSZ;
+
+        /* Hash the whole batch up front, allowing the
+         * metadata cache misses to overlap */
+        for (size_t j = 0u; j < nbatch; ++j) {
+            hashes[j] = base->ht_hash(value + (i + j) * elemsize, elemsize);
+            SCC_ON_PERFTRACK(++base->ht_perf.ev_n_hash);
+            scc_prefetch(md + (hashes[j] & (cap - 1u)));
+        }
+
+        /* Elements are distinct and the table holds nothing but empty
+         * and occupied slots, the first empty one is the target */
+        for (size_t j = 0u; j < nbatch; ++j) {
+            slot = hashes[j] & (cap - 1u);
+            while (md[slot]) {
+                slot = (slot + 1u) & (cap - 1u);
+            }
+
+            memcpy(data + slot * elemsize, value + (i + j) * elemsize, elemsize);
+            ent = (scc_hashtab_metatype)(SCC_HASHTAB_OCCUPIED | (hashes[j] >> SCC_HASHTAB_HASHSHIFT));
+            scc_hashtab_set_mdent(md, slot, ent, cap);
+        }
+    }
+
+    base->ht_size = n;
     return tab;
 }
 
 void scc_hashtab_free(void *tab) {
     struct scc_hashtab_base *base = scc_hashtab_impl_base(tab);
+    if (base->ht_oldtab) {
+        scc_hashtab_free(base->ht_oldtab);
+    }
     if (base->ht_dynalloc) {
-        free(base);
+        scc_pages_free(base->ht_allocator, base, scc_hashtab_bytesz(base), base->ht_dynalloc);
     }
 }
 
 bool scc_hashtab_impl_reserve(void *tabaddr, size_t capacity, size_t elemsize) {
     struct scc_hashtab_base *base = scc_hashtab_impl_base(*(void **)tabaddr);
+    if (base->ht_oldtab) {
+        scc_hashtab_migrate(*(void **)tabaddr, base, elemsize, SIZE_MAX);
+    }
     if (capacity <= base->ht_capacity) {
         return true;
     }
@@ -269,11 +502,20 @@ bool scc_hashtab_impl_remove(void *tab, size_t elemsize) {
         return false;
     }
 
+    if (base->ht_oldtab) {
+        scc_hashtab_migrate(tab, base, elemsize, SCC_HASHTAB_MIGRATESZ);
+    }
+
     scc_hash_type const hash = base->ht_hash(tab, elemsize);
 
     long long const index = scc_hashtab_impl_probe_find(base, tab, elemsize, hash);
     if (index == -1ll) {
-        return false;
+        long long const oindex = scc_hashtab_probe_old(base, tab, elemsize, hash);
+        if (oindex == -1ll) {
+            return false;
+        }
+        scc_hashtab_vacate_old(base, oindex);
+        return true;
     }
 
     assert(base->ht_size);
@@ -287,6 +529,10 @@ bool scc_hashtab_impl_remove(void *tab, size_t elemsize) {
 
 void scc_hashtab_clear(void *tab) {
     struct scc_hashtab_base *base = scc_hashtab_impl_base(tab);
+    if (base->ht_oldtab) {
+        scc_hashtab_free(base->ht_oldtab);
+        base->ht_oldtab = 0;
+    }
     scc_hashtab_metatype *md = scc_hashtab_metadata(base);
     scc_static_assert(sizeof(*md) == 1u);
     memset(md, 0, base->ht_capacity + SCC_HASHTAB_GUARDSZ);
@@ -295,23 +541,30 @@ void scc_hashtab_clear(void *tab) {
 
 void *scc_hashtab_clone(void const *tab) {
     struct scc_hashtab_base const *obase = scc_hashtab_impl_base_qual(tab, const);
-    scc_static_assert(sizeof(scc_hashtab_metatype) == 1);
-    size_t sz = obase->ht_mdoff + obase->ht_capacity + SCC_HASHTAB_GUARDSZ;
-    scc_when_mutating(assert(sz > obase->ht_mdoff + obase->ht_capacity));
-#ifdef SCC_CANARY_ENABLED
-    sz += SCC_HASHTAB_CANARYSZ;
-#endif
-    struct scc_hashtab_base *nbase = malloc(sz);
+    size_t const sz = scc_hashtab_bytesz(obase);
+    unsigned char dynalloc;
+    struct scc_hashtab_base *nbase = scc_pages_alloc(obase->ht_allocator, sz, false, &dynalloc);
     if (!nbase) {
         return 0;
     }
     scc_memcpy(nbase, obase, sz);
-    nbase->ht_dynalloc = 1;
+    nbase->ht_dynalloc = dynalloc;
+    if (obase->ht_oldtab) {
+        nbase->ht_oldtab = scc_hashtab_clone(obase->ht_oldtab);
+        if (!nbase->ht_oldtab) {
+            scc_pages_free(nbase->ht_allocator, nbase, sz, dynalloc);
+            return 0;
+        }
+    }
     return (unsigned char *)nbase + offsetof(struct scc_hashtab_base, ht_fwoff) + nbase->ht_fwoff + sizeof(nbase->ht_fwoff);
 }
 
 void const *scc_hashtab_impl_iter_begin(void *tab, size_t elemsize) {
     struct scc_hashtab_base *base = scc_hashtab_impl_base(tab);
+    if (base->ht_oldtab) {
+        /* Iteration requires all elements to be in the same table */
+        scc_hashtab_migrate(tab, base, elemsize, SIZE_MAX);
+    }
     return scc_hashtab_impl_iter_next_occupied(base, tab, elemsize, 0u);
 }
 
@@ -0,0 +1,104 @@
+#if defined __unix__ || defined __APPLE__
+/* posix_memalign, MAP_ANONYMOUS and madvise */
+#define _DEFAULT_SOURCE
+#define SCC_PAGES_POSIX
+#endif
+
+#include <scc/mem.h>
+#include <scc/pages.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef SCC_PAGES_POSIX
+#include <sys/mman.h>
+#endif
+
+#ifdef SCC_PAGES_POSIX
+static void *scc_pages_map(size_t size) {
+    size_t const mapsize = scc_align(size, (size_t)SCC_PAGES_HUGESZ);
+
+    /* Over-map by one huge page and trim both ends so that the
+     * block starts on a huge page boundary */
+    unsigned char *mem = mmap(0, mapsize + SCC_PAGES_HUGESZ, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return 0;
+    }
+
+    unsigned char *addr = (void *)scc_align((uintptr_t)mem, (uintptr_t)SCC_PAGES_HUGESZ);
+    size_t const head = addr - mem;
+    if (head) {
+        munmap(mem, head);
+    }
+    if (SCC_PAGES_HUGESZ - head) {
+        munmap(addr + mapsize, SCC_PAGES_HUGESZ - head);
+    }
+
+#ifdef MADV_HUGEPAGE
+    /* Advisory only, the mapping is usable either way */
+    (void)madvise(addr, mapsize, MADV_HUGEPAGE);
+#endif
+    return addr;
+}
+
+static void *scc_pages_heap(size_t size, bool zero) {
+    void *addr;
+    if (posix_memalign(&addr, SCC_PAGES_LINESZ, size)) {
+        return 0;
+    }
+    if (zero) {
+        memset(addr, 0, size);
+    }
+    return addr;
+}
+#else
+static void *scc_pages_map(size_t size) {
+    (void)size;
+    return 0;
+}
+
+static void *scc_pages_heap(size_t size, bool zero) {
+    /* No portable aligned allocation in C99, alignment
+     * is that of malloc */
+    return zero ? calloc(size, sizeof(unsigned char)) : malloc(size);
+}
+#endif
+
+void *scc_pages_alloc(struct scc_allocator const *allocator, size_t size, bool zero, unsigned char *kind) {
+    void *addr = 0;
+    if (allocator) {
+        *kind = SCC_PAGES_HEAP;
+        return zero ? scc_allocator_zalloc(allocator, size) : scc_allocator_alloc(allocator, size);
+    }
+
+    if (size >= SCC_PAGES_HUGE_THRESHOLD) {
+        /* Anonymous mappings are zero-filled */
+        addr = scc_pages_map(size);
+        if (addr) {
+            *kind = SCC_PAGES_MAPPED;
+            return addr;
+        }
+    }
+
+    addr = scc_pages_heap(size, zero);
+    *kind = SCC_PAGES_HEAP;
+    return addr;
+}
+
+void scc_pages_free(struct scc_allocator const *allocator, void *addr, size_t size, unsigned char kind) {
+    switch (kind) {
+        case SCC_PAGES_HEAP:
+            scc_allocator_free(allocator, addr);
+            break;
+#ifdef SCC_PAGES_POSIX
+        case SCC_PAGES_MAPPED:
+            munmap(addr, scc_align(size, (size_t)SCC_PAGES_HUGESZ));
+            break;
+#endif
+        default:
+            (void)size;
+            break;
+    }
+}
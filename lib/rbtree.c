@@ -5,7 +5,6 @@
 #include <assert.h>
 #include <limits.h>
 #include <stdbool.h>
-#include <stdlib.h>
 #include <string.h>
 
 #define rb_root rb_sentinel.rs_left
@@ -295,7 +294,7 @@ static inline struct scc_rbtree_base *scc_rbtree_clone_base(struct scc_rbtree_ba
     size_t bytesz = basesz + elemsize;
     scc_when_mutating(assert(bytesz > basesz));
 
-    struct scc_rbtree_base *nbase = malloc(bytesz);
+    struct scc_rbtree_base *nbase = scc_allocator_alloc(obase->rb_arena.ar_allocator, bytesz);
     if (!nbase) {
         return 0;
     }
@@ -322,7 +321,7 @@ void *scc_rbtree_impl_new(struct scc_rbtree_base *base, size_t coff) {
 }
 
 void *scc_rbtree_impl_new_dyn(size_t treesz, struct scc_arena *arena, scc_rbcompare compare, size_t coff, size_t dataoff) {
-    struct scc_rbtree_base *base = calloc(treesz, sizeof(unsigned char));
+    struct scc_rbtree_base *base = scc_allocator_zalloc(arena->ar_allocator, treesz);
     if (!base) {
         return 0;
     }
@@ -345,7 +344,7 @@ void scc_rbtree_free(void *rbtree) {
     struct scc_rbtree_base *base = scc_rbtree_impl_base(rbtree);
     scc_arena_release(&base->rb_arena);
     if (base->rb_dynalloc) {
-        free(base);
+        scc_allocator_free(base->rb_arena.ar_allocator, base);
     }
 }
 
@@ -480,7 +479,7 @@ void *scc_rbtree_impl_clone(void const *rbtree, size_t elemsize) {
 
     /* Know how many nodes are needed */
     if (!scc_arena_reserve(&nbase->rb_arena, obase->rb_size)) {
-        free(nbase);
+        scc_allocator_free(nbase->rb_arena.ar_allocator, nbase);
         return 0;
     }
 
@@ -552,7 +551,7 @@ void *scc_rbtree_impl_clone(void const *rbtree, size_t elemsize) {
 epilogue:
     scc_deque_free(deque);
     if (!ntree) {
-        free(nbase);
+        scc_allocator_free(nbase->rb_arena.ar_allocator, nbase);
     }
     return ntree;
 }
@@ -0,0 +1,188 @@
+#include <scc/mem.h>
+#include <scc/region.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+struct scc_allocator const *scc_region_allocator(struct scc_region *region);
+size_t scc_region_nchunks(struct scc_region const *region);
+
+/* Each block is preceded by its size, required for reallocation */
+enum { SCC_REGION_HDRSZ = sizeof(size_t) };
+
+/* Largest block header and padding may occupy */
+enum { SCC_REGION_OVERHEAD = SCC_REGION_HDRSZ + SCC_REGION_ALIGN - 1u };
+
+static inline size_t *scc_region_block_size(void *block) {
+    return (size_t *)((unsigned char *)block - SCC_REGION_HDRSZ);
+}
+
+/* Address of a block of the given size, placed at the first free byte in the
+ * chunk, or NULL if it does not fit */
+static inline unsigned char *scc_region_chunk_fit(struct scc_region_chunk *chunk, size_t size) {
+    unsigned char *block = (void *)scc_align(
+        (uintptr_t)(chunk->rc_buffer + chunk->rc_offset + SCC_REGION_HDRSZ),
+        (uintptr_t)SCC_REGION_ALIGN
+    );
+    size_t const end = block - chunk->rc_buffer;
+    if (end > chunk->rc_size || chunk->rc_size - end < size) {
+        return 0;
+    }
+    return block;
+}
+
+static inline void *scc_region_chunk_bump(struct scc_region_chunk *chunk, unsigned char *block, size_t size) {
+    *scc_region_block_size(block) = size;
+    chunk->rc_last = block - chunk->rc_buffer;
+    chunk->rc_offset = chunk->rc_last + size;
+    return block;
+}
+
+static struct scc_region_chunk *scc_region_chunk_new(struct scc_region *region, size_t size) {
+    struct scc_region_chunk *chunk = scc_allocator_alloc(region->rg_backing, sizeof(*chunk) + size);
+    if (!chunk) {
+        return 0;
+    }
+    chunk->rc_prev = 0;
+    chunk->rc_size = size;
+    chunk->rc_offset = 0u;
+    chunk->rc_last = SIZE_MAX;
+    ++region->rg_nchunks;
+    return chunk;
+}
+
+/* Size of the next regular chunk, doubling with each chunk in the region */
+static size_t scc_region_growsize(struct scc_region const *region) {
+    size_t size = SCC_REGION_CHUNKSIZE;
+    for (size_t i = 0u; i < region->rg_nchunks && size < SCC_REGION_MAX_CHUNKSIZE; ++i) {
+        size <<= 1u;
+    }
+    return size < SCC_REGION_MAX_CHUNKSIZE ? size : SCC_REGION_MAX_CHUNKSIZE;
+}
+
+static void *scc_region_alloc_slow(struct scc_region *region, size_t size) {
+    size_t const required = size + SCC_REGION_OVERHEAD;
+    if (required < size) {
+        return 0;
+    }
+
+    size_t const growsize = scc_region_growsize(region);
+    struct scc_region_chunk *chunk;
+    if (required > growsize && region->rg_current) {
+        /* Oversized block in a chunk of its own, placed behind the
+         * current one so as to not waste the space left in it */
+        chunk = scc_region_chunk_new(region, required);
+        if (!chunk) {
+            return 0;
+        }
+        chunk->rc_prev = region->rg_current->rc_prev;
+        region->rg_current->rc_prev = chunk;
+    }
+    else {
+        chunk = scc_region_chunk_new(region, required > growsize ? required : growsize);
+        if (!chunk) {
+            return 0;
+        }
+        chunk->rc_prev = region->rg_current;
+        region->rg_current = chunk;
+    }
+
+    unsigned char *block = scc_region_chunk_fit(chunk, size);
+    return scc_region_chunk_bump(chunk, block, size);
+}
+
+/* Whether addr is the most recently allocated block in the current chunk */
+static inline bool scc_region_is_last(struct scc_region const *region, void const *addr) {
+    struct scc_region_chunk const *chunk = region->rg_current;
+    return chunk && chunk->rc_last != SIZE_MAX &&
+        (unsigned char const *)addr == chunk->rc_buffer + chunk->rc_last;
+}
+
+static void *scc_region_vtable_alloc(void *ctx, size_t size) {
+    return scc_region_alloc(ctx, size);
+}
+
+static void *scc_region_vtable_realloc(void *ctx, void *addr, size_t size) {
+    struct scc_region *region = ctx;
+    if (!addr) {
+        return scc_region_alloc(region, size);
+    }
+
+    size_t const oldsize = *scc_region_block_size(addr);
+    if (scc_region_is_last(region, addr)) {
+        /* Grow or shrink in place if possible */
+        struct scc_region_chunk *chunk = region->rg_current;
+        if (chunk->rc_size - chunk->rc_last >= size) {
+            return scc_region_chunk_bump(chunk, addr, size);
+        }
+    }
+    else if (size <= oldsize) {
+        return addr;
+    }
+
+    void *block = scc_region_alloc(region, size);
+    if (!block) {
+        return 0;
+    }
+    memcpy(block, addr, oldsize < size ? oldsize : size);
+    return block;
+}
+
+static void scc_region_vtable_free(void *ctx, void *addr) {
+    struct scc_region *region = ctx;
+    if (addr && scc_region_is_last(region, addr)) {
+        /* Cheap to reclaim, the block is on top */
+        struct scc_region_chunk *chunk = region->rg_current;
+        chunk->rc_offset = chunk->rc_last - SCC_REGION_HDRSZ;
+        chunk->rc_last = SIZE_MAX;
+    }
+}
+
+void scc_region_init(struct scc_region *region, struct scc_allocator const *backing) {
+    region->rg_allocator = (struct scc_allocator) {
+        .al_alloc = scc_region_vtable_alloc,
+        .al_realloc = scc_region_vtable_realloc,
+        .al_free = scc_region_vtable_free,
+        .al_ctx = region,
+    };
+    region->rg_backing = backing;
+    region->rg_current = 0;
+    region->rg_nchunks = 0u;
+}
+
+void *scc_region_alloc(struct scc_region *region, size_t size) {
+    struct scc_region_chunk *chunk = region->rg_current;
+    if (chunk) {
+        unsigned char *block = scc_region_chunk_fit(chunk, size);
+        if (block) {
+            return scc_region_chunk_bump(chunk, block, size);
+        }
+    }
+    return scc_region_alloc_slow(region, size);
+}
+
+static void scc_region_release_chain(struct scc_region *region, struct scc_region_chunk *chunk) {
+    struct scc_region_chunk *prev;
+    for (; chunk; chunk = prev) {
+        prev = chunk->rc_prev;
+        scc_allocator_free(region->rg_backing, chunk);
+        --region->rg_nchunks;
+    }
+}
+
+void scc_region_reset(struct scc_region *region) {
+    struct scc_region_chunk *chunk = region->rg_current;
+    if (!chunk) {
+        return;
+    }
+    scc_region_release_chain(region, chunk->rc_prev);
+    chunk->rc_prev = 0;
+    chunk->rc_offset = 0u;
+    chunk->rc_last = SIZE_MAX;
+}
+
+void scc_region_release(struct scc_region *region) {
+    scc_region_release_chain(region, region->rg_current);
+    region->rg_current = 0;
+}
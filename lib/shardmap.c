@@ -0,0 +1,358 @@
+#include <scc/bits.h>
+#include <scc/bug.h>
+#include <scc/hashmap.h>
+#include <scc/mem.h>
+#include <scc/shardmap.h>
+
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of hash bits stored in the hashmap metadata */
+enum { SCC_SHARDMAP_TAGBITS = 7 };
+
+/* Writers serialize on sh_lock. The sequence number is odd while the map
+ * is modified in place, lookups overlapping such a modification are
+ * retried. Maps about to be reallocated are replaced by a copy instead */
+struct scc_shardmap_shard {
+    unsigned long sh_seq;
+    void *sh_map;
+    pthread_mutex_t sh_lock;
+    unsigned char sh_pad[
+        SCC_SHARDMAP_LINESZ - (sizeof(unsigned long) + sizeof(void *) + sizeof(pthread_mutex_t)) % SCC_SHARDMAP_LINESZ
+    ];
+};
+
+/* State of a handle, placed on a line of its own following the
+ * staging pair. The sequence number is odd for as long as a lookup
+ * made through the handle may refer to a map */
+struct scc_shardmap_reader {
+    unsigned long rd_seq;
+    struct scc_shardmap_base *rd_base;
+    struct scc_shardmap_reader *rd_next;
+    void *rd_handle;
+};
+
+struct scc_shardmap_base {
+    scc_hashmap_hash sm_hash;
+    size_t sm_nshards;
+    size_t sm_pairsize;
+    unsigned sm_shift;
+    struct scc_shardmap_shard *sm_shards;
+    void *sm_shardmem;
+    struct scc_shardmap_reader *sm_readers;
+    pthread_mutex_t sm_rdlock;
+};
+
+size_t scc_shardmap_impl_readeroff(size_t pairsize);
+
+/* Allocate a handle, i.e. a staging pair followed by a pointer to the
+ * reader state, and register it with the map */
+static void *scc_shardmap_new_handle(struct scc_shardmap_base *base) {
+    size_t const ptroff = scc_shardmap_impl_readeroff(base->sm_pairsize);
+    size_t const readersz = scc_align(sizeof(struct scc_shardmap_reader), (size_t)SCC_SHARDMAP_LINESZ);
+    unsigned char *smap = calloc(ptroff + sizeof(struct scc_shardmap_reader *) + SCC_SHARDMAP_LINESZ - 1u + readersz, sizeof(unsigned char));
+    if (!smap) {
+        return 0;
+    }
+
+    uintptr_t const rdaddr = (uintptr_t)(smap + ptroff + sizeof(struct scc_shardmap_reader *));
+    struct scc_shardmap_reader *reader = (void *)scc_align(rdaddr, (uintptr_t)SCC_SHARDMAP_LINESZ);
+    reader->rd_base = base;
+    reader->rd_handle = smap;
+    *(struct scc_shardmap_reader **)(smap + ptroff) = reader;
+
+    pthread_mutex_lock(&base->sm_rdlock);
+    reader->rd_next = base->sm_readers;
+    base->sm_readers = reader;
+    pthread_mutex_unlock(&base->sm_rdlock);
+    return smap;
+}
+
+static void scc_shardmap_unregister(struct scc_shardmap_reader *reader) {
+    struct scc_shardmap_base *base = reader->rd_base;
+    pthread_mutex_lock(&base->sm_rdlock);
+    struct scc_shardmap_reader **link = &base->sm_readers;
+    while (*link != reader) {
+        assert(*link);
+        link = &(*link)->rd_next;
+    }
+    *link = reader->rd_next;
+    pthread_mutex_unlock(&base->sm_rdlock);
+}
+
+/* Wait until every lookup that might have loaded a replaced
+ * map pointer has finished */
+static void scc_shardmap_synchronize(struct scc_shardmap_base *base) {
+    unsigned long seq;
+    pthread_mutex_lock(&base->sm_rdlock);
+    for (struct scc_shardmap_reader *reader = base->sm_readers; reader; reader = reader->rd_next) {
+        seq = __atomic_load_n(&reader->rd_seq, __ATOMIC_SEQ_CST);
+        if (!(seq & 1u)) {
+            continue;
+        }
+        while (__atomic_load_n(&reader->rd_seq, __ATOMIC_ACQUIRE) == seq) {
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&base->sm_rdlock);
+}
+
+static inline void scc_shardmap_read_lock(struct scc_shardmap_reader *reader) {
+    /* Only ever written by the owning thread */
+    __atomic_store_n(&reader->rd_seq, reader->rd_seq + 1u, __ATOMIC_SEQ_CST);
+}
+
+static inline void scc_shardmap_read_unlock(struct scc_shardmap_reader *reader) {
+    __atomic_store_n(&reader->rd_seq, reader->rd_seq + 1u, __ATOMIC_RELEASE);
+}
+
+/* Wait for any in-place modification of the shard to finish and
+ * return its sequence number */
+static inline unsigned long scc_shardmap_read_begin(struct scc_shardmap_shard const *shard) {
+    unsigned long seq;
+    while ((seq = __atomic_load_n(&shard->sh_seq, __ATOMIC_ACQUIRE)) & 1u) {
+        sched_yield();
+    }
+    return seq;
+}
+
+/* Whether the shard was modified since scc_shardmap_read_begin */
+static inline bool scc_shardmap_read_retry(struct scc_shardmap_shard const *shard, unsigned long seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&shard->sh_seq, __ATOMIC_RELAXED) != seq;
+}
+
+/* Only ever called with sh_lock held */
+static inline void scc_shardmap_write_begin(struct scc_shardmap_shard *shard) {
+    __atomic_store_n(&shard->sh_seq, shard->sh_seq + 1u, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void scc_shardmap_write_end(struct scc_shardmap_shard *shard) {
+    __atomic_store_n(&shard->sh_seq, shard->sh_seq + 1u, __ATOMIC_RELEASE);
+}
+
+static inline struct scc_shardmap_shard *scc_shardmap_shard_of(
+    struct scc_shardmap_base const *base,
+    scc_hash_type hash
+) {
+    /* The high bits are stored in the metadata and the low ones
+     * index into the shard, use the ones just below the former */
+    return &base->sm_shards[(hash >> base->sm_shift) & (base->sm_nshards - 1u)];
+}
+
+static inline scc_hash_type scc_shardmap_hash_key(struct scc_shardmap_base const *base, void const *key, size_t keysize) {
+    return base->sm_hash(key, keysize);
+}
+
+static void scc_shardmap_release_shards(struct scc_shardmap_base *base, size_t nshards) {
+    for (size_t i = 0u; i < nshards; ++i) {
+        pthread_mutex_destroy(&base->sm_shards[i].sh_lock);
+        scc_hashmap_free(base->sm_shards[i].sh_map);
+    }
+    pthread_mutex_destroy(&base->sm_rdlock);
+    free(base->sm_shardmem);
+    free(base);
+}
+
+void *scc_shardmap_impl_new(void *proto, size_t nshards, size_t pairsize) {
+    scc_static_assert(sizeof(struct scc_shardmap_shard) % SCC_SHARDMAP_LINESZ == 0u);
+    if (!proto) {
+        return 0;
+    }
+    if (!nshards || nshards > SCC_SHARDMAP_MAXSHARDS || !scc_bits_is_power_of_2(nshards)) {
+        scc_hashmap_free(proto);
+        return 0;
+    }
+
+    struct scc_shardmap_base *base = calloc(1u, sizeof(*base));
+    if (!base) {
+        scc_hashmap_free(proto);
+        return 0;
+    }
+    if (pthread_mutex_init(&base->sm_rdlock, 0)) {
+        free(base);
+        scc_hashmap_free(proto);
+        return 0;
+    }
+
+    /* Pad to allow for aligning the shards on a line boundary */
+    base->sm_shardmem = calloc(nshards * sizeof(*base->sm_shards) + SCC_SHARDMAP_LINESZ - 1u, sizeof(unsigned char));
+    if (!base->sm_shardmem) {
+        pthread_mutex_destroy(&base->sm_rdlock);
+        free(base);
+        scc_hashmap_free(proto);
+        return 0;
+    }
+
+    base->sm_shards = (void *)scc_align((uintptr_t)base->sm_shardmem, (uintptr_t)SCC_SHARDMAP_LINESZ);
+    base->sm_hash = scc_hashmap_impl_base(proto)->hm_hash;
+    base->sm_nshards = nshards;
+    base->sm_pairsize = pairsize;
+
+    unsigned shardbits = 0u;
+    while ((1ull << shardbits) < nshards) {
+        ++shardbits;
+    }
+    base->sm_shift = sizeof(scc_hash_type) * CHAR_BIT - SCC_SHARDMAP_TAGBITS - shardbits;
+
+    size_t i;
+    for (i = 0u; i < nshards; ++i) {
+        base->sm_shards[i].sh_map = i ? scc_hashmap_clone(proto) : proto;
+        if (!base->sm_shards[i].sh_map) {
+            break;
+        }
+        if (pthread_mutex_init(&base->sm_shards[i].sh_lock, 0)) {
+            scc_hashmap_free(base->sm_shards[i].sh_map);
+            break;
+        }
+    }
+
+    if (i < nshards) {
+        scc_shardmap_release_shards(base, i);
+        return 0;
+    }
+
+    void *smap = scc_shardmap_new_handle(base);
+    if (!smap) {
+        scc_shardmap_release_shards(base, nshards);
+        return 0;
+    }
+    return smap;
+}
+
+void *scc_shardmap_impl_attach(struct scc_shardmap_reader *reader) {
+    return scc_shardmap_new_handle(reader->rd_base);
+}
+
+void scc_shardmap_impl_detach(struct scc_shardmap_reader *reader) {
+    scc_shardmap_unregister(reader);
+    free(reader->rd_handle);
+}
+
+void scc_shardmap_impl_free(struct scc_shardmap_reader *reader) {
+    struct scc_shardmap_base *base = reader->rd_base;
+    scc_shardmap_unregister(reader);
+    assert(!base->sm_readers);
+    scc_shardmap_release_shards(base, base->sm_nshards);
+    free(reader->rd_handle);
+}
+
+/* Insert into a copy of the shard and replace the shard by it. Lookups
+ * proceed in the previous map until the copy has been published */
+static bool scc_shardmap_insert_copy(
+    struct scc_shardmap_base *base,
+    struct scc_shardmap_shard *shard,
+    void const *smap,
+    size_t keysize,
+    size_t valsize,
+    scc_hash_type hash
+) {
+    void *draft = scc_hashmap_clone(shard->sh_map);
+    if (!draft) {
+        return false;
+    }
+    /* The staging pair has the same layout as hm_curr */
+    memcpy(draft, smap, base->sm_pairsize);
+    if (!scc_hashmap_impl_insert_hashed(&draft, keysize, valsize, hash)) {
+        scc_hashmap_free(draft);
+        return false;
+    }
+    /* Readers probe without migrating, finish any incremental rehash */
+    scc_hashmap_impl_settle(draft, keysize, valsize);
+
+    void *prev = __atomic_exchange_n(&shard->sh_map, draft, __ATOMIC_SEQ_CST);
+    scc_shardmap_synchronize(base);
+    scc_hashmap_free(prev);
+    return true;
+}
+
+bool scc_shardmap_impl_insert(void *smap, struct scc_shardmap_reader *reader, size_t keysize, size_t valsize) {
+    struct scc_shardmap_base *base = reader->rd_base;
+    scc_hash_type const hash = scc_shardmap_hash_key(base, smap, keysize);
+    struct scc_shardmap_shard *shard = scc_shardmap_shard_of(base, hash);
+
+    pthread_mutex_lock(&shard->sh_lock);
+    void *map = shard->sh_map;
+    bool inserted;
+    if (scc_hashmap_impl_should_rehash(map)) {
+        inserted = scc_shardmap_insert_copy(base, shard, smap, keysize, valsize, hash);
+    }
+    else {
+        memcpy(map, smap, base->sm_pairsize);
+        scc_shardmap_write_begin(shard);
+        inserted = scc_hashmap_impl_insert_hashed(&map, keysize, valsize, hash);
+        scc_shardmap_write_end(shard);
+        /* Neither rehashed nor migrating, the map stays in place */
+        assert(map == shard->sh_map);
+    }
+    pthread_mutex_unlock(&shard->sh_lock);
+    return inserted;
+}
+
+void *scc_shardmap_impl_find(void *smap, struct scc_shardmap_reader *reader, void *val, size_t keysize, size_t valsize) {
+    struct scc_shardmap_base *base = reader->rd_base;
+    scc_hash_type const hash = scc_shardmap_hash_key(base, smap, keysize);
+    struct scc_shardmap_shard *shard = scc_shardmap_shard_of(base, hash);
+
+    void *map;
+    void const *found;
+    unsigned long seq;
+    scc_shardmap_read_lock(reader);
+    do {
+        seq = scc_shardmap_read_begin(shard);
+        map = __atomic_load_n(&shard->sh_map, __ATOMIC_SEQ_CST);
+        /* The shared probe writes neither to hm_curr nor to the metadata */
+        found = scc_hashmap_impl_find_shared_hashed(map, smap, keysize, valsize, hash);
+        if (found) {
+            /* The map may be modified as soon as the lookup is done */
+            memcpy(val, found, valsize);
+        }
+    } while (scc_shardmap_read_retry(shard, seq));
+    scc_shardmap_read_unlock(reader);
+    return found ? val : 0;
+}
+
+bool scc_shardmap_impl_remove(void *smap, struct scc_shardmap_reader *reader, size_t keysize, size_t valsize) {
+    struct scc_shardmap_base *base = reader->rd_base;
+    scc_hash_type const hash = scc_shardmap_hash_key(base, smap, keysize);
+    struct scc_shardmap_shard *shard = scc_shardmap_shard_of(base, hash);
+
+    pthread_mutex_lock(&shard->sh_lock);
+    /* Removal never reallocates */
+    memcpy(shard->sh_map, smap, keysize);
+    scc_shardmap_write_begin(shard);
+    bool const removed = scc_hashmap_impl_remove_hashed(shard->sh_map, keysize, valsize, hash);
+    scc_shardmap_write_end(shard);
+    pthread_mutex_unlock(&shard->sh_lock);
+    return removed;
+}
+
+size_t scc_shardmap_impl_size(struct scc_shardmap_reader *reader) {
+    struct scc_shardmap_base *base = reader->rd_base;
+    struct scc_shardmap_shard *shard;
+    unsigned long seq;
+    size_t size = 0u;
+    size_t shardsize;
+    scc_shardmap_read_lock(reader);
+    for (size_t i = 0u; i < base->sm_nshards; ++i) {
+        shard = &base->sm_shards[i];
+        do {
+            seq = scc_shardmap_read_begin(shard);
+            shardsize = scc_hashmap_size(__atomic_load_n(&shard->sh_map, __ATOMIC_SEQ_CST));
+        } while (scc_shardmap_read_retry(shard, seq));
+        size += shardsize;
+    }
+    scc_shardmap_read_unlock(reader);
+    return size;
+}
+
+size_t scc_shardmap_impl_nshards(struct scc_shardmap_reader const *reader) {
+    return reader->rd_base->sm_nshards;
+}
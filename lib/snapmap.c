@@ -0,0 +1,173 @@
+#include <scc/hashmap.h>
+#include <scc/mem.h>
+#include <scc/snapmap.h>
+
+#include <assert.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+size_t scc_snapmap_impl_readeroff(size_t pairsize);
+
+/* Allocate a handle, i.e. a staging pair followed by the reader
+ * state, and register it with the map */
+static void *scc_snapmap_new_handle(struct scc_snapmap_base *base) {
+    size_t const readeroff = scc_snapmap_impl_readeroff(base->sm_pairsize);
+    void *mem = calloc(readeroff + sizeof(struct scc_snapmap_reader) + SCC_SNAPMAP_LINESZ - 1u, sizeof(unsigned char));
+    if (!mem) {
+        return 0;
+    }
+
+    unsigned char *smap = (void *)scc_align((uintptr_t)mem, (uintptr_t)SCC_SNAPMAP_LINESZ);
+    struct scc_snapmap_reader *reader = (void *)(smap + readeroff);
+    reader->rd_base = base;
+    reader->rd_mem = mem;
+
+    pthread_mutex_lock(&base->sm_rdlock);
+    reader->rd_next = base->sm_readers;
+    base->sm_readers = reader;
+    pthread_mutex_unlock(&base->sm_rdlock);
+    return smap;
+}
+
+static void scc_snapmap_unregister(struct scc_snapmap_reader *reader) {
+    struct scc_snapmap_base *base = reader->rd_base;
+    pthread_mutex_lock(&base->sm_rdlock);
+    struct scc_snapmap_reader **link = &base->sm_readers;
+    while (*link != reader) {
+        assert(*link);
+        link = &(*link)->rd_next;
+    }
+    *link = reader->rd_next;
+    pthread_mutex_unlock(&base->sm_rdlock);
+}
+
+/* Wait until every reader that might have loaded the previous
+ * snapshot pointer has finished its lookup. A reader's sequence
+ * number is odd for as long as it is probing a snapshot */
+static void scc_snapmap_synchronize(struct scc_snapmap_base *base) {
+    unsigned long seq;
+    pthread_mutex_lock(&base->sm_rdlock);
+    for (struct scc_snapmap_reader *reader = base->sm_readers; reader; reader = reader->rd_next) {
+        seq = __atomic_load_n(&reader->rd_seq, __ATOMIC_SEQ_CST);
+        if (!(seq & 1u)) {
+            continue;
+        }
+        while (__atomic_load_n(&reader->rd_seq, __ATOMIC_ACQUIRE) == seq) {
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&base->sm_rdlock);
+}
+
+static inline void *scc_snapmap_read_lock(struct scc_snapmap_reader *reader) {
+    /* Only ever written by the owning thread */
+    __atomic_store_n(&reader->rd_seq, reader->rd_seq + 1u, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&reader->rd_base->sm_snapshot, __ATOMIC_SEQ_CST);
+}
+
+static inline void scc_snapmap_read_unlock(struct scc_snapmap_reader *reader) {
+    __atomic_store_n(&reader->rd_seq, reader->rd_seq + 1u, __ATOMIC_RELEASE);
+}
+
+void *scc_snapmap_impl_new(void *map, size_t pairsize) {
+    if (!map) {
+        return 0;
+    }
+
+    struct scc_snapmap_base *base = calloc(1u, sizeof(*base));
+    if (!base) {
+        goto epilogue;
+    }
+    if (pthread_mutex_init(&base->sm_wrlock, 0)) {
+        goto epilogue;
+    }
+    if (pthread_mutex_init(&base->sm_rdlock, 0)) {
+        goto destroy_wrlock;
+    }
+
+    base->sm_snapshot = map;
+    base->sm_pairsize = pairsize;
+
+    void *smap = scc_snapmap_new_handle(base);
+    if (!smap) {
+        goto destroy_rdlock;
+    }
+    return smap;
+
+destroy_rdlock:
+    pthread_mutex_destroy(&base->sm_rdlock);
+destroy_wrlock:
+    pthread_mutex_destroy(&base->sm_wrlock);
+epilogue:
+    free(base);
+    scc_hashmap_free(map);
+    return 0;
+}
+
+void *scc_snapmap_impl_attach(struct scc_snapmap_base *base) {
+    return scc_snapmap_new_handle(base);
+}
+
+void scc_snapmap_impl_detach(struct scc_snapmap_reader *reader) {
+    scc_snapmap_unregister(reader);
+    free(reader->rd_mem);
+}
+
+void scc_snapmap_impl_free(struct scc_snapmap_reader *reader) {
+    struct scc_snapmap_base *base = reader->rd_base;
+    scc_snapmap_unregister(reader);
+    assert(!base->sm_readers);
+
+    pthread_mutex_destroy(&base->sm_rdlock);
+    pthread_mutex_destroy(&base->sm_wrlock);
+    scc_hashmap_free(base->sm_snapshot);
+    free(base);
+    free(reader->rd_mem);
+}
+
+void *scc_snapmap_impl_find(void *smap, struct scc_snapmap_reader *reader, void *val, size_t keysize, size_t valsize) {
+    void *snapshot = scc_snapmap_read_lock(reader);
+    void const *found = scc_hashmap_impl_find_shared(snapshot, smap, keysize, valsize);
+    if (found) {
+        /* The snapshot may be freed as soon as the lookup is done */
+        memcpy(val, found, valsize);
+    }
+    scc_snapmap_read_unlock(reader);
+    return found ? val : 0;
+}
+
+size_t scc_snapmap_impl_size(struct scc_snapmap_reader *reader) {
+    void *snapshot = scc_snapmap_read_lock(reader);
+    size_t const size = scc_hashmap_size(snapshot);
+    scc_snapmap_read_unlock(reader);
+    return size;
+}
+
+void *scc_snapmap_impl_edit(struct scc_snapmap_base *base) {
+    pthread_mutex_lock(&base->sm_wrlock);
+    /* Snapshot is only replaced while holding sm_wrlock */
+    void *draft = scc_hashmap_clone(base->sm_snapshot);
+    if (!draft) {
+        pthread_mutex_unlock(&base->sm_wrlock);
+        return 0;
+    }
+    return draft;
+}
+
+void scc_snapmap_impl_publish(struct scc_snapmap_base *base, void *draft, size_t keysize, size_t valsize) {
+    /* Readers never migrate, leave nothing behind in the old table */
+    scc_hashmap_impl_settle(draft, keysize, valsize);
+
+    void *prev = __atomic_exchange_n(&base->sm_snapshot, draft, __ATOMIC_SEQ_CST);
+    scc_snapmap_synchronize(base);
+    scc_hashmap_free(prev);
+    pthread_mutex_unlock(&base->sm_wrlock);
+}
+
+void scc_snapmap_impl_discard(struct scc_snapmap_base *base, void *draft) {
+    scc_hashmap_free(draft);
+    pthread_mutex_unlock(&base->sm_wrlock);
+}
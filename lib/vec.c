@@ -2,7 +2,6 @@
 
 #include <assert.h>
 #include <stdbool.h>
-#include <stdlib.h>
 #include <string.h>
 
 enum { SCC_VEC_MAX_CAPACITY_INCREASE = 4096 };
@@ -25,12 +24,13 @@ static inline size_t scc_vec_calc_new_capacity(size_t current) {
     return current << 1u | 1u;
 }
 
-static struct scc_vec_base *scc_vec_alloc(size_t nbytes, size_t nelems, size_t npad) {
-    struct scc_vec_base *v = malloc(nbytes);
+static struct scc_vec_base *scc_vec_alloc(struct scc_allocator const *allocator, size_t nbytes, size_t nelems, size_t npad) {
+    struct scc_vec_base *v = scc_allocator_alloc(allocator, nbytes);
     if (!v) {
         return 0;
     }
     v->sv_size = nelems;
+    v->sv_allocator = allocator;
     v->sv_buffer[npad - 2u] = npad - 2 * sizeof(unsigned char);
     v->sv_buffer[npad - 1u] = 1u;
     return v;
@@ -38,18 +38,19 @@ static struct scc_vec_base *scc_vec_alloc(size_t nbytes, size_t nelems, size_t n
 
 static bool scc_vec_grow(void *restrict *vec, size_t capacity, size_t elemsize) {
     struct scc_vec_base *v;
+    struct scc_allocator const *allocator = scc_vec_impl_base(*vec)->sv_allocator;
     size_t const npad = scc_vec_impl_npad(*vec);
     size_t const nbytes = scc_vec_bytesize(capacity, elemsize, npad);
 
     if (!scc_vec_is_allocd(*vec)) {
-        v = scc_vec_alloc(nbytes, scc_vec_size(*vec), npad);
+        v = scc_vec_alloc(allocator, nbytes, scc_vec_size(*vec), npad);
         if (!v) {
             return false;
         }
         memcpy(v->sv_buffer + npad, *vec, scc_vec_size(*vec) * elemsize);
     }
     else {
-        v = realloc(scc_vec_impl_base(*vec), nbytes);
+        v = scc_allocator_realloc(allocator, scc_vec_impl_base(*vec), nbytes);
         if (!v) {
             return false;
         }
@@ -67,12 +68,13 @@ void *scc_vec_impl_new(struct scc_vec_base *base, size_t offset, size_t capacity
     return vec;
 }
 
-void *scc_vec_impl_new_dyn(size_t vecsz, size_t offset, size_t capacity) {
-    struct scc_vec_base *base = calloc(vecsz, sizeof(unsigned char));
+void *scc_vec_impl_new_dyn(size_t vecsz, size_t offset, size_t capacity, struct scc_allocator const *allocator) {
+    struct scc_vec_base *base = scc_allocator_zalloc(allocator, vecsz);
     if (!base) {
         return 0;
     }
 
+    base->sv_allocator = allocator;
     unsigned char *vec = scc_vec_impl_new(base, offset, capacity);
     vec[-1] = 1;
     return vec;
@@ -87,7 +89,8 @@ void *scc_vec_impl_from(void *restrict vec, void const *restrict data, size_t si
     return vec;
 }
 
-void *scc_vec_impl_from_dyn(size_t basecap, size_t offset, void const *data, size_t size, size_t elemsize) {
+void *scc_vec_impl_from_dyn(size_t basecap, size_t offset, void const *data, size_t size, size_t elemsize,
+        struct scc_allocator const *allocator) {
     size_t vecsz = offset + basecap * elemsize;
     if (basecap < size) {
         scc_when_mutating(assert(basecap < size));
@@ -95,7 +98,7 @@ void *scc_vec_impl_from_dyn(size_t basecap, size_t offset, void const *data, siz
         basecap = size;
         assert(vecsz == offset + size * elemsize);
     }
-    unsigned char *vec = scc_vec_impl_new_dyn(vecsz, offset, basecap);
+    unsigned char *vec = scc_vec_impl_new_dyn(vecsz, offset, basecap, allocator);
     if (!vec) {
         return 0;
     }
@@ -178,7 +181,8 @@ bool scc_vec_impl_reserve(void *vec, size_t capacity, size_t elemsize) {
 
 void scc_vec_free(void *vec) {
     if (scc_vec_is_allocd(vec)) {
-        free(scc_vec_impl_base(vec));
+        struct scc_vec_base *base = scc_vec_impl_base(vec);
+        scc_allocator_free(base->sv_allocator, base);
     }
 }
 
@@ -186,7 +190,7 @@ void *scc_vec_impl_clone(void const *vec, size_t elemsize) {
     struct scc_vec_base const *obase = scc_vec_impl_base_qual(vec, const);
     size_t basesz = (unsigned char const *)vec - (unsigned char const *)obase;
     size_t bytesz = basesz + obase->sv_capacity * elemsize;
-    struct scc_vec_base *nbase = malloc(bytesz);
+    struct scc_vec_base *nbase = scc_allocator_alloc(obase->sv_allocator, bytesz);
     if (!nbase) {
         return 0;
     }
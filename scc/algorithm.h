@@ -9,4 +9,6 @@ size_t scc_algo_lower_bound(void const *key, void const *base, size_t nmemb, siz
 
 size_t scc_algo_lower_bound_eq(void const *key, void const *base, size_t nmemb, size_t size, int(*compare)(void const *, void const *));
 
+size_t scc_algo_upper_bound(void const *key, void const *base, size_t nmemb, size_t size, int(*compare)(void const *, void const *));
+
 #endif /* SCC_ALGORITHM_H */
@@ -0,0 +1,66 @@
+#ifndef SCC_ALLOCATOR_H
+#define SCC_ALLOCATOR_H
+
+#include <stddef.h>
+
+/**
+ * Allocator used by a container for obtaining and releasing
+ * dynamic memory.
+ *
+ * The members mirror ``malloc``, ``realloc`` and ``free``, each
+ * receiving \a al_ctx as its first argument. Memory returned by
+ * ``al_alloc`` and ``al_realloc`` must be suitably aligned for any
+ * object type.
+ *
+ * Containers store a pointer to the allocator they were created
+ * with, the instance must therefore outlive every container using
+ * it. A ``NULL`` allocator refers to the standard library functions.
+ */
+struct scc_allocator {
+    void *(*al_alloc)(void *ctx, size_t size);
+    void *(*al_realloc)(void *ctx, void *addr, size_t size);
+    void (*al_free)(void *ctx, void *addr);
+    void *al_ctx;
+};
+
+/**
+ * Allocate \a size bytes using the given \a allocator
+ *
+ * \param allocator The allocator to use, or ``NULL`` for ``malloc``
+ * \param size Number of bytes to allocate
+ *
+ * \return Address of the allocated memory, or ``NULL`` on failure
+ */
+void *scc_allocator_alloc(struct scc_allocator const *allocator, size_t size);
+
+/**
+ * Like ``scc_allocator_alloc`` except that the memory is zeroed
+ *
+ * \param allocator The allocator to use, or ``NULL`` for ``calloc``
+ * \param size Number of bytes to allocate
+ *
+ * \return Address of the allocated memory, or ``NULL`` on failure
+ */
+void *scc_allocator_zalloc(struct scc_allocator const *allocator, size_t size);
+
+/**
+ * Resize memory obtained from the given \a allocator
+ *
+ * \param allocator The allocator \a addr was obtained from
+ * \param addr Address of the memory to resize
+ * \param size The new size, in bytes
+ *
+ * \return Address of the resized memory, or ``NULL`` on failure in
+ *         which case \a addr is left untouched
+ */
+void *scc_allocator_realloc(struct scc_allocator const *allocator, void *addr, size_t size);
+
+/**
+ * Release memory obtained from the given \a allocator
+ *
+ * \param allocator The allocator \a addr was obtained from
+ * \param addr Address of the memory to release
+ */
+void scc_allocator_free(struct scc_allocator const *allocator, void *addr);
+
+#endif /* SCC_ALLOCATOR_H */
@@ -13,6 +13,14 @@
 #define SCC_VECSIZE SCC_SWARVEC_SIZE
 #endif
 
+#ifdef SCC_HWVEC_MAXSIZE
+#define SCC_VECSIZE_MAX SCC_HWVEC_MAXSIZE
+#elif defined SCC_SIMD_ISA
+#error "SCC_HWVEC_MAXSIZE must match the widest vector the SIMD probes may select at runtime"
+#else
+#define SCC_VECSIZE_MAX SCC_VECSIZE
+#endif
+
 #ifdef SCC_SIMD_ISA
 #define scc_arch_select(func)       \
     scc_pp_cat_expand(              \
@@ -34,20 +42,75 @@ struct scc_hashmap_base;
 struct scc_hashtab_base;
 
 extern unsigned long long scc_arch_select(scc_hashmap_impl_probe_insert)(
-    struct scc_hashmap_base const *base,
+    struct scc_hashmap_base *base,
     void const *map,
     size_t keysize,
     unsigned long long hash
 );
 
 extern long long scc_arch_select(scc_hashmap_impl_probe_find)(
-    struct scc_hashmap_base const *base,
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+);
+
+extern void scc_arch_select(scc_hashmap_impl_probe_find_batch)(
+    struct scc_hashmap_base *base,
+    void *map,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+);
+
+extern unsigned long long scc_arch_select(scc_hashmap_impl_probe_insert_scalar)(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+);
+
+extern long long scc_arch_select(scc_hashmap_impl_probe_find_scalar)(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+);
+
+extern void scc_arch_select(scc_hashmap_impl_probe_find_scalar_batch)(
+    struct scc_hashmap_base *base,
+    void *map,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+);
+
+/* Probes writing neither to the metadata nor to hm_curr, used
+ * for maps read by several threads at once */
+extern long long scc_arch_select(scc_hashmap_impl_probe_find_shared)(
+    struct scc_hashmap_base *base,
     void const *map,
+    void const *key,
     size_t keysize,
     unsigned long long hash
 );
 
-extern unsigned long long scc_arch_select(scc_hashtab_impl_probe_insert)(
+extern long long scc_arch_select(scc_hashmap_impl_probe_find_shared_scalar)(
+    struct scc_hashmap_base *base,
+    void const *map,
+    void const *key,
+    size_t keysize,
+    unsigned long long hash
+);
+
+extern long long scc_arch_select(scc_hashmap_impl_next_occupied)(
+    struct scc_hashmap_base const *base,
+    size_t start
+);
+
+extern long long scc_arch_select(scc_hashtab_impl_probe_insert)(
     struct scc_hashtab_base const *base,
     void const *tab,
     size_t elemsize,
@@ -61,8 +124,52 @@ extern long long scc_arch_select(scc_hashtab_impl_probe_find)(
     unsigned long long hash
 );
 
+#ifdef SCC_SIMD_ISA
+/* Portable implementations, used as fallback by the
+ * trampolines and for maps storing full hashes */
+extern unsigned long long scc_hashmap_impl_probe_insert_swar(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+);
+
+extern long long scc_hashmap_impl_probe_find_swar(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+);
+
+extern void scc_hashmap_impl_probe_find_batch_swar(
+    struct scc_hashmap_base *base,
+    void *map,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+);
+
+extern long long scc_hashmap_impl_probe_find_shared_swar(
+    struct scc_hashmap_base *base,
+    void const *map,
+    void const *key,
+    size_t keysize,
+    unsigned long long hash
+);
+
+extern long long scc_hashmap_impl_probe_find_shared_scalar_swar(
+    struct scc_hashmap_base *base,
+    void const *map,
+    void const *key,
+    size_t keysize,
+    unsigned long long hash
+);
+#endif
+
+
 inline unsigned long long scc_hashmap_impl_probe_insert(
-    struct scc_hashmap_base const *base,
+    struct scc_hashmap_base *base,
     void const *map,
     size_t keysize,
     unsigned long long hash
@@ -71,7 +178,7 @@ inline unsigned long long scc_hashmap_impl_probe_insert(
 }
 
 inline long long scc_hashmap_impl_probe_find(
-    struct scc_hashmap_base const *base,
+    struct scc_hashmap_base *base,
     void const *map,
     size_t keysize,
     unsigned long long hash
@@ -79,6 +186,73 @@ inline long long scc_hashmap_impl_probe_find(
     return scc_arch_select(scc_hashmap_impl_probe_find)(base, map, keysize, hash);
 }
 
+inline void scc_hashmap_impl_probe_find_batch(
+    struct scc_hashmap_base *base,
+    void *map,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+) {
+    scc_arch_select(scc_hashmap_impl_probe_find_batch)(base, map, keysize, keys, hashes, n);
+}
+
+inline unsigned long long scc_hashmap_impl_probe_insert_scalar(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+) {
+    return scc_arch_select(scc_hashmap_impl_probe_insert_scalar)(base, map, keysize, hash);
+}
+
+inline long long scc_hashmap_impl_probe_find_scalar(
+    struct scc_hashmap_base *base,
+    void const *map,
+    size_t keysize,
+    unsigned long long hash
+) {
+    return scc_arch_select(scc_hashmap_impl_probe_find_scalar)(base, map, keysize, hash);
+}
+
+inline void scc_hashmap_impl_probe_find_scalar_batch(
+    struct scc_hashmap_base *base,
+    void *map,
+    size_t keysize,
+    void const *keys,
+    unsigned long long *hashes,
+    size_t n
+) {
+    scc_arch_select(scc_hashmap_impl_probe_find_scalar_batch)(base, map, keysize, keys, hashes, n);
+}
+
+inline long long scc_hashmap_impl_probe_find_shared(
+    struct scc_hashmap_base *base,
+    void const *map,
+    void const *key,
+    size_t keysize,
+    unsigned long long hash
+) {
+    return scc_arch_select(scc_hashmap_impl_probe_find_shared)(base, map, key, keysize, hash);
+}
+
+inline long long scc_hashmap_impl_probe_find_shared_scalar(
+    struct scc_hashmap_base *base,
+    void const *map,
+    void const *key,
+    size_t keysize,
+    unsigned long long hash
+) {
+    return scc_arch_select(scc_hashmap_impl_probe_find_shared_scalar)(base, map, key, keysize, hash);
+}
+
+inline long long scc_hashmap_impl_next_occupied(
+    struct scc_hashmap_base const *base,
+    size_t start
+) {
+    return scc_arch_select(scc_hashmap_impl_next_occupied)(base, start);
+}
+
 inline long long scc_hashtab_impl_probe_insert(
     struct scc_hashtab_base const *base,
     void const *tab,
@@ -97,4 +271,33 @@ inline long long scc_hashtab_impl_probe_find(
     return scc_arch_select(scc_hashtab_impl_probe_find)(base, tab, elemsize, hash);
 }
 
+extern size_t scc_arch_select(scc_btkey_impl_lower_bound_i32)(void const *keys, size_t nkeys, void const *key);
+extern size_t scc_arch_select(scc_btkey_impl_lower_bound_i64)(void const *keys, size_t nkeys, void const *key);
+extern size_t scc_arch_select(scc_btkey_impl_lower_bound_f32)(void const *keys, size_t nkeys, void const *key);
+extern size_t scc_arch_select(scc_btkey_impl_lower_bound_f64)(void const *keys, size_t nkeys, void const *key);
+
+#ifdef SCC_SIMD_ISA
+/* Portable node searches, used as fallback by the trampolines */
+extern size_t scc_btkey_impl_lower_bound_i32_swar(void const *keys, size_t nkeys, void const *key);
+extern size_t scc_btkey_impl_lower_bound_i64_swar(void const *keys, size_t nkeys, void const *key);
+extern size_t scc_btkey_impl_lower_bound_f32_swar(void const *keys, size_t nkeys, void const *key);
+extern size_t scc_btkey_impl_lower_bound_f64_swar(void const *keys, size_t nkeys, void const *key);
+#endif
+
+inline size_t scc_btkey_impl_lower_bound_i32(void const *keys, size_t nkeys, void const *key) {
+    return scc_arch_select(scc_btkey_impl_lower_bound_i32)(keys, nkeys, key);
+}
+
+inline size_t scc_btkey_impl_lower_bound_i64(void const *keys, size_t nkeys, void const *key) {
+    return scc_arch_select(scc_btkey_impl_lower_bound_i64)(keys, nkeys, key);
+}
+
+inline size_t scc_btkey_impl_lower_bound_f32(void const *keys, size_t nkeys, void const *key) {
+    return scc_arch_select(scc_btkey_impl_lower_bound_f32)(keys, nkeys, key);
+}
+
+inline size_t scc_btkey_impl_lower_bound_f64(void const *keys, size_t nkeys, void const *key) {
+    return scc_arch_select(scc_btkey_impl_lower_bound_f64)(keys, nkeys, key);
+}
+
 #endif /* SCC_ARCH_H */
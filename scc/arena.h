@@ -1,6 +1,7 @@
 #ifndef SCC_ARENA_H
 #define SCC_ARENA_H
 
+#include "allocator.h"
 #include "bug.h"
 #include "mem.h"
 
@@ -14,29 +15,63 @@
 #error Chunksize must be greater than 0
 #endif
 
+/* Chunks allocated on demand double in size, starting at
+ * SCC_ARENA_CHUNKSIZE elements, until reaching this many */
+#ifndef SCC_ARENA_MAX_CHUNKSIZE
+#define SCC_ARENA_MAX_CHUNKSIZE (SCC_ARENA_CHUNKSIZE << 8u)
+#endif
+
+#if SCC_ARENA_MAX_CHUNKSIZE < SCC_ARENA_CHUNKSIZE
+#error Max chunksize must not be less than chunksize
+#endif
+
+/* Chunks are aligned on a power-of-2 segment size chosen such that a
+ * chunk of ar_chunksize elements fits in a single segment, provided that
+ * the chunk takes no more than a page. Larger chunks are split into
+ * segments of at least a page holding at least 16 elements each. The chunk
+ * owning an element is found by masking off the low bits of its address.
+ * Chunks spanning several segments repeat the back-pointer and leave
+ * ar_baseoff bytes unused at the start of each segment. Aligning costs up
+ * to one segment per chunk, allocated in excess when using an allocator. */
 struct scc_arena {
     struct scc_chunk *ar_first;     /* First chunk */
     struct scc_chunk *ar_current;   /* Current (last) chunk */
+    struct scc_chunk *ar_avail;     /* Chunks with freed slots available for reuse */
+    struct scc_allocator const *ar_allocator; /* Allocator for chunks, NULL for malloc */
+    size_t ar_nchunks;              /* Number of chunks in arena */
     unsigned short ar_baseoff;      /* Buffer offset in chunk */
-    unsigned short ar_elemsize;     /* Size of element in chunk buffer */
-    unsigned short ar_chunksize;    /* Number of elements in each chunk */
+    unsigned short ar_elemsize;     /* Size of element slot in chunk buffer, at least sizeof(void *) */
+    unsigned short ar_chunksize;    /* Number of elements in the first chunk */
+    unsigned char ar_segshift;      /* Log2 of the segment size, 0 until the first chunk is allocated */
 };
 
 struct scc_chunk {
+    struct scc_chunk *ch_owner;     /* Chunk owning the segment, repeated at the start of each segment */
     unsigned ch_refcount;           /* Number of non-freed elements in this chunk */
-    unsigned ch_offset;             /* Offset of next element relative address of chunk */
-    unsigned ch_end;                /* Offset of last element relative address of chunk */
+    size_t ch_offset;               /* Offset of last handed out element relative address of chunk, 0 if none */
+    size_t ch_end;                  /* Offset of last element relative address of chunk */
+    void *ch_free;                  /* Intrusive list of freed elements */
     struct scc_chunk *ch_next;      /* Next chunk */
+    struct scc_chunk *ch_prev;      /* Previous chunk */
+    struct scc_chunk *ch_nextavail; /* Next chunk with freed elements */
+    struct scc_chunk *ch_prevavail; /* Previous chunk with freed elements */
+    void *ch_mem;                   /* Address returned by the allocator */
     unsigned char ch_buffer[];
 };
 
 #define scc_chunk_impl_layout(type)                                 \
     struct {                                                        \
         struct {                                                    \
+            struct scc_chunk *ch_owner;                             \
             unsigned ch_refcount;                                   \
-            unsigned ch_offset;                                     \
-            unsigned ch_end;                                        \
+            size_t ch_offset;                                       \
+            size_t ch_end;                                          \
+            void *ch_free;                                          \
             struct scc_chunk *ch_next;                              \
+            struct scc_chunk *ch_prev;                              \
+            struct scc_chunk *ch_nextavail;                         \
+            struct scc_chunk *ch_prevavail;                         \
+            void *ch_mem;                                           \
         } ar0;                                                      \
         type ch_buffer[];                                           \
     }
@@ -44,18 +79,32 @@ struct scc_chunk {
 #define scc_arena_impl_baseoff(type)                                \
     sizeof(scc_chunk_impl_layout(type))
 
+/* Slots are large enough to link freed elements into a list */
+#define scc_arena_impl_slotsize(type)                               \
+    (sizeof(type) < sizeof(void *) ? sizeof(void *) : sizeof(type))
+
 #define scc_arena_new(type)                                         \
     (struct scc_arena) {                                            \
         .ar_baseoff = scc_arena_impl_baseoff(type),                 \
-        .ar_elemsize = sizeof(type),                                \
+        .ar_elemsize = scc_arena_impl_slotsize(type),               \
+        .ar_chunksize = SCC_ARENA_CHUNKSIZE                         \
+    }
+
+#define scc_arena_with_allocator(type, allocator)                   \
+    (struct scc_arena) {                                            \
+        .ar_allocator = (allocator),                                \
+        .ar_baseoff = scc_arena_impl_baseoff(type),                 \
+        .ar_elemsize = scc_arena_impl_slotsize(type),               \
         .ar_chunksize = SCC_ARENA_CHUNKSIZE                         \
     }
 
 #define scc_arena_clone(arena)                                      \
     (struct scc_arena) {                                            \
+        .ar_allocator = (arena)->ar_allocator,                      \
         .ar_baseoff = (arena)->ar_baseoff,                          \
         .ar_elemsize = (arena)->ar_elemsize,                        \
-        .ar_chunksize = (arena)->ar_chunksize                       \
+        .ar_chunksize = (arena)->ar_chunksize,                      \
+        .ar_segshift = (arena)->ar_segshift                         \
     }
 
 void scc_arena_release(struct scc_arena *arena);
@@ -73,17 +122,35 @@ void scc_arena_release(struct scc_arena *arena);
         iter;                                                       \
         tortoise = iter, iter = iter->ch_next)
 
+/* Elements freed from the arena are reused by subsequent allocations */
 void *scc_arena_alloc(struct scc_arena *arena);
+/* Ensure that nelems elements may be allocated without failing. Chunks
+ * allocated to satisfy the request hold exactly nelems elements, unless
+ * that is fewer than the next chunk would have held */
 _Bool scc_arena_reserve(struct scc_arena *arena, size_t nelems);
 
+/* Number of chunks currently allocated, useful for
+ * monitoring fragmentation */
+inline size_t scc_arena_nchunks(struct scc_arena const *arena) {
+    return arena->ar_nchunks;
+}
+
+/* Free the element at addr, returning false if addr does not refer to an
+ * element handed out by the arena. The chunks are searched for addr before
+ * touching any memory, making the call linear in the number of chunks */
 _Bool scc_arena_try_free(struct scc_arena *restrict arena, void const *restrict addr);
 
 inline void scc_arena_reset(struct scc_arena *arena) {
     scc_arena_release(arena);
     arena->ar_first = 0;
     arena->ar_current = 0;
+    arena->ar_avail = 0;
+    arena->ar_nchunks = 0u;
 }
 
+/* Free the element at addr, which must have been handed out by the arena.
+ * The owning chunk is found in constant time by masking addr down to its
+ * segment, passing any other address is undefined */
 void scc_arena_free(struct scc_arena *restrict arena, void const *restrict addr);
 
 #endif /* SCC_ARENA_H */
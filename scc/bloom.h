@@ -1,6 +1,7 @@
 #ifndef SCC_BLOOM_H
 #define SCC_BLOOM_H
 
+#include <scc/allocator.h>
 #include <scc/config.h>
 #include <scc/hash.h>
 #include <scc/mem.h>
@@ -41,6 +42,7 @@ struct scc_bloom_base {
     scc_bloom_hash bm_hash;
     unsigned bm_nbits;
     unsigned bm_nhashes;
+    struct scc_allocator const *bm_allocator;
     unsigned char bm_tail[];
 };
 
@@ -50,6 +52,7 @@ struct scc_bloom_base {
             scc_bloom_hash bm_hash;                                     \
             unsigned bm_nbits;                                          \
             unsigned bm_nhashes;                                        \
+            struct scc_allocator const *bm_allocator;                   \
             unsigned char bm_npad;                                      \
             unsigned char bm_dynalloc;                                  \
         } bm_base;                                                      \
@@ -64,6 +67,7 @@ struct scc_bloom_base {
                 scc_bloom_hash bm_hash;                                 \
                 unsigned bm_nbits;                                      \
                 unsigned bm_nhashes;                                    \
+                struct scc_allocator const *bm_allocator;               \
                 unsigned char bm_npad;                                  \
                 unsigned char bm_dynalloc;                              \
             } bm_base;                                                  \
@@ -160,11 +164,12 @@ void *scc_bloom_impl_with_hash(struct scc_bloom_base *base, size_t offset,
         sizeof(scc_bloom_impl_layout(type, m)),                         \
         scc_bloom_impl_offset(type),                                    \
         (m),                                                            \
-        (k)                                                             \
+        (k),                                                            \
+        0                                                               \
     )
 
 void *scc_bloom_impl_new_dyn(size_t size, size_t offset, unsigned m,
-        unsigned k);
+        unsigned k, struct scc_allocator const *allocator);
 
 /**
  * Like @verbatim embed:rst:inline :ref:scc_bloom_new_dyn <scc_bloom_new_dyn>` @endverbatim
@@ -184,11 +189,56 @@ void *scc_bloom_impl_new_dyn(size_t size, size_t offset, unsigned m,
         scc_bloom_impl_offset(type),                                    \
         (m),                                                            \
         (k),                                                            \
-        (hash)                                                          \
+        (hash),                                                         \
+        0                                                               \
     )
 
 void *scc_bloom_impl_with_hash_dyn(size_t size, size_t offset, unsigned m,
-        unsigned k, scc_bloom_hash hash);
+        unsigned k, scc_bloom_hash hash, struct scc_allocator const *allocator);
+
+/**
+ * Like @verbatim embed:rst:inline :ref:`scc_bloom_new_dyn <scc_bloom_new_dyn>` @endverbatim
+ * except that the filter is allocated using the given \a allocator.
+ *
+ * \param type The type of the instances to be tracked in the filter.
+ * \param m Size of the filter, in bits. Must be an integer constant expression.
+ * \param k Number of hash functions to use
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the filter.
+ *
+ * \return A handle to an instantiated filter, or ``NULL`` on failure.
+ */
+#define scc_bloom_new_in(type, m, k, allocator)                         \
+    (type *)scc_bloom_impl_new_dyn(                                     \
+        sizeof(scc_bloom_impl_layout(type, m)),                         \
+        scc_bloom_impl_offset(type),                                    \
+        (m),                                                            \
+        (k),                                                            \
+        (allocator)                                                     \
+    )
+
+/**
+ * Like @verbatim embed:rst:inline :ref:`scc_bloom_with_hash_dyn <scc_bloom_with_hash_dyn>` @endverbatim
+ * except that the filter is allocated using the given \a allocator.
+ *
+ * \param type The type of the instances to be tracked in the filter.
+ * \param m Size of the filter, in bits. Must be an integer constant expression.
+ * \param k Number of hash functions to use.
+ * \param hash Pointer to hash function to use. Should be compatible with the
+ *        the @verbatim embed:rst:inline :ref:`scc_bloom_hash <scc_bloom_hash>` @endverbatim
+ *        typedef.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the filter.
+ *
+ * \return A handle to an instantiated filter, or ``NULL`` on failure.
+ */
+#define scc_bloom_with_hash_in(type, m, k, hash, allocator)             \
+    (type *)scc_bloom_impl_with_hash_dyn(                               \
+        sizeof(scc_bloom_impl_layout(type, m)),                         \
+        scc_bloom_impl_offset(type),                                    \
+        (m),                                                            \
+        (k),                                                            \
+        (hash),                                                         \
+        (allocator)                                                     \
+    )
 
 inline size_t scc_bloom_impl_npad(void const *flt) {
     return ((unsigned char const *)flt)[-2] + (sizeof(unsigned char) << 1u);
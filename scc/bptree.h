@@ -0,0 +1,579 @@
+#ifndef SCC_BPTREE_H
+#define SCC_BPTREE_H
+
+#include "arena.h"
+#include "mem.h"
+#include "pp_token.h"
+
+#include <stddef.h>
+
+/**
+ * Expands to a type suitable for storing a handle to a B+ tree
+ * containing the specified type.
+ *
+ * \param type The type to store in the ``bptree``.
+ */
+#define scc_bptree(type) type *
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_bptree_iter:
+ * \endverbatim
+ *
+ * Expands to a type suitable for iterating a ``bptree`` containing
+ * instances of \a type.
+ *
+ * \param type The type stored in the ``bptree``
+ */
+#define scc_bptree_iter(type) type const *
+
+/**
+ * Signature of the function used for comparing keys in a ``bptree``.
+ *
+ * <table>
+ *  <caption id="bpcmp_rv">Return value</caption>
+ *  <tr><th>Condition <th>Value
+ *  <tr><td>left < right<td> < 0
+ *  <tr><td>left == right<td> 0
+ *  <tr><td>left > right<td> > 0
+ * </table>
+ */
+typedef int(*scc_bpcompare)(void const *, void const *);
+
+#ifndef SCC_BPTREE_DEFAULT_ORDER
+/**
+ * Default order of ``bptree`` instances.
+ *
+ * The value may be overridden by defining it before including
+ * the header. Instances of a specific order may be instantiated
+ * using ``scc_bptree_with_order``.
+ *
+ * Both internal nodes and leaves hold at most ``order - 1`` elements.
+ *
+ * \warning Must be greater than 2.
+ */
+#define SCC_BPTREE_DEFAULT_ORDER 16u
+#endif /* SCC_BPTREE_DEFAULT_ORDER */
+
+#if SCC_BPTREE_DEFAULT_ORDER <= 2
+#error Order must be at least 3
+#endif
+
+struct scc_bpnode_base {
+    unsigned char bp_flags;
+    unsigned short bp_nkeys;
+    unsigned char bp_data[];
+};
+
+struct scc_bptree_base {
+    unsigned short const bp_order;
+    unsigned short const bp_dataoff;
+    unsigned short const bp_linkoff;
+    size_t bp_size;
+    struct scc_bpnode_base *bp_root;
+    scc_bpcompare bp_compare;
+    struct scc_arena bp_arena;
+    unsigned char bp_dynalloc;
+    unsigned char bp_fwoff;
+    unsigned char bp_data[];
+};
+
+/* Internal nodes use all order links for children, leaves use
+ * the first two for the next and previous leaf, respectively */
+#define scc_bpnode_impl_layout(type, order)                                                     \
+    struct {                                                                                    \
+        struct {                                                                                \
+            struct {                                                                            \
+                unsigned char bp_flags;                                                         \
+                unsigned short bp_nkeys;                                                        \
+            } bpn0;                                                                             \
+            type bp_data[(order) - 1u];                                                         \
+        } bpn1;                                                                                 \
+        struct scc_bpnode_base *bp_links[order];                                                \
+    }
+
+#define scc_bpnode_impl_dataoff(type)                                                           \
+    sizeof(                                                                                     \
+        struct {                                                                                \
+            struct {                                                                            \
+                unsigned char bp_flags;                                                         \
+                unsigned short bp_nkeys;                                                        \
+            } bpn0;                                                                             \
+            type bp_data[];                                                                     \
+        }                                                                                       \
+    )
+
+#define scc_bpnode_impl_linkoff(type, order)                                                    \
+    sizeof(                                                                                     \
+        struct {                                                                                \
+            struct {                                                                            \
+                struct {                                                                        \
+                    unsigned char bp_flags;                                                     \
+                    unsigned short bp_nkeys;                                                    \
+                } bpn0;                                                                         \
+                type bp_data[(order) - 1u];                                                     \
+            } bpn1;                                                                             \
+            struct scc_bpnode_base *bp_links[];                                                 \
+        }                                                                                       \
+    )
+
+#define scc_bptree_impl_layout(type, order)                                                         \
+    struct {                                                                                        \
+        struct {                                                                                    \
+            struct {                                                                                \
+                unsigned short const bp_order;                                                      \
+                unsigned short const bp_dataoff;                                                    \
+                unsigned short const bp_linkoff;                                                    \
+                size_t bp_size;                                                                     \
+                struct scc_bpnode_base *bp_root;                                                    \
+                scc_bpcompare bp_compare;                                                           \
+                struct scc_arena bp_arena;                                                          \
+                unsigned char bp_dynalloc;                                                          \
+                unsigned char bp_fwoff;                                                             \
+                unsigned char bp_bkoff;                                                             \
+            } bp0;                                                                                  \
+            type bp_curr;                                                                           \
+        } bp1;                                                                                      \
+        scc_bpnode_impl_layout(type, order) bp_rootmem;                                             \
+    }
+
+#define scc_bptree_impl_curroff(type)                                                               \
+    sizeof(                                                                                         \
+        struct {                                                                                    \
+            struct {                                                                                \
+                unsigned short const bp_order;                                                      \
+                unsigned short const bp_dataoff;                                                    \
+                unsigned short const bp_linkoff;                                                    \
+                size_t bp_size;                                                                     \
+                struct scc_bpnode_base *bp_root;                                                    \
+                scc_bpcompare bp_compare;                                                           \
+                struct scc_arena bp_arena;                                                          \
+                unsigned char bp_dynalloc;                                                          \
+                unsigned char bp_fwoff;                                                             \
+                unsigned char bp_bkoff;                                                             \
+            } bp0;                                                                                  \
+            type bp_curr[];                                                                         \
+        }                                                                                           \
+    )
+
+#define scc_bptree_impl_rootoff(type, order)                                                        \
+    sizeof(                                                                                         \
+        struct {                                                                                    \
+            struct {                                                                                \
+                struct {                                                                            \
+                    unsigned short const bp_order;                                                  \
+                    unsigned short const bp_dataoff;                                                \
+                    unsigned short const bp_linkoff;                                                \
+                    size_t bp_size;                                                                 \
+                    struct scc_bpnode_base *bp_root;                                                \
+                    scc_bpcompare bp_compare;                                                       \
+                    struct scc_arena bp_arena;                                                      \
+                    unsigned char bp_dynalloc;                                                      \
+                    unsigned char bp_fwoff;                                                         \
+                    unsigned char bp_bkoff;                                                         \
+                } bp0;                                                                              \
+                type bp_curr;                                                                       \
+            } bp1;                                                                                  \
+            scc_bpnode_impl_layout(type, order) bp_rootmem[];                                       \
+        }                                                                                           \
+    )
+
+#define scc_bptree_impl_initvals(type, compare, order, arena)                                       \
+    {                                                                                               \
+        .bp1 = {                                                                                    \
+            .bp0 = {                                                                                \
+                .bp_order = (order),                                                                \
+                .bp_dataoff = scc_bpnode_impl_dataoff(type),                                        \
+                .bp_linkoff = scc_bpnode_impl_linkoff(type, order),                                 \
+                .bp_arena = arena,                                                                  \
+                .bp_compare = (compare)                                                             \
+            },                                                                                      \
+        },                                                                                          \
+    }
+
+void *scc_bptree_impl_new(void *base, size_t coff, size_t rootoff);
+
+void *scc_bptree_impl_new_dyn(void *sbase, size_t basesz, size_t coff, size_t rootoff);
+
+inline void *scc_bptree_impl_with_order(void *base, size_t coff, size_t rootoff) {
+    unsigned order = ((struct scc_bptree_base *)base)->bp_order;
+    if (order < 3u) {
+        return 0;
+    }
+    return scc_bptree_impl_new(base, coff, rootoff);
+}
+
+inline void *scc_bptree_impl_with_order_dyn(void *sbase, size_t basesz, size_t coff, size_t rootoff) {
+    unsigned order = ((struct scc_bptree_base *)sbase)->bp_order;
+    if (order < 3u) {
+        return 0;
+    }
+    return scc_bptree_impl_new_dyn(sbase, basesz, coff, rootoff);
+}
+
+/**
+ * Instantiate a ``bptree`` of \a order storing instances of \a type.
+ *
+ * The tree is constructed in the frame of the calling function.
+ *
+ * \param type      The type of the values to be stored in the ``bptree``.
+ * \param compare   Pointer to the comparison function to use. The signature should match ``scc_bpcompare``.
+ * \param order     The desired order of the ``bptree``. Must be at least 3.
+ *
+ * \return          An opaque pointer to a ``bptree``, or ``NULL`` if the order is invalid.
+ */
+#define scc_bptree_with_order(type, compare, order)                                                 \
+    scc_bptree_impl_with_order(                                                                     \
+        &(scc_bptree_impl_layout(type, order))                                                      \
+            scc_bptree_impl_initvals(                                                               \
+                type, compare, order, scc_arena_new(scc_bpnode_impl_layout(type, order))            \
+            ),                                                                                      \
+        scc_bptree_impl_curroff(type),                                                              \
+        scc_bptree_impl_rootoff(type, order)                                                        \
+    )
+
+/**
+ * Instantiate a ``bptree`` storing instances of \a type.
+ *
+ * The tree uses the provided \a compare function and is created in the frame of
+ * the calling function. The call is equivalent to invoking ``scc_bptree_with_order``,
+ * passing ``SCC_BPTREE_DEFAULT_ORDER`` as the order parameter.
+ *
+ * The call cannot fail.
+ *
+ * \param type    The type to be stored in the ``bptree``.
+ * \param compare Pointer to a function used to compare entries. The signature should match
+ *  ``scc_bpcompare``.
+ *
+ * \return An opaque pointer to a ``bptree`` allocated in the frame of the calling function.
+ */
+#define scc_bptree_new(type, compare)                                                               \
+    (type *)scc_bptree_impl_new(                                                                    \
+        &(scc_bptree_impl_layout(type, SCC_BPTREE_DEFAULT_ORDER))                                   \
+            scc_bptree_impl_initvals(                                                               \
+                type, compare, SCC_BPTREE_DEFAULT_ORDER,                                            \
+                scc_arena_new(scc_bpnode_impl_layout(type, SCC_BPTREE_DEFAULT_ORDER))               \
+            ),                                                                                      \
+        scc_bptree_impl_curroff(type),                                                              \
+        scc_bptree_impl_rootoff(type, SCC_BPTREE_DEFAULT_ORDER)                                     \
+    )
+
+/**
+ * Instantiate a dynamically allocated ``bptree`` with the provided \a order.
+ *
+ * Effectively equivalent to ``scc_bptree_with_order`` in every way except that the constructed
+ * tree is placed on the heap.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type    The type of the values to be stored in the tree.
+ * \param compare Pointer to a comparison function, the signature of which should match
+ *  ``scc_bpcompare``.
+ * \param order   The order of the tree. Must be at least 3.
+ *
+ * \return An opaque pointer to a ``bptree`` allocated on the heap, or ``NULL`` on failure.
+ */
+#define scc_bptree_with_order_dyn(type, compare, order)                                             \
+    scc_bptree_impl_with_order_dyn(                                                                 \
+        &(scc_bptree_impl_layout(type, order))                                                      \
+            scc_bptree_impl_initvals(                                                               \
+                type, compare, order, scc_arena_new(scc_bpnode_impl_layout(type, order))            \
+            ),                                                                                      \
+        sizeof(scc_bptree_impl_layout(type, order)),                                                \
+        scc_bptree_impl_curroff(type),                                                              \
+        scc_bptree_impl_rootoff(type, order)                                                        \
+    )
+
+/**
+ * Instantiate a ``bptree`` with default order and place it on the heap.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type    The type to be stored in the tree
+ * \param compare Pointer to a comparison function, the signature of which should match
+ *  ``scc_bpcompare``.
+ *
+ * \return An opaque pointer to a ``bptree`` allocated on the heap, or ``NULL`` on failure.
+ */
+#define scc_bptree_new_dyn(type, compare)                                                           \
+    (type *)scc_bptree_impl_new_dyn(                                                                \
+        &(scc_bptree_impl_layout(type, SCC_BPTREE_DEFAULT_ORDER))                                   \
+            scc_bptree_impl_initvals(                                                               \
+                type, compare, SCC_BPTREE_DEFAULT_ORDER,                                            \
+                scc_arena_new(scc_bpnode_impl_layout(type, SCC_BPTREE_DEFAULT_ORDER))               \
+            ),                                                                                      \
+        sizeof(scc_bptree_impl_layout(type, SCC_BPTREE_DEFAULT_ORDER)),                             \
+        scc_bptree_impl_curroff(type),                                                              \
+        scc_bptree_impl_rootoff(type, SCC_BPTREE_DEFAULT_ORDER)                                     \
+    )
+
+/**
+ * Like ``scc_bptree_with_order_dyn`` except that the tree and all of its nodes
+ * are allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type      The type of the values to be stored in the tree.
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *  ``scc_bpcompare``.
+ * \param order     The order of the tree. Must be at least 3.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the tree.
+ *
+ * \return An opaque pointer to a ``bptree``, or ``NULL`` on failure.
+ */
+#define scc_bptree_with_order_in(type, compare, order, allocator)                                   \
+    scc_bptree_impl_with_order_dyn(                                                                 \
+        &(scc_bptree_impl_layout(type, order))                                                      \
+            scc_bptree_impl_initvals(                                                               \
+                type, compare, order,                                                               \
+                scc_arena_with_allocator(scc_bpnode_impl_layout(type, order), allocator)            \
+            ),                                                                                      \
+        sizeof(scc_bptree_impl_layout(type, order)),                                                \
+        scc_bptree_impl_curroff(type),                                                              \
+        scc_bptree_impl_rootoff(type, order)                                                        \
+    )
+
+/**
+ * Like ``scc_bptree_new_dyn`` except that the tree and all of its nodes are
+ * allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type      The type to be stored in the tree
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *  ``scc_bpcompare``.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the tree.
+ *
+ * \return An opaque pointer to a ``bptree``, or ``NULL`` on failure.
+ */
+#define scc_bptree_new_in(type, compare, allocator)                                                 \
+    (type *)scc_bptree_impl_new_dyn(                                                                \
+        &(scc_bptree_impl_layout(type, SCC_BPTREE_DEFAULT_ORDER))                                   \
+            scc_bptree_impl_initvals(                                                               \
+                type, compare, SCC_BPTREE_DEFAULT_ORDER,                                            \
+                scc_arena_with_allocator(                                                           \
+                    scc_bpnode_impl_layout(type, SCC_BPTREE_DEFAULT_ORDER),                         \
+                    allocator                                                                       \
+                )                                                                                   \
+            ),                                                                                      \
+        sizeof(scc_bptree_impl_layout(type, SCC_BPTREE_DEFAULT_ORDER)),                             \
+        scc_bptree_impl_curroff(type),                                                              \
+        scc_bptree_impl_rootoff(type, SCC_BPTREE_DEFAULT_ORDER)                                     \
+    )
+
+inline size_t scc_bptree_impl_npad(void const *bptree) {
+    return ((unsigned char const *)bptree)[-1] + sizeof(unsigned char);
+}
+
+#define scc_bptree_impl_base_qual(bptree, qual)                                                     \
+    scc_container_qual(                                                                             \
+        (unsigned char qual *)(bptree) - scc_bptree_impl_npad(bptree),                              \
+        struct scc_bptree_base,                                                                     \
+        bp_fwoff,                                                                                   \
+        qual                                                                                        \
+    )
+
+#define scc_bptree_impl_base(bptree)                                                                \
+    scc_bptree_impl_base_qual(bptree,)
+
+/**
+ * Reclaim memory allocated for the ``bptree``.
+ *
+ * \param bptree Handle identifying the ``bptree`` to free
+ */
+void scc_bptree_free(void *bptree);
+
+/**
+ * Return the order of the given ``bptree``
+ *
+ * \param bptree Handle identifying the ``bptree``
+ *
+ * \return The order of the \a bptree
+ */
+inline size_t scc_bptree_order(void const *bptree) {
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    return base->bp_order;
+}
+
+/**
+ * Query the size of the given ``bptree``
+ *
+ * \param bptree Handle identifying the ``bptree``
+ *
+ * \return Number of elements in the \a bptree
+ */
+inline size_t scc_bptree_size(void const *bptree) {
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    return base->bp_size;
+}
+
+_Bool scc_bptree_impl_insert(void *bptreeaddr, size_t elemsize);
+
+/**
+ * Insert the given value into the specified ``bptree``.
+ *
+ * The ``value`` parameter must not necessarily be the same type as the one
+ * with which the ``bptree`` was intantiated. If it is not, it is implicitly converted
+ * to the value type of the ``bptree``.
+ *
+ * \note The \a bptreeaddr parameter should be the \b address of the handle used to refer to
+ *       the ``bptree``, \b not the handle itself.
+ *
+ * \param bptreeaddr Address of the handle used to refer to the ``bptree``
+ * \param value The value to insert
+ *
+ * \return ``true`` if the value was inserted, ``false`` on failure
+ */
+#define scc_bptree_insert(bptreeaddr, value)                                                        \
+    scc_bptree_impl_insert((**(bptreeaddr) = (value), bptreeaddr), sizeof(**(bptreeaddr)))
+
+void const *scc_bptree_impl_find(void const *bptree, size_t elemsize);
+
+/**
+ * Search for and, if found, return a pointer to, an element matching the given value.
+ *
+ * \note The ``bptree`` may contain duplicates. The first one in order is returned.
+ *
+ * \param bptree Handle referring to the ``bptree``  instance
+ * \param value The value to search for
+ *
+ * \return A pointer to the found element, or ``NULL`` if none is found.
+ */
+#define scc_bptree_find(bptree, value)                                                              \
+    scc_bptree_impl_find((*(bptree) = (value), (bptree)), sizeof(*(bptree)))
+
+_Bool scc_bptree_impl_remove(void *bptree, size_t elemsize);
+
+/**
+ * Find and remove the specified value in, and from, the given ``bptree``.
+ *
+ * Should the ``bptree`` contain several copies of the value in question, only one
+ * instance is removed.
+ *
+ * \param bptree Handle referring to the ``bptree`` in question
+ * \param value The value to remove
+ *
+ * \return ``true`` if a value was removed, ``false`` if no such value was found
+ */
+#define scc_bptree_remove(bptree, value)                                                            \
+    scc_bptree_impl_remove(((*(bptree) = (value)), (bptree)), sizeof(*(bptree)))
+
+void *scc_bptree_impl_clone(void const *bptree, size_t elemsize);
+
+/**
+ * Clone the given ``bptree``.
+ *
+ * The returned copy is allocated on the heap and contains the same elements as the
+ * provided mould.
+ *
+ * \param bptree Handle identifying the ``bptree`` to clone
+ *
+ * \return An opaque handle referring to a new ``bptree``, allocated on the heap. Or ``NULL``
+ *         on failure
+ */
+#define scc_bptree_clone(bptree)                                                                    \
+    scc_bptree_impl_clone(bptree, sizeof(*(bptree)))
+
+void const *scc_bptree_impl_leftmost(void const *bptree, void const **leaf);
+
+void const *scc_bptree_impl_rightmost(void const *bptree, void const **leaf, size_t elemsize);
+
+void const *scc_bptree_impl_lower_bound(void const *bptree, void const **leaf, size_t elemsize);
+
+void const *scc_bptree_impl_range_begin(void const *bptree, void const **leaf, void const *end, size_t elemsize);
+
+void const *scc_bptree_impl_successor(void const *bptree, void const **leaf, void const *iter, size_t elemsize);
+
+void const *scc_bptree_impl_predecessor(void const *bptree, void const **leaf, void const *iter, size_t elemsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_bptree_foreach:
+ * \endverbatim
+ *
+ * Iterate over the elements in the ``bptree`` in ascending order.
+ *
+ * The elements are stored in the leaves only, all of which are linked together.
+ * Advancing the iterator is therefore a matter of moving to the next element
+ * in the leaf, or following a single link to the next leaf.
+ *
+ * The macro expands to a scope executed with \a iter - an instance whose type is
+ * created using @verbatim embed:rst:inline :ref:`scc_bptree_iter <scc_bptree_iter>` @endverbatim -
+ * pointing to each of the elements in turn.
+ *
+ * \note The ``bptree`` must not be modified during iteration.
+ *
+ * \param iter An instance of a type generated using
+ *              @verbatim embed:rst:inline :ref:`scc_bptree_iter <scc_bptree_iter>` @endverbatim.
+ *              Used as iteration variable
+ * \param bptree Handle identifying the ``bptree`` to iterate over
+ */
+#define scc_bptree_foreach(iter, bptree)                                                            \
+    for (void const *scc_pp_cat_expand(scc_bptree_leaf_,__LINE__) = 0,                              \
+            *scc_pp_cat_expand(scc_bptree_curr_,__LINE__) = scc_bptree_impl_leftmost(               \
+                bptree, &scc_pp_cat_expand(scc_bptree_leaf_,__LINE__)                               \
+            );                                                                                      \
+        (iter = scc_pp_cat_expand(scc_bptree_curr_,__LINE__)) != 0;                                 \
+        scc_pp_cat_expand(scc_bptree_curr_,__LINE__) = scc_bptree_impl_successor(                   \
+            bptree, &scc_pp_cat_expand(scc_bptree_leaf_,__LINE__), iter, sizeof(*(bptree))          \
+        ))
+
+/**
+ * Like @verbatim embed:rst:inline :ref:`scc_bptree_foreach <scc_bptree_foreach>` @endverbatim
+ * except that the elements are traversed in descending order.
+ *
+ * \param iter An instance of a type generated using
+ *              @verbatim embed:rst:inline :ref:`scc_bptree_iter <scc_bptree_iter>` @endverbatim.
+ *              Used as iteration variable
+ * \param bptree Handle identifying the ``bptree`` to iterate over
+ */
+#define scc_bptree_foreach_reversed(iter, bptree)                                                   \
+    for (void const *scc_pp_cat_expand(scc_bptree_leaf_,__LINE__) = 0,                              \
+            *scc_pp_cat_expand(scc_bptree_curr_,__LINE__) = scc_bptree_impl_rightmost(              \
+                bptree, &scc_pp_cat_expand(scc_bptree_leaf_,__LINE__), sizeof(*(bptree))            \
+            );                                                                                      \
+        (iter = scc_pp_cat_expand(scc_bptree_curr_,__LINE__)) != 0;                                 \
+        scc_pp_cat_expand(scc_bptree_curr_,__LINE__) = scc_bptree_impl_predecessor(                 \
+            bptree, &scc_pp_cat_expand(scc_bptree_leaf_,__LINE__), iter, sizeof(*(bptree))          \
+        ))
+
+/**
+ * Iterate over all elements \c e in the ``bptree`` for which
+ * \a low <= \c e < \a high, in ascending order.
+ *
+ * Locating the first element requires a single descent of the tree,
+ * the remaining ones are reached by walking the leaves.
+ *
+ * \note The ``bptree`` must not be modified during iteration.
+ *
+ * \param iter An instance of a type generated using
+ *              @verbatim embed:rst:inline :ref:`scc_bptree_iter <scc_bptree_iter>` @endverbatim.
+ *              Used as iteration variable
+ * \param bptree Handle identifying the ``bptree`` to iterate over
+ * \param low Lower, inclusive, bound of the range
+ * \param high Upper, exclusive, bound of the range
+ */
+#define scc_bptree_foreach_range(iter, bptree, low, high)                                           \
+    for (void const *scc_pp_cat_expand(scc_bptree_leaf_,__LINE__) = 0,                              \
+            *scc_pp_cat_expand(scc_bptree_end_,__LINE__) = (                                        \
+                *(bptree) = (high),                                                                 \
+                scc_bptree_impl_lower_bound(                                                        \
+                    bptree, &scc_pp_cat_expand(scc_bptree_leaf_,__LINE__), sizeof(*(bptree))        \
+                )                                                                                   \
+            ),                                                                                      \
+            *scc_pp_cat_expand(scc_bptree_curr_,__LINE__) = (                                       \
+                *(bptree) = (low),                                                                  \
+                scc_bptree_impl_range_begin(                                                        \
+                    bptree,                                                                         \
+                    &scc_pp_cat_expand(scc_bptree_leaf_,__LINE__),                                  \
+                    scc_pp_cat_expand(scc_bptree_end_,__LINE__),                                    \
+                    sizeof(*(bptree))                                                               \
+                )                                                                                   \
+            );                                                                                      \
+        (iter = scc_pp_cat_expand(scc_bptree_curr_,__LINE__)) !=                                    \
+            scc_pp_cat_expand(scc_bptree_end_,__LINE__);                                            \
+        scc_pp_cat_expand(scc_bptree_curr_,__LINE__) = scc_bptree_impl_successor(                   \
+            bptree, &scc_pp_cat_expand(scc_bptree_leaf_,__LINE__), iter, sizeof(*(bptree))          \
+        ))
+
+#endif /* SCC_BPTREE_H */
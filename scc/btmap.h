@@ -4,6 +4,7 @@
 #include "arena.h"
 #include "btree.h"
 #include "mem.h"
+#include "pp_token.h"
 
 #include <stddef.h>
 
@@ -103,11 +104,15 @@ struct scc_btmap_base {
     scc_btmcompare btm_compare;
     struct scc_arena btm_arena;
     unsigned char const btm_kvoff;
+    unsigned char btm_keykind;
     unsigned char btm_dynalloc;
     unsigned char btm_fwoff;
     unsigned char btm_data[];
 };
 
+/* Keys and links are placed next to each other, followed by the values.
+ * Descending the tree thus only touches the leading part of each node, the
+ * values are not accessed until a matching key is found */
 #define scc_btmnode_impl_layout(keytype, valuetype, order)                                                          \
     struct {                                                                                                        \
         struct {                                                                                                    \
@@ -118,9 +123,9 @@ struct scc_btmap_base {
                 } btmn0;                                                                                            \
                 keytype btm_keys[(order) - 1u];                                                                     \
             } btmn1;                                                                                                \
-            valuetype btm_vals[(order) - 1u];                                                                       \
+            struct scc_btmnode_base *btm_links[order];                                                              \
         } btmn2;                                                                                                    \
-        struct scc_btmnode_base *btm_links[order];                                                                  \
+        valuetype btm_vals[(order) - 1u];                                                                           \
     }
 
 #define scc_btmnode_impl_keyoff(keytype)                                                                            \
@@ -139,11 +144,14 @@ struct scc_btmap_base {
         struct {                                                                                                    \
             struct {                                                                                                \
                 struct {                                                                                            \
-                    unsigned char btm_flags;                                                                        \
-                    unsigned short btm_nkeys;                                                                       \
-                } btmn0;                                                                                            \
-                keytype btm_keys[(order) - 1u];                                                                     \
-            } btmn1;                                                                                                \
+                    struct {                                                                                        \
+                        unsigned char btm_flags;                                                                    \
+                        unsigned short btm_nkeys;                                                                   \
+                    } btmn0;                                                                                        \
+                    keytype btm_keys[(order) - 1u];                                                                 \
+                } btmn1;                                                                                            \
+                struct scc_btmnode_base *btm_links[order];                                                          \
+            } btmn2;                                                                                                \
             valuetype btm_vals[];                                                                                   \
         }                                                                                                           \
     )
@@ -153,14 +161,11 @@ struct scc_btmap_base {
         struct {                                                                                                    \
             struct {                                                                                                \
                 struct {                                                                                            \
-                    struct {                                                                                        \
-                        unsigned char btm_flags;                                                                    \
-                        unsigned short btm_Nkeys;                                                                   \
-                    } btmn0;                                                                                        \
-                    keytype btm_keys[(order) - 1u];                                                                 \
-                } btmn1;                                                                                            \
-                valuetype btm_vals[(order) - 1u];                                                                   \
-            } btmn2;                                                                                                \
+                    unsigned char btm_flags;                                                                        \
+                    unsigned short btm_nkeys;                                                                       \
+                } btmn0;                                                                                            \
+                keytype btm_keys[(order) - 1u];                                                                     \
+            } btmn1;                                                                                                \
             struct scc_btmnode_base *btm_links[];                                                                   \
         }                                                                                                           \
     )
@@ -180,6 +185,7 @@ struct scc_btmap_base {
                 scc_btmcompare btm_compare;                                                                             \
                 struct scc_arena btm_arena;                                                                             \
                 unsigned char const btm_kvoff;                                                                          \
+                unsigned char btm_keykind;                                                                              \
                 unsigned char btm_dynalloc;                                                                             \
                 unsigned char btm_fwoff;                                                                                \
                 unsigned char btm_bkoff;                                                                                \
@@ -204,6 +210,7 @@ struct scc_btmap_base {
                 scc_btmcompare btm_compare;                                                                             \
                 struct scc_arena btm_arena;                                                                             \
                 unsigned char const btm_kvoff;                                                                          \
+                unsigned char btm_keykind;                                                                              \
                 unsigned char btm_dynalloc;                                                                             \
                 unsigned char btm_fwoff;                                                                                \
                 unsigned char btm_bkoff;                                                                                \
@@ -228,6 +235,7 @@ struct scc_btmap_base {
                     scc_btmcompare btm_compare;                                                                         \
                     struct scc_arena btm_arena;                                                                         \
                     unsigned char const btm_kvoff;                                                                      \
+                    unsigned char btm_keykind;                                                                          \
                     unsigned char btm_dynalloc;                                                                         \
                     unsigned char btm_fwoff;                                                                            \
                     unsigned char btm_bkoff;                                                                            \
@@ -378,6 +386,81 @@ struct scc_btmap_base {
         scc_btmap_impl_rootoff(keytype, valuetype, SCC_BTMAP_DEFAULT_ORDER)                                             \
     )
 
+/**
+ * Like ``scc_btmap_with_order_dyn`` except that the ``btmap`` and all of its nodes
+ * are allocated using the given \a allocator.
+ *
+ * \warning The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype The type of the keys to be stored in the ``btmap``.
+ * \param valuetype The type of the values to be stored in the ``btmap``.
+ * \param compare Pointer to the comparison function to use.
+ * \param order Desired order of the ``btmap``. Must be at least 2.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``btmap``.
+ *
+ * \return An opaque pointer to the ``btmap``, or ``NULL`` on failure.
+ */
+#define scc_btmap_with_order_in(keytype, valuetype, compare, order, allocator)                                          \
+    scc_btmap_impl_with_order_dyn(&(scc_btmap_impl_layout(keytype, valuetype, order)) {                                 \
+            .btm1 = {                                                                                                   \
+                .btm0 = {                                                                                               \
+                    .btm_order = order,                                                                                 \
+                    .btm_keyoff = scc_btmnode_impl_keyoff(keytype),                                                     \
+                    .btm_valoff = scc_btmnode_impl_valoff(keytype, valuetype, order),                                   \
+                    .btm_linkoff = scc_btmnode_impl_linkoff(keytype, valuetype, order),                                 \
+                    .btm_keysize = sizeof(keytype),                                                                     \
+                    .btm_valsize = sizeof(valuetype),                                                                   \
+                    .btm_arena = scc_arena_with_allocator(                                                              \
+                        scc_btmnode_impl_layout(keytype, valuetype, order),                                             \
+                        allocator                                                                                       \
+                    ),                                                                                                  \
+                    .btm_compare = compare,                                                                             \
+                    .btm_kvoff = scc_btmap_impl_pair_valoff(keytype, valuetype)                                         \
+                },                                                                                                      \
+            },                                                                                                          \
+        },                                                                                                              \
+        sizeof(scc_btmap_impl_layout(keytype, valuetype, order)),                                                       \
+        scc_btmap_impl_curroff(keytype, valuetype, order),                                                              \
+        scc_btmap_impl_rootoff(keytype, valuetype, order)                                                               \
+    )
+
+/**
+ * Like ``scc_btmap_new_dyn`` except that the ``btmap`` and all of its nodes are
+ * allocated using the given \a allocator.
+ *
+ * \warning The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype The type of the keys to be stored in the map.
+ * \param valuetype The type of the values to be stored in the map.
+ * \param compare Pointer to the comparison function to use.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``btmap``.
+ *
+ * \return An opaque pointer to a ``btmap``, or ``NULL`` on allocation failure.
+ */
+#define scc_btmap_new_in(keytype, valuetype, compare, allocator)                                                        \
+    scc_btmap_impl_new_dyn(&(scc_btmap_impl_layout(keytype, valuetype, SCC_BTMAP_DEFAULT_ORDER)) {                      \
+            .btm1 = {                                                                                                   \
+                .btm0 = {                                                                                               \
+                    .btm_order = SCC_BTMAP_DEFAULT_ORDER,                                                               \
+                    .btm_keyoff = scc_btmnode_impl_keyoff(keytype),                                                     \
+                    .btm_valoff = scc_btmnode_impl_valoff(keytype, valuetype, SCC_BTMAP_DEFAULT_ORDER),                 \
+                    .btm_linkoff = scc_btmnode_impl_linkoff(keytype, valuetype, SCC_BTMAP_DEFAULT_ORDER),               \
+                    .btm_keysize = sizeof(keytype),                                                                     \
+                    .btm_valsize = sizeof(valuetype),                                                                   \
+                    .btm_arena = scc_arena_with_allocator(                                                              \
+                        scc_btmnode_impl_layout(keytype, valuetype, SCC_BTMAP_DEFAULT_ORDER),                           \
+                        allocator                                                                                       \
+                    ),                                                                                                  \
+                    .btm_compare = compare,                                                                             \
+                    .btm_kvoff = scc_btmap_impl_pair_valoff(keytype, valuetype)                                         \
+                },                                                                                                      \
+            },                                                                                                          \
+        },                                                                                                              \
+        sizeof(scc_btmap_impl_layout(keytype, valuetype, SCC_BTMAP_DEFAULT_ORDER)),                                     \
+        scc_btmap_impl_curroff(keytype, valuetype, SCC_BTMAP_DEFAULT_ORDER),                                            \
+        scc_btmap_impl_rootoff(keytype, valuetype, SCC_BTMAP_DEFAULT_ORDER)                                             \
+    )
+
 void *scc_btmap_impl_new(void *base, size_t coff, size_t rootoff);
 
 void *scc_btmap_impl_new_dyn(void *sbase, size_t basesz, size_t coff, size_t rootoff);
@@ -413,6 +496,101 @@ inline size_t scc_btmap_impl_npad(void const *btmap) {
 #define scc_btmap_impl_base(btmap)                                                                  \
     scc_btmap_impl_base_qual(btmap,)
 
+void *scc_btmap_impl_from_sorted(void *btmap, void const *keys, void const *vals, size_t n);
+
+/**
+ * Construct a ``btmap`` of the given \a order from arrays of keys and values.
+ * The keys must be unique and sorted in ascending order, as defined by \a compare.
+ * The i'th value is associated with the i'th key.
+ *
+ * The map is built bottom up in time linear in \a n, without searching
+ * or splitting any nodes. Leaves are filled left to right and all nodes
+ * are allocated at once.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned. The
+ *          result is undefined if the keys are not sorted or not unique.
+ *
+ * \param keytype   The key type of the map
+ * \param valuetype The value type of the map
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *                  ``scc_btmcompare``
+ * \param order     The order of the map. Using an even value is advised.
+ * \param keys      Pointer to the first of the sorted keys, of type \a keytype
+ * \param vals      Pointer to the first value, of type \a valuetype
+ * \param n         Number of key-value pairs
+ *
+ * \return An opaque pointer to a ``btmap`` allocated on the heap, or ``NULL`` on failure.
+ */
+#define scc_btmap_with_order_from_sorted(keytype, valuetype, compare, order, keys, vals, n)        \
+    scc_btmap_impl_from_sorted(                                                                     \
+        scc_btmap_with_order_dyn(keytype, valuetype, compare, order), keys, vals, n                 \
+    )
+
+/**
+ * Construct a ``btmap`` of default order from arrays of sorted keys and values.
+ * See ``scc_btmap_with_order_from_sorted``.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned. The
+ *          result is undefined if the keys are not sorted or not unique.
+ *
+ * \param keytype   The key type of the map
+ * \param valuetype The value type of the map
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *                  ``scc_btmcompare``
+ * \param keys      Pointer to the first of the sorted keys, of type \a keytype
+ * \param vals      Pointer to the first value, of type \a valuetype
+ * \param n         Number of key-value pairs
+ *
+ * \return An opaque pointer to a ``btmap`` allocated on the heap, or ``NULL`` on failure.
+ */
+#define scc_btmap_from_sorted(keytype, valuetype, compare, keys, vals, n)                           \
+    scc_btmap_impl_from_sorted(scc_btmap_new_dyn(keytype, valuetype, compare), keys, vals, n)
+
+/**
+ * Like ``scc_btmap_with_order_from_sorted`` except that the map and all of
+ * its nodes are allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned. The
+ *          result is undefined if the keys are not sorted or not unique.
+ *
+ * \param keytype   The key type of the map
+ * \param valuetype The value type of the map
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *                  ``scc_btmcompare``
+ * \param order     The order of the map. Using an even value is advised.
+ * \param keys      Pointer to the first of the sorted keys, of type \a keytype
+ * \param vals      Pointer to the first value, of type \a valuetype
+ * \param n         Number of key-value pairs
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the map.
+ *
+ * \return An opaque pointer to a ``btmap``, or ``NULL`` on failure.
+ */
+#define scc_btmap_with_order_from_sorted_in(keytype, valuetype, compare, order, keys, vals, n, allocator) \
+    scc_btmap_impl_from_sorted(                                                                     \
+        scc_btmap_with_order_in(keytype, valuetype, compare, order, allocator), keys, vals, n       \
+    )
+
+/**
+ * Like ``scc_btmap_from_sorted`` except that the map and all of its nodes
+ * are allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned. The
+ *          result is undefined if the keys are not sorted or not unique.
+ *
+ * \param keytype   The key type of the map
+ * \param valuetype The value type of the map
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *                  ``scc_btmcompare``
+ * \param keys      Pointer to the first of the sorted keys, of type \a keytype
+ * \param vals      Pointer to the first value, of type \a valuetype
+ * \param n         Number of key-value pairs
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the map.
+ *
+ * \return An opaque pointer to a ``btmap``, or ``NULL`` on failure.
+ */
+#define scc_btmap_from_sorted_in(keytype, valuetype, compare, keys, vals, n, allocator)             \
+    scc_btmap_impl_from_sorted(scc_btmap_new_in(keytype, valuetype, compare, allocator), keys, vals, n)
+
 /**
  * Reclaim memory allocated for the ``btmap``
  *
@@ -555,4 +733,152 @@ _Bool scc_btmap_impl_remove(void *btmap);
  */
 void *scc_btmap_clone(void const *btmap);
 
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_btmap_iter:
+ * \endverbatim
+ *
+ * Cursor referring to a key-value pair in a ``btmap``.
+ *
+ * The path from the root is kept on an explicit stack bounded by
+ * ``SCC_BTREE_MAX_HEIGHT``, meaning that the nodes need not store
+ * parent pointers. The iterator requires no cleanup and is invalidated
+ * by any modification of the map.
+ */
+struct scc_btmap_iter {
+    unsigned it_depth;
+    void const *it_end;
+    unsigned short it_index[SCC_BTREE_MAX_HEIGHT];
+    struct scc_btmnode_base *it_nodes[SCC_BTREE_MAX_HEIGHT];
+};
+
+void const *scc_btmap_impl_leftmost(void const *btmap, struct scc_btmap_iter *iter);
+void const *scc_btmap_impl_lower_bound(void const *btmap, struct scc_btmap_iter *iter);
+void const *scc_btmap_impl_upper_bound(void const *btmap, struct scc_btmap_iter *iter);
+void const *scc_btmap_impl_range_end(void const *btmap, struct scc_btmap_iter *iter);
+void const *scc_btmap_impl_range_begin(void const *btmap, struct scc_btmap_iter *iter);
+void const *scc_btmap_impl_iter_next(void const *btmap, struct scc_btmap_iter *iter);
+void *scc_btmap_impl_iter_value(void const *btmap, struct scc_btmap_iter const *iter);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_btmap_foreach:
+ * \endverbatim
+ *
+ * Iterate over the key-value pairs in the ``btmap`` in ascending key order,
+ * as defined by the comparator used.
+ *
+ * The macro expands to a scope executed with \a key and \a value referring
+ * to the key and value of each pair in the map.
+ *
+ * \note The ``btmap`` must not be modified during the iteration. Values may
+ *       be written through \a value.
+ *
+ * \param key Pointer to const-qualified key type, used as iteration variable
+ * \param value Pointer to value type, used as iteration variable
+ * \param btmap Handle identifying the ``btmap``
+ */
+#define scc_btmap_foreach(key, value, btmap)                                                        \
+    for (struct scc_btmap_iter scc_pp_cat_expand(scc_btmap_cursor_,__LINE__),                      \
+            *scc_pp_cat_expand(scc_btmap_cursorp_,__LINE__) =                                       \
+                (key = scc_btmap_impl_leftmost(                                                     \
+                    btmap, &scc_pp_cat_expand(scc_btmap_cursor_,__LINE__)                           \
+                ), &scc_pp_cat_expand(scc_btmap_cursor_,__LINE__));                                 \
+        key && (value = scc_btmap_impl_iter_value(                                                  \
+            btmap, scc_pp_cat_expand(scc_btmap_cursorp_,__LINE__)                                   \
+        ), 1);                                                                                      \
+        key = scc_btmap_impl_iter_next(btmap, scc_pp_cat_expand(scc_btmap_cursorp_,__LINE__)))
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_btmap_range:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_btmap_foreach <scc_btmap_foreach>` @endverbatim
+ * but visits only the pairs whose keys are in the half-open interval [\a low, \a high).
+ *
+ * Each of \a low and \a high is evaluated exactly once. Nothing is visited
+ * if \a high is not ordered after \a low.
+ *
+ * \note The ``btmap`` must not be modified during the iteration.
+ *
+ * \param key Pointer to const-qualified key type, used as iteration variable
+ * \param value Pointer to value type, used as iteration variable
+ * \param btmap Handle identifying the ``btmap``
+ * \param low Lower, inclusive, bound of the range
+ * \param high Upper, exclusive, bound of the range
+ */
+#define scc_btmap_range(key, value, btmap, low, high)                                               \
+    for (struct scc_btmap_iter scc_pp_cat_expand(scc_btmap_cursor_,__LINE__),                      \
+            *scc_pp_cat_expand(scc_btmap_cursorp_,__LINE__) = (                                     \
+                (btmap)->btm_key = (high),                                                          \
+                scc_btmap_impl_range_end(btmap, &scc_pp_cat_expand(scc_btmap_cursor_,__LINE__)),   \
+                (btmap)->btm_key = (low),                                                           \
+                key = scc_btmap_impl_range_begin(                                                   \
+                    btmap, &scc_pp_cat_expand(scc_btmap_cursor_,__LINE__)                           \
+                ), &scc_pp_cat_expand(scc_btmap_cursor_,__LINE__));                                 \
+        key && (value = scc_btmap_impl_iter_value(                                                  \
+            btmap, scc_pp_cat_expand(scc_btmap_cursorp_,__LINE__)                                   \
+        ), 1);                                                                                      \
+        key = scc_btmap_impl_iter_next(btmap, scc_pp_cat_expand(scc_btmap_cursorp_,__LINE__)))
+
+/**
+ * Position the iterator at the first pair in the ``btmap`` whose key is
+ * not ordered before the given one.
+ *
+ * The \a key parameter must not necessarily be the same type as the key type
+ * with which the ``btmap`` was instantiated. If it is not, the key is implicitly
+ * converted to the key type.
+ *
+ * \param btmap Handle identifying the ``btmap``
+ * \param key The key to search for
+ * \param iter Address of a ``struct scc_btmap_iter`` to position
+ *
+ * \return Pointer to the key of the pair the iterator refers to, or ``NULL``
+ *         if all keys in the ``btmap`` are ordered before \a key
+ */
+#define scc_btmap_lower_bound(btmap, key, iter)                                                     \
+    scc_btmap_impl_lower_bound((((btmap)->btm_key = (key)), (btmap)), iter)
+
+/**
+ * Position the iterator at the first pair in the ``btmap`` whose key is
+ * ordered after the given one.
+ *
+ * The \a key parameter must not necessarily be the same type as the key type
+ * with which the ``btmap`` was instantiated. If it is not, the key is implicitly
+ * converted to the key type.
+ *
+ * \param btmap Handle identifying the ``btmap``
+ * \param key The key to search for
+ * \param iter Address of a ``struct scc_btmap_iter`` to position
+ *
+ * \return Pointer to the key of the pair the iterator refers to, or ``NULL``
+ *         if no key in the ``btmap`` is ordered after \a key
+ */
+#define scc_btmap_upper_bound(btmap, key, iter)                                                     \
+    scc_btmap_impl_upper_bound((((btmap)->btm_key = (key)), (btmap)), iter)
+
+/**
+ * Advance the iterator to the next pair in the ``btmap``.
+ *
+ * \param btmap Handle identifying the ``btmap``
+ * \param iter Address of a positioned ``struct scc_btmap_iter``
+ *
+ * \return Pointer to the key of the next pair, or ``NULL`` if the
+ *         iterator was referring to the last pair in the ``btmap``
+ */
+#define scc_btmap_iter_next(btmap, iter)                                                            \
+    scc_btmap_impl_iter_next(btmap, iter)
+
+/**
+ * Obtain the value of the pair the iterator refers to.
+ *
+ * \param btmap Handle identifying the ``btmap``
+ * \param iter Address of a ``struct scc_btmap_iter`` referring to a pair
+ *
+ * \return Mutable pointer to the value of the pair
+ */
+#define scc_btmap_iter_value(btmap, iter)                                                           \
+    scc_btmap_impl_iter_value(btmap, iter)
+
 #endif /* SCC_BTMAP_H */
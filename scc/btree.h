@@ -5,6 +5,7 @@
 #include "bits.h"
 #include "bug.h"
 #include "mem.h"
+#include "pp_token.h"
 
 #include <stddef.h>
 
@@ -45,6 +46,35 @@
  */
 typedef int(*scc_btcompare)(void const *, void const *);
 
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_btcompare_builtin:
+ * \endverbatim
+ *
+ * Comparators for 32- and 64-bit signed integers and for ``float``
+ * and ``double``.
+ *
+ * Passing one of these when constructing a ``btree`` or ``btmap``
+ * replaces the comparator calls made while searching each node
+ * with vectorized comparisons of the keys in the node. The
+ * comparators must only be used with keys of the matching type.
+ */
+int scc_btcompare_i32(void const *left, void const *right);
+int scc_btcompare_i64(void const *left, void const *right);
+int scc_btcompare_f32(void const *left, void const *right);
+int scc_btcompare_f64(void const *left, void const *right);
+
+/* Key types for which node searches are specialized */
+enum scc_btkey_kind {
+    SCC_BTKEY_GENERIC,
+    SCC_BTKEY_I32,
+    SCC_BTKEY_I64,
+    SCC_BTKEY_F32,
+    SCC_BTKEY_F64
+};
+
+unsigned char scc_btkey_impl_kind(scc_btcompare compare);
+
 #ifndef SCC_BTREE_FAULT_ORDER
 /**
  * Default order of ``btree`` instances.
@@ -67,6 +97,19 @@ typedef int(*scc_btcompare)(void const *, void const *);
 #error Order must be at least 2
 #endif
 
+/**
+ * Upper bound for the height of a ``btree``, used for sizing the
+ * explicit stack carried by iterators.
+ *
+ * Each internal node has at least two children, meaning that a
+ * tree of height ``h`` holds at least ``2^(h - 1)`` elements. The
+ * default is thus sufficient for any tree whose size fits in a
+ * ``size_t``.
+ */
+#ifndef SCC_BTREE_MAX_HEIGHT
+#define SCC_BTREE_MAX_HEIGHT 64u
+#endif /* SCC_BTREE_MAX_HEIGHT */
+
 struct scc_btnode_base {
     unsigned char bt_flags;
     unsigned short bt_nkeys;
@@ -77,10 +120,12 @@ struct scc_btree_base {
     unsigned short const bt_order;
     unsigned short const bt_dataoff;
     unsigned short const bt_linkoff;
+    unsigned short const bt_cntoff;
     size_t bt_size;
     struct scc_btnode_base *bt_root;
     scc_btcompare bt_compare;
     struct scc_arena bt_arena;
+    unsigned char bt_keykind;
     unsigned char bt_dynalloc;
     unsigned char bt_fwoff;
     unsigned char bt_data[];
@@ -123,24 +168,40 @@ struct scc_btree_base {
         }                                                                                       \
     )
 
-#define scc_btree_impl_layout(type, order)                                                          \
+#define scc_btnode_impl_counted_layout(type, order)                                             \
+    struct {                                                                                    \
+        scc_btnode_impl_layout(type, order) btc0;                                               \
+        size_t bt_count;                                                                        \
+    }
+
+#define scc_btnode_impl_cntoff(type, order)                                                     \
+    sizeof(                                                                                     \
+        struct {                                                                                \
+            scc_btnode_impl_layout(type, order) btc0;                                           \
+            size_t bt_count[];                                                                  \
+        }                                                                                       \
+    )
+
+#define scc_btree_impl_layout_of(type, node)                                                        \
     struct {                                                                                        \
         struct {                                                                                    \
             struct {                                                                                \
                 unsigned short const bt_order;                                                      \
                 unsigned short const bt_dataoff;                                                    \
                 unsigned short const bt_linkoff;                                                    \
+                unsigned short const bt_cntoff;                                                     \
                 size_t bt_size;                                                                     \
                 struct scc_btnode_base *bt_root;                                                    \
                 scc_btcompare bt_compare;                                                           \
                 struct scc_arena bt_arena;                                                          \
+                unsigned char bt_keykind;                                                           \
                 unsigned char bt_dynalloc;                                                          \
                 unsigned char bt_fwoff;                                                             \
                 unsigned char bt_bkoff;                                                             \
             } bt0;                                                                                  \
             type bt_curr;                                                                           \
         } bt1;                                                                                      \
-        scc_btnode_impl_layout(type, order) bt_rootmem;                                             \
+        node bt_rootmem;                                                                            \
     }
 
 #define scc_btree_impl_curroff(type)                                                                \
@@ -150,10 +211,12 @@ struct scc_btree_base {
                 unsigned short const bt_order;                                                      \
                 unsigned short const bt_dataoff;                                                    \
                 unsigned short const bt_linkoff;                                                    \
+                unsigned short const bt_cntoff;                                                     \
                 size_t bt_size;                                                                     \
                 struct scc_btnode_base *bt_root;                                                    \
                 scc_btcompare bt_compare;                                                           \
                 struct scc_arena bt_arena;                                                          \
+                unsigned char bt_keykind;                                                           \
                 unsigned char bt_dynalloc;                                                          \
                 unsigned char bt_fwoff;                                                             \
                 unsigned char bt_bkoff;                                                             \
@@ -162,7 +225,7 @@ struct scc_btree_base {
         }                                                                                           \
     )
 
-#define scc_btree_impl_rootoff(type, order)                                                         \
+#define scc_btree_impl_rootoff_of(type, node)                                                       \
     sizeof(                                                                                         \
         struct {                                                                                    \
             struct {                                                                                \
@@ -170,20 +233,34 @@ struct scc_btree_base {
                     unsigned short const bt_order;                                                  \
                     unsigned short const bt_dataoff;                                                \
                     unsigned short const bt_linkoff;                                                \
+                    unsigned short const bt_cntoff;                                                 \
                     size_t bt_size;                                                                 \
                     struct scc_btnode_base *bt_root;                                                \
                     scc_btcompare bt_compare;                                                       \
                     struct scc_arena bt_arena;                                                      \
+                    unsigned char bt_keykind;                                                       \
                     unsigned char bt_dynalloc;                                                      \
                     unsigned char bt_fwoff;                                                         \
                     unsigned char bt_bkoff;                                                         \
                 } bt0;                                                                              \
                 type bt_curr;                                                                       \
             } bt1;                                                                                  \
-            scc_btnode_impl_layout(type, order) bt_rootmem[];                                       \
+            node bt_rootmem[];                                                                      \
         }                                                                                           \
     )
 
+#define scc_btree_impl_layout(type, order)                                                          \
+    scc_btree_impl_layout_of(type, scc_btnode_impl_layout(type, order))
+
+#define scc_btree_impl_rootoff(type, order)                                                         \
+    scc_btree_impl_rootoff_of(type, scc_btnode_impl_layout(type, order))
+
+#define scc_btree_impl_counted_layout(type, order)                                                  \
+    scc_btree_impl_layout_of(type, scc_btnode_impl_counted_layout(type, order))
+
+#define scc_btree_impl_counted_rootoff(type, order)                                                 \
+    scc_btree_impl_rootoff_of(type, scc_btnode_impl_counted_layout(type, order))
+
 
 void *scc_btree_impl_new(void *base, size_t coff, size_t rootoff);
 
@@ -333,6 +410,181 @@ inline void *scc_btree_impl_with_order_dyn(void *sbase, size_t basesz, size_t co
         scc_btree_impl_rootoff(type, SCC_BTREE_DEFAULT_ORDER)                                       \
     )
 
+/**
+ * Like ``scc_btree_with_order_dyn`` except that the tree and all of its nodes
+ * are allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type      The type of the values to be stored in the tree.
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *  ``scc_btcompare``.
+ * \param order     The order of the tree. Using an even value is advised.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the tree.
+ *
+ *  \return An opaque pointer to a ``btree``, or ``NULL`` on failure.
+ */
+#define scc_btree_with_order_in(type, compare, order, allocator)                                    \
+    scc_btree_impl_with_order_dyn(&(scc_btree_impl_layout(type, order)) {                           \
+            .bt1 = {                                                                                \
+                .bt0 = {                                                                            \
+                    .bt_order = (order),                                                            \
+                    .bt_dataoff = scc_btnode_impl_dataoff(type),                                    \
+                    .bt_linkoff = scc_btnode_impl_linkoff(type, order),                             \
+                    .bt_arena = scc_arena_with_allocator(                                           \
+                        scc_btnode_impl_layout(type, (order)),                                      \
+                        allocator                                                                   \
+                    ),                                                                              \
+                    .bt_compare = (compare)                                                         \
+                },                                                                                  \
+            },                                                                                      \
+        },                                                                                          \
+        sizeof(scc_btree_impl_layout(type, order)),                                                 \
+        scc_btree_impl_curroff(type),                                                               \
+        scc_btree_impl_rootoff(type, order)                                                         \
+    )
+
+/**
+ * Like ``scc_btree_new_dyn`` except that the tree and all of its nodes are
+ * allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type      The type to be stored in the tree
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *  ``scc_btcompare``.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the tree.
+ *
+ *  \return An opaque pointer to a ``btree``, or ``NULL`` on failure.
+ */
+#define scc_btree_new_in(type, compare, allocator)                                                  \
+    (type *)scc_btree_impl_new_dyn(&(scc_btree_impl_layout(type, SCC_BTREE_DEFAULT_ORDER)) {        \
+            .bt1 = {                                                                                \
+                .bt0 = {                                                                            \
+                    .bt_order = SCC_BTREE_DEFAULT_ORDER,                                            \
+                    .bt_dataoff = scc_btnode_impl_dataoff(type),                                    \
+                    .bt_linkoff = scc_btnode_impl_linkoff(type, SCC_BTREE_DEFAULT_ORDER),           \
+                    .bt_arena = scc_arena_with_allocator(                                           \
+                        scc_btnode_impl_layout(type, SCC_BTREE_DEFAULT_ORDER),                      \
+                        allocator                                                                   \
+                    ),                                                                              \
+                    .bt_compare = (compare)                                                         \
+                },                                                                                  \
+            },                                                                                      \
+        },                                                                                          \
+        sizeof(scc_btree_impl_layout(type, SCC_BTREE_DEFAULT_ORDER)),                               \
+        scc_btree_impl_curroff(type),                                                               \
+        scc_btree_impl_rootoff(type, SCC_BTREE_DEFAULT_ORDER)                                       \
+    )
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_btree_counted:
+ * \endverbatim
+ *
+ * Instantiate a dynamically allocated, order-statistic ``btree`` of the given \a order.
+ *
+ * Each node additionally keeps the number of elements in the subtree rooted
+ * at it. The counts are maintained on insertion and removal at the cost of
+ * a ``size_t`` per node and a few extra writes along the modified path, and
+ * allow for ``scc_btree_rank``, ``scc_btree_select`` and ``scc_btree_quantile``
+ * to run in time logarithmic in the size of the tree.
+ *
+ * The tree is otherwise used exactly like any other ``btree``.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type    The type of the values to be stored in the tree.
+ * \param compare Pointer to a comparison function, the signature of which should match
+ *  ``scc_btcompare``.
+ * \param order   The order of the tree. Using an even value is advised.
+ *
+ *  \return An opaque pointer to a ``btree`` allocated on the heap, or ``NULL`` on failure.
+ */
+#define scc_btree_with_order_counted_dyn(type, compare, order)                                      \
+    scc_btree_impl_with_order_dyn(&(scc_btree_impl_counted_layout(type, order)) {                   \
+            .bt1 = {                                                                                \
+                .bt0 = {                                                                            \
+                    .bt_order = (order),                                                            \
+                    .bt_dataoff = scc_btnode_impl_dataoff(type),                                    \
+                    .bt_linkoff = scc_btnode_impl_linkoff(type, order),                             \
+                    .bt_cntoff = scc_btnode_impl_cntoff(type, order),                               \
+                    .bt_arena = scc_arena_new(scc_btnode_impl_counted_layout(type, (order))),       \
+                    .bt_compare = (compare)                                                         \
+                },                                                                                  \
+            },                                                                                      \
+        },                                                                                          \
+        sizeof(scc_btree_impl_counted_layout(type, order)),                                         \
+        scc_btree_impl_curroff(type),                                                               \
+        scc_btree_impl_counted_rootoff(type, order)                                                 \
+    )
+
+/**
+ * Instantiate a dynamically allocated, order-statistic ``btree`` of default
+ * order. See ``scc_btree_with_order_counted_dyn``.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type    The type to be stored in the tree
+ * \param compare Pointer to a comparison function, the signature of which should match
+ *  ``scc_btcompare``.
+ *
+ *  \return An opaque pointer to a ``btree`` allocated on the heap, or ``NULL`` on failure.
+ */
+#define scc_btree_new_counted_dyn(type, compare)                                                    \
+    (type *)scc_btree_with_order_counted_dyn(type, compare, SCC_BTREE_DEFAULT_ORDER)
+
+/**
+ * Like ``scc_btree_with_order_counted_dyn`` except that the tree and all of
+ * its nodes are allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type      The type of the values to be stored in the tree.
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *  ``scc_btcompare``.
+ * \param order     The order of the tree. Using an even value is advised.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the tree.
+ *
+ *  \return An opaque pointer to a ``btree``, or ``NULL`` on failure.
+ */
+#define scc_btree_with_order_counted_in(type, compare, order, allocator)                            \
+    scc_btree_impl_with_order_dyn(&(scc_btree_impl_counted_layout(type, order)) {                   \
+            .bt1 = {                                                                                \
+                .bt0 = {                                                                            \
+                    .bt_order = (order),                                                            \
+                    .bt_dataoff = scc_btnode_impl_dataoff(type),                                    \
+                    .bt_linkoff = scc_btnode_impl_linkoff(type, order),                             \
+                    .bt_cntoff = scc_btnode_impl_cntoff(type, order),                               \
+                    .bt_arena = scc_arena_with_allocator(                                           \
+                        scc_btnode_impl_counted_layout(type, (order)),                              \
+                        allocator                                                                   \
+                    ),                                                                              \
+                    .bt_compare = (compare)                                                         \
+                },                                                                                  \
+            },                                                                                      \
+        },                                                                                          \
+        sizeof(scc_btree_impl_counted_layout(type, order)),                                         \
+        scc_btree_impl_curroff(type),                                                               \
+        scc_btree_impl_counted_rootoff(type, order)                                                 \
+    )
+
+/**
+ * Like ``scc_btree_new_counted_dyn`` except that the tree and all of its
+ * nodes are allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned.
+ *
+ * \param type      The type to be stored in the tree
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *  ``scc_btcompare``.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the tree.
+ *
+ *  \return An opaque pointer to a ``btree``, or ``NULL`` on failure.
+ */
+#define scc_btree_new_counted_in(type, compare, allocator)                                          \
+    (type *)scc_btree_with_order_counted_in(type, compare, SCC_BTREE_DEFAULT_ORDER, allocator)
+
 inline size_t scc_btree_impl_npad(void const *btree) {
     return ((unsigned char const *)btree)[-1] + sizeof(unsigned char);
 }
@@ -348,6 +600,94 @@ inline size_t scc_btree_impl_npad(void const *btree) {
 #define scc_btree_impl_base(btree)                                                                  \
     scc_btree_impl_base_qual(btree,)
 
+void *scc_btree_impl_from_sorted(void *btree, void const *values, size_t n, size_t elemsize);
+
+/**
+ * Construct a ``btree`` of the given \a order from an array of values sorted
+ * in ascending order, as defined by \a compare.
+ *
+ * The tree is built bottom up in time linear in \a n, without searching
+ * or splitting any nodes. Leaves are filled left to right and all nodes
+ * are allocated at once.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned. The
+ *          result is undefined if the values are not sorted.
+ *
+ * \param type    The type of the values to be stored in the tree
+ * \param compare Pointer to a comparison function, the signature of which should match
+ *                ``scc_btcompare``
+ * \param order   The order of the tree. Using an even value is advised.
+ * \param values  Pointer to the first of the sorted values, of type \a type
+ * \param n       Number of values in the array
+ *
+ * \return An opaque pointer to a ``btree`` allocated on the heap, or ``NULL`` on failure.
+ */
+#define scc_btree_with_order_from_sorted(type, compare, order, values, n)                           \
+    (type *)scc_btree_impl_from_sorted(                                                             \
+        scc_btree_with_order_dyn(type, compare, order), values, n, sizeof(type)                     \
+    )
+
+/**
+ * Construct a ``btree`` of default order from an array of sorted values. See
+ * ``scc_btree_with_order_from_sorted``.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned. The
+ *          result is undefined if the values are not sorted.
+ *
+ * \param type    The type of the values to be stored in the tree
+ * \param compare Pointer to a comparison function, the signature of which should match
+ *                ``scc_btcompare``
+ * \param values  Pointer to the first of the sorted values, of type \a type
+ * \param n       Number of values in the array
+ *
+ * \return An opaque pointer to a ``btree`` allocated on the heap, or ``NULL`` on failure.
+ */
+#define scc_btree_from_sorted(type, compare, values, n)                                             \
+    (type *)scc_btree_impl_from_sorted(scc_btree_new_dyn(type, compare), values, n, sizeof(type))
+
+/**
+ * Like ``scc_btree_with_order_from_sorted`` except that the tree and all of
+ * its nodes are allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned. The
+ *          result is undefined if the values are not sorted.
+ *
+ * \param type      The type of the values to be stored in the tree
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *                  ``scc_btcompare``
+ * \param order     The order of the tree. Using an even value is advised.
+ * \param values    Pointer to the first of the sorted values, of type \a type
+ * \param n         Number of values in the array
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the tree.
+ *
+ * \return An opaque pointer to a ``btree``, or ``NULL`` on failure.
+ */
+#define scc_btree_with_order_from_sorted_in(type, compare, order, values, n, allocator)             \
+    (type *)scc_btree_impl_from_sorted(                                                             \
+        scc_btree_with_order_in(type, compare, order, allocator), values, n, sizeof(type)           \
+    )
+
+/**
+ * Like ``scc_btree_from_sorted`` except that the tree and all of its nodes
+ * are allocated using the given \a allocator.
+ *
+ * \warning The call may fail, in which case ``NULL`` is returned. The
+ *          result is undefined if the values are not sorted.
+ *
+ * \param type      The type of the values to be stored in the tree
+ * \param compare   Pointer to a comparison function, the signature of which should match
+ *                  ``scc_btcompare``
+ * \param values    Pointer to the first of the sorted values, of type \a type
+ * \param n         Number of values in the array
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the tree.
+ *
+ * \return An opaque pointer to a ``btree``, or ``NULL`` on failure.
+ */
+#define scc_btree_from_sorted_in(type, compare, values, n, allocator)                               \
+    (type *)scc_btree_impl_from_sorted(                                                             \
+        scc_btree_new_in(type, compare, allocator), values, n, sizeof(type)                         \
+    )
+
 /**
  * Reclaim memory allocated for the ``btree``.
  *
@@ -487,4 +827,416 @@ void *scc_btree_impl_clone(void const *btree, size_t elemsize);
 #define scc_btree_clone(btree)                                                                              \
     scc_btree_impl_clone(btree, sizeof(*(btree)))
 
+_Bool scc_btree_impl_merge(void *dst, void const *src, size_t elemsize);
+
+/**
+ * Insert every element in \a src into \a dst.
+ *
+ * If no element in \a dst is ordered after the smallest one in \a src,
+ * or every element in \a src is ordered before those in \a dst, the
+ * nodes of \a src are copied and joined to the spine of \a dst at the
+ * matching height. If the elements of \a src instead all fall between
+ * two adjacent elements of \a dst, \a dst is cut in two along the path
+ * to the gap and the parts joined on either side of the copy. Only nodes
+ * on the path are touched, all others are reused in place. Both cases
+ * take time linear in the size of \a src and polylogarithmic in that of
+ * \a dst. Otherwise, the elements of both trees are streamed in a single
+ * in-order pass into the nodes of a rebuilt \a dst, in time linear in
+ * the combined size, with the old nodes released afterwards.
+ *
+ * Elements present in both trees are kept in both copies, those
+ * originating from \a dst ordered first.
+ *
+ * Both trees must have been instantiated with the same type and comparator.
+ * The \a src tree is left unmodified.
+ *
+ * \param dst Handle identifying the ``btree`` to insert the elements into
+ * \param src Handle identifying the ``btree`` whose elements are to be inserted
+ *
+ * \return ``true`` on success, ``false`` on allocation failure in which case
+ *         \a dst is left unmodified
+ */
+#define scc_btree_merge(dst, src)                                                                   \
+    scc_btree_impl_merge(dst, src, sizeof(*(dst)))
+
+_Bool scc_btree_impl_split(void *btree, void *rightaddr, size_t elemsize);
+
+/**
+ * Move all elements not ordered before the given key to a new ``btree``.
+ *
+ * The new tree is allocated on the heap, is of the same order as
+ * \a btree and uses the same comparator and allocator.
+ *
+ * The tree is cut along the path to the key, the nodes to either side
+ * of the path joined back into two trees in time logarithmic in the
+ * size of \a btree. As each tree owns the memory of its nodes, those
+ * of one of the two are then copied over, in time linear in its size.
+ * In trees with order statistics the smaller half is picked, otherwise
+ * the one predicted to be smaller from the position of the key in the
+ * root.
+ *
+ * The \a key parameter must not necessarily be the same type as the one
+ * with which the ``btree`` was instantiated. If it is not, the value is implicitly
+ * converted to the type stored in the ``btree``.
+ *
+ * \param btree Handle identifying the ``btree`` to split
+ * \param key The key at which to split the tree
+ * \param rightaddr Address of a handle set to refer to the new ``btree``
+ *                  on success. Must be freed using ``scc_btree_free``.
+ *
+ * \return ``true`` on success, ``false`` on allocation failure in which case
+ *         \a btree is left unmodified
+ */
+#define scc_btree_split(btree, key, rightaddr)                                                      \
+    scc_btree_impl_split((*(btree) = (key), (btree)), rightaddr, sizeof(*(btree)))
+
+void *scc_btree_impl_union(void const *left, void const *right, size_t elemsize);
+void *scc_btree_impl_intersection(void const *left, void const *right, size_t elemsize);
+void *scc_btree_impl_difference(void const *left, void const *right, size_t elemsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_btree_setops:
+ * \endverbatim
+ *
+ * Compute the union of two ``btree`` instances.
+ *
+ * The result is a new ``btree`` allocated on the heap. A first in-order
+ * pass over both operands counts the elements in the result, a second
+ * one streams them into nodes reserved up front. It is of the same order
+ * as \a left and uses the same comparator and allocator. Duplicates are
+ * treated as distinct elements. An element present ``m`` times in
+ * \a left and ``n`` times in \a right is present ``max(m, n)`` times in
+ * the result.
+ *
+ * Both trees must have been instantiated with the same type and comparator.
+ *
+ * \param left Handle identifying the first operand
+ * \param right Handle identifying the second operand
+ *
+ * \return Handle referring to a new ``btree``, or ``NULL`` on allocation failure.
+ */
+#define scc_btree_union(left, right)                                                                \
+    scc_btree_impl_union(left, right, sizeof(*(left)))
+
+/**
+ * Compute the intersection of two ``btree`` instances. See
+ * ``scc_btree_union``.
+ *
+ * An element present ``m`` times in \a left and ``n`` times in
+ * \a right is present ``min(m, n)`` times in the result.
+ *
+ * \param left Handle identifying the first operand
+ * \param right Handle identifying the second operand
+ *
+ * \return Handle referring to a new ``btree``, or ``NULL`` on allocation failure.
+ */
+#define scc_btree_intersection(left, right)                                                         \
+    scc_btree_impl_intersection(left, right, sizeof(*(left)))
+
+/**
+ * Compute the difference of two ``btree`` instances. See
+ * ``scc_btree_union``.
+ *
+ * An element present ``m`` times in \a left and ``n`` times in
+ * \a right is present ``max(m - n, 0)`` times in the result.
+ *
+ * \param left Handle identifying the ``btree`` to subtract from
+ * \param right Handle identifying the ``btree`` to subtract
+ *
+ * \return Handle referring to a new ``btree``, or ``NULL`` on allocation failure.
+ */
+#define scc_btree_difference(left, right)                                                           \
+    scc_btree_impl_difference(left, right, sizeof(*(left)))
+
+size_t scc_btree_impl_rank(void const *btree, size_t elemsize);
+void const *scc_btree_impl_select(void const *btree, size_t k, size_t elemsize);
+void const *scc_btree_impl_quantile(void const *btree, double q, size_t elemsize);
+
+/**
+ * Count the elements in the ``btree`` ordered before the given value.
+ *
+ * The result is the index at which the value would be found were the
+ * elements in a sorted array. Only the path from the root to a leaf is
+ * visited.
+ *
+ * The \a value parameter must not necessarily be the same type as the one
+ * with which the ``btree`` was instantiated. If it is not, the value is implicitly
+ * converted to the type stored in the ``btree``.
+ *
+ * \note The ``btree`` must have been instantiated using
+ *       @verbatim embed:rst:inline :ref:`scc_btree_with_order_counted_dyn <scc_btree_counted>` @endverbatim
+ *       or ``scc_btree_new_counted_dyn``.
+ *
+ * \param btree Handle identifying the ``btree``
+ * \param value The value whose rank is to be computed
+ *
+ * \return Number of elements in \a btree ordered before \a value
+ */
+#define scc_btree_rank(btree, value)                                                                \
+    scc_btree_impl_rank((*(btree) = (value), (btree)), sizeof(*(btree)))
+
+/**
+ * Find the element at the given zero-based position in the sorted order of
+ * the ``btree``.
+ *
+ * \note The ``btree`` must have been instantiated using
+ *       @verbatim embed:rst:inline :ref:`scc_btree_with_order_counted_dyn <scc_btree_counted>` @endverbatim
+ *       or ``scc_btree_new_counted_dyn``.
+ *
+ * \param btree Handle identifying the ``btree``
+ * \param k Number of elements ordered before the one to find
+ *
+ * \return Pointer to the element, or ``NULL`` if \a k is not less than the
+ *         size of the \a btree
+ */
+#define scc_btree_select(btree, k)                                                                  \
+    scc_btree_impl_select(btree, k, sizeof(*(btree)))
+
+/**
+ * Find the element at the \a q quantile of the ``btree``, using the
+ * nearest rank method.
+ *
+ * The element returned is the one at zero-based position ``ceil(q * n) - 1``,
+ * with ``n`` being the size of the tree, i.e. the smallest element such that at
+ * least a fraction \a q of the elements compare less than or equal to it. The
+ * median is thus found by passing ``0.5`` and the 99th percentile by passing
+ * ``0.99``. For a tree of 4 elements, the median is the second smallest. Values
+ * of \a q outside of ``[0, 1]`` are clamped, and ``0`` yields the smallest element.
+ *
+ * \note The ``btree`` must have been instantiated using
+ *       @verbatim embed:rst:inline :ref:`scc_btree_with_order_counted_dyn <scc_btree_counted>` @endverbatim
+ *       or ``scc_btree_new_counted_dyn``.
+ *
+ * \param btree Handle identifying the ``btree``
+ * \param q The quantile to compute, in ``[0, 1]``
+ *
+ * \return Pointer to the element, or ``NULL`` if the \a btree is empty
+ */
+#define scc_btree_quantile(btree, q)                                                                \
+    scc_btree_impl_quantile(btree, q, sizeof(*(btree)))
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_btree_iter:
+ * \endverbatim
+ *
+ * Cursor referring to a position in a ``btree``.
+ *
+ * The path from the root to the current element is kept on an
+ * explicit stack, meaning that the nodes need not store parent
+ * pointers. Each frame holds a node along with the index of the
+ * element in it to be visited next. The iterator requires no
+ * cleanup and is invalidated by any modification of the tree.
+ */
+struct scc_btree_iter {
+    unsigned it_depth;
+    unsigned short it_index[SCC_BTREE_MAX_HEIGHT];
+    struct scc_btnode_base *it_nodes[SCC_BTREE_MAX_HEIGHT];
+};
+
+void const *scc_btree_impl_leftmost(void const *btree, struct scc_btree_iter *iter, size_t elemsize);
+void const *scc_btree_impl_lower_bound(void const *btree, struct scc_btree_iter *iter, size_t elemsize);
+void const *scc_btree_impl_upper_bound(void const *btree, struct scc_btree_iter *iter, size_t elemsize);
+void const *scc_btree_impl_iter_next(void const *btree, struct scc_btree_iter *iter, size_t elemsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_btree_foreach:
+ * \endverbatim
+ *
+ * Iterate over the elements in the ``btree`` in ascending order, as
+ * defined by the comparator used.
+ *
+ * The macro expands to a scope executed with \a iter referring to each
+ * element in the tree.
+ *
+ * \note The ``btree`` must not be modified during the iteration.
+ *
+ * \param iter Pointer to const-qualified value type, used as iteration variable
+ * \param btree Handle identifying the ``btree``
+ */
+#define scc_btree_foreach(iter, btree)                                                              \
+    for (struct scc_btree_iter scc_pp_cat_expand(scc_btree_cursor_,__LINE__),                       \
+            *scc_pp_cat_expand(scc_btree_cursorp_,__LINE__) =                                       \
+                (iter = scc_btree_impl_leftmost(                                                    \
+                    btree, &scc_pp_cat_expand(scc_btree_cursor_,__LINE__), sizeof(*(btree))         \
+                ), &scc_pp_cat_expand(scc_btree_cursor_,__LINE__));                                 \
+        iter;                                                                                       \
+        iter = scc_btree_impl_iter_next(                                                            \
+            btree, scc_pp_cat_expand(scc_btree_cursorp_,__LINE__), sizeof(*(btree))                 \
+        ))
+
+/**
+ * Position the iterator at the first element in the ``btree`` not
+ * ordered before the given value.
+ *
+ * The \a value parameter must not necessarily be the same type as the one
+ * with which the ``btree`` was instantiated. If it is not, the value is implicitly
+ * converted to the type stored in the ``btree``.
+ *
+ * \param btree Handle identifying the ``btree``
+ * \param value The value to search for
+ * \param iter Address of a ``struct scc_btree_iter`` to position
+ *
+ * \return Pointer to the element the iterator refers to, or ``NULL`` if
+ *         all elements in the ``btree`` are ordered before \a value
+ */
+#define scc_btree_lower_bound(btree, value, iter)                                                   \
+    scc_btree_impl_lower_bound((*(btree) = (value), (btree)), iter, sizeof(*(btree)))
+
+/**
+ * Position the iterator at the first element in the ``btree`` ordered
+ * after the given value.
+ *
+ * The \a value parameter must not necessarily be the same type as the one
+ * with which the ``btree`` was instantiated. If it is not, the value is implicitly
+ * converted to the type stored in the ``btree``.
+ *
+ * \param btree Handle identifying the ``btree``
+ * \param value The value to search for
+ * \param iter Address of a ``struct scc_btree_iter`` to position
+ *
+ * \return Pointer to the element the iterator refers to, or ``NULL`` if
+ *         no element in the ``btree`` is ordered after \a value
+ */
+#define scc_btree_upper_bound(btree, value, iter)                                                   \
+    scc_btree_impl_upper_bound((*(btree) = (value), (btree)), iter, sizeof(*(btree)))
+
+/**
+ * Advance the iterator to the next element in the ``btree``.
+ *
+ * \param btree Handle identifying the ``btree``
+ * \param iter Address of a ``struct scc_btree_iter`` positioned using
+ *             ``scc_btree_lower_bound`` or ``scc_btree_upper_bound``
+ *
+ * \return Pointer to the next element, or ``NULL`` if the iterator was
+ *         referring to the last element in the ``btree``
+ */
+#define scc_btree_iter_next(btree, iter)                                                            \
+    scc_btree_impl_iter_next(btree, iter, sizeof(*(btree)))
+
+/**
+ * Expands to a type suitable for storing a handle to a frozen
+ * ``btree`` containing the specified type.
+ *
+ * \param type The type stored in the frozen ``btree``
+ */
+#define scc_btfrozen(type) type *
+
+/**
+ * Prefetch distance used when searching a frozen ``btree``, expressed
+ * in levels of the implicit tree. The descendants of an element \a n
+ * levels down are contiguous in memory, meaning that a single prefetch
+ * covers all of them for sufficiently small types.
+ */
+#ifndef SCC_BTFROZEN_PREFETCH_DEPTH
+#define SCC_BTFROZEN_PREFETCH_DEPTH 4u
+#endif /* SCC_BTFROZEN_PREFETCH_DEPTH */
+
+struct scc_btfrozen_base {
+    size_t bf_size;
+    scc_btcompare bf_compare;
+    struct scc_allocator const *bf_allocator;
+    unsigned char bf_keykind;
+    unsigned char bf_fwoff;
+    unsigned char bf_data[];
+};
+
+inline size_t scc_btfrozen_impl_npad(void const *frozen) {
+    return ((unsigned char const *)frozen)[-1] + sizeof(unsigned char);
+}
+
+#define scc_btfrozen_impl_base_qual(frozen, qual)                                                   \
+    scc_container_qual(                                                                             \
+        (unsigned char qual *)(frozen) - scc_btfrozen_impl_npad(frozen),                            \
+        struct scc_btfrozen_base,                                                                   \
+        bf_fwoff,                                                                                   \
+        qual                                                                                        \
+    )
+
+#define scc_btfrozen_impl_base(frozen)                                                              \
+    scc_btfrozen_impl_base_qual(frozen,)
+
+void *scc_btree_impl_freeze(void const *btree, size_t elemsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_btree_freeze:
+ * \endverbatim
+ *
+ * Create a read-only copy of the given ``btree``, suitable for lookups
+ * in data that never changes once loaded.
+ *
+ * The elements are copied into a single contiguous array in Eytzinger
+ * order, that is the breadth-first order of a complete binary search
+ * tree. The children of the element at index ``k`` are found at ``2k`` and
+ * ``2k + 1``, meaning that searches require neither links nor branches on
+ * the result of the comparisons and that upcoming elements may be prefetched.
+ *
+ * The frozen copy is independent of the ``btree`` and is allocated using the
+ * same allocator. It must be freed using ``scc_btfrozen_free``.
+ *
+ * \param btree Handle identifying the ``btree`` to freeze
+ *
+ * \return Handle referring to the frozen copy of \a btree, or ``NULL`` on
+ *         allocation failure
+ */
+#define scc_btree_freeze(btree)                                                                     \
+    scc_btree_impl_freeze(btree, sizeof(*(btree)))
+
+/**
+ * Reclaim memory allocated for the frozen ``btree``.
+ *
+ * \param frozen Handle returned by ``scc_btree_freeze``
+ */
+void scc_btfrozen_free(void *frozen);
+
+/**
+ * Query the size of the given frozen ``btree``
+ *
+ * \param frozen Handle returned by ``scc_btree_freeze``
+ *
+ * \return Number of elements in \a frozen
+ */
+inline size_t scc_btfrozen_size(void const *frozen) {
+    struct scc_btfrozen_base const *base = scc_btfrozen_impl_base_qual(frozen, const);
+    return base->bf_size;
+}
+
+void const *scc_btfrozen_impl_find(void const *frozen, size_t elemsize);
+void const *scc_btfrozen_impl_lower_bound(void const *frozen, size_t elemsize);
+
+/**
+ * Search for the given value in the frozen ``btree``.
+ *
+ * The \a value parameter must not necessarily be the same type as the one
+ * stored in the frozen ``btree``. If it is not, the value is implicitly
+ * converted to the type stored.
+ *
+ * \param frozen Handle returned by ``scc_btree_freeze``
+ * \param value The value to search for
+ *
+ * \return Pointer to the matching element, or ``NULL`` if no such element exists
+ */
+#define scc_btfrozen_find(frozen, value)                                                            \
+    scc_btfrozen_impl_find((*(frozen) = (value), (frozen)), sizeof(*(frozen)))
+
+/**
+ * Find the first element in the frozen ``btree`` not ordered before the
+ * given value.
+ *
+ * The \a value parameter must not necessarily be the same type as the one
+ * stored in the frozen ``btree``. If it is not, the value is implicitly
+ * converted to the type stored.
+ *
+ * \param frozen Handle returned by ``scc_btree_freeze``
+ * \param value The value to search for
+ *
+ * \return Pointer to the element, or ``NULL`` if all elements are ordered
+ *         before \a value
+ */
+#define scc_btfrozen_lower_bound(frozen, value)                                                     \
+    scc_btfrozen_impl_lower_bound((*(frozen) = (value), (frozen)), sizeof(*(frozen)))
+
 #endif /* SCC_BTREE_H */
@@ -1,6 +1,7 @@
 #ifndef SCC_DEQUE_H
 #define SCC_DEQUE_H
 
+#include "allocator.h"
 #include "bits.h"
 #include "bug.h"
 #include "mem.h"
@@ -59,6 +60,7 @@ struct scc_deque_base {
     size_t rd_capacity;
     size_t rd_begin;
     size_t rd_end;
+    struct scc_allocator const *rd_allocator;
     unsigned char rd_buffer[];
 };
 
@@ -69,6 +71,7 @@ struct scc_deque_base {
             size_t rd_capacity;                                                 \
             size_t rd_begin;                                                    \
             size_t rd_end;                                                      \
+            struct scc_allocator const *rd_allocator;                           \
             unsigned char rd_npad;                                              \
             unsigned char rd_dynalloc;                                          \
         } rd0;                                                                  \
@@ -83,6 +86,7 @@ struct scc_deque_base {
                 size_t rd_capacity;                                             \
                 size_t rd_begin;                                                \
                 size_t rd_end;                                                  \
+                struct scc_allocator const *rd_allocator;                       \
                 unsigned char rd_npad;                                          \
                 unsigned char rd_dynalloc;                                      \
             } rd0;                                                              \
@@ -103,7 +107,7 @@ struct scc_deque_base {
 
 void *scc_deque_impl_new(struct scc_deque_base *base, size_t offset, size_t capacity);
 
-void *scc_deque_impl_new_dyn(size_t dequesz, size_t offset, size_t capacity);
+void *scc_deque_impl_new_dyn(size_t dequesz, size_t offset, size_t capacity, struct scc_allocator const *allocator);
 
 /**
  * \verbatim embed:rst:leading-asterisk
@@ -147,7 +151,26 @@ void *scc_deque_impl_new_dyn(size_t dequesz, size_t offset, size_t capacity);
     (type *)scc_deque_impl_new_dyn(                                             \
         sizeof(scc_deque_impl_layout(type)),                                    \
         scc_deque_impl_dataoff(type),                                           \
-        SCC_DEQUE_STATIC_CAPACITY                                               \
+        SCC_DEQUE_STATIC_CAPACITY,                                              \
+        0                                                                       \
+    )
+
+/**
+ * Like ``scc_deque_new_dyn`` except that all memory used by the ``deque``
+ * is obtained from the given \a allocator.
+ *
+ * \param type The type to store in the ``deque``
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must
+ *                  outlive the ``deque``.
+ *
+ * \return Handle to a newly created ``deque``, or ``NULL`` on allocation failure
+ */
+#define scc_deque_new_in(type, allocator)                                       \
+    (type *)scc_deque_impl_new_dyn(                                             \
+        sizeof(scc_deque_impl_layout(type)),                                    \
+        scc_deque_impl_dataoff(type),                                           \
+        SCC_DEQUE_STATIC_CAPACITY,                                              \
+        (allocator)                                                             \
     )
 
 /**
@@ -1,6 +1,7 @@
 #ifndef SCC_HASHMAP_H
 #define SCC_HASHMAP_H
 
+#include "allocator.h"
 #include "arch.h"
 #include "bits.h"
 #include "bug.h"
@@ -43,7 +44,25 @@
 #define scc_hashmap(keytype, valuetype)                                                 \
     scc_hashmap_impl_pair(keytype, valuetype) *
 
-#define SCC_HASHMAP_GUARDSZ ((unsigned)SCC_VECSIZE - 1u)
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_iter:
+ * \endverbatim
+ *
+ * Expands to a type suitable for iterating over a ``hashmap``
+ * mapping \a keytype instances to \a valuetype dittos.
+ *
+ * The key and value of the current pair may be accessed through
+ * the ``key`` and ``value`` pointer members in this type. The value
+ * may be modified through the latter, the key may not.
+ *
+ * \param keytype The type of the keys stored in the ``hashmap``
+ * \param valuetype The type of the values stored in the ``hashmap``
+ */
+#define scc_hashmap_iter(keytype, valuetype)                                            \
+    struct { keytype const *key; valuetype *value; }
+
+#define SCC_HASHMAP_GUARDSZ ((unsigned)SCC_VECSIZE_MAX - 1u)
 
 #define SCC_HASHMAP_CANARYSZ 32u
 
@@ -70,6 +89,62 @@
 #error Stack capacity must be a power of 2
 #endif
 
+#ifndef SCC_HASHMAP_BATCHSZ
+
+/**
+ * Number of keys hashed and prefetched ahead of probing by
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_find_batch <scc_hashmap_find_batch>` @endverbatim.
+ *
+ * Users may override this value when using the library by providing a
+ * preprocessor definition with this name before including the header.
+ */
+#define SCC_HASHMAP_BATCHSZ 16
+#endif
+
+#if SCC_HASHMAP_BATCHSZ <= 0
+#error Batch size must be greater than 0
+#endif
+
+#ifndef SCC_HASHMAP_MIGRATESZ
+
+/**
+ * Number of slots of the old table moved to the new one on each insertion,
+ * lookup and removal while an incremental rehash is in progress. See
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_set_incremental <scc_hashmap_set_incremental>` @endverbatim.
+ *
+ * Users may override this value when using the library by providing a
+ * preprocessor definition with this name before including the header.
+ *
+ * \warning Must be at least 2 for the migration to be guaranteed to finish before
+ *          the next rehash is due
+ */
+#define SCC_HASHMAP_MIGRATESZ 32
+#endif
+
+#if SCC_HASHMAP_MIGRATESZ < 2
+#error Migration step must be at least 2
+#endif
+
+#ifndef SCC_HASHMAP_TOMBSTONE_PERCENT
+
+/**
+ * Percentage of the capacity of a ``hashmap`` that may be occupied by tombstones,
+ * i.e. slots vacated by removals, before the map is rehashed in place. The rehash
+ * retains the capacity and requires no additional allocation.
+ *
+ * Regardless of this value, an in-place rehash is also performed should tombstones
+ * and pairs together exceed the 87.5% load threshold without the pairs alone doing so.
+ *
+ * Users may override this value when using the library by providing a
+ * preprocessor definition with this name before including the header.
+ */
+#define SCC_HASHMAP_TOMBSTONE_PERCENT 25
+#endif
+
+#if SCC_HASHMAP_TOMBSTONE_PERCENT <= 0 || SCC_HASHMAP_TOMBSTONE_PERCENT > 100
+#error Tombstone percentage must be in the range (0, 100]
+#endif
+
 /**
  * Signature of the function used for compating keys in a ``hashmap``.
  *
@@ -121,6 +196,10 @@ struct scc_hashmap_perfevts {
     size_t ev_n_hash;
     size_t ev_n_inserts;
     size_t ev_bytesz;
+    size_t ev_n_migrations;
+    size_t ev_n_migrated;
+    size_t ev_n_tombstones;
+    size_t ev_n_compactions;
 };
 
 struct scc_hashmap_base {
@@ -134,10 +213,16 @@ struct scc_hashmap_base {
 #ifdef SCC_PERFEVTS
     struct scc_hashmap_perfevts hm_perf;
 #endif
+    size_t hm_tombs;
+    void *hm_oldmap;
+    size_t hm_migrated;
+    size_t hm_hashoff;
+    struct scc_allocator const *hm_allocator;
     unsigned short hm_keyalign;
     unsigned short hm_valalign;
     unsigned char hm_dynalloc;
     unsigned char hm_valpad;
+    unsigned char hm_incremental;
     unsigned char hm_fwoff;
     unsigned char hm_buffer[];
 };
@@ -162,10 +247,16 @@ struct scc_hashmap_base {
                     size_t hm_capacity;                                                     \
                     size_t hm_pairsize;                                                     \
                     SCC_HASHMAP_INJECT_PERFEVTS(hm_perf)                                    \
+                    size_t hm_tombs;                                                        \
+                    void *hm_oldmap;                                                        \
+                    size_t hm_migrated;                                                     \
+                    size_t hm_hashoff;                                                      \
+                    struct scc_allocator const *hm_allocator;                               \
                     unsigned short hm_keyalign;                                             \
                     unsigned short hm_valalign;                                             \
                     unsigned char hm_dynalloc;                                              \
                     unsigned char hm_valpad;                                                \
+                    unsigned char hm_incremental;                                           \
                     unsigned char hm_fwoff;                                                 \
                     unsigned char hm_bkoff;                                                 \
                 } hm0;                                                                      \
@@ -191,10 +282,16 @@ struct scc_hashmap_base {
                 size_t hm_capacity;                                                         \
                 size_t hm_pairsize;                                                         \
                 SCC_HASHMAP_INJECT_PERFEVTS(hm_perf)                                        \
+                size_t hm_tombs;                                                            \
+                void *hm_oldmap;                                                            \
+                size_t hm_migrated;                                                         \
+                size_t hm_hashoff;                                                          \
+                struct scc_allocator const *hm_allocator;                                   \
                 unsigned short hm_keyalign;                                                 \
                 unsigned short hm_valalign;                                                 \
                 unsigned char hm_dynalloc;                                                  \
                 unsigned char hm_valpad;                                                    \
+                unsigned char hm_incremental;                                               \
                 unsigned char hm_fwoff;                                                     \
                 unsigned char hm_bkoff;                                                     \
             } hm0;                                                                          \
@@ -215,10 +312,16 @@ struct scc_hashmap_base {
                     size_t hm_capacity;                                                     \
                     size_t hm_pairsize;                                                     \
                     SCC_HASHMAP_INJECT_PERFEVTS(hm_perf)                                    \
+                    size_t hm_tombs;                                                        \
+                    void *hm_oldmap;                                                        \
+                    size_t hm_migrated;                                                     \
+                    size_t hm_hashoff;                                                      \
+                    struct scc_allocator const *hm_allocator;                               \
                     unsigned short hm_keyalign;                                             \
                     unsigned short hm_valalign;                                             \
                     unsigned char hm_dynalloc;                                              \
                     unsigned char hm_valpad;                                                \
+                    unsigned char hm_incremental;                                           \
                     unsigned char hm_fwoff;                                                 \
                     unsigned char hm_bkoff;                                                 \
                 } hm0;                                                                      \
@@ -243,10 +346,16 @@ struct scc_hashmap_base {
                         size_t hm_capacity;                                                 \
                         size_t hm_pairsize;                                                 \
                         SCC_HASHMAP_INJECT_PERFEVTS(hm_perf)                                \
+                        size_t hm_tombs;                                                    \
+                        void *hm_oldmap;                                                    \
+                        size_t hm_migrated;                                                 \
+                        size_t hm_hashoff;                                                  \
+                        struct scc_allocator const *hm_allocator;                           \
                         unsigned short hm_keyalign;                                         \
                         unsigned short hm_valalign;                                         \
                         unsigned char hm_dynalloc;                                          \
                         unsigned char hm_valpad;                                            \
+                        unsigned char hm_incremental;                                       \
                         unsigned char hm_fwoff;                                             \
                         unsigned char hm_bkoff;                                             \
                     } hm0;                                                                  \
@@ -259,6 +368,20 @@ struct scc_hashmap_base {
         }                                                                                   \
     )
 
+#define scc_hashmap_impl_layout_stored(keytype, valuetype)                                  \
+    struct {                                                                                \
+        scc_hashmap_impl_layout(keytype, valuetype) hm3;                                    \
+        scc_hash_type hm_hashes[SCC_HASHMAP_STACKCAP];                                      \
+    }
+
+#define scc_hashmap_impl_hashoff(keytype, valuetype)                                        \
+    sizeof(                                                                                 \
+        struct {                                                                            \
+            scc_hashmap_impl_layout(keytype, valuetype) hm3;                                \
+            scc_hash_type hm_hashes[];                                                      \
+        }                                                                                   \
+    )
+
 void *scc_hashmap_impl_new(struct scc_hashmap_base *base, size_t coff, size_t valoff, size_t keysize);
 
 void *scc_hashmap_impl_new_dyn(struct scc_hashmap_base const *sbase, size_t mapsize, size_t coff, size_t valoff, size_t keysize);
@@ -334,6 +457,27 @@ void *scc_hashmap_impl_new_dyn(struct scc_hashmap_base const *sbase, size_t maps
  * \return Handle to a dynamically allocated ``hashmap``, or ``NULL`` on failure
  */
 #define scc_hashmap_with_hash_dyn(keytype, valuetype, eq, hash)                             \
+    scc_hashmap_with_hash_in(keytype, valuetype, eq, hash, 0)
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_with_hash_in:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_hashmap_with_hash_dyn <scc_hashmap_with_hash_dyn>` @endverbatim
+ * except that the ``hashmap``, and any table it grows into, is allocated using \a allocator.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param eq Pointer to function to be used for key comparison
+ * \param hash: Pointer to function to use for hashing keys
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``hashmap``.
+ *
+ * \return Handle to a dynamically allocated ``hashmap``, or ``NULL`` on failure
+ */
+#define scc_hashmap_with_hash_in(keytype, valuetype, eq, hash, allocator)                   \
     scc_hashmap_impl_new_dyn(                                                               \
         (void *)&(struct scc_hashmap_base){                                                 \
             .hm_eq = eq,                                                                    \
@@ -343,7 +487,8 @@ void *scc_hashmap_impl_new_dyn(struct scc_hashmap_base const *sbase, size_t maps
             .hm_capacity = SCC_HASHMAP_STACKCAP,                                            \
             .hm_pairsize = sizeof(scc_hashmap_impl_pair(keytype, valuetype)),               \
             .hm_keyalign = scc_alignof(keytype),                                            \
-            .hm_valalign = scc_alignof(valuetype)                                           \
+            .hm_valalign = scc_alignof(valuetype),                                          \
+            .hm_allocator = (allocator)                                                     \
         },                                                                                  \
         sizeof(scc_hashmap_impl_layout(keytype, valuetype)),                                \
         scc_hashmap_impl_curroff(keytype, valuetype),                                       \
@@ -351,6 +496,111 @@ void *scc_hashmap_impl_new_dyn(struct scc_hashmap_base const *sbase, size_t maps
         sizeof(keytype)                                                                     \
     )
 
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_with_stored_hash:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_hashmap_with_hash <scc_hashmap_with_hash>` @endverbatim
+ * except for the full hash of each key being stored alongside the key.
+ *
+ * Keeping the hashes around means that keys never have to be rehashed when the ``hashmap``
+ * grows. The portable probes also compare the stored hash before calling \a eq, which is then
+ * only invoked for keys whose full hashes are equal. The vectorized probes used when
+ * ``SCC_SIMD_ISA`` is set filter on the metadata tag alone. This comes at the cost of an
+ * additional ``sizeof(scc_hash_type)`` bytes per slot and is most useful for keys that are
+ * expensive to hash, such as strings.
+ *
+ * The call cannot fail.
+ *
+ * \param keytype The type of the keys to store in the map
+ * \param valuetype The type of the values to store in the map
+ * \param eq Pointer to the function to use to compare keys
+ * \param hash Pointer to the function to use for hashing keys
+ *
+ * \return Handle to a newly created ``hashmap``.
+ */
+#define scc_hashmap_with_stored_hash(keytype, valuetype, eq, hash)                          \
+    scc_hashmap_impl_new(                                                                   \
+        (void *)&(scc_hashmap_impl_layout_stored(keytype, valuetype)){                      \
+            .hm3 = {                                                                        \
+                .hm2 = {                                                                    \
+                    .hm1 = {                                                                \
+                        .hm0 = {                                                            \
+                            .hm_eq = eq,                                                    \
+                            .hm_hash = hash,                                                \
+                            .hm_valoff = scc_hashmap_impl_valoff(keytype, valuetype),       \
+                            .hm_mdoff = scc_hashmap_impl_mdoff(keytype, valuetype),         \
+                            .hm_capacity = SCC_HASHMAP_STACKCAP,                            \
+                            .hm_pairsize =                                                  \
+                                sizeof(scc_hashmap_impl_pair(keytype, valuetype)),          \
+                            .hm_hashoff = scc_hashmap_impl_hashoff(keytype, valuetype),     \
+                            .hm_keyalign = scc_alignof(keytype),                            \
+                            .hm_valalign = scc_alignof(valuetype)                           \
+                        },                                                                  \
+                    },                                                                      \
+                },                                                                          \
+            },                                                                              \
+        },                                                                                  \
+        scc_hashmap_impl_curroff(keytype, valuetype),                                       \
+        scc_hashmap_impl_pair_valoff(keytype, valuetype),                                   \
+        sizeof(keytype)                                                                     \
+    )
+
+/**
+ * Like @verbatim embed:rst:inline :ref:`scc_hashmap_with_stored_hash <scc_hashmap_with_stored_hash>` @endverbatim
+ * except for the ``hashmap`` being allocated on the heap rather than the stack.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param eq Pointer to function to be used for key comparison
+ * \param hash: Pointer to function to use for hashing keys
+ *
+ * \return Handle to a dynamically allocated ``hashmap``, or ``NULL`` on failure
+ */
+#define scc_hashmap_with_stored_hash_dyn(keytype, valuetype, eq, hash)                      \
+    scc_hashmap_with_stored_hash_in(keytype, valuetype, eq, hash, 0)
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_with_stored_hash_in:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_hashmap_with_stored_hash_dyn <scc_hashmap_with_stored_hash_dyn>` @endverbatim
+ * except that the ``hashmap``, and any table it grows into, is allocated using \a allocator.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param eq Pointer to function to be used for key comparison
+ * \param hash: Pointer to function to use for hashing keys
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``hashmap``.
+ *
+ * \return Handle to a dynamically allocated ``hashmap``, or ``NULL`` on failure
+ */
+#define scc_hashmap_with_stored_hash_in(keytype, valuetype, eq, hash, allocator)            \
+    scc_hashmap_impl_new_dyn(                                                               \
+        (void *)&(struct scc_hashmap_base){                                                 \
+            .hm_eq = eq,                                                                    \
+            .hm_hash = hash,                                                                \
+            .hm_valoff = scc_hashmap_impl_valoff(keytype, valuetype),                       \
+            .hm_mdoff = scc_hashmap_impl_mdoff(keytype, valuetype),                         \
+            .hm_capacity = SCC_HASHMAP_STACKCAP,                                            \
+            .hm_pairsize = sizeof(scc_hashmap_impl_pair(keytype, valuetype)),               \
+            .hm_hashoff = scc_hashmap_impl_hashoff(keytype, valuetype),                     \
+            .hm_keyalign = scc_alignof(keytype),                                            \
+            .hm_valalign = scc_alignof(valuetype),                                          \
+            .hm_allocator = (allocator)                                                     \
+        },                                                                                  \
+        sizeof(scc_hashmap_impl_layout_stored(keytype, valuetype)),                         \
+        scc_hashmap_impl_curroff(keytype, valuetype),                                       \
+        scc_hashmap_impl_pair_valoff(keytype, valuetype),                                   \
+        sizeof(keytype)                                                                     \
+    )
+
 /**
  * \verbatim embed:rst:leading-asterisk
  *  .. _scc_hashmap_new:
@@ -401,6 +651,175 @@ void *scc_hashmap_impl_new_dyn(struct scc_hashmap_base const *sbase, size_t maps
 #define scc_hashmap_new_dyn(keytype, valuetype, eq)                                       \
     scc_hashmap_with_hash_dyn(keytype, valuetype, eq, scc_hash_fnv1a)
 
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_new_in:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_hashmap_new_dyn <scc_hashmap_new_dyn>` @endverbatim
+ * except that all memory used by the ``hashmap`` is obtained from \a allocator.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to store in the ``hashmap``
+ * \param valuetype Type of the values to store in the map
+ * \param eq Pointer to function used to compare keys for equality
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``hashmap``.
+ *
+ * \return Opaque pointer referring to a dynamically allocated ``hashmap`` or ``NULL`` on failure.
+ */
+#define scc_hashmap_new_in(keytype, valuetype, eq, allocator)                               \
+    scc_hashmap_with_hash_in(keytype, valuetype, eq, scc_hash_fnv1a, allocator)
+
+#define scc_hashmap_impl_scalar_eq(keytype)                                                 \
+    (                                                                                       \
+        scc_static_assert(                                                                  \
+            sizeof(keytype) == 1u || sizeof(keytype) == 2u ||                               \
+            sizeof(keytype) == 4u || sizeof(keytype) == 8u,                                 \
+            "Scalar keys must be 1, 2, 4 or 8 bytes in size"                                \
+        ),                                                                                  \
+        (scc_hashmap_eq)0                                                                   \
+    )
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_new_scalar:
+ * \endverbatim
+ *
+ * Initializes a ``hashmap`` with integer or pointer keys.
+ *
+ * Rather than calling an equality function through a pointer, keys are compared
+ * inline as integers of size ``sizeof(keytype)``. This saves an indirect call and
+ * the associated register spills for every slot whose stored hash matches the one
+ * being probed for. The same default hash function as
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_new <scc_hashmap_new>` @endverbatim
+ * is used.
+ *
+ * The size of \a key \a type must be 1, 2, 4 or 8 bytes, checked at compile time.
+ *
+ * The call cannot fail.
+ *
+ * \warning Keys are considered equal if and only if their object representations are.
+ *          Types with padding bits or multiple representations of the same value, such
+ *          as floating point types, must not be used.
+ *
+ * \param keytype Integer or pointer type of the keys to be stored in the ``hashmap``
+ * \param valuetype Type of the values to be stored in the map
+ *
+ * \return An opaque pointer referring to the newly created ``hashmap``
+ */
+#define scc_hashmap_new_scalar(keytype, valuetype)                                          \
+    scc_hashmap_with_hash(keytype, valuetype, scc_hashmap_impl_scalar_eq(keytype), scc_hash_fnv1a)
+
+/**
+ * Like @verbatim embed:rst:inline :ref:`scc_hashmap_new_scalar <scc_hashmap_new_scalar>` @endverbatim
+ * except that the returned ``hashmap`` is allocated on the heap rather than the stack.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Integer or pointer type of the keys to store in the ``hashmap``
+ * \param valuetype Type of the values to store in the map
+ *
+ * \return Opaque pointer referring to a dynamically allocated ``hashmap`` or ``NULL`` on failure.
+ */
+#define scc_hashmap_new_scalar_dyn(keytype, valuetype)                                      \
+    scc_hashmap_with_hash_dyn(keytype, valuetype, scc_hashmap_impl_scalar_eq(keytype), scc_hash_fnv1a)
+
+/**
+ * Like ``scc_hashmap_new_scalar_dyn`` except that all memory used by the ``hashmap`` is obtained from \a allocator.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Integer or pointer type of the keys to store in the ``hashmap``
+ * \param valuetype Type of the values to store in the map
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``hashmap``.
+ *
+ * \return Opaque pointer referring to a dynamically allocated ``hashmap`` or ``NULL`` on failure.
+ */
+#define scc_hashmap_new_scalar_in(keytype, valuetype, allocator)                            \
+    scc_hashmap_with_hash_in(keytype, valuetype, scc_hashmap_impl_scalar_eq(keytype), scc_hash_fnv1a, allocator)
+
+void *scc_hashmap_impl_from(
+    struct scc_hashmap_base *sbase,
+    size_t coff,
+    size_t valoff,
+    size_t keysize,
+    size_t valsize,
+    void const *keys,
+    void const *vals,
+    size_t n
+);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_with_hash_from:
+ * \endverbatim
+ *
+ * Instantiate a ``hashmap`` on the heap, populated with the \a n key-value pairs
+ * formed by ``keys[i]`` and ``values[i]``.
+ *
+ * The map is sized once to hold all pairs without exceeding the 87.5% load threshold.
+ * All keys are then hashed and placed directly in their slots, bypassing the rehash checks,
+ * staging and duplicate detection performed by
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_insert <scc_hashmap_insert>` @endverbatim.
+ * This makes the call considerably faster than inserting the pairs one by one.
+ *
+ * \warning The keys must be distinct. Passing duplicate keys results in the map containing
+ *          multiple pairs with the same key.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param eq Pointer to function to be used for key comparison
+ * \param hash Pointer to function to use for hashing keys
+ * \param keys Pointer to an array of at least \a n distinct keys
+ * \param values Pointer to an array of at least \a n values
+ * \param n Number of pairs to insert
+ *
+ * \return Handle to a dynamically allocated ``hashmap``, or ``NULL`` on failure
+ */
+#define scc_hashmap_with_hash_from(keytype, valuetype, eq, hash, keys, values, n)           \
+    scc_hashmap_impl_from(                                                                  \
+        &(struct scc_hashmap_base){                                                         \
+            .hm_eq = eq,                                                                    \
+            .hm_hash = hash,                                                                \
+            .hm_pairsize = sizeof(scc_hashmap_impl_pair(keytype, valuetype)),               \
+            .hm_keyalign = scc_alignof(keytype),                                            \
+            .hm_valalign = scc_alignof(valuetype)                                           \
+        },                                                                                  \
+        scc_hashmap_impl_curroff(keytype, valuetype),                                       \
+        scc_hashmap_impl_pair_valoff(keytype, valuetype),                                   \
+        sizeof(keytype),                                                                    \
+        sizeof(valuetype),                                                                  \
+        (keytype const *){ keys },                                                          \
+        (valuetype const *){ values },                                                      \
+        n                                                                                   \
+    )
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_from:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_hashmap_with_hash_from <scc_hashmap_with_hash_from>` @endverbatim
+ * using the same default hash function as
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_new <scc_hashmap_new>` @endverbatim.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param eq Pointer to function to be used for key comparison
+ * \param keys Pointer to an array of at least \a n distinct keys
+ * \param values Pointer to an array of at least \a n values
+ * \param n Number of pairs to insert
+ *
+ * \return Handle to a dynamically allocated ``hashmap``, or ``NULL`` on failure
+ */
+#define scc_hashmap_from(keytype, valuetype, eq, keys, values, n)                           \
+    scc_hashmap_with_hash_from(keytype, valuetype, eq, scc_hash_fnv1a, keys, values, n)
+
 inline size_t scc_hashmap_impl_bkpad(void const *map) {
     return ((unsigned char const *)map)[-1] + sizeof(((struct scc_hashmap_base *)0)->hm_fwoff);
 }
@@ -431,7 +850,13 @@ void scc_hashmap_free(void *map);
 
 _Bool scc_hashmap_impl_insert(void *mapaddr, size_t keysize, size_t valsize);
 
+_Bool scc_hashmap_impl_insert_hashed(void *mapaddr, size_t keysize, size_t valsize, scc_hash_type hash);
+
 /**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_insert:
+ * \endverbatim
+ *
  * Insert a key-value pair in the ``hashmap``.
  *
  * If the \a key is already present in the ``hashmap``, its assocaited value is replaced with the
@@ -502,8 +927,103 @@ inline size_t scc_hashmap_size(void const *map) {
     return base->hm_size;
 }
 
+_Bool scc_hashmap_impl_reserve(void *mapaddr, size_t capacity, size_t keysize, size_t valsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_reserve:
+ * \endverbatim
+ *
+ * Reserve storage for at least \a capacity number of key-value pairs in the ``hashmap``.
+ *
+ * The ``hashmap`` is rehashed at most once, to the smallest power-of-2 capacity able to hold
+ * \a capacity pairs without exceeding the 87.5% load threshold. Inserting up to \a capacity
+ * pairs afterwards does not trigger any further rehashes.
+ *
+ * If reallocation is required, any and all existing pointers into the map are
+ * invalidated.
+ *
+ * \param mapaddr Address of the handle referring to the ``hashmap``
+ * \param capacity The number of pairs to reserve storage for
+ *
+ * \return ``true`` if enough memory could be reserved, otherwise ``false``
+ */
+#define scc_hashmap_reserve(mapaddr, capacity)                              \
+    scc_hashmap_impl_reserve(                                               \
+        mapaddr,                                                            \
+        capacity,                                                           \
+        sizeof((*(mapaddr))->hp_key),                                       \
+        sizeof((*(mapaddr))->hp_val)                                        \
+    )
+
+_Bool scc_hashmap_impl_shrink_to_fit(void *mapaddr, size_t keysize, size_t valsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_shrink_to_fit:
+ * \endverbatim
+ *
+ * Reduce the capacity of the ``hashmap`` to the smallest power of 2 able to hold its current
+ * pairs without exceeding the 87.5% load threshold. The capacity is never reduced below
+ * ``SCC_HASHMAP_STACKCAP``. Any tombstones left behind by removals are dropped in the process.
+ *
+ * If reallocation takes place, any and all existing pointers into the map are
+ * invalidated.
+ *
+ * \param mapaddr Address of the handle referring to the ``hashmap``
+ *
+ * \return ``true`` on success, ``false`` if a smaller map could not be allocated. The original
+ *         map is left untouched in the latter case.
+ */
+#define scc_hashmap_shrink_to_fit(mapaddr)                                  \
+    scc_hashmap_impl_shrink_to_fit(                                         \
+        mapaddr,                                                            \
+        sizeof((*(mapaddr))->hp_key),                                       \
+        sizeof((*(mapaddr))->hp_val)                                        \
+    )
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_set_incremental:
+ * \endverbatim
+ *
+ * Enable or disable incremental rehashing of the given ``hashmap``.
+ *
+ * By default, all pairs are moved to the new table in the same call that
+ * triggers the rehash. With incremental rehashing enabled, the old table is
+ * instead kept alive alongside the new one and each subsequent insertion,
+ * lookup and removal moves at most ``SCC_HASHMAP_MIGRATESZ`` slots until the
+ * old table is empty. This bounds the worst-case latency of an insertion at
+ * the cost of lookups probing both tables for as long as the migration is
+ * ongoing.
+ *
+ * Disabling incremental rehashing does not abort a migration already in
+ * progress, it only affects subsequent rehashes.
+ *
+ * \note While a migration is in progress, pointers returned by
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_find <scc_hashmap_find>` @endverbatim
+ * are invalidated by any subsequent call operating on the ``hashmap``.
+ *
+ * \param map Handle identifying the ``hashmap``
+ * \param enable Whether or not to rehash incrementally
+ */
+inline void scc_hashmap_set_incremental(void *map, _Bool enable) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    base->hm_incremental = enable;
+}
+
 void *scc_hashmap_impl_find(void *map, size_t keysize, size_t valsize);
 
+void *scc_hashmap_impl_find_hashed(void *map, size_t keysize, size_t valsize, scc_hash_type hash);
+
+void *scc_hashmap_impl_find_shared(void *map, void const *key, size_t keysize, size_t valsize);
+
+void *scc_hashmap_impl_find_shared_hashed(void *map, void const *key, size_t keysize, size_t valsize, scc_hash_type hash);
+
+void scc_hashmap_impl_settle(void *map, size_t keysize, size_t valsize);
+
+_Bool scc_hashmap_impl_should_rehash(void *map);
+
 /**
  * \verbatim embed:rst:leading-asterisk
  *  .. _scc_hashmap_find:
@@ -537,7 +1057,52 @@ void *scc_hashmap_impl_find(void *map, size_t keysize, size_t valsize);
         sizeof((map)->hp_val)                                           \
     )
 
-_Bool scc_hashmap_impl_remove(void *map, size_t keysize);
+size_t scc_hashmap_impl_find_batch(
+    void *map,
+    void const *keys,
+    size_t n,
+    void **vals,
+    size_t keysize,
+    size_t valsize
+);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_find_batch:
+ * \endverbatim
+ *
+ * Look up the values associated with each of the \a n keys in \a keys.
+ *
+ * The keys are processed in groups of ``SCC_HASHMAP_BATCHSZ``. All keys in a group are hashed
+ * and the metadata at their respective start slots prefetched before any of them is probed,
+ * allowing the cache misses of independent lookups to overlap. On large maps, this is
+ * considerably faster than invoking
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_find <scc_hashmap_find>` @endverbatim
+ * in a loop.
+ *
+ * The value pointer for ``keys[i]`` is written to ``out_values[i]``. Keys not present in
+ * the map result in ``NULL`` being written.
+ *
+ * \param map ``hashmap`` handle
+ * \param keys Pointer to an array of at least \a n keys
+ * \param n Number of keys to look up
+ * \param out_values Pointer to an array of at least \a n value pointers
+ *
+ * \return The number of keys that were found in the map
+ */
+#define scc_hashmap_find_batch(map, keys, n, out_values)                \
+    scc_hashmap_impl_find_batch(                                        \
+        (map),                                                          \
+        (keys),                                                         \
+        (n),                                                            \
+        (void **)(out_values),                                          \
+        sizeof((map)->hp_key),                                          \
+        sizeof((map)->hp_val)                                           \
+    )
+
+_Bool scc_hashmap_impl_remove(void *map, size_t keysize, size_t valsize);
+
+_Bool scc_hashmap_impl_remove_hashed(void *map, size_t keysize, size_t valsize, scc_hash_type hash);
 
 /**
  * \verbatim embed:rst:leading-asterisk
@@ -562,7 +1127,11 @@ _Bool scc_hashmap_impl_remove(void *map, size_t keysize);
  * \return ``true`` if the removal took place, ``false`` if the key was not found
  */
 #define scc_hashmap_remove(map, key)                                    \
-    scc_hashmap_impl_remove(((map)->hp_key = (key), (map)), sizeof((map)->hp_key))
+    scc_hashmap_impl_remove(                                            \
+        ((map)->hp_key = (key), (map)),                                 \
+        sizeof((map)->hp_key),                                          \
+        sizeof((map)->hp_val)                                           \
+    )
 
 /**
  * Clear all entries in the given ``hashmap``
@@ -583,4 +1152,54 @@ void scc_hashmap_clear(void *map);
  */
 void *scc_hashmap_clone(void const *map);
 
+void const *scc_hashmap_impl_iter_begin(void *map, size_t keysize, size_t valsize);
+
+void const *scc_hashmap_impl_iter_next(void *map, size_t keysize, void const *key);
+
+inline void *scc_hashmap_impl_iter_value(void *map, void const *key, size_t keysize, size_t valsize) {
+    struct scc_hashmap_base *base = scc_hashmap_impl_base(map);
+    size_t const slot = (size_t)((unsigned char const *)key -
+        ((unsigned char const *)map + base->hm_pairsize)) / keysize;
+    return (unsigned char *)base + base->hm_valoff + slot * valsize;
+}
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashmap_foreach:
+ * \endverbatim
+ *
+ * Iterate over the key-value pairs in the ``hashmap``.
+ *
+ * Empty and vacated slots are skipped a full vector of metadata at a time,
+ * making the cost of iterating a sparse ``hashmap`` proportional to the
+ * number of pairs in it rather than its capacity.
+ *
+ * The pairs must not be inserted or removed while the ``hashmap`` is being iterated
+ * over. Values may be modified through the ``value`` member of \a iter.
+ *
+ * \note The order in which the pairs are traversed is ultimately decided by
+ *       the hash function used. If a specific order is required, users need to
+ *       enforce this by crafting an appropriate hash function.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ *  .. literalinclude:: /../examples/hashmap/iteration.c
+ *      :caption: Iterating over a ``hashmap``
+ *      :start-after: int main
+ *      :end-at: scc_hashmap_free
+ *      :language: c
+ *
+ * \endverbatim
+ *
+ * \param iter An instance of @verbatim embed:rst:inline :ref:`scc_hashmap_iter <scc_hashmap_iter>` @endverbatim
+ *             instantiated using the key and value types of \a map
+ * \param map Handle identifying the ``hashmap``
+ */
+#define scc_hashmap_foreach(iter, map)                                                      \
+    for ((iter).key = scc_hashmap_impl_iter_begin(                                          \
+            map, sizeof((map)->hp_key), sizeof((map)->hp_val));                             \
+         (iter).key && ((iter).value = scc_hashmap_impl_iter_value(                         \
+            map, (iter).key, sizeof((map)->hp_key), sizeof((map)->hp_val)), 1);             \
+         (iter).key = scc_hashmap_impl_iter_next(map, sizeof((map)->hp_key), (iter).key))
+
 #endif /* SCC_HASHMAP_H */
@@ -1,6 +1,7 @@
 #ifndef SCC_HASHTAB_H
 #define SCC_HASHTAB_H
 
+#include "allocator.h"
 #include "arch.h"
 #include "bits.h"
 #include "bug.h"
@@ -45,7 +46,7 @@
  */
 #define scc_hashtab_iter(type) type const *
 
-#define SCC_HASHTAB_GUARDSZ ((unsigned)SCC_VECSIZE - 1u)
+#define SCC_HASHTAB_GUARDSZ ((unsigned)SCC_VECSIZE_MAX - 1u)
 
 #define SCC_HASHTAB_CANARYSZ 32u
 
@@ -69,6 +70,26 @@
 #error Stack capacity must be a power of 2
 #endif
 
+#ifndef SCC_HASHTAB_MIGRATESZ
+
+/**
+ * Number of slots of the old table moved to the new one on each insertion
+ * and removal while an incremental rehash is in progress. See
+ * @verbatim embed:rst:inline :ref:`scc_hashtab_set_incremental <scc_hashtab_set_incremental>` @endverbatim.
+ *
+ * Users may override this value when using the library by providing a
+ * preprocessor definition with this name before including the header.
+ *
+ * \warning Must be at least 2 for the migration to be guaranteed to finish before
+ *          the next rehash is due
+ */
+#define SCC_HASHTAB_MIGRATESZ 32
+#endif
+
+#if SCC_HASHTAB_MIGRATESZ < 2
+#error Migration step must be at least 2
+#endif
+
 /**
  * Signature of the function used for compating elements in a ``hashtab``.
  *
@@ -120,6 +141,8 @@ struct scc_hashtab_perfevts {
     size_t ev_n_hash;
     size_t ev_n_inserts;
     size_t ev_bytesz;
+    size_t ev_n_migrations;
+    size_t ev_n_migrated;
 };
 
 struct scc_hashtab_base {
@@ -131,7 +154,11 @@ struct scc_hashtab_base {
 #ifdef SCC_PERFEVTS
     struct scc_hashtab_perfevts ht_perf;
 #endif
+    void *ht_oldtab;
+    size_t ht_migrated;
+    struct scc_allocator const *ht_allocator;
     unsigned char ht_dynalloc;
+    unsigned char ht_incremental;
     unsigned char ht_fwoff;
     unsigned char ht_buffer[];
 };
@@ -153,7 +180,11 @@ struct scc_hashtab_base {
                 size_t ht_size;                                             \
                 size_t ht_capacity;                                         \
                 SCC_HASHTAB_INJECT_PERFEVTS(ht_perf)                        \
+                void *ht_oldtab;                                            \
+                size_t ht_migrated;                                         \
+                struct scc_allocator const *ht_allocator;                   \
                 unsigned char ht_dynalloc;                                  \
+                unsigned char ht_incremental;                               \
                 unsigned char ht_fwoff;                                     \
                 unsigned char ht_bkoff;                                     \
             } ht0;                                                          \
@@ -175,7 +206,11 @@ struct scc_hashtab_base {
                 size_t ht_size;                                             \
                 size_t ht_capacity;                                         \
                 SCC_HASHTAB_INJECT_PERFEVTS(ht_perf)                        \
+                void *ht_oldtab;                                            \
+                size_t ht_migrated;                                         \
+                struct scc_allocator const *ht_allocator;                   \
                 unsigned char ht_dynalloc;                                  \
+                unsigned char ht_incremental;                               \
                 unsigned char ht_fwoff;                                     \
                 unsigned char ht_bkoff;                                     \
             } ht0;                                                          \
@@ -194,7 +229,11 @@ struct scc_hashtab_base {
                     size_t ht_size;                                         \
                     size_t ht_capacity;                                     \
                     SCC_HASHTAB_INJECT_PERFEVTS(ht_perf)                    \
+                    void *ht_oldtab;                                        \
+                    size_t ht_migrated;                                     \
+                    struct scc_allocator const *ht_allocator;               \
                     unsigned char ht_dynalloc;                              \
+                    unsigned char ht_incremental;                           \
                     unsigned char ht_fwoff;                                 \
                     unsigned char ht_bkoff;                                 \
                 } ht0;                                                      \
@@ -207,7 +246,15 @@ struct scc_hashtab_base {
 
 void *scc_hashtab_impl_new(struct scc_hashtab_base *base, size_t coff, size_t mdoff);
 
-void *scc_hashtab_impl_new_dyn(scc_hashtab_eq eq, scc_hashtab_hash hash, size_t cap, size_t tabsz, size_t coff, size_t mdoff);
+void *scc_hashtab_impl_new_dyn(
+    scc_hashtab_eq eq,
+    scc_hashtab_hash hash,
+    size_t cap,
+    size_t tabsz,
+    size_t coff,
+    size_t mdoff,
+    struct scc_allocator const *allocator
+);
 
 /**
  * \verbatim embed:rst:leading-asterisk
@@ -276,7 +323,35 @@ void *scc_hashtab_impl_new_dyn(scc_hashtab_eq eq, scc_hashtab_hash hash, size_t
         SCC_HASHTAB_STACKCAP,                                               \
         sizeof(scc_hashtab_impl_layout(type)),                              \
         scc_hashtab_impl_curroff(type),                                     \
-        scc_hashtab_impl_metaoff(type)                                      \
+        scc_hashtab_impl_metaoff(type),                                     \
+        0                                                                   \
+    )
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashtab_with_hash_in:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_hashtab_with_hash_dyn <scc_hashtab_with_hash_dyn>` @endverbatim
+ * except that the ``hashtab`` and every table it is rehashed into are allocated using the given
+ * \a allocator.
+ *
+ * \param type Type of the elements to store in the ``hashtab``
+ * \param eq Pointer to function to be used for key comparison
+ * \param hash: Pointer to function to use for hashing keys
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``hashtab``.
+ *
+ * \return Handle to a dynamically allocated ``hashtab``, or ``NULL`` on failure
+ */
+#define scc_hashtab_with_hash_in(type, eq, hash, allocator)                 \
+    (type *)scc_hashtab_impl_new_dyn(                                       \
+        eq,                                                                 \
+        hash,                                                               \
+        SCC_HASHTAB_STACKCAP,                                               \
+        sizeof(scc_hashtab_impl_layout(type)),                              \
+        scc_hashtab_impl_curroff(type),                                     \
+        scc_hashtab_impl_metaoff(type),                                     \
+        (allocator)                                                         \
     )
 
 /**
@@ -331,6 +406,89 @@ void *scc_hashtab_impl_new_dyn(scc_hashtab_eq eq, scc_hashtab_hash hash, size_t
 #define scc_hashtab_new_dyn(type, eq)                                       \
     scc_hashtab_with_hash_dyn(type, eq, scc_hash_fnv1a)
 
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashtab_new_in:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_hashtab_new_dyn <scc_hashtab_new_dyn>` @endverbatim
+ * except that all memory used by the ``hashtab`` is obtained from the given \a allocator.
+ *
+ * \param type Type of the elements to store in the ``hashtab``
+ * \param eq Pointer to function used to compare keys for equality
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``hashtab``.
+ *
+ * \return Opaque pointer referring to a dynamically allocated ``hashtab`` or ``NULL`` on failure.
+ */
+#define scc_hashtab_new_in(type, eq, allocator)                             \
+    scc_hashtab_with_hash_in(type, eq, scc_hash_fnv1a, allocator)
+
+void *scc_hashtab_impl_from(
+    scc_hashtab_eq eq,
+    scc_hashtab_hash hash,
+    size_t coff,
+    size_t elemsize,
+    void const *values,
+    size_t n
+);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashtab_with_hash_from:
+ * \endverbatim
+ *
+ * Instantiate a ``hashtab`` on the heap, populated with the first \a n elements in \a values.
+ *
+ * The table is sized once to hold all elements without exceeding the 87.5% load threshold.
+ * All elements are then hashed and placed directly in their slots, bypassing the rehash checks,
+ * staging and duplicate detection performed by
+ * @verbatim embed:rst:inline :ref:`scc_hashtab_insert <scc_hashtab_insert>` @endverbatim.
+ * This makes the call considerably faster than inserting the elements one by one.
+ *
+ * \warning The elements must be distinct. Passing duplicates results in the table containing
+ *          multiple copies of the same element.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param type Type of the elements to store in the ``hashtab``
+ * \param eq Pointer to function to be used for key comparison
+ * \param hash Pointer to function to use for hashing keys
+ * \param values Pointer to an array of at least \a n distinct elements
+ * \param n Number of elements to insert
+ *
+ * \return Handle to a dynamically allocated ``hashtab``, or ``NULL`` on failure
+ */
+#define scc_hashtab_with_hash_from(type, eq, hash, values, n)               \
+    (type *)scc_hashtab_impl_from(                                          \
+        eq,                                                                 \
+        hash,                                                               \
+        scc_hashtab_impl_curroff(type),                                     \
+        sizeof(type),                                                       \
+        (type const *){ values },                                           \
+        n                                                                   \
+    )
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashtab_from:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_hashtab_with_hash_from <scc_hashtab_with_hash_from>` @endverbatim
+ * using the same default hash function as
+ * @verbatim embed:rst:inline :ref:`scc_hashtab_new <scc_hashtab_new>` @endverbatim.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param type Type of the elements to store in the ``hashtab``
+ * \param eq Pointer to function used to compare keys for equality
+ * \param values Pointer to an array of at least \a n distinct elements
+ * \param n Number of elements to insert
+ *
+ * \return Handle to a dynamically allocated ``hashtab`` or ``NULL`` on failure.
+ */
+#define scc_hashtab_from(type, eq, values, n)                               \
+    scc_hashtab_with_hash_from(type, eq, scc_hash_fnv1a, values, n)
+
 inline size_t scc_hashtab_impl_bkpad(void const *tab) {
     return ((unsigned char const *)tab)[-1] + sizeof(((struct scc_hashtab_base *)0)->ht_fwoff);
 }
@@ -425,6 +583,32 @@ inline size_t scc_hashtab_size(void const *tab) {
     return base->ht_size;
 }
 
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashtab_set_incremental:
+ * \endverbatim
+ *
+ * Enable or disable incremental rehashing of the given ``hashtab``.
+ *
+ * With incremental rehashing enabled, the old table is kept alive alongside the
+ * new one after a rehash and each subsequent insertion and removal moves at
+ * most ``SCC_HASHTAB_MIGRATESZ`` slots until the old table is empty. Lookups
+ * probe both tables but never move any elements. Any remaining elements are
+ * moved at once when iteration starts or when
+ * @verbatim embed:rst:inline :ref:`scc_hashtab_reserve <scc_hashtab_reserve>` @endverbatim
+ * is called.
+ *
+ * Disabling incremental rehashing does not abort a migration already in
+ * progress, it only affects subsequent rehashes.
+ *
+ * \param tab Handle identifying the ``hashtab``
+ * \param enable Whether or not to rehash incrementally
+ */
+inline void scc_hashtab_set_incremental(void *tab, _Bool enable) {
+    struct scc_hashtab_base *base = scc_hashtab_impl_base(tab);
+    base->ht_incremental = enable;
+}
+
 void const *scc_hashtab_impl_find(void const *tab, size_t elemsize);
 
 /**
@@ -446,6 +630,10 @@ void const *scc_hashtab_impl_find(void const *tab, size_t elemsize);
 _Bool scc_hashtab_impl_reserve(void *tabaddr, size_t capacity, size_t elemsize);
 
 /**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_hashtab_reserve:
+ * \endverbatim
+ *
  * Reserve storage for at least \a capacity number of elements in the ``hashtab``.
  *
  * If reallocation is required, any and all existing pointers into the table are
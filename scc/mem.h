@@ -19,6 +19,14 @@
 #define scc_align(addr, bound)                          \
     (((addr) + (bound) - 1u) & ~((bound) - 1u))
 
+#if defined __GNUC__ || defined __clang__
+#define scc_prefetch(addr)                              \
+    __builtin_prefetch(addr)
+#else
+#define scc_prefetch(addr)                              \
+    ((void)(addr))
+#endif
+
 #ifdef SCC_INTERCEPT_NULLSIZE_COPIES
 
 #ifdef NDEBUG
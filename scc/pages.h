@@ -0,0 +1,64 @@
+#ifndef SCC_PAGES_H
+#define SCC_PAGES_H
+
+#include "allocator.h"
+
+#include <stddef.h>
+
+/**
+ * Alignment of blocks returned by scc_pages_alloc
+ */
+#define SCC_PAGES_LINESZ 64u
+
+/**
+ * Huge page size assumed when aligning mapped blocks
+ */
+#ifndef SCC_PAGES_HUGESZ
+#define SCC_PAGES_HUGESZ (2ull << 20u)
+#endif
+
+/**
+ * Blocks of at least this many bytes are mapped directly
+ * and advised to be backed by transparent huge pages
+ */
+#ifndef SCC_PAGES_HUGE_THRESHOLD
+#define SCC_PAGES_HUGE_THRESHOLD (8ull * SCC_PAGES_HUGESZ)
+#endif
+
+/**
+ * How a block was obtained. Stored in the dynalloc
+ * field of the hash table bases
+ */
+enum scc_pages_kind {
+    SCC_PAGES_NONE,
+    SCC_PAGES_HEAP,
+    SCC_PAGES_MAPPED
+};
+
+/**
+ * Allocate a block of the given size aligned on a SCC_PAGES_LINESZ
+ * boundary. Blocks of at least SCC_PAGES_HUGE_THRESHOLD bytes are
+ * mapped and aligned on a SCC_PAGES_HUGESZ boundary, smaller ones
+ * come from the heap. A non-NULL \a allocator is used as is, in
+ * which case neither the alignment nor the mapping applies
+ *
+ * \param allocator Allocator to use, or ``NULL`` for the default
+ * \param size Size of the block, in bytes
+ * \param zero Whether the block has to be zero-initialized
+ * \param kind Set to the scc_pages_kind of the block
+ *
+ * \return Address of the block, or ``NULL`` on allocation failure
+ */
+void *scc_pages_alloc(struct scc_allocator const *allocator, size_t size, _Bool zero, unsigned char *kind);
+
+/**
+ * Release a block obtained from scc_pages_alloc
+ *
+ * \param allocator The allocator passed to scc_pages_alloc
+ * \param addr Address of the block
+ * \param size The size passed to scc_pages_alloc
+ * \param kind The kind reported by scc_pages_alloc
+ */
+void scc_pages_free(struct scc_allocator const *allocator, void *addr, size_t size, unsigned char kind);
+
+#endif /* SCC_PAGES_H */
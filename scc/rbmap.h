@@ -184,6 +184,31 @@ typedef int(*scc_rmcompare)(void const *, void const *);
         scc_rbmnode_impl_pairoff(keytype, valuetype)                                        \
     )
 
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_rbmap_new_in:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_rbmap_new_dyn <scc_rbmap_new_dyn>` @endverbatim
+ * except that the ``rbmap`` and all of its nodes are allocated using the given \a allocator.
+ *
+ * \param keytype Type of the keys stored in the ``rbmap``
+ * \param valuetype Type of the values stored in the ``rbmap``
+ * \param compare Pointer to the comparison function to use. The signature should match
+ *                @verbatim embed:rst:inline :ref:`scc_rmcompare <scc_rmcompare>` @endverbatim
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``rbmap``.
+ *
+ * \return An opaque pointer referring to a dynamically allocated ``rbmap``, or ``NULL`` on failure.
+ */
+#define scc_rbmap_new_in(keytype, valuetype, compare, allocator)                            \
+    scc_rbtree_impl_new_dyn(                                                                \
+        sizeof(scc_rbmap_impl_layout(keytype, valuetype)),                                  \
+        &scc_arena_with_allocator(scc_rbmnode_impl_layout(keytype, valuetype), allocator),  \
+        compare,                                                                            \
+        scc_rbmap_impl_curroff(keytype, valuetype),                                         \
+        scc_rbmnode_impl_pairoff(keytype, valuetype)                                        \
+    )
+
 /**
  * Query the size of the given ``rbmap``.
  *
@@ -231,6 +231,30 @@ void *scc_rbtree_impl_new_dyn(size_t treesz, struct scc_arena *arena, scc_rbcomp
         scc_rbnode_impl_valoff(type)                                                        \
     )
 
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_rbtree_new_in:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_rbtree_new_dyn <scc_rbtree_new_dyn>` @endverbatim
+ * except that the ``rbtree`` and all of its nodes are allocated using the given \a allocator.
+ *
+ * \param type Type of the elements stored in the ``rbtree``
+ * \param compare Pointer to the comparison function to use. The signature should match
+ *                @verbatim embed:rst:inline :ref:`scc_rbcompare <scc_rbcompare>` @endverbatim
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the ``rbtree``.
+ *
+ * \return An opaque pointer referring to a dynamically allocated ``rbtree``, or ``NULL`` on failure.
+ */
+#define scc_rbtree_new_in(type, compare, allocator)                                         \
+    (type *)scc_rbtree_impl_new_dyn(                                                        \
+        sizeof(scc_rbtree_impl_layout(type)),                                               \
+        &scc_arena_with_allocator(scc_rbnode_impl_layout(type), allocator),                 \
+        compare,                                                                            \
+        scc_rbtree_impl_curroff(type),                                                      \
+        scc_rbnode_impl_valoff(type)                                                        \
+    )
+
 inline size_t scc_rbtree_impl_npad(void const *rbtree) {
     return ((unsigned char const *)rbtree)[-1] + sizeof(unsigned char);
 }
@@ -0,0 +1,124 @@
+#ifndef SCC_REGION_H
+#define SCC_REGION_H
+
+#include "allocator.h"
+
+#include <stddef.h>
+
+/**
+ * Alignment of blocks returned by scc_region_alloc
+ */
+#ifndef SCC_REGION_ALIGN
+#define SCC_REGION_ALIGN 16u
+#endif
+
+/**
+ * Size of the first chunk allocated by a region, in bytes. Subsequent
+ * chunks double in size up to SCC_REGION_MAX_CHUNKSIZE
+ */
+#ifndef SCC_REGION_CHUNKSIZE
+#define SCC_REGION_CHUNKSIZE 4096u
+#endif
+
+#ifndef SCC_REGION_MAX_CHUNKSIZE
+#define SCC_REGION_MAX_CHUNKSIZE (SCC_REGION_CHUNKSIZE << 8u)
+#endif
+
+#if SCC_REGION_MAX_CHUNKSIZE < SCC_REGION_CHUNKSIZE
+#error Max chunksize must not be less than chunksize
+#endif
+
+struct scc_region_chunk;
+
+/**
+ * Region from which blocks of arbitrary size are bump allocated and
+ * released all at once using scc_region_reset or scc_region_release.
+ *
+ * Follows the same chunk growth policy as ``scc_arena``, but with a
+ * byte granularity. The region doubles as an allocator, meaning that
+ * any container constructed through an ``_in`` constructor may be
+ * placed in it by passing the address returned by
+ * scc_region_allocator. Such containers need not be freed individually.
+ *
+ * Regions must be initialized using scc_region_init before use.
+ */
+struct scc_region {
+    struct scc_allocator rg_allocator;          /* Interface passed to containers */
+    struct scc_allocator const *rg_backing;     /* Allocator for chunks, NULL for malloc */
+    struct scc_region_chunk *rg_current;        /* Chunk being bump allocated from */
+    size_t rg_nchunks;                          /* Number of chunks in region */
+};
+
+struct scc_region_chunk {
+    struct scc_region_chunk *rc_prev;           /* Previously allocated chunk */
+    size_t rc_size;                             /* Size of rc_buffer, in bytes */
+    size_t rc_offset;                           /* Offset of first free byte in rc_buffer */
+    size_t rc_last;                             /* Offset of most recently allocated block */
+    unsigned char rc_buffer[];
+};
+
+/**
+ * Initialize a region obtaining its chunks from the given \a backing
+ * allocator
+ *
+ * \param region The region to initialize
+ * \param backing Allocator to obtain chunks from, or ``NULL`` for ``malloc``
+ */
+void scc_region_init(struct scc_region *region, struct scc_allocator const *backing);
+
+/**
+ * Obtain the allocator interface of a region, suitable for passing
+ * to the ``_in`` constructors of the containers.
+ *
+ * Memory handed out through the interface is never returned to the
+ * region individually. Freeing a container placed in the region is
+ * therefore optional, all of its memory is reclaimed on reset.
+ *
+ * \param region The region
+ *
+ * \return Allocator placing all memory in \a region
+ */
+inline struct scc_allocator const *scc_region_allocator(struct scc_region *region) {
+    return &region->rg_allocator;
+}
+
+/**
+ * Allocate a block of \a size bytes, aligned on a SCC_REGION_ALIGN boundary
+ *
+ * \param region The region to allocate from
+ * \param size Size of the block, in bytes
+ *
+ * \return Address of the block, or ``NULL`` on allocation failure
+ */
+void *scc_region_alloc(struct scc_region *region, size_t size);
+
+/**
+ * Drop every block allocated from the region. The most recently allocated
+ * chunk is kept and reused, all others are released.
+ *
+ * Containers placed in the region must not be used after the call.
+ *
+ * \param region The region to reset
+ */
+void scc_region_reset(struct scc_region *region);
+
+/**
+ * Release all memory held by the region. The region may be reused
+ * afterwards, allocating new chunks as required.
+ *
+ * \param region The region to release
+ */
+void scc_region_release(struct scc_region *region);
+
+/**
+ * Number of chunks currently held by the region
+ *
+ * \param region The region
+ *
+ * \return The number of chunks in \a region
+ */
+inline size_t scc_region_nchunks(struct scc_region const *region) {
+    return region->rg_nchunks;
+}
+
+#endif /* SCC_REGION_H */
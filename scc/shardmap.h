@@ -0,0 +1,330 @@
+#ifndef SCC_SHARDMAP_H
+#define SCC_SHARDMAP_H
+
+#include "hashmap.h"
+#include "mem.h"
+
+#include <stddef.h>
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ * .. _scc_shardmap:
+ * \endverbatim
+ *
+ * Expands to an opaque pointer suitable for referring to a
+ * ``shardmap`` mapping instances of the provided \a key \a type
+ * to \a value \a type instances.
+ *
+ * A ``shardmap`` is a hash map split into a power-of-2 number of
+ * independent ``hashmap`` shards. Keys are hashed once and the shard is
+ * selected by the hash bits immediately below those stored in the
+ * ``hashmap`` metadata. Writers lock the shard that the key maps to, meaning
+ * that threads operating on keys in different shards never contend.
+ *
+ * Lookups are optimistic. Each shard carries a sequence number that writers
+ * make odd for the duration of any modification done in place, and readers
+ * retry lookups that overlapped such a modification. Shards about to be
+ * reallocated are instead copied and replaced once the write is complete,
+ * the previous copy being freed as soon as no lookup may still refer to it.
+ * Readers therefore never write to memory shared with other threads.
+ *
+ * As a consequence, the equality function may be called with keys that are
+ * being modified concurrently. Such calls are always retried, but the
+ * equality function must not rely on the contents of the keys for anything
+ * other than the comparison itself.
+ *
+ * Each handle carries the staging area for the key and value of the
+ * current operation and must only be used by one thread at a time.
+ * Additional threads obtain handles of their own through
+ * @verbatim embed:rst:inline :ref:`scc_shardmap_attach <scc_shardmap_attach>` @endverbatim.
+ *
+ * \param keytype Type of the keys to store in the map
+ * \param valuetype Type of the values to store in the map
+ */
+#define scc_shardmap(keytype, valuetype)                                                \
+    scc_hashmap_impl_pair(keytype, valuetype) *
+
+#ifndef SCC_SHARDMAP_LINESZ
+
+/**
+ * Size in bytes to which each shard, along with its lock, is padded to
+ * avoid false sharing between threads operating on adjacent shards. The
+ * per-handle reader state is aligned and padded likewise.
+ *
+ * Users may override this value when using the library by providing a
+ * preprocessor definition with this name before including the header.
+ *
+ * \warning Must be a power of 2
+ */
+#define SCC_SHARDMAP_LINESZ 64
+#endif
+
+#if !scc_bits_is_power_of_2(SCC_SHARDMAP_LINESZ)
+#error Line size must be a power of 2
+#endif
+
+#ifndef SCC_SHARDMAP_MAXSHARDS
+
+/**
+ * Maximum number of shards in a ``shardmap``. The number of hash bits used for
+ * selecting the shard may not overlap those used for indexing into the shard
+ * for any reasonable capacity.
+ *
+ * Users may override this value when using the library by providing a
+ * preprocessor definition with this name before including the header.
+ */
+#define SCC_SHARDMAP_MAXSHARDS 4096
+#endif
+
+/* Reader state of a handle, defined in lib/shardmap.c along
+ * with the shards themselves */
+struct scc_shardmap_reader;
+
+inline size_t scc_shardmap_impl_readeroff(size_t pairsize) {
+    return scc_align(pairsize, scc_alignof(struct scc_shardmap_reader *));
+}
+
+#define scc_shardmap_impl_reader(smap)                                                  \
+    (*(struct scc_shardmap_reader **)(                                                  \
+        (unsigned char *)(smap) + scc_shardmap_impl_readeroff(sizeof(*(smap)))          \
+    ))
+
+void *scc_shardmap_impl_new(void *proto, size_t nshards, size_t pairsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_shardmap_with_hash:
+ * \endverbatim
+ *
+ * Instantiate a ``shardmap`` with \a nshards shards, using the given \a hash
+ * function and equality function \a eq for each of them.
+ *
+ * \a nshards must be a power of 2 no greater than ``SCC_SHARDMAP_MAXSHARDS``.
+ *
+ * The ``shardmap`` is allocated on the heap and must be freed using
+ * @verbatim embed:rst:inline :ref:`scc_shardmap_free <scc_shardmap_free>` @endverbatim.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param eq Pointer to function to be used for key comparison
+ * \param hash Pointer to function to use for hashing keys
+ * \param nshards Number of shards
+ *
+ * \return Handle to a newly created ``shardmap``, or ``NULL`` on failure
+ */
+#define scc_shardmap_with_hash(keytype, valuetype, eq, hash, nshards)                   \
+    scc_shardmap_impl_new(                                                              \
+        scc_hashmap_with_hash_dyn(keytype, valuetype, eq, hash),                        \
+        nshards,                                                                        \
+        sizeof(scc_hashmap_impl_pair(keytype, valuetype))                               \
+    )
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_shardmap_new:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_shardmap_with_hash <scc_shardmap_with_hash>` @endverbatim
+ * using the same default hash function as
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_new <scc_hashmap_new>` @endverbatim.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param eq Pointer to function to be used for key comparison
+ * \param nshards Number of shards, a power of 2
+ *
+ * \return Handle to a newly created ``shardmap``, or ``NULL`` on failure
+ */
+#define scc_shardmap_new(keytype, valuetype, eq, nshards)                               \
+    scc_shardmap_with_hash(keytype, valuetype, eq, scc_hash_fnv1a, nshards)
+
+/**
+ * Like @verbatim embed:rst:inline :ref:`scc_shardmap_new <scc_shardmap_new>` @endverbatim
+ * except that the keys are compared inline as described for
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_new_scalar <scc_hashmap_new_scalar>` @endverbatim.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Integer or pointer type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param nshards Number of shards, a power of 2
+ *
+ * \return Handle to a newly created ``shardmap``, or ``NULL`` on failure
+ */
+#define scc_shardmap_new_scalar(keytype, valuetype, nshards)                            \
+    scc_shardmap_with_hash(keytype, valuetype, scc_hashmap_impl_scalar_eq(keytype),     \
+                           scc_hash_fnv1a, nshards)
+
+void *scc_shardmap_impl_attach(struct scc_shardmap_reader *reader);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_shardmap_attach:
+ * \endverbatim
+ *
+ * Create a new handle referring to the same ``shardmap`` as \a smap. The
+ * new handle is typically handed to another thread, which may then use it
+ * concurrently with \a smap.
+ *
+ * The handle must be released using
+ * @verbatim embed:rst:inline :ref:`scc_shardmap_detach <scc_shardmap_detach>` @endverbatim
+ * before the ``shardmap`` itself is freed.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param smap Handle referring to the ``shardmap``
+ *
+ * \return A new handle referring to the ``shardmap``, or ``NULL`` on failure
+ */
+#define scc_shardmap_attach(smap)                                                       \
+    scc_shardmap_impl_attach(scc_shardmap_impl_reader(smap))
+
+void scc_shardmap_impl_detach(struct scc_shardmap_reader *reader);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_shardmap_detach:
+ * \endverbatim
+ *
+ * Release a handle obtained through
+ * @verbatim embed:rst:inline :ref:`scc_shardmap_attach <scc_shardmap_attach>` @endverbatim.
+ * The ``shardmap`` itself is left untouched.
+ *
+ * \param smap The handle to release
+ */
+#define scc_shardmap_detach(smap)                                                       \
+    scc_shardmap_impl_detach(scc_shardmap_impl_reader(smap))
+
+void scc_shardmap_impl_free(struct scc_shardmap_reader *reader);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_shardmap_free:
+ * \endverbatim
+ *
+ * Reclaim memory used by the ``shardmap`` and the handle returned when
+ * creating it.
+ *
+ * Any handles obtained through
+ * @verbatim embed:rst:inline :ref:`scc_shardmap_attach <scc_shardmap_attach>` @endverbatim
+ * must have been detached beforehand, and no other thread may operate on the
+ * ``shardmap`` during the call.
+ *
+ * \param smap Handle returned when creating the ``shardmap``
+ */
+#define scc_shardmap_free(smap)                                                         \
+    scc_shardmap_impl_free(scc_shardmap_impl_reader(smap))
+
+_Bool scc_shardmap_impl_insert(void *smap, struct scc_shardmap_reader *reader, size_t keysize, size_t valsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_shardmap_insert:
+ * \endverbatim
+ *
+ * Insert a key-value pair in the ``shardmap``, replacing the value associated
+ * with \a key if already present.
+ *
+ * Only the shard that the key maps to is locked for the duration of the call.
+ * Insertions requiring the shard to grow copy it first, lookups meanwhile
+ * proceed in the previous copy.
+ *
+ * \param smap Handle referring to the ``shardmap``
+ * \param key The key to insert
+ * \param value The value to insert
+ *
+ * \return ``true`` if the insertion was successful, otherwise ``false``
+ */
+#define scc_shardmap_insert(smap, key, value)                                           \
+    scc_shardmap_impl_insert(                                                           \
+        ((smap)->hp_key = (key), (smap)->hp_val = (value), (smap)),                     \
+        scc_shardmap_impl_reader(smap),                                                 \
+        sizeof((smap)->hp_key),                                                         \
+        sizeof((smap)->hp_val)                                                          \
+    )
+
+void *scc_shardmap_impl_find(void *smap, struct scc_shardmap_reader *reader, void *val, size_t keysize, size_t valsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_shardmap_find:
+ * \endverbatim
+ *
+ * Look up the value associated with \a key.
+ *
+ * No lock is taken. The lookup is retried for as long as it overlaps a
+ * modification of the shard that the key maps to. As other threads may
+ * modify the ``shardmap`` as soon as the lookup is done, the value is copied
+ * to the handle rather than referred to in place.
+ * The returned pointer remains valid until the next call made with \a smap, and
+ * modifying the value through it has no effect on the ``shardmap``.
+ *
+ * \param smap Handle referring to the ``shardmap``
+ * \param key The key to search for
+ *
+ * \return Pointer to a copy of the value associated with \a key, or ``NULL``
+ *         if the key was not found
+ */
+#define scc_shardmap_find(smap, key)                                                    \
+    scc_shardmap_impl_find(                                                             \
+        ((smap)->hp_key = (key), (smap)),                                               \
+        scc_shardmap_impl_reader(smap),                                                 \
+        &(smap)->hp_val,                                                                \
+        sizeof((smap)->hp_key),                                                         \
+        sizeof((smap)->hp_val)                                                          \
+    )
+
+_Bool scc_shardmap_impl_remove(void *smap, struct scc_shardmap_reader *reader, size_t keysize, size_t valsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_shardmap_remove:
+ * \endverbatim
+ *
+ * Remove a key-value pair from the ``shardmap``.
+ *
+ * \param smap Handle referring to the ``shardmap``
+ * \param key The key to remove
+ *
+ * \return ``true`` if the removal took place, ``false`` if the key was not found
+ */
+#define scc_shardmap_remove(smap, key)                                                  \
+    scc_shardmap_impl_remove(                                                           \
+        ((smap)->hp_key = (key), (smap)),                                               \
+        scc_shardmap_impl_reader(smap),                                                 \
+        sizeof((smap)->hp_key),                                                         \
+        sizeof((smap)->hp_val)                                                          \
+    )
+
+size_t scc_shardmap_impl_size(struct scc_shardmap_reader *reader);
+
+/**
+ * Return the number of key-value pairs in the ``shardmap``.
+ *
+ * The shards are read one at a time. With other threads inserting or
+ * removing concurrently, the result is therefore only an approximation.
+ *
+ * \param smap Handle referring to the ``shardmap``
+ *
+ * \return The number of pairs in the ``shardmap``
+ */
+#define scc_shardmap_size(smap)                                                         \
+    scc_shardmap_impl_size(scc_shardmap_impl_reader(smap))
+
+size_t scc_shardmap_impl_nshards(struct scc_shardmap_reader const *reader);
+
+/**
+ * Return the number of shards in the ``shardmap``.
+ *
+ * \param smap Handle referring to the ``shardmap``
+ *
+ * \return The number of shards
+ */
+#define scc_shardmap_nshards(smap)                                                      \
+    scc_shardmap_impl_nshards(scc_shardmap_impl_reader(smap))
+
+#endif /* SCC_SHARDMAP_H */
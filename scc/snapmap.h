@@ -0,0 +1,315 @@
+#ifndef SCC_SNAPMAP_H
+#define SCC_SNAPMAP_H
+
+#include "hashmap.h"
+#include "mem.h"
+
+#include <pthread.h>
+#include <stddef.h>
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ * .. _scc_snapmap:
+ * \endverbatim
+ *
+ * Expands to an opaque pointer suitable for referring to a
+ * ``snapmap`` mapping instances of the provided \a key \a type
+ * to \a value \a type instances.
+ *
+ * A ``snapmap`` is a read-optimized hash map for data that is read far more
+ * often than it is modified. The current contents are held in an immutable
+ * ``hashmap`` snapshot published through an atomic pointer. Lookups take no
+ * locks and write only to memory owned by the reading thread. Writers
+ * instead clone the current snapshot, modify the clone and publish it in
+ * place of the old one, which is reclaimed once no reader can still be
+ * referring to it.
+ *
+ * Each handle carries the staging area for the key and value of the
+ * current operation and must only be used by one thread at a time.
+ * Additional threads obtain handles of their own through
+ * @verbatim embed:rst:inline :ref:`scc_snapmap_attach <scc_snapmap_attach>` @endverbatim.
+ *
+ * \param keytype Type of the keys to store in the map
+ * \param valuetype Type of the values to store in the map
+ */
+#define scc_snapmap(keytype, valuetype)                                                 \
+    scc_hashmap_impl_pair(keytype, valuetype) *
+
+#ifndef SCC_SNAPMAP_LINESZ
+
+/**
+ * Alignment, in bytes, of each handle. Readers write to their handle on every
+ * lookup, aligning them keeps readers on different cores from sharing lines.
+ *
+ * Users may override this value when using the library by providing a
+ * preprocessor definition with this name before including the header.
+ *
+ * \warning Must be a power of 2
+ */
+#define SCC_SNAPMAP_LINESZ 64
+#endif
+
+#if !scc_bits_is_power_of_2(SCC_SNAPMAP_LINESZ)
+#error Line size must be a power of 2
+#endif
+
+struct scc_snapmap_base;
+
+struct scc_snapmap_reader {
+    unsigned long rd_seq;
+    struct scc_snapmap_base *rd_base;
+    struct scc_snapmap_reader *rd_next;
+    void *rd_mem;
+};
+
+struct scc_snapmap_base {
+    void *sm_snapshot;
+    struct scc_snapmap_reader *sm_readers;
+    size_t sm_pairsize;
+    pthread_mutex_t sm_wrlock;
+    pthread_mutex_t sm_rdlock;
+};
+
+inline size_t scc_snapmap_impl_readeroff(size_t pairsize) {
+    return scc_align(pairsize, scc_alignof(struct scc_snapmap_reader));
+}
+
+#define scc_snapmap_impl_reader(smap)                                                   \
+    ((struct scc_snapmap_reader *)(                                                     \
+        (unsigned char *)(smap) + scc_snapmap_impl_readeroff(sizeof(*(smap)))           \
+    ))
+
+void *scc_snapmap_impl_new(void *map, size_t pairsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_snapmap_with_hash:
+ * \endverbatim
+ *
+ * Instantiate an empty ``snapmap`` using the given \a hash function and
+ * equality function \a eq.
+ *
+ * The ``snapmap`` is allocated on the heap and must be freed using
+ * @verbatim embed:rst:inline :ref:`scc_snapmap_free <scc_snapmap_free>` @endverbatim.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param eq Pointer to function to be used for key comparison
+ * \param hash Pointer to function to use for hashing keys
+ *
+ * \return Handle to a newly created ``snapmap``, or ``NULL`` on failure
+ */
+#define scc_snapmap_with_hash(keytype, valuetype, eq, hash)                             \
+    scc_snapmap_impl_new(                                                               \
+        scc_hashmap_with_hash_dyn(keytype, valuetype, eq, hash),                        \
+        sizeof(scc_hashmap_impl_pair(keytype, valuetype))                               \
+    )
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_snapmap_new:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_snapmap_with_hash <scc_snapmap_with_hash>` @endverbatim
+ * using the same default hash function as
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_new <scc_hashmap_new>` @endverbatim.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ * \param eq Pointer to function to be used for key comparison
+ *
+ * \return Handle to a newly created ``snapmap``, or ``NULL`` on failure
+ */
+#define scc_snapmap_new(keytype, valuetype, eq)                                         \
+    scc_snapmap_with_hash(keytype, valuetype, eq, scc_hash_fnv1a)
+
+/**
+ * Like @verbatim embed:rst:inline :ref:`scc_snapmap_new <scc_snapmap_new>` @endverbatim
+ * except that the keys are compared inline as described for
+ * @verbatim embed:rst:inline :ref:`scc_hashmap_new_scalar <scc_hashmap_new_scalar>` @endverbatim.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param keytype Integer or pointer type of the keys to be stored in the map
+ * \param valuetype Type of the values to be stored in the map
+ *
+ * \return Handle to a newly created ``snapmap``, or ``NULL`` on failure
+ */
+#define scc_snapmap_new_scalar(keytype, valuetype)                                      \
+    scc_snapmap_with_hash(keytype, valuetype, scc_hashmap_impl_scalar_eq(keytype), scc_hash_fnv1a)
+
+void *scc_snapmap_impl_attach(struct scc_snapmap_base *base);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_snapmap_attach:
+ * \endverbatim
+ *
+ * Create a new handle referring to the same ``snapmap`` as \a smap, typically
+ * to be handed to another thread.
+ *
+ * The handle must be released using
+ * @verbatim embed:rst:inline :ref:`scc_snapmap_detach <scc_snapmap_detach>` @endverbatim
+ * before the ``snapmap`` itself is freed.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param smap Handle referring to the ``snapmap``
+ *
+ * \return A new handle referring to the ``snapmap``, or ``NULL`` on failure
+ */
+#define scc_snapmap_attach(smap)                                                        \
+    scc_snapmap_impl_attach(scc_snapmap_impl_reader(smap)->rd_base)
+
+void scc_snapmap_impl_detach(struct scc_snapmap_reader *reader);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_snapmap_detach:
+ * \endverbatim
+ *
+ * Release a handle obtained through
+ * @verbatim embed:rst:inline :ref:`scc_snapmap_attach <scc_snapmap_attach>` @endverbatim.
+ *
+ * \param smap The handle to release
+ */
+#define scc_snapmap_detach(smap)                                                        \
+    scc_snapmap_impl_detach(scc_snapmap_impl_reader(smap))
+
+void scc_snapmap_impl_free(struct scc_snapmap_reader *reader);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_snapmap_free:
+ * \endverbatim
+ *
+ * Reclaim memory used by the ``snapmap`` and the handle returned when
+ * creating it.
+ *
+ * Any handles obtained through
+ * @verbatim embed:rst:inline :ref:`scc_snapmap_attach <scc_snapmap_attach>` @endverbatim
+ * must have been detached beforehand, and no draft may be outstanding.
+ *
+ * \param smap Handle returned when creating the ``snapmap``
+ */
+#define scc_snapmap_free(smap)                                                          \
+    scc_snapmap_impl_free(scc_snapmap_impl_reader(smap))
+
+void *scc_snapmap_impl_find(void *smap, struct scc_snapmap_reader *reader, void *val, size_t keysize, size_t valsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_snapmap_find:
+ * \endverbatim
+ *
+ * Look up the value associated with \a key in the currently published snapshot.
+ *
+ * The lookup takes no locks. The only shared state written to is a sequence
+ * counter in the handle itself, which lets writers determine when an old
+ * snapshot may be reclaimed. The snapshot is probed without writing to it,
+ * using the portable probe rather than the vectorized ones.
+ *
+ * The value is copied to the handle, and the returned pointer remains valid
+ * until the next call made with \a smap.
+ *
+ * \param smap Handle referring to the ``snapmap``
+ * \param key The key to search for
+ *
+ * \return Pointer to a copy of the value associated with \a key, or ``NULL``
+ *         if the key was not found
+ */
+#define scc_snapmap_find(smap, key)                                                     \
+    scc_snapmap_impl_find(                                                              \
+        ((smap)->hp_key = (key), (smap)),                                               \
+        scc_snapmap_impl_reader(smap),                                                  \
+        &(smap)->hp_val,                                                                \
+        sizeof((smap)->hp_key),                                                         \
+        sizeof((smap)->hp_val)                                                          \
+    )
+
+size_t scc_snapmap_impl_size(struct scc_snapmap_reader *reader);
+
+/**
+ * Return the number of key-value pairs in the currently published snapshot.
+ *
+ * \param smap Handle referring to the ``snapmap``
+ *
+ * \return The number of pairs in the ``snapmap``
+ */
+#define scc_snapmap_size(smap)                                                          \
+    scc_snapmap_impl_size(scc_snapmap_impl_reader(smap))
+
+void *scc_snapmap_impl_edit(struct scc_snapmap_base *base);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_snapmap_edit:
+ * \endverbatim
+ *
+ * Start modifying the ``snapmap``. The currently published snapshot is cloned
+ * using @verbatim embed:rst:inline :ref:`scc_hashmap_clone <scc_hashmap_clone>` @endverbatim
+ * and the clone, referred to as the draft, is returned. The draft is an ordinary
+ * ``hashmap`` and may be modified using any of the ``scc_hashmap`` functions.
+ * Readers keep seeing the published snapshot until the draft is handed to
+ * @verbatim embed:rst:inline :ref:`scc_snapmap_publish <scc_snapmap_publish>` @endverbatim.
+ *
+ * Only one draft may exist at a time. Other threads calling ``scc_snapmap_edit``
+ * block until the current draft has been either published or discarded.
+ *
+ * \note The call may fail in which case ``NULL`` is returned.
+ *
+ * \param smap Handle referring to the ``snapmap``
+ *
+ * \return Handle referring to a ``hashmap`` holding a copy of the current
+ *         snapshot, or ``NULL`` on failure
+ */
+#define scc_snapmap_edit(smap)                                                          \
+    scc_snapmap_impl_edit(scc_snapmap_impl_reader(smap)->rd_base)
+
+void scc_snapmap_impl_publish(struct scc_snapmap_base *base, void *draft, size_t keysize, size_t valsize);
+
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_snapmap_publish:
+ * \endverbatim
+ *
+ * Replace the published snapshot with the given \a draft. Lookups starting
+ * after the call see the contents of the draft.
+ *
+ * The previous snapshot is freed once every reader that could still be
+ * probing it has completed its lookup. The call blocks until then. As each
+ * lookup is short, the wait is brief.
+ *
+ * The ``snapmap`` takes ownership of the draft, which must not be modified
+ * after the call.
+ *
+ * \param smap Handle referring to the ``snapmap``
+ * \param draft Handle returned by
+ *              @verbatim embed:rst:inline :ref:`scc_snapmap_edit <scc_snapmap_edit>` @endverbatim,
+ *              after any modifications
+ */
+#define scc_snapmap_publish(smap, draft)                                                \
+    scc_snapmap_impl_publish(                                                           \
+        scc_snapmap_impl_reader(smap)->rd_base,                                         \
+        draft,                                                                          \
+        sizeof((smap)->hp_key),                                                         \
+        sizeof((smap)->hp_val)                                                          \
+    )
+
+void scc_snapmap_impl_discard(struct scc_snapmap_base *base, void *draft);
+
+/**
+ * Free the given \a draft without publishing it, leaving the ``snapmap`` unchanged.
+ *
+ * \param smap Handle referring to the ``snapmap``
+ * \param draft Handle returned by
+ *              @verbatim embed:rst:inline :ref:`scc_snapmap_edit <scc_snapmap_edit>` @endverbatim
+ */
+#define scc_snapmap_discard(smap, draft)                                                \
+    scc_snapmap_impl_discard(scc_snapmap_impl_reader(smap)->rd_base, draft)
+
+#endif /* SCC_SNAPMAP_H */
@@ -55,6 +55,21 @@
  */
 #define scc_stack_new_dyn(type) scc_pp_cat_expand(SCC_STACK_CONTAINER,_new)(type)
 
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *  .. _scc_stack_new_in:
+ * \endverbatim
+ *
+ * Like @verbatim embed:rst:inline :ref:`scc_stack_new_dyn <scc_stack_new_dyn>` @endverbatim
+ * except that all memory used by the stack is obtained from the given \a allocator.
+ *
+ * \param type The type to store in the stack.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must outlive the stack.
+ *
+ * \return A handle to a stack storing \a type instances, or ``NULL`` on failure.
+ */
+#define scc_stack_new_in(type, allocator) scc_pp_cat_expand(SCC_STACK_CONTAINER,_new_in)(type, allocator)
+
 /**
  * \verbatim embed:rst:leading-asterisk
  *  .. _scc_stack_free:
@@ -9,6 +9,7 @@
 
 typedef unsigned long long scc_vectype;
 
+/* Standard mandates that char be
  * at least 8 bits */
 #if CHAR_BIT < 8
 #error Non-conformant implementation
@@ -1,6 +1,7 @@
 #ifndef SCC_VEC_H
 #define SCC_VEC_H
 
+#include "allocator.h"
 #include "bug.h"
 #include "mem.h"
 #include "pp_token.h"
@@ -54,6 +55,7 @@
 struct scc_vec_base {
     size_t sv_size;
     size_t sv_capacity;
+    struct scc_allocator const *sv_allocator;
     unsigned char sv_buffer[];
 };
 
@@ -62,6 +64,7 @@ struct scc_vec_base {
         struct {                                                        \
             size_t sv_size;                                             \
             size_t sv_capacity;                                         \
+            struct scc_allocator const *sv_allocator;                   \
             unsigned char sv_npad;                                      \
             unsigned char sv_dynalloc;                                  \
         } v0;                                                           \
@@ -85,6 +88,7 @@ struct scc_vec_base {
             struct {                                                    \
                 size_t sv_size;                                         \
                 size_t sv_capacity;                                     \
+                struct scc_allocator const *sv_allocator;               \
                 unsigned char sv_npad;                                  \
                 unsigned char sv_dynalloc;                              \
             } v0;                                                       \
@@ -94,7 +98,7 @@ struct scc_vec_base {
 
 void *scc_vec_impl_new(struct scc_vec_base *base, size_t offset, size_t capacity);
 
-void *scc_vec_impl_new_dyn(size_t vecsz, size_t offset, size_t capacity);
+void *scc_vec_impl_new_dyn(size_t vecsz, size_t offset, size_t capacity, struct scc_allocator const *allocator);
 
 /**
  * Initialize a vector storing instances of the specified \a type.
@@ -136,12 +140,32 @@ void *scc_vec_impl_new_dyn(size_t vecsz, size_t offset, size_t capacity);
     (type *)scc_vec_impl_new_dyn(                                        \
         sizeof(scc_vec_impl_layout(type)),                               \
         scc_vec_impl_offset(type),                                       \
-        SCC_VEC_STATIC_CAPACITY                                          \
+        SCC_VEC_STATIC_CAPACITY,                                         \
+        0                                                                \
+    )
+
+/**
+ * Like ``scc_vec_new_dyn`` except that all memory used by the ``vec``
+ * is obtained from the given \a allocator.
+ *
+ * \param type The type to store in the ``vec``.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must
+ *                  outlive the ``vec``.
+ *
+ * \return A handle to the new ``vec``, or ``NULL`` on failure.
+ */
+#define scc_vec_new_in(type, allocator)                                  \
+    (type *)scc_vec_impl_new_dyn(                                        \
+        sizeof(scc_vec_impl_layout(type)),                               \
+        scc_vec_impl_offset(type),                                       \
+        SCC_VEC_STATIC_CAPACITY,                                         \
+        (allocator)                                                      \
     )
 
 void *scc_vec_impl_from(void *restrict vec, void const *restrict data, size_t size, size_t elemsize);
 
-void *scc_vec_impl_from_dyn(size_t basecap, size_t offset, void const *data, size_t size, size_t elemsize);
+void *scc_vec_impl_from_dyn(size_t basecap, size_t offset, void const *data, size_t size, size_t elemsize,
+        struct scc_allocator const *allocator);
 
 /**
  * Create and instantiate a ``vec`` holding the provided values, each
@@ -190,7 +214,29 @@ void *scc_vec_impl_from_dyn(size_t basecap, size_t offset, void const *data, siz
         scc_vec_impl_offset(type),                                          \
         (type[]){ __VA_ARGS__ },                                            \
         scc_arrsize(((type[]){ __VA_ARGS__ })),                             \
-        sizeof(type)                                                        \
+        sizeof(type),                                                       \
+        0                                                                   \
+    )
+
+/**
+ * Like ``scc_vec_from_dyn`` except that all memory used by the ``vec``
+ * is obtained from the given \a allocator.
+ *
+ * \param type The type of instances to store in the ``vec``.
+ * \param allocator Pointer to the ``struct scc_allocator`` to use. Must
+ *                  outlive the ``vec``.
+ * \param ... Arbitrary number of values to initialize the ``vec`` with.
+ *
+ * \return An opaque pointer suitable for referring to the ``vec``, or ``NULL`` on faliure.
+ */
+#define scc_vec_from_in(type, allocator, ...)                               \
+    scc_vec_impl_from_dyn(                                                  \
+        SCC_VEC_STATIC_CAPACITY,                                            \
+        scc_vec_impl_offset(type),                                          \
+        (type[]){ __VA_ARGS__ },                                            \
+        scc_arrsize(((type[]){ __VA_ARGS__ })),                             \
+        sizeof(type),                                                       \
+        (allocator)                                                         \
     )
 
 _Bool scc_vec_impl_resize(void *vecaddr, size_t size, size_t elemsize);
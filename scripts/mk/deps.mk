@@ -1,16 +1,24 @@
 ifndef __Deps_mk
 __Deps_mk := _
 
-avx2_deps            := arch canary hash hashmap hashtab murmur32 murmur64 swar
-bloom_deps           := arch canary hash murmur32 murmur64 swar
-btmap_deps           := algorithm arena vec
-btree_deps           := algorithm arena vec
-hashmap_deps         := arch canary hash hashtab murmur32 murmur64 swar
-hashtab_deps         := arch canary hash hashmap murmur32 murmur64 swar
-rbmap_deps           := arena deque rbtree
-rbtree_deps          := arena deque
-stack_deps           := vec
-hashmap_swar_deps    := arch canary hash hashmap hashtab murmur32 murmur64 swar
-hashtab_swar_deps    := arch canary hash hashmap hashtab murmur32 murmur64 swar
+arena_deps           := allocator
+avx2_deps            := allocator arch btkey canary hash hashmap hashtab murmur32 murmur64 pages swar
+bloom_deps           := allocator arch canary hash murmur32 murmur64 swar
+bptree_deps          := algorithm allocator arena vec
+btmap_deps           := algorithm allocator arch arena btkey vec
+btree_deps           := algorithm allocator arch arena btkey vec
+deque_deps           := allocator
+hashmap_deps         := allocator arch canary hash hashtab murmur32 murmur64 pages swar
+hashtab_deps         := allocator arch canary hash hashmap murmur32 murmur64 pages swar
+pages_deps           := allocator
+rbmap_deps           := allocator arena deque rbtree
+rbtree_deps          := allocator arena deque
+region_deps          := allocator arena arch canary deque hash hashmap hashtab murmur32 murmur64 pages rbtree swar vec
+shardmap_deps        := allocator arch canary hash hashmap hashtab murmur32 murmur64 pages swar
+snapmap_deps         := allocator arch canary hash hashmap hashtab murmur32 murmur64 pages swar
+stack_deps           := allocator vec
+vec_deps             := allocator
+hashmap_swar_deps    := allocator arch canary hash hashmap hashtab murmur32 murmur64 pages swar
+hashtab_swar_deps    := allocator arch canary hash hashmap hashtab murmur32 murmur64 pages swar
 
 endif # __Deps_mk
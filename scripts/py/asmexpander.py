@@ -247,7 +247,8 @@ def eval_conditionals(content):
             del content[elsexpr:endifxpr+1]
             del content[ifxpr]
         else:
-            del content[endifxpr]
+            if elsexpr != endifxpr:
+                del content[endifxpr]
             del content[ifxpr:elsexpr+1]
 
     return content
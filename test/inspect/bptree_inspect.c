@@ -0,0 +1,104 @@
+#include "bptree_inspect.h"
+
+#include <scc/bptree.h>
+
+enum { SCC_BPTREE_FLAG_LEAF = 0x01 };
+
+struct inspectctx {
+    struct scc_bptree_base const *base;
+    size_t elemsize;
+    long leafdepth;
+    size_t nelems;
+    struct scc_bpnode_base *prevleaf;
+    scc_inspect_mask mask;
+};
+
+static inline unsigned char *scc_bpnode_data(struct scc_bptree_base const *restrict base, struct scc_bpnode_base *restrict node) {
+    return (unsigned char *)node + base->bp_dataoff;
+}
+
+static inline struct scc_bpnode_base **scc_bpnode_links(struct scc_bptree_base const *restrict base, struct scc_bpnode_base *restrict node) {
+    return (void *)((unsigned char *)node + base->bp_linkoff);
+}
+
+/* Verify that all elements in the subtree rooted at node are in [min, max] */
+static void scc_bptree_inspect_node(
+    struct inspectctx *ctx,
+    struct scc_bpnode_base *node,
+    void const *min,
+    void const *max,
+    long depth
+) {
+    struct scc_bptree_base const *base = ctx->base;
+    unsigned char *data = scc_bpnode_data(base, node);
+    size_t const elemsize = ctx->elemsize;
+
+    for (unsigned i = 0u; i < node->bp_nkeys; ++i) {
+        if (min && base->bp_compare(data + i * elemsize, min) < 0) {
+            ctx->mask |= SCC_BPTREE_ERR_RIGHT;
+        }
+        if (max && base->bp_compare(data + i * elemsize, max) > 0) {
+            ctx->mask |= SCC_BPTREE_ERR_LEFT;
+        }
+        if (i && base->bp_compare(data + (i - 1u) * elemsize, data + i * elemsize) > 0) {
+            ctx->mask |= SCC_BPTREE_ERR_LEFT;
+        }
+    }
+
+    if (node != base->bp_root && node->bp_nkeys < ((base->bp_order - 1u) >> 1u)) {
+        ctx->mask |= SCC_BPTREE_ERR_CHILDREN;
+    }
+
+    struct scc_bpnode_base **links = scc_bpnode_links(base, node);
+    if (node->bp_flags & SCC_BPTREE_FLAG_LEAF) {
+        if (ctx->leafdepth == -1l) {
+            ctx->leafdepth = depth;
+        }
+        else if (ctx->leafdepth != depth) {
+            ctx->mask |= SCC_BPTREE_ERR_LEAFDEPTH;
+        }
+
+        /* Leaves must be chained in order */
+        if (links[1] != ctx->prevleaf) {
+            ctx->mask |= SCC_BPTREE_ERR_LEAFLINK;
+        }
+        if (ctx->prevleaf && scc_bpnode_links(base, ctx->prevleaf)[0] != node) {
+            ctx->mask |= SCC_BPTREE_ERR_LEAFLINK;
+        }
+        ctx->prevleaf = node;
+        ctx->nelems += node->bp_nkeys;
+        return;
+    }
+
+    if (node == base->bp_root && !node->bp_nkeys) {
+        ctx->mask |= SCC_BPTREE_ERR_ROOT;
+    }
+
+    for (unsigned i = 0u; i <= node->bp_nkeys; ++i) {
+        scc_bptree_inspect_node(
+            ctx,
+            links[i],
+            i ? data + (i - 1u) * elemsize : min,
+            i < node->bp_nkeys ? data + i * elemsize : max,
+            depth + 1l
+        );
+    }
+}
+
+scc_inspect_mask scc_bptree_impl_inspect_invariants(void const *bptree, size_t elemsize) {
+    struct scc_bptree_base const *base = scc_bptree_impl_base_qual(bptree, const);
+    struct inspectctx ctx = {
+        .base = base,
+        .elemsize = elemsize,
+        .leafdepth = -1l,
+    };
+
+    scc_bptree_inspect_node(&ctx, base->bp_root, 0, 0, 0l);
+    if (ctx.prevleaf && scc_bpnode_links(base, ctx.prevleaf)[0]) {
+        ctx.mask |= SCC_BPTREE_ERR_LEAFLINK;
+    }
+    if (ctx.nelems != base->bp_size) {
+        ctx.mask |= SCC_BPTREE_ERR_SIZE;
+    }
+    return ctx.mask;
+}
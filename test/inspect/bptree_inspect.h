@@ -0,0 +1,24 @@
+#ifndef SCC_BPTREE_INSPECT_H
+#define SCC_BPTREE_INSPECT_H
+
+#include <stddef.h>
+
+#ifndef SCC_TYPE_INSPECT_MASK
+#define SCC_TYPE_INSPECT_MASK
+typedef unsigned scc_inspect_mask;
+#endif /* SCC_TYPE_INSPECT_MASK */
+
+#define SCC_BPTREE_ERR_LEFT      0x01
+#define SCC_BPTREE_ERR_RIGHT     0x02
+#define SCC_BPTREE_ERR_CHILDREN  0x04
+#define SCC_BPTREE_ERR_LEAFDEPTH 0x08
+#define SCC_BPTREE_ERR_ROOT      0x10
+#define SCC_BPTREE_ERR_LEAFLINK  0x20
+#define SCC_BPTREE_ERR_SIZE      0x40
+
+scc_inspect_mask scc_bptree_impl_inspect_invariants(void const *bptree, size_t elemsize);
+
+#define scc_bptree_inspect_invariants(bptree)       \
+    scc_bptree_impl_inspect_invariants((bptree), sizeof(*(bptree)))
+
+#endif /* SCC_BPTREE_INSPECT_H */
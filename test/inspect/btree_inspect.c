@@ -24,6 +24,20 @@ static inline struct scc_btnode_base **scc_btnode_links(struct scc_btree_base co
     return (void *)((unsigned char *)node + base->bt_linkoff);
 }
 
+/* Size of the subtree rooted at node, flagging any node whose count differs from it */
+static size_t scc_btnode_inspect_count(struct scc_btree_base const *base, struct scc_btnode_base *node, scc_inspect_mask *mask) {
+    size_t count = node->bt_nkeys;
+    if (!(node->bt_flags & SCC_BTREE_FLAG_LEAF)) {
+        for (unsigned i = 0u; i <= node->bt_nkeys; ++i) {
+            count += scc_btnode_inspect_count(base, scc_btnode_links(base, node)[i], mask);
+        }
+    }
+    if (*(size_t const *)((unsigned char const *)node + base->bt_cntoff) != count) {
+        *mask |= SCC_BTREE_ERR_COUNT;
+    }
+    return count;
+}
+
 scc_inspect_mask scc_btree_impl_inspect_invariants(void const *btree, size_t elemsize) {
     scc_inspect_mask mask = 0u;
     struct scc_btree_base const *base = scc_btree_impl_base_qual(btree, const);
@@ -90,6 +104,10 @@ scc_inspect_mask scc_btree_impl_inspect_invariants(void const *btree, size_t ele
     }
 
     scc_stack_free(stack);
+
+    if (base->bt_cntoff && scc_btnode_inspect_count(base, base->bt_root, &mask) != base->bt_size) {
+        mask |= SCC_BTREE_ERR_COUNT;
+    }
     return mask;
 }
 
@@ -0,0 +1,57 @@
+#ifndef SCC_COUNTING_ALLOCATOR_H
+#define SCC_COUNTING_ALLOCATOR_H
+
+#include <scc/allocator.h>
+
+#include <stdlib.h>
+
+/* Allocator fixture shared by the unit tests. Each call is
+ * counted in the struct alloc_counts passed as context.
+ * Reallocating NULL counts as an allocation and freeing
+ * NULL is not counted */
+struct alloc_counts {
+    unsigned allocs;
+    unsigned reallocs;
+    unsigned frees;
+    size_t bytes;   /* Total size requested through al_alloc */
+};
+
+static struct alloc_counts alloc_counts;
+
+static inline void *counting_alloc(void *ctx, size_t size) {
+    struct alloc_counts *counts = ctx;
+    ++counts->allocs;
+    counts->bytes += size;
+    return malloc(size);
+}
+
+static inline void *counting_realloc(void *ctx, void *addr, size_t size) {
+    struct alloc_counts *counts = ctx;
+    if (addr) {
+        ++counts->reallocs;
+    }
+    else {
+        ++counts->allocs;
+    }
+    return realloc(addr, size);
+}
+
+static inline void counting_free(void *ctx, void *addr) {
+    if (addr) {
+        ++((struct alloc_counts *)ctx)->frees;
+    }
+    free(addr);
+}
+
+static struct scc_allocator const counting_allocator = {
+    .al_alloc = counting_alloc,
+    .al_realloc = counting_realloc,
+    .al_free = counting_free,
+    .al_ctx = &alloc_counts,
+};
+
+static inline void counting_allocator_reset(void) {
+    alloc_counts = (struct alloc_counts){ 0 };
+}
+
+#endif /* SCC_COUNTING_ALLOCATOR_H */
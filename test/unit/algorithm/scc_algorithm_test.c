@@ -101,3 +101,32 @@ void test_scc_algo_lower_bound_linear_limit(void) {
     TEST_ASSERT_TRUE(scc_algo_impl_lower_bound_is_linear(19u));
     TEST_ASSERT_FALSE(scc_algo_impl_lower_bound_is_linear(20u));
 }
+
+static size_t stupid_upper_bound(int val, int const *data, size_t size) {
+    size_t i = 0u;
+    while(i < size && data[i] <= val) {
+        ++i;
+    }
+    return i;
+}
+
+void test_scc_algo_upper_bound(void) {
+    int small[] = { 0, 1, 2, 2, 3, 3, 3, 66 };
+    int large[] = {
+        0, 1, 2, 2, 3, 3, 3, 4,
+        4, 4, 4, 4, 4, 4, 4, 4,
+        6, 6, 6, 6, 6, 6, 6, 7,
+        7, 7, 7, 7, 7, 7, 7, 7,
+        8, 8, 8, 8, 8, 8, 8, 8
+    };
+    for(int i = -1; i < 70; ++i) {
+        TEST_ASSERT_EQUAL_UINT64(
+            stupid_upper_bound(i, small, scc_arrsize(small)),
+            scc_algo_upper_bound(&i, small, scc_arrsize(small), sizeof(i), compare)
+        );
+        TEST_ASSERT_EQUAL_UINT64(
+            stupid_upper_bound(i, large, scc_arrsize(large)),
+            scc_algo_upper_bound(&i, large, scc_arrsize(large), sizeof(i), compare)
+        );
+    }
+}
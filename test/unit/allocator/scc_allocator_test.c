@@ -0,0 +1,68 @@
+#include <inspect/counting_allocator.h>
+#include <scc/allocator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <unity.h>
+
+/* test_scc_allocator_null
+ *
+ * A NULL allocator falls back on the standard
+ * library functions
+ */
+void test_scc_allocator_null(void) {
+    unsigned char *mem = scc_allocator_zalloc(0, 32u);
+    TEST_ASSERT_TRUE(!!mem);
+    for (unsigned i = 0u; i < 32u; ++i) {
+        TEST_ASSERT_EQUAL_UINT8(0u, mem[i]);
+    }
+    mem = scc_allocator_realloc(0, mem, 64u);
+    TEST_ASSERT_TRUE(!!mem);
+    scc_allocator_free(0, mem);
+}
+
+/* test_scc_allocator_vtable
+ *
+ * Calls are forwarded to the vtable along with
+ * the context
+ */
+void test_scc_allocator_vtable(void) {
+    struct alloc_counts counts = { 0 };
+    struct scc_allocator allocator = counting_allocator;
+    allocator.al_ctx = &counts;
+
+    void *mem = scc_allocator_alloc(&allocator, 16u);
+    TEST_ASSERT_TRUE(!!mem);
+    TEST_ASSERT_EQUAL_UINT32(1u, counts.allocs);
+    mem = scc_allocator_realloc(&allocator, mem, 128u);
+    TEST_ASSERT_TRUE(!!mem);
+    TEST_ASSERT_EQUAL_UINT32(1u, counts.reallocs);
+    scc_allocator_free(&allocator, mem);
+    TEST_ASSERT_EQUAL_UINT32(1u, counts.frees);
+}
+
+/* test_scc_allocator_zalloc
+ *
+ * Memory from scc_allocator_zalloc is zeroed even
+ * if the vtable allocation function does not
+ */
+void test_scc_allocator_zalloc(void) {
+    struct alloc_counts counts = { 0 };
+    struct scc_allocator allocator = counting_allocator;
+    allocator.al_ctx = &counts;
+
+    unsigned char *mem = scc_allocator_alloc(&allocator, 64u);
+    TEST_ASSERT_TRUE(!!mem);
+    memset(mem, 0xff, 64u);
+    scc_allocator_free(&allocator, mem);
+
+    mem = scc_allocator_zalloc(&allocator, 64u);
+    TEST_ASSERT_TRUE(!!mem);
+    for (unsigned i = 0u; i < 64u; ++i) {
+        TEST_ASSERT_EQUAL_UINT8(0u, mem[i]);
+    }
+    scc_allocator_free(&allocator, mem);
+    TEST_ASSERT_EQUAL_UINT32(2u, counts.allocs);
+    TEST_ASSERT_EQUAL_UINT32(2u, counts.frees);
+}
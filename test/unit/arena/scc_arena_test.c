@@ -1,8 +1,20 @@
+#include <inspect/counting_allocator.h>
+
 #include <scc/arena.h>
 #include <scc/mem.h>
 
+#include <stdint.h>
+#include <stdlib.h>
+
 #include <unity.h>
 
+/* Number of elements in chunk i of an arena from which
+ * no chunks have been released */
+static size_t chunk_nelems(struct scc_arena const *arena, unsigned i) {
+    size_t const nelems = (size_t)arena->ar_chunksize << i;
+    return nelems < SCC_ARENA_MAX_CHUNKSIZE ? nelems : SCC_ARENA_MAX_CHUNKSIZE;
+}
+
 void test_scc_arena_release_empty(void) {
     struct scc_arena arena = scc_arena_new(int);
     scc_arena_release(&arena);
@@ -23,7 +35,7 @@ void test_scc_arena_alloc_single_chunk(void) {
 #if SCC_ARENA_CHUNKSIZE > 1
     int *elem1 = scc_arena_alloc(&arena);
     /* Elements should be contiguous */
-    TEST_ASSERT_EQUAL_PTR(elem1, (unsigned char *)elem0 + sizeof(*elem0));
+    TEST_ASSERT_EQUAL_PTR(elem1, (unsigned char *)elem0 + arena.ar_elemsize);
     TEST_ASSERT_EQUAL_UINT32(2u, arena.ar_current->ch_refcount);
     /* Only a single chunk in arena */
     TEST_ASSERT_EQUAL_PTR(arena.ar_first, arena.ar_current);
@@ -33,7 +45,7 @@ void test_scc_arena_alloc_single_chunk(void) {
 #if SCC_ARENA_CHUNKSIZE > 2
     int *elem2 = scc_arena_alloc(&arena);
     /* Contiguous elements */
-    TEST_ASSERT_EQUAL_PTR(elem2, (unsigned char *)elem1 + sizeof(*elem1));
+    TEST_ASSERT_EQUAL_PTR(elem2, (unsigned char *)elem1 + arena.ar_elemsize);
     TEST_ASSERT_EQUAL_UINT32(3u, arena.ar_current->ch_refcount);
     /* Single chunk in arena */
     TEST_ASSERT_EQUAL_PTR(arena.ar_first, arena.ar_current);
@@ -53,7 +65,7 @@ void test_scc_arena_alloc_multiple_chunks(void) {
         /* Verify refcount */
         TEST_ASSERT_EQUAL_UINT32(i + 2u, arena.ar_current->ch_refcount);
         /* Elements should be contiguous */
-        TEST_ASSERT_EQUAL_PTR((unsigned char *)prev + sizeof(*prev), curr);
+        TEST_ASSERT_EQUAL_PTR((unsigned char *)prev + arena.ar_elemsize, curr);
         /* Single chunk in arena */
         TEST_ASSERT_EQUAL_PTR(0, arena.ar_first->ch_next);
         TEST_ASSERT_EQUAL_PTR(arena.ar_first, arena.ar_current);
@@ -69,7 +81,7 @@ void test_scc_arena_alloc_multiple_chunks(void) {
         /* Verify refcount */
         TEST_ASSERT_EQUAL_UINT32(i + 2u, arena.ar_current->ch_refcount);
         /* Contiguous addresses */
-        TEST_ASSERT_EQUAL_PTR((unsigned char *)prev + sizeof(*prev), curr);
+        TEST_ASSERT_EQUAL_PTR((unsigned char *)prev + arena.ar_elemsize, curr);
         /* Expect two chunks in arena */
         TEST_ASSERT_EQUAL_PTR(arena.ar_current, arena.ar_first->ch_next);
         /* No chunk following ar_current */
@@ -82,20 +94,32 @@ void test_scc_arena_alloc_multiple_chunks(void) {
 
 void test_scc_arena_free_single_chunk(void) {
     struct scc_arena arena = scc_arena_new(int);
-    int *elem;
-    for(unsigned i = 0; i < arena.ar_chunksize - 1u; i++) {
-        /* Allocate and verify refcount */
-        elem = scc_arena_alloc(&arena);
-        TEST_ASSERT_EQUAL_UINT32(1u, arena.ar_current->ch_refcount);
-
+    int *elem = scc_arena_alloc(&arena);
+    for(unsigned i = 0; i < arena.ar_chunksize; i++) {
         /* Free and verify refcount */
         scc_arena_free(&arena, elem);
         TEST_ASSERT_EQUAL_UINT32(0u, arena.ar_current->ch_refcount);
+
+        /* Freed element is handed out again */
+        TEST_ASSERT_EQUAL_PTR(elem, scc_arena_alloc(&arena));
+        TEST_ASSERT_EQUAL_UINT32(1u, arena.ar_current->ch_refcount);
     }
-    /* Allocate and free last element in chunk */
-    elem = scc_arena_alloc(&arena);
-    TEST_ASSERT_EQUAL_UINT32(1u, arena.ar_current->ch_refcount);
-    scc_arena_free(&arena, elem);
+
+    /* Allocate remaining elements in chunk */
+    int **elems = malloc(arena.ar_chunksize * sizeof(*elems));
+    TEST_ASSERT_TRUE(!!elems);
+    elems[0] = elem;
+    for(unsigned i = 1u; i < arena.ar_chunksize; i++) {
+        elems[i] = scc_arena_alloc(&arena);
+        TEST_ASSERT_EQUAL_UINT32(i + 1u, arena.ar_current->ch_refcount);
+    }
+    TEST_ASSERT_EQUAL_PTR(arena.ar_first, arena.ar_current);
+
+    /* Free all of them, releasing the exhausted chunk */
+    for(unsigned i = 0u; i < arena.ar_chunksize; i++) {
+        scc_arena_free(&arena, elems[i]);
+    }
+    free(elems);
 
     /* No chunks in arena */
     TEST_ASSERT_EQUAL_PTR(0, arena.ar_current);
@@ -135,15 +159,27 @@ void test_scc_arena_free_middle_chunks(void) {
     struct scc_arena arena = scc_arena_new(int);
 
     int *chks[NCHUNKS];
+    /* Elements of chunks 1 and 2, not contiguous once
+     * chunks span several segments */
+    int **elems[NCHUNKS] = { 0 };
     /* Allocate elements corresponding to 5 chunks */
     for(unsigned i = 0u; i < scc_arrsize(chks); i++) {
+        if (i == 1u || i == 2u) {
+            elems[i] = malloc(chunk_nelems(&arena, i) * sizeof(*elems[i]));
+            TEST_ASSERT_TRUE(!!elems[i]);
+        }
         /* First element of chunk i in chks[i] */
         chks[i] = scc_arena_alloc(&arena);
         /* Verify refcount */
         TEST_ASSERT_EQUAL_UINT32(1u, arena.ar_current->ch_refcount);
-        for(unsigned j = 0u; j < arena.ar_chunksize - 1u; j++) {
-            /* Throw away remaining allocations */
-            scc_arena_alloc(&arena);
+        if (elems[i]) {
+            elems[i][0] = chks[i];
+        }
+        for(unsigned j = 1u; j < chunk_nelems(&arena, i); j++) {
+            int *elem = scc_arena_alloc(&arena);
+            if (elems[i]) {
+                elems[i][j] = elem;
+            }
         }
     }
 
@@ -154,18 +190,20 @@ void test_scc_arena_free_middle_chunks(void) {
     for(unsigned i = 0u; i < scc_arrsize(chks); i++) {
         chunk = (struct scc_chunk *)((unsigned char *)chks[i] - arena.ar_baseoff);
         TEST_ASSERT_EQUAL_PTR(chunk, iter);
-        TEST_ASSERT_EQUAL_UINT32(arena.ar_chunksize, chunk->ch_refcount);
+        TEST_ASSERT_EQUAL_UINT32(chunk_nelems(&arena, i), chunk->ch_refcount);
         iter = iter->ch_next;
     }
 
     /* Free all elements in chunks 1 and 2 */
     for(unsigned i = 1u; i < 3u; i++) {
-        for(unsigned j = 0u; j < arena.ar_chunksize; j++) {
+        size_t const nelems = chunk_nelems(&arena, i);
+        for(unsigned j = 0u; j < nelems; j++) {
             chunk = (struct scc_chunk *)((unsigned char *)chks[i] - arena.ar_baseoff);
             /* Verify refcount */
-            TEST_ASSERT_EQUAL_UINT32(arena.ar_chunksize - j, chunk->ch_refcount);
-            scc_arena_free(&arena, chks[i] + j);
+            TEST_ASSERT_EQUAL_UINT32(nelems - j, chunk->ch_refcount);
+            scc_arena_free(&arena, elems[i][j]);
         }
+        free(elems[i]);
     }
 
     /* First chunk should be origin chunk 0 */
@@ -190,32 +228,40 @@ void test_scc_arena_free_first_chunk(void) {
     };
 
     struct scc_arena arena = scc_arena_new(struct foo);
-    /* Allocate 4 chunks' worth of elements */
-    struct foo *first = scc_arena_alloc(&arena);
-    for(unsigned i = 0; i < arena.ar_chunksize * 4u - 1u; i++) {
-        scc_arena_alloc(&arena);
+    /* Allocate 4 chunks' worth of elements. The chunks are
+     * large enough to be split into several segments */
+    struct foo **elems = malloc(arena.ar_chunksize * sizeof(*elems));
+    TEST_ASSERT_TRUE(!!elems);
+    for(unsigned i = 0; i < arena.ar_chunksize * 4u; i++) {
+        struct foo *elem = scc_arena_alloc(&arena);
+        if(i < arena.ar_chunksize) {
+            elems[i] = elem;
+        }
     }
 
-    struct scc_chunk *chunk = (struct scc_chunk *)((unsigned char *)first - arena.ar_baseoff);
+    struct scc_chunk *chunk = (struct scc_chunk *)((unsigned char *)elems[0] - arena.ar_baseoff);
     /* Verify head pointer */
     TEST_ASSERT_EQUAL_PTR(arena.ar_first, chunk);
     struct scc_chunk *next = chunk->ch_next;
     /* Free all elements in first chunk */
     for(unsigned i = 0; i < arena.ar_chunksize; i++) {
         TEST_ASSERT_EQUAL_UINT32(arena.ar_chunksize - i, chunk->ch_refcount);
-        scc_arena_free(&arena, first + i);
+        scc_arena_free(&arena, elems[i]);
     }
     /* First chunk should no longer be in arena */
     TEST_ASSERT_EQUAL_PTR(arena.ar_first, next);
 
+    free(elems);
     scc_arena_release(&arena);
 }
 
 void test_scc_arena_free_last_chunk(void) {
     struct scc_arena arena = scc_arena_new(int);
     /* Push 4 chunks to arena */
-    for(unsigned i = 0u; i < arena.ar_chunksize * 4u; i++) {
-        scc_arena_alloc(&arena);
+    for(unsigned i = 0u; i < 4u; i++) {
+        for(unsigned j = 0u; j < chunk_nelems(&arena, i); j++) {
+            scc_arena_alloc(&arena);
+        }
     }
     /* Check list */
     TEST_ASSERT_EQUAL_PTR(arena.ar_first->ch_next->ch_next->ch_next, arena.ar_current);
@@ -241,25 +287,36 @@ void test_scc_arena_free_last_chunk(void) {
     /* Chunk not released */
     TEST_ASSERT_EQUAL_PTR(chunk, arena.ar_current);
 
-    /* Allocate and free single element until only one free
-     * slot remains in chunk */
-    for(unsigned i = 0; i < arena.ar_chunksize - 2u; i++) {
-        p = scc_arena_alloc(&arena);
-        TEST_ASSERT_EQUAL_UINT32(1u, arena.ar_current->ch_refcount);
-        scc_arena_free(&arena, p);
-        TEST_ASSERT_EQUAL_UINT32(0u, arena.ar_current->ch_refcount);
+    /* Allocate all but the last element in chunk, the first
+     * one being the one just freed, and free them again */
+    size_t const nelems = chunk_nelems(&arena, 4u);
+    int **elems = malloc(nelems * sizeof(*elems));
+    TEST_ASSERT_TRUE(!!elems);
+    for(unsigned i = 0; i < nelems - 1u; i++) {
+        elems[i] = scc_arena_alloc(&arena);
+        TEST_ASSERT_EQUAL_UINT32(i + 1u, arena.ar_current->ch_refcount);
+    }
+    TEST_ASSERT_EQUAL_PTR(p, elems[0]);
+    for(unsigned i = 0; i < nelems - 1u; i++) {
+        scc_arena_free(&arena, elems[i]);
         /* Chunk not released */
         TEST_ASSERT_EQUAL_PTR(chunk, arena.ar_current);
     }
+    TEST_ASSERT_EQUAL_UINT32(0u, arena.ar_current->ch_refcount);
 
-    /* Allocate last element in chunk */
-    p = scc_arena_alloc(&arena);
+    /* Allocate every element in chunk, exhausting it */
+    for(unsigned i = 0; i < nelems; i++) {
+        elems[i] = scc_arena_alloc(&arena);
+    }
     /* Still not released */
     TEST_ASSERT_EQUAL_PTR(chunk, arena.ar_current);
     /* Check list layout to force check for chunk being released to be correct */
     TEST_ASSERT_EQUAL_PTR(arena.ar_first->ch_next->ch_next->ch_next->ch_next, chunk);
-    /* Free last element */
-    scc_arena_free(&arena, p);
+    /* Free all elements */
+    for(unsigned i = 0; i < nelems; i++) {
+        scc_arena_free(&arena, elems[i]);
+    }
+    free(elems);
     /* Chunk should now have been released */
     TEST_ASSERT_EQUAL_PTR(arena.ar_first->ch_next->ch_next->ch_next, arena.ar_current);
 #endif
@@ -320,3 +377,216 @@ void test_scc_arena_reserve_same_size(void) {
     TEST_ASSERT_TRUE(scc_arena_reserve(&arena, arena.ar_chunksize));
     scc_arena_release(&arena);
 }
+
+void test_scc_arena_freed_elements_reused(void) {
+    struct scc_arena arena = scc_arena_new(long long);
+    long long *elems[4];
+    for (unsigned i = 0u; i < scc_arrsize(elems); ++i) {
+        elems[i] = scc_arena_alloc(&arena);
+        TEST_ASSERT_TRUE(!!elems[i]);
+    }
+    scc_arena_free(&arena, elems[1]);
+    scc_arena_free(&arena, elems[2]);
+    TEST_ASSERT_EQUAL_UINT32(2u, arena.ar_current->ch_refcount);
+    TEST_ASSERT_EQUAL_PTR(arena.ar_current, arena.ar_avail);
+
+    /* Most recently freed element is reused first */
+    TEST_ASSERT_EQUAL_PTR(elems[2], scc_arena_alloc(&arena));
+    TEST_ASSERT_EQUAL_PTR(elems[1], scc_arena_alloc(&arena));
+    TEST_ASSERT_EQUAL_UINT32(4u, arena.ar_current->ch_refcount);
+    TEST_ASSERT_EQUAL_PTR(0, arena.ar_avail);
+
+    /* Bump allocation resumes once the free list is empty */
+    TEST_ASSERT_EQUAL_PTR(elems[3] + 1, scc_arena_alloc(&arena));
+    scc_arena_release(&arena);
+}
+
+void test_scc_arena_freed_small_elements_reused(void) {
+    struct scc_arena arena = scc_arena_new(char);
+    /* Slots are rounded up to fit the free list link */
+    TEST_ASSERT_EQUAL_UINT64(sizeof(void *), arena.ar_elemsize);
+    char *first = scc_arena_alloc(&arena);
+    char *second = scc_arena_alloc(&arena);
+    TEST_ASSERT_TRUE(first && second);
+    TEST_ASSERT_EQUAL_UINT64(sizeof(void *), (size_t)(second - first));
+
+    scc_arena_free(&arena, first);
+    TEST_ASSERT_EQUAL_PTR(arena.ar_current, arena.ar_avail);
+    TEST_ASSERT_EQUAL_PTR(first, scc_arena_alloc(&arena));
+    TEST_ASSERT_EQUAL_UINT32(2u, arena.ar_current->ch_refcount);
+    scc_arena_release(&arena);
+}
+
+void test_scc_arena_full_chunk_with_freed_elements_released(void) {
+    struct scc_arena arena = scc_arena_new(long long);
+    long long *first = scc_arena_alloc(&arena);
+    for (unsigned i = 1u; i < arena.ar_chunksize; ++i) {
+        TEST_ASSERT_EQUAL_PTR(first + i, scc_arena_alloc(&arena));
+    }
+    long long *second = scc_arena_alloc(&arena);
+    TEST_ASSERT_EQUAL_PTR(arena.ar_first->ch_next, arena.ar_current);
+
+    /* Freed elements of a full chunk are never handed out again */
+    for (unsigned i = 0u; i < arena.ar_chunksize; ++i) {
+        scc_arena_free(&arena, first + i);
+    }
+    /* First chunk released, no dangling free list */
+    TEST_ASSERT_EQUAL_PTR(arena.ar_current, arena.ar_first);
+    TEST_ASSERT_EQUAL_PTR(0, arena.ar_avail);
+    TEST_ASSERT_EQUAL_PTR((unsigned char *)second - arena.ar_baseoff, arena.ar_first);
+    scc_arena_release(&arena);
+}
+
+void test_scc_arena_chunk_found_across_segments(void) {
+    struct scc_arena arena = scc_arena_new(long long);
+    size_t const nelems = arena.ar_chunksize * 8u;
+    TEST_ASSERT_TRUE(scc_arena_reserve(&arena, nelems));
+    struct scc_chunk *chunk = arena.ar_current;
+    size_t const segsize = (size_t)1u << arena.ar_segshift;
+    /* Reserved chunk spans several segments */
+    TEST_ASSERT_GREATER_THAN_UINT64(segsize, chunk->ch_end);
+
+    long long *prev = 0;
+    for (size_t i = 0u; i < nelems; ++i) {
+        long long *elem = scc_arena_alloc(&arena);
+        TEST_ASSERT_TRUE(!!elem);
+        /* Elements never overlap a segment header */
+        TEST_ASSERT_TRUE(((uintptr_t)elem & (segsize - 1u)) >= arena.ar_baseoff);
+        TEST_ASSERT_TRUE(((uintptr_t)elem & (segsize - 1u)) + sizeof(*elem) <= segsize);
+        TEST_ASSERT_TRUE(!prev || elem > prev);
+        *elem = (long long)i;
+        prev = elem;
+    }
+    /* All elements came from the reserved chunk */
+    TEST_ASSERT_EQUAL_PTR(chunk, arena.ar_current);
+    TEST_ASSERT_EQUAL_PTR(arena.ar_first, arena.ar_current);
+    TEST_ASSERT_EQUAL_UINT64(chunk->ch_end, (size_t)((unsigned char *)prev - (unsigned char *)chunk));
+
+    /* Element in last segment is traced back to its chunk */
+    scc_arena_free(&arena, prev);
+    TEST_ASSERT_EQUAL_UINT32(nelems - 1u, chunk->ch_refcount);
+    TEST_ASSERT_EQUAL_PTR(prev, scc_arena_alloc(&arena));
+    TEST_ASSERT_EQUAL_UINT32(nelems, chunk->ch_refcount);
+    scc_arena_release(&arena);
+}
+
+void test_scc_arena_try_free_unallocated_element(void) {
+    struct scc_arena arena = scc_arena_new(long long);
+    long long *elem = scc_arena_alloc(&arena);
+    TEST_ASSERT_TRUE(!!elem);
+    /* Element past the last one handed out */
+    TEST_ASSERT_FALSE(scc_arena_try_free(&arena, elem + 1));
+    TEST_ASSERT_TRUE(scc_arena_try_free(&arena, elem));
+    scc_arena_release(&arena);
+}
+
+void test_scc_arena_try_free_foreign_element(void) {
+    struct scc_arena arena = scc_arena_new(long long);
+    long long *elem = scc_arena_alloc(&arena);
+    TEST_ASSERT_TRUE(!!elem);
+    long long *foreign = malloc(64u * sizeof(*foreign));
+    TEST_ASSERT_TRUE(!!foreign);
+    /* Neither element nor segment header of foreign memory is touched */
+    TEST_ASSERT_FALSE(scc_arena_try_free(&arena, foreign + 32));
+    TEST_ASSERT_FALSE(scc_arena_try_free(&arena, &elem));
+    TEST_ASSERT_EQUAL_UINT32(1u, arena.ar_current->ch_refcount);
+    free(foreign);
+    TEST_ASSERT_TRUE(scc_arena_try_free(&arena, elem));
+    scc_arena_release(&arena);
+}
+
+void test_scc_arena_chunks_grow_geometrically(void) {
+    struct scc_arena arena = scc_arena_new(long long);
+    size_t expected = arena.ar_chunksize;
+    for (unsigned i = 0u; i < 12u; ++i) {
+        TEST_ASSERT_EQUAL_UINT64(i, scc_arena_nchunks(&arena));
+        /* Fill a chunk */
+        for (size_t j = 0u; j < expected; ++j) {
+            TEST_ASSERT_TRUE(!!scc_arena_alloc(&arena));
+        }
+        struct scc_chunk *chunk = arena.ar_current;
+        TEST_ASSERT_EQUAL_UINT64(i + 1u, scc_arena_nchunks(&arena));
+        TEST_ASSERT_EQUAL_UINT64(expected, chunk->ch_refcount);
+        TEST_ASSERT_EQUAL_UINT64(chunk->ch_end, chunk->ch_offset);
+
+        expected <<= 1u;
+        if (expected > SCC_ARENA_MAX_CHUNKSIZE) {
+            expected = SCC_ARENA_MAX_CHUNKSIZE;
+        }
+    }
+    scc_arena_release(&arena);
+}
+
+void test_scc_arena_reserve_exact_size(void) {
+    struct scc_arena arena = scc_arena_new(long long);
+    size_t const nelems = arena.ar_chunksize * 3u + 7u;
+    TEST_ASSERT_TRUE(scc_arena_reserve(&arena, nelems));
+    TEST_ASSERT_EQUAL_UINT64(1u, scc_arena_nchunks(&arena));
+    struct scc_chunk *chunk = arena.ar_current;
+
+    for (size_t i = 0u; i < nelems; ++i) {
+        TEST_ASSERT_TRUE(!!scc_arena_alloc(&arena));
+        TEST_ASSERT_EQUAL_PTR(chunk, arena.ar_current);
+    }
+    /* Reserved chunk exactly full */
+    TEST_ASSERT_EQUAL_UINT64(chunk->ch_end, chunk->ch_offset);
+    TEST_ASSERT_TRUE(!!scc_arena_alloc(&arena));
+    TEST_ASSERT_EQUAL_UINT64(2u, scc_arena_nchunks(&arena));
+    scc_arena_release(&arena);
+}
+
+void test_scc_arena_nchunks_after_free(void) {
+    struct scc_arena arena = scc_arena_new(long long);
+    long long *first = scc_arena_alloc(&arena);
+    for (unsigned i = 1u; i < arena.ar_chunksize; ++i) {
+        TEST_ASSERT_TRUE(!!scc_arena_alloc(&arena));
+    }
+    TEST_ASSERT_TRUE(scc_arena_reserve(&arena, 1u));
+    TEST_ASSERT_EQUAL_UINT64(2u, scc_arena_nchunks(&arena));
+    for (unsigned i = 0u; i < arena.ar_chunksize; ++i) {
+        scc_arena_free(&arena, first + i);
+    }
+    TEST_ASSERT_EQUAL_UINT64(1u, scc_arena_nchunks(&arena));
+    scc_arena_reset(&arena);
+    TEST_ASSERT_EQUAL_UINT64(0u, scc_arena_nchunks(&arena));
+}
+
+void test_scc_arena_superseded_chunk_released(void) {
+    struct scc_arena arena = scc_arena_new(long long);
+    long long *elem = scc_arena_alloc(&arena);
+    struct scc_chunk *chunk = arena.ar_current;
+    /* Not enough room in the current chunk */
+    TEST_ASSERT_TRUE(scc_arena_reserve(&arena, arena.ar_chunksize));
+    TEST_ASSERT_EQUAL_PTR(chunk, arena.ar_first);
+    TEST_ASSERT_TRUE(chunk != arena.ar_current);
+    /* No longer bump allocated from, released once empty */
+    scc_arena_free(&arena, elem);
+    TEST_ASSERT_EQUAL_PTR(arena.ar_current, arena.ar_first);
+    TEST_ASSERT_EQUAL_UINT64(1u, scc_arena_nchunks(&arena));
+    scc_arena_release(&arena);
+}
+
+void test_scc_arena_large_chunk_alignment_overhead(void) {
+    struct large { unsigned char bytes[512]; };
+    counting_allocator_reset();
+    struct scc_arena arena = scc_arena_with_allocator(struct large, &counting_allocator);
+    size_t const payload = arena.ar_chunksize * sizeof(struct large);
+
+    struct large *first = scc_arena_alloc(&arena);
+    TEST_ASSERT_TRUE(!!first);
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.allocs);
+    /* Chunk split into segments much smaller than itself */
+    size_t const segsize = (size_t)1u << arena.ar_segshift;
+    TEST_ASSERT_LESS_THAN_UINT64(payload / 4u, segsize);
+    /* Headers, slack and alignment cost less than a quarter */
+    TEST_ASSERT_LESS_THAN_UINT64(payload + payload / 4u, alloc_counts.bytes);
+
+    /* Every element still traced back to its chunk */
+    for (unsigned i = 1u; i < arena.ar_chunksize; ++i) {
+        TEST_ASSERT_TRUE(!!scc_arena_alloc(&arena));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.allocs);
+    TEST_ASSERT_TRUE(scc_arena_try_free(&arena, first));
+    scc_arena_release(&arena);
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.frees);
+}
@@ -0,0 +1,95 @@
+#include <scc/arch.h>
+#include <scc/btree.h>
+#include <scc/mem.h>
+
+#include <stdint.h>
+
+#include <unity.h>
+
+enum { MAXKEYS = 67 };
+
+extern int scc_simd_support;
+extern int scc_impl_simd_level(void);
+
+static int simd_backup;
+
+static void pin_level(int level) {
+    if(scc_impl_simd_level() < level) {
+        TEST_IGNORE_MESSAGE("AVX2 not supported");
+    }
+    simd_backup = scc_simd_support;
+    scc_simd_support = level;
+}
+
+static void restore_simd(void) {
+    scc_simd_support = simd_backup;
+}
+
+/* Sorted keys with runs of duplicates and negative values */
+#define fill_keys(keys, n)                                                  \
+    do {                                                                    \
+        for(unsigned i_ = 0u; i_ < (n); ++i_) {                             \
+            (keys)[i_] = (int)(i_ / 3u) * 2 - (int)(n) / 3;                 \
+        }                                                                   \
+    } while(0)
+
+#define check_lower_bound(type, suffix)                                                         \
+    do {                                                                                        \
+        type keys[MAXKEYS];                                                                     \
+        for(unsigned n = 0u; n <= MAXKEYS; ++n) {                                               \
+            fill_keys(keys, n);                                                                 \
+            for(int k = -(int)n / 3 - 2; k <= (int)n; ++k) {                                    \
+                type key = (type)k;                                                             \
+                size_t expected = 0u;                                                           \
+                while(expected < n && keys[expected] < key) {                                   \
+                    ++expected;                                                                 \
+                }                                                                               \
+                TEST_ASSERT_EQUAL_UINT64(                                                       \
+                    expected, scc_btkey_impl_lower_bound_##suffix(keys, n, &key)                \
+                );                                                                              \
+                TEST_ASSERT_EQUAL_UINT64(                                                       \
+                    expected, scc_btkey_impl_lower_bound_##suffix##_swar(keys, n, &key)         \
+                );                                                                              \
+            }                                                                                   \
+        }                                                                                       \
+    } while(0)
+
+void test_avx2_btkey_lower_bound_i32(void) {
+    pin_level(2);
+    check_lower_bound(int32_t, i32);
+    restore_simd();
+}
+
+void test_avx2_btkey_lower_bound_i64(void) {
+    pin_level(2);
+    check_lower_bound(int64_t, i64);
+    restore_simd();
+}
+
+void test_avx2_btkey_lower_bound_f32(void) {
+    pin_level(2);
+    check_lower_bound(float, f32);
+    restore_simd();
+}
+
+void test_avx2_btkey_lower_bound_f64(void) {
+    pin_level(2);
+    check_lower_bound(double, f64);
+    restore_simd();
+}
+
+void test_avx2_btkey_lower_bound_large_i64(void) {
+    pin_level(2);
+    int64_t keys[] = { INT64_MIN, -(1ll << 40), -1, 0, 1ll << 33, INT64_MAX };
+    for(unsigned i = 0u; i < scc_arrsize(keys); ++i) {
+        TEST_ASSERT_EQUAL_UINT64(i, scc_btkey_impl_lower_bound_i64(keys, scc_arrsize(keys), &keys[i]));
+    }
+    restore_simd();
+}
+
+void test_sse2_btkey_lower_bound_falls_back(void) {
+    pin_level(1);
+    check_lower_bound(int32_t, i32);
+    check_lower_bound(double, f64);
+    restore_simd();
+}
@@ -0,0 +1,135 @@
+#include <inspect/hashmap_inspect.h>
+
+#include <scc/arch.h>
+#include <scc/hashmap.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unity.h>
+
+enum { TESTSIZE = 2048 };
+
+extern int scc_simd_support;
+extern int scc_impl_simd_level(void);
+
+static int simd_backup;
+
+static bool eq(void const *l, void const *r) {
+    return *(int const *)l == *(int const *)r;
+}
+
+static void pin_level(int level) {
+    if(scc_impl_simd_level() < level) {
+        TEST_IGNORE_MESSAGE("Instruction set not supported");
+    }
+    simd_backup = scc_simd_support;
+    scc_simd_support = level;
+}
+
+static void restore_simd(void) {
+    scc_simd_support = simd_backup;
+}
+
+/* Size of the metadata, including the guard */
+static size_t md_size(void *map) {
+    return scc_hashmap_capacity(map) + SCC_HASHMAP_GUARDSZ;
+}
+
+/* Insert keys, remove every third to leave tombstones behind and
+ * verify that the shared probe agrees with the regular one without
+ * writing to the metadata */
+static void check_find_shared(void *handle) {
+    scc_hashmap(int, unsigned) map = handle;
+    for(int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, (unsigned)i));
+    }
+    for(int i = 0; i < TESTSIZE; i += 3) {
+        TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
+    }
+
+    size_t const mdsize = md_size(map);
+    unsigned char *snapshot = malloc(mdsize);
+    TEST_ASSERT_TRUE(!!snapshot);
+    memcpy(snapshot, scc_hashmap_inspect_metadata(map), mdsize);
+
+    /* Scalar probes may load 8 bytes starting at the key */
+    int key[2] = { 0, 0 };
+    unsigned *val;
+    for(int i = 0; i < 2 * TESTSIZE; ++i) {
+        key[0] = i;
+        val = scc_hashmap_impl_find_shared(map, key, sizeof(key[0]), sizeof(*val));
+        TEST_ASSERT_EQUAL_INT(0, memcmp(snapshot, scc_hashmap_inspect_metadata(map), mdsize));
+        TEST_ASSERT_EQUAL_PTR(scc_hashmap_find(map, i), val);
+        TEST_ASSERT_EQUAL_INT(i < TESTSIZE && i % 3, !!val);
+        if(val) {
+            TEST_ASSERT_EQUAL_UINT32((unsigned)i, *val);
+        }
+    }
+    free(snapshot);
+    scc_hashmap_free(map);
+}
+
+/* Fill the metadata with tombstones, leaving no probe ends, and
+ * verify that the shared probe terminates after a single lap */
+static void check_find_shared_no_probe_end(void *handle) {
+    scc_hashmap(int, unsigned) map = handle;
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 1, 1u));
+    struct scc_hashmap_base *base = scc_hashmap_inspect_base(map);
+    scc_hashmap_metatype *md = scc_hashmap_inspect_metadata(map);
+    size_t const mdsize = md_size(map);
+    memset(md, 0x7f, mdsize);
+
+    int key[2] = { 2, 0 };
+    TEST_ASSERT_EQUAL_PTR(0, scc_hashmap_impl_find_shared(map, key, sizeof(key[0]), sizeof(unsigned)));
+    for(size_t i = 0u; i < mdsize; ++i) {
+        TEST_ASSERT_EQUAL_UINT8(0x7f, md[i]);
+    }
+
+    memset(md, 0, mdsize);
+    base->hm_size = 0u;
+    scc_hashmap_free(map);
+}
+
+void test_sse2_hashmap_find_shared(void) {
+    pin_level(1);
+    check_find_shared(scc_hashmap_new_dyn(int, unsigned, eq));
+    check_find_shared(scc_hashmap_new_scalar_dyn(int, unsigned));
+    restore_simd();
+}
+
+void test_avx2_hashmap_find_shared(void) {
+    pin_level(2);
+    check_find_shared(scc_hashmap_new_dyn(int, unsigned, eq));
+    check_find_shared(scc_hashmap_new_scalar_dyn(int, unsigned));
+    restore_simd();
+}
+
+void test_avx512_hashmap_find_shared(void) {
+    pin_level(3);
+    check_find_shared(scc_hashmap_new_dyn(int, unsigned, eq));
+    check_find_shared(scc_hashmap_new_scalar_dyn(int, unsigned));
+    restore_simd();
+}
+
+void test_sse2_hashmap_find_shared_no_probe_end(void) {
+    pin_level(1);
+    check_find_shared_no_probe_end(scc_hashmap_new_dyn(int, unsigned, eq));
+    check_find_shared_no_probe_end(scc_hashmap_new_scalar_dyn(int, unsigned));
+    restore_simd();
+}
+
+void test_avx2_hashmap_find_shared_no_probe_end(void) {
+    pin_level(2);
+    check_find_shared_no_probe_end(scc_hashmap_new_dyn(int, unsigned, eq));
+    check_find_shared_no_probe_end(scc_hashmap_new_scalar_dyn(int, unsigned));
+    restore_simd();
+}
+
+void test_avx512_hashmap_find_shared_no_probe_end(void) {
+    pin_level(3);
+    check_find_shared_no_probe_end(scc_hashmap_new_dyn(int, unsigned, eq));
+    check_find_shared_no_probe_end(scc_hashmap_new_scalar_dyn(int, unsigned));
+    restore_simd();
+}
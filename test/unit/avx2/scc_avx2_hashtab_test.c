@@ -13,6 +13,20 @@ static bool eq(void const *l, void const *r) {
     return *(int const *)l == *(int const *)r;
 }
 
+extern int scc_simd_support;
+static int simd_backup;
+
+/* Pin the dispatch to the AVX2 kernels, even on
+ * hosts supporting wider vectors */
+static void pin_avx2(void) {
+    simd_backup = scc_simd_support;
+    scc_simd_support = 2;
+}
+
+static void restore_simd(void) {
+    scc_simd_support = simd_backup;
+}
+
 /* test_insertion_probe_detects_duplicate
  *
  * Compute index to insert value in, manually insert the
@@ -166,6 +180,7 @@ void test_insertion_probe_until_stop(void) {
  * index beyond the vector
  */
 void test_insertion_probe_no_end_in_vector(void) {
+    pin_avx2();
     scc_hashtab(int) tab = scc_hashtab_new(int, eq);
 
     /* Reserve enough space to require multiple vector loads */
@@ -202,6 +217,7 @@ void test_insertion_probe_no_end_in_vector(void) {
     TEST_ASSERT_EQUAL_INT64(index + SCC_VECSIZE + 0ll, scc_hashtab_impl_probe_insert_avx2_trampoline(base, tab, sizeof(int), hash));
 
     scc_hashtab_free(tab);
+    restore_simd();
 }
 
 /* test_find_probe_empty
@@ -0,0 +1,163 @@
+#include <inspect/hashtab_inspect.h>
+
+#include <scc/arch.h>
+#include <scc/hash.h>
+#include <scc/hashtab.h>
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <unity.h>
+
+enum { XMMSIZE = 16 };
+
+extern int scc_simd_support;
+
+static int simd_backup;
+
+static bool eq(void const *l, void const *r) {
+    return *(int const *)l == *(int const *)r;
+}
+
+/* Pin the dispatch to the SSE2 kernels. SSE2 is part
+ * of the x86-64 baseline, no need to check for support */
+static void pin_sse2(void) {
+    simd_backup = scc_simd_support;
+    scc_simd_support = 1;
+}
+
+static void restore_simd(void) {
+    scc_simd_support = simd_backup;
+}
+
+static void set_md(void *tab, size_t slot, scc_hashtab_metatype ent) {
+    scc_hashtab_metatype *md = scc_hashtab_inspect_metadata(tab);
+    md[slot] = ent;
+    if(slot < SCC_HASHTAB_GUARDSZ) {
+        md[slot + scc_hashtab_capacity(tab)] = ent;
+    }
+}
+
+/* test_sse2_insertion_probe_no_end_in_xmmword
+ *
+ * Occupy a xmmword's worth of slots starting at the index
+ * the value hashes to and verify that the probing returns
+ * the first index beyond them
+ */
+void test_sse2_insertion_probe_no_end_in_xmmword(void) {
+    pin_sse2();
+    scc_hashtab(int) tab = scc_hashtab_new(int, eq);
+    TEST_ASSERT_TRUE(scc_hashtab_reserve(&tab, XMMSIZE << 2u));
+    size_t const cap = scc_hashtab_capacity(tab);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT64(XMMSIZE << 1u, cap);
+    struct scc_hashtab_base *base = scc_hashtab_inspect_base(tab);
+    int *data = scc_hashtab_inspect_data(tab);
+
+    unsigned long long hash;
+    size_t index = SIZE_MAX;
+    int elem;
+    for(elem = 0; index >= XMMSIZE; ++elem) {
+        hash = scc_hash_fnv1a(&elem, sizeof(elem));
+        index = hash & (cap - 1u);
+    }
+    --elem;
+
+    scc_hashtab_metatype meta = (scc_hashtab_metatype)(0x80 | (hash >> 57));
+    for(size_t i = 0u; i < XMMSIZE; ++i) {
+        set_md(tab, index + i, meta);
+        data[index + i] = ~elem;
+    }
+
+    *tab = elem;
+    TEST_ASSERT_EQUAL_INT64(index + XMMSIZE + 0ll, scc_hashtab_impl_probe_insert_avx2_trampoline(base, tab, sizeof(int), hash));
+    TEST_ASSERT_EQUAL_INT64(-1ll, scc_hashtab_impl_probe_find_avx2_trampoline(base, tab, sizeof(int), hash));
+
+    /* Place the value in the slot following the xmmword */
+    set_md(tab, index + XMMSIZE, meta);
+    data[index + XMMSIZE] = elem;
+    TEST_ASSERT_EQUAL_INT64(index + XMMSIZE + 0ll, scc_hashtab_impl_probe_find_avx2_trampoline(base, tab, sizeof(int), hash));
+    TEST_ASSERT_EQUAL_INT64(-1ll, scc_hashtab_impl_probe_insert_avx2_trampoline(base, tab, sizeof(int), hash));
+
+    scc_hashtab_free(tab);
+    restore_simd();
+}
+
+/* test_sse2_probe_wraps_around
+ *
+ * Occupy all slots from the index the value hashes to up
+ * to the end of the metadata array along with the first few
+ * slots and verify that the probing wraps around via the guard
+ */
+void test_sse2_probe_wraps_around(void) {
+    enum { WRAPPED = 5 };
+    pin_sse2();
+    scc_hashtab(int) tab = scc_hashtab_new(int, eq);
+    TEST_ASSERT_TRUE(scc_hashtab_reserve(&tab, XMMSIZE << 2u));
+    size_t const cap = scc_hashtab_capacity(tab);
+    struct scc_hashtab_base *base = scc_hashtab_inspect_base(tab);
+    int *data = scc_hashtab_inspect_data(tab);
+
+    unsigned long long hash;
+    size_t index = 0u;
+    int elem;
+    for(elem = 0; index < cap - 8u; ++elem) {
+        hash = scc_hash_fnv1a(&elem, sizeof(elem));
+        index = hash & (cap - 1u);
+    }
+    --elem;
+
+    scc_hashtab_metatype meta = (scc_hashtab_metatype)(0x80 | (hash >> 57));
+    for(size_t i = index; i < cap; ++i) {
+        set_md(tab, i, meta);
+        data[i] = ~elem;
+    }
+    for(size_t i = 0u; i < WRAPPED; ++i) {
+        set_md(tab, i, meta);
+        data[i] = ~elem;
+    }
+
+    *tab = elem;
+    TEST_ASSERT_EQUAL_INT64(WRAPPED, scc_hashtab_impl_probe_insert_avx2_trampoline(base, tab, sizeof(int), hash));
+    TEST_ASSERT_EQUAL_INT64(-1ll, scc_hashtab_impl_probe_find_avx2_trampoline(base, tab, sizeof(int), hash));
+
+    data[WRAPPED - 1u] = elem;
+    TEST_ASSERT_EQUAL_INT64(WRAPPED - 1ll, scc_hashtab_impl_probe_find_avx2_trampoline(base, tab, sizeof(int), hash));
+    TEST_ASSERT_EQUAL_INT64(-1ll, scc_hashtab_impl_probe_insert_avx2_trampoline(base, tab, sizeof(int), hash));
+
+    scc_hashtab_free(tab);
+    restore_simd();
+}
+
+/* test_sse2_insert_and_find
+ *
+ * Insert values through the public interface, growing the table
+ * to well above an xmmword's worth of slots, and verify that each
+ * value is found
+ */
+void test_sse2_insert_and_find(void) {
+    enum { SIZE = 2048 };
+    pin_sse2();
+    scc_hashtab(int) tab = scc_hashtab_new(int, eq);
+
+    for(int i = 0; i < SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashtab_insert(&tab, i));
+        TEST_ASSERT_FALSE(scc_hashtab_insert(&tab, i));
+    }
+
+    for(int i = 0; i < SIZE; ++i) {
+        int const *elem = scc_hashtab_find(tab, i);
+        TEST_ASSERT_TRUE(elem);
+        TEST_ASSERT_EQUAL_INT32(i, *elem);
+    }
+    TEST_ASSERT_FALSE(scc_hashtab_find(tab, SIZE));
+
+    for(int i = 0; i < SIZE; i += 2) {
+        TEST_ASSERT_TRUE(scc_hashtab_remove(tab, i));
+    }
+    for(int i = 0; i < SIZE; ++i) {
+        TEST_ASSERT_EQUAL_INT32(i & 1, !!scc_hashtab_find(tab, i));
+    }
+
+    scc_hashtab_free(tab);
+    restore_simd();
+}
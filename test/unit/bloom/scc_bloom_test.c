@@ -1,3 +1,4 @@
+#include <inspect/counting_allocator.h>
 #include <scc/bloom.h>
 
 #include <stdint.h>
@@ -21,6 +22,28 @@ void test_alternate_allocation(void) {
     scc_bloom_free(flt);
 }
 
+void test_bloom_new_in(void) {
+    counting_allocator_reset();
+    scc_bloom(unsigned) flt = scc_bloom_new_in(unsigned, 128u, 8u, &counting_allocator);
+    TEST_ASSERT_TRUE(!!flt);
+    for (unsigned i = 0u; i < 512u; ++i) {
+        scc_bloom_insert(&flt, i << 1u);
+    }
+    scc_bloom(unsigned) copy = scc_bloom_clone(flt);
+    TEST_ASSERT_TRUE(!!copy);
+    TEST_ASSERT_EQUAL_UINT32(2u, alloc_counts.allocs);
+    scc_bloom_free(flt);
+    scc_bloom_free(copy);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+
+    counting_allocator_reset();
+    flt = scc_bloom_with_hash_in(unsigned, 128u, 8u, murmur_wrapper, &counting_allocator);
+    TEST_ASSERT_TRUE(!!flt);
+    scc_bloom_free(flt);
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.allocs);
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.frees);
+}
+
 void test_simple_insertion_and_lookup(void) {
     scc_bloom(unsigned) flt = scc_bloom_new(unsigned, 128u, 8u);
 
@@ -0,0 +1,274 @@
+#include <inspect/bptree_inspect.h>
+#include <inspect/counting_allocator.h>
+#include <scc/bptree.h>
+#include <scc/mem.h>
+
+#include <stdlib.h>
+
+#include <unity.h>
+
+#ifdef SCC_MUTATION_TEST
+enum { BPTEST_SIZE = 64 };
+#else
+enum { BPTEST_SIZE = 2048 };
+#endif
+
+/* Coprime with BPTEST_SIZE, used for visiting values out of order */
+enum { BPTEST_STRIDE = 7919 };
+
+static int compare(void const *l, void const *r) {
+    return *(int const *)l - *(int const *)r;
+}
+
+static int permute(int i) {
+    return (int)(((unsigned)i * BPTEST_STRIDE) % BPTEST_SIZE);
+}
+
+/* Run the given check on trees of a number of different orders */
+static void for_each_order(void (*check)(scc_bptree(int))) {
+    check(scc_bptree_with_order_dyn(int, compare, 3));
+    check(scc_bptree_with_order_dyn(int, compare, 4));
+    check(scc_bptree_with_order_dyn(int, compare, 5));
+    check(scc_bptree_with_order_dyn(int, compare, 6));
+    check(scc_bptree_with_order_dyn(int, compare, 9));
+    check(scc_bptree_with_order_dyn(int, compare, 16));
+    check(scc_bptree_with_order_dyn(int, compare, 33));
+}
+
+void test_scc_bptree_with_order_invalid(void) {
+    TEST_ASSERT_FALSE(scc_bptree_with_order(int, compare, 2));
+    TEST_ASSERT_FALSE(scc_bptree_with_order_dyn(int, compare, 2));
+}
+
+void test_scc_bptree_new_dyn(void) {
+    scc_bptree(int) bptree = scc_bptree_new_dyn(int, compare);
+    TEST_ASSERT_TRUE(!!bptree);
+    struct scc_bptree_base *base = scc_bptree_impl_base(bptree);
+    TEST_ASSERT_TRUE(base->bp_dynalloc);
+    TEST_ASSERT_EQUAL_UINT64(SCC_BPTREE_DEFAULT_ORDER, scc_bptree_order(bptree));
+    scc_bptree_free(bptree);
+}
+
+static void check_insert_ascending(scc_bptree(int) bptree) {
+    TEST_ASSERT_TRUE(!!bptree);
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, i));
+        TEST_ASSERT_EQUAL_UINT64(i + 1ull, scc_bptree_size(bptree));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_bptree_inspect_invariants(bptree));
+    }
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        int const *p = scc_bptree_find(bptree, i);
+        TEST_ASSERT_TRUE(!!p);
+        TEST_ASSERT_EQUAL_INT32(i, *p);
+    }
+    TEST_ASSERT_FALSE(scc_bptree_find(bptree, BPTEST_SIZE));
+    TEST_ASSERT_FALSE(scc_bptree_find(bptree, -1));
+    scc_bptree_free(bptree);
+}
+
+void test_scc_bptree_insert_ascending(void) {
+    for_each_order(check_insert_ascending);
+}
+
+static void check_insert_descending(scc_bptree(int) bptree) {
+    TEST_ASSERT_TRUE(!!bptree);
+    for (int i = BPTEST_SIZE - 1; i >= 0; --i) {
+        TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, i));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_bptree_inspect_invariants(bptree));
+    }
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(!!scc_bptree_find(bptree, i));
+    }
+    scc_bptree_free(bptree);
+}
+
+void test_scc_bptree_insert_descending(void) {
+    for_each_order(check_insert_descending);
+}
+
+static void check_insert_remove_permuted(scc_bptree(int) bptree) {
+    TEST_ASSERT_TRUE(!!bptree);
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, permute(i)));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_bptree_inspect_invariants(bptree));
+    }
+
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        int const val = permute(BPTEST_SIZE - i - 1);
+        TEST_ASSERT_TRUE(scc_bptree_remove(bptree, val));
+        TEST_ASSERT_FALSE(scc_bptree_remove(bptree, val));
+        TEST_ASSERT_FALSE(scc_bptree_find(bptree, val));
+        TEST_ASSERT_EQUAL_UINT64(BPTEST_SIZE - i - 1ull, scc_bptree_size(bptree));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_bptree_inspect_invariants(bptree));
+    }
+
+    /* Tree is usable after having been emptied */
+    TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, 1));
+    TEST_ASSERT_TRUE(!!scc_bptree_find(bptree, 1));
+    scc_bptree_free(bptree);
+}
+
+void test_scc_bptree_insert_remove_permuted(void) {
+    for_each_order(check_insert_remove_permuted);
+}
+
+static void check_remove_ascending(scc_bptree(int) bptree) {
+    TEST_ASSERT_TRUE(!!bptree);
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, i));
+    }
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_remove(bptree, i));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_bptree_inspect_invariants(bptree));
+        if (i + 1 < BPTEST_SIZE) {
+            TEST_ASSERT_TRUE(!!scc_bptree_find(bptree, i + 1));
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT64(0u, scc_bptree_size(bptree));
+    scc_bptree_free(bptree);
+}
+
+void test_scc_bptree_remove_ascending(void) {
+    for_each_order(check_remove_ascending);
+}
+
+static void check_duplicates(scc_bptree(int) bptree) {
+    TEST_ASSERT_TRUE(!!bptree);
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, i % 7));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_bptree_inspect_invariants(bptree));
+    }
+
+    /* Remove in an order that leaves stale separators behind */
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_remove(bptree, (BPTEST_SIZE - i - 1) % 7));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_bptree_inspect_invariants(bptree));
+    }
+    TEST_ASSERT_EQUAL_UINT64(0u, scc_bptree_size(bptree));
+    scc_bptree_free(bptree);
+}
+
+void test_scc_bptree_duplicates(void) {
+    for_each_order(check_duplicates);
+}
+
+static void check_foreach(scc_bptree(int) bptree) {
+    TEST_ASSERT_TRUE(!!bptree);
+
+    scc_bptree_iter(int) iter;
+    int n = 0;
+    scc_bptree_foreach(iter, bptree) {
+        ++n;
+    }
+    TEST_ASSERT_EQUAL_INT32(0, n);
+
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, permute(i)));
+    }
+
+    scc_bptree_foreach(iter, bptree) {
+        TEST_ASSERT_EQUAL_INT32(n, *iter);
+        ++n;
+    }
+    TEST_ASSERT_EQUAL_INT32(BPTEST_SIZE, n);
+
+    scc_bptree_foreach_reversed(iter, bptree) {
+        TEST_ASSERT_EQUAL_INT32(--n, *iter);
+    }
+    TEST_ASSERT_EQUAL_INT32(0, n);
+
+    scc_bptree_free(bptree);
+}
+
+void test_scc_bptree_foreach(void) {
+    for_each_order(check_foreach);
+}
+
+static void check_foreach_range(scc_bptree(int) bptree) {
+    TEST_ASSERT_TRUE(!!bptree);
+    /* Even values only */
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, permute(i) << 1));
+    }
+
+    int const bounds[][2] = {
+        { 0, 2 * BPTEST_SIZE },
+        { -10, 10 },
+        { 1, 2 },
+        { 3, 3 },
+        { 17, 1023 },
+        { 18, 1024 },
+        { 2 * BPTEST_SIZE - 5, 4 * BPTEST_SIZE },
+        { 4 * BPTEST_SIZE, 5 * BPTEST_SIZE },
+        { 400, 100 },
+    };
+
+    scc_bptree_iter(int) iter;
+    for (unsigned i = 0u; i < scc_arrsize(bounds); ++i) {
+        int const low = bounds[i][0];
+        int const high = bounds[i][1];
+        int expected = low < 0 ? 0 : low + (low & 1);
+        int n = 0;
+        scc_bptree_foreach_range(iter, bptree, low, high) {
+            TEST_ASSERT_EQUAL_INT32(expected, *iter);
+            expected += 2;
+            ++n;
+        }
+
+        int nexpected = 0;
+        for (int j = 0; j < 2 * BPTEST_SIZE; j += 2) {
+            nexpected += low <= j && j < high;
+        }
+        TEST_ASSERT_EQUAL_INT32(nexpected, n);
+    }
+    scc_bptree_free(bptree);
+}
+
+void test_scc_bptree_foreach_range(void) {
+    for_each_order(check_foreach_range);
+}
+
+static void check_clone(scc_bptree(int) bptree) {
+    TEST_ASSERT_TRUE(!!bptree);
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, permute(i)));
+    }
+
+    scc_bptree(int) copy = scc_bptree_clone(bptree);
+    TEST_ASSERT_TRUE(!!copy);
+    TEST_ASSERT_EQUAL_UINT64(scc_bptree_size(bptree), scc_bptree_size(copy));
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_bptree_inspect_invariants(copy));
+    scc_bptree_free(bptree);
+
+    scc_bptree_iter(int) iter;
+    int n = 0;
+    scc_bptree_foreach(iter, copy) {
+        TEST_ASSERT_EQUAL_INT32(n++, *iter);
+    }
+    TEST_ASSERT_EQUAL_INT32(BPTEST_SIZE, n);
+
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_remove(copy, i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_bptree_inspect_invariants(copy));
+    scc_bptree_free(copy);
+}
+
+void test_scc_bptree_clone(void) {
+    for_each_order(check_clone);
+}
+
+void test_scc_bptree_with_order_in(void) {
+    counting_allocator_reset();
+    scc_bptree(int) bptree = scc_bptree_with_order_in(int, compare, 5, &counting_allocator);
+    TEST_ASSERT_TRUE(!!bptree);
+    for (int i = 0; i < BPTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_bptree_insert(&bptree, i));
+    }
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    scc_bptree(int) copy = scc_bptree_clone(bptree);
+    TEST_ASSERT_TRUE(!!copy);
+    scc_bptree_free(bptree);
+    scc_bptree_free(copy);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
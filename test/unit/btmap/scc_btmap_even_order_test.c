@@ -1,3 +1,4 @@
+#include <inspect/counting_allocator.h>
 #include <inspect/btmap_inspect.h>
 #include <scc/btmap.h>
 #include <scc/mem.h>
@@ -42,6 +43,21 @@ void test_scc_btmap_new_dyn(void) {
     scc_btmap_free(btmap);
 }
 
+void test_scc_btmap_new_in(void) {
+    counting_allocator_reset();
+    scc_btmap(int, int) btmap = scc_btmap_new_in(int, int, ecompare, &counting_allocator);
+    TEST_ASSERT_TRUE(!!btmap);
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btmap_insert(&btmap, i, i));
+    }
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    scc_btmap(int, int) copy = scc_btmap_clone(btmap);
+    TEST_ASSERT_TRUE(!!copy);
+    scc_btmap_free(btmap);
+    scc_btmap_free(copy);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
 void test_scc_btmap_with_order_dyn(void) {
     scc_btmap(int, int) btmap = scc_btmap_with_order_dyn(int, int, ecompare, 32);
     TEST_ASSERT_TRUE(!!btmap);
@@ -222,3 +238,163 @@ void test_scc_btmap_insert_descending_order(void) {
 
     scc_btmap_free(btmap);
 }
+
+void test_scc_btmap_foreach(void) {
+    scc_btmap(int, int) btmap = scc_btmap_with_order(int, int, ecompare, 4);
+    int const *key;
+    int *value;
+    scc_btmap_foreach(key, value, btmap) {
+        TEST_FAIL_MESSAGE("Iteration over empty btmap");
+    }
+
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btmap_insert(&btmap, (i * 7) % ETEST_SIZE, i));
+    }
+
+    int expected = 0;
+    scc_btmap_foreach(key, value, btmap) {
+        TEST_ASSERT_EQUAL_INT32(expected, *key);
+        *value = -expected;
+        ++expected;
+    }
+    TEST_ASSERT_EQUAL_INT32(ETEST_SIZE, expected);
+
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        value = scc_btmap_find(btmap, i);
+        TEST_ASSERT_TRUE(!!value);
+        TEST_ASSERT_EQUAL_INT32(-i, *value);
+    }
+    scc_btmap_free(btmap);
+}
+
+static int brute_range_size(int low, int high, int size) {
+    int count = 0;
+    for(int i = 0; i < size; ++i) {
+        count += !(i & 1) && i >= low && i < high;
+    }
+    return count;
+}
+
+void test_scc_btmap_range(void) {
+    scc_btmap(int, int) btmap = scc_btmap_with_order(int, int, ecompare, 4);
+    int const *key;
+    int *value;
+    scc_btmap_range(key, value, btmap, 0, 10) {
+        TEST_FAIL_MESSAGE("Iteration over empty btmap");
+    }
+
+    for(int i = 0; i < ETEST_SIZE; i += 2) {
+        TEST_ASSERT_TRUE(scc_btmap_insert(&btmap, i, i << 1));
+    }
+
+    static int const bounds[][2] = {
+        { 0, ETEST_SIZE }, { -10, 5 }, { 3, 4 }, { 4, 4 }, { 5, 3 },
+        { 13, 58 }, { 14, 58 }, { 13, 57 }, { ETEST_SIZE - 10, ETEST_SIZE + 10 },
+        { ETEST_SIZE, ETEST_SIZE + 2 }, { -20, -10 }
+    };
+    for(unsigned b = 0u; b < scc_arrsize(bounds); ++b) {
+        int const low = bounds[b][0];
+        int const high = bounds[b][1];
+        int count = 0;
+        int prev = low - 1;
+        scc_btmap_range(key, value, btmap, low, high) {
+            TEST_ASSERT_TRUE(*key >= low);
+            TEST_ASSERT_TRUE(*key < high);
+            TEST_ASSERT_TRUE(*key > prev);
+            TEST_ASSERT_EQUAL_INT32(*key << 1, *value);
+            prev = *key;
+            ++count;
+        }
+        TEST_ASSERT_EQUAL_INT32(brute_range_size(low, high, ETEST_SIZE), count);
+    }
+    scc_btmap_free(btmap);
+}
+
+void test_scc_btmap_builtin_compare_i64(void) {
+    scc_btmap(long long, int) btmap = scc_btmap_with_order(long long, int, scc_btcompare_i64, 16);
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btmap_insert(&btmap, ((i * 7) % ETEST_SIZE) * (1ll << 34), i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btmap_inspect_invariants(btmap));
+
+    /* Overwrite every other value */
+    for(int i = 0; i < ETEST_SIZE; i += 2) {
+        TEST_ASSERT_TRUE(scc_btmap_insert(&btmap, i * (1ll << 34), -i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(ETEST_SIZE, scc_btmap_size(btmap));
+
+    int *val;
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        val = scc_btmap_find(btmap, i * (1ll << 34));
+        TEST_ASSERT_TRUE(!!val);
+        if(!(i & 1)) {
+            TEST_ASSERT_EQUAL_INT32(-i, *val);
+        }
+        TEST_ASSERT_FALSE(scc_btmap_find(btmap, i * (1ll << 34) + 1));
+    }
+
+    for(int i = 0; i < ETEST_SIZE; i += 3) {
+        TEST_ASSERT_TRUE(scc_btmap_remove(btmap, i * (1ll << 34)));
+        TEST_ASSERT_FALSE(scc_btmap_remove(btmap, i * (1ll << 34)));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btmap_inspect_invariants(btmap));
+    scc_btmap_free(btmap);
+}
+
+void test_scc_btmap_builtin_compare_f32(void) {
+    scc_btmap(float, int) btmap = scc_btmap_with_order(float, int, scc_btcompare_f32, 9);
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btmap_insert(&btmap, (float)(ETEST_SIZE - i) * -0.25f, i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btmap_inspect_invariants(btmap));
+
+    int *val;
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        val = scc_btmap_find(btmap, (float)(ETEST_SIZE - i) * -0.25f);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_INT32(i, *val);
+    }
+    TEST_ASSERT_FALSE(scc_btmap_find(btmap, 0.f));
+    scc_btmap_free(btmap);
+}
+
+struct large_value {
+    int v[24];
+};
+
+void test_scc_btmap_large_values(void) {
+    scc_btmap(int, struct large_value) btmap = scc_btmap_new(int, struct large_value, ecompare);
+    struct large_value value;
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        for (unsigned j = 0u; j < scc_arrsize(value.v); ++j) {
+            value.v[j] = i + (int)j;
+        }
+        TEST_ASSERT_TRUE(scc_btmap_insert(&btmap, i, value));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btmap_inspect_invariants(btmap));
+
+    scc_btmap(int, struct large_value) copy = scc_btmap_clone(btmap);
+    TEST_ASSERT_TRUE(!!copy);
+    scc_btmap_free(btmap);
+
+    /* Values are unaffected by keys and links moving around */
+    for (int i = 0; i < ETEST_SIZE; i += 2) {
+        TEST_ASSERT_TRUE(scc_btmap_remove(copy, i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btmap_inspect_invariants(copy));
+
+    struct large_value *found;
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        found = scc_btmap_find(copy, i);
+        if (i & 1) {
+            TEST_ASSERT_TRUE(!!found);
+            for (unsigned j = 0u; j < scc_arrsize(found->v); ++j) {
+                TEST_ASSERT_EQUAL_INT32(i + (int)j, found->v[j]);
+            }
+        }
+        else {
+            TEST_ASSERT_FALSE(found);
+        }
+    }
+    scc_btmap_free(copy);
+}
@@ -1,4 +1,5 @@
 #include <inspect/btmap_inspect.h>
+#include <inspect/counting_allocator.h>
 #include <scc/btmap.h>
 #include <scc/mem.h>
 
@@ -174,3 +175,127 @@ void test_scc_btmap_clone(void) {
     scc_btmap_free(btmap);
     scc_btmap_free(nbtmap);
 }
+
+void test_scc_btmap_bounds_odd_order(void) {
+    scc_btmap(int, int) btmap = scc_btmap_with_order(int, int, ocompare, 3);
+    struct scc_btmap_iter iter;
+    TEST_ASSERT_EQUAL_PTR(0, scc_btmap_upper_bound(btmap, 0, &iter));
+
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btmap_insert(&btmap, 2 * (OTEST_SIZE - i - 1), i));
+    }
+
+    int const *key;
+    for(int i = -1; i < 2 * OTEST_SIZE; ++i) {
+        int lower = i < 0 ? 0 : i + (i & 1);
+        key = scc_btmap_lower_bound(btmap, i, &iter);
+        if(lower == 2 * OTEST_SIZE) {
+            TEST_ASSERT_EQUAL_PTR(0, key);
+        }
+        else {
+            TEST_ASSERT_EQUAL_INT32(lower, *key);
+            TEST_ASSERT_EQUAL_INT32(OTEST_SIZE - lower / 2 - 1, *(int *)scc_btmap_iter_value(btmap, &iter));
+        }
+
+        int upper = i < 0 ? 0 : i + 1 + !(i & 1);
+        key = scc_btmap_upper_bound(btmap, i, &iter);
+        if(upper == 2 * OTEST_SIZE) {
+            TEST_ASSERT_EQUAL_PTR(0, key);
+            continue;
+        }
+        TEST_ASSERT_EQUAL_INT32(upper, *key);
+        key = scc_btmap_iter_next(btmap, &iter);
+        if(upper + 2 == 2 * OTEST_SIZE) {
+            TEST_ASSERT_EQUAL_PTR(0, key);
+        }
+        else {
+            TEST_ASSERT_EQUAL_INT32(upper + 2, *key);
+        }
+    }
+    scc_btmap_free(btmap);
+}
+
+#define check_from_sorted(order)                                                                    \
+    do {                                                                                            \
+        for(int n_ = 0; n_ < OTEST_SIZE; n_ += 1 + n_ / 8) {                                        \
+            scc_btmap(int, int) btmap_ =                                                            \
+                scc_btmap_with_order_from_sorted(int, int, ocompare, order, keys, vals, n_);        \
+            TEST_ASSERT_TRUE(!!btmap_);                                                             \
+            TEST_ASSERT_EQUAL_UINT64(n_, scc_btmap_size(btmap_));                                   \
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btmap_inspect_invariants(btmap_));                     \
+            int expected_ = 0;                                                                      \
+            int const *key_;                                                                        \
+            int *val_;                                                                              \
+            scc_btmap_foreach(key_, val_, btmap_) {                                                 \
+                TEST_ASSERT_EQUAL_INT32(keys[expected_], *key_);                                    \
+                TEST_ASSERT_EQUAL_INT32(vals[expected_], *val_);                                    \
+                ++expected_;                                                                        \
+            }                                                                                       \
+            TEST_ASSERT_EQUAL_INT32(n_, expected_);                                                 \
+            for(int i_ = 0; i_ < n_; i_ += 2) {                                                     \
+                TEST_ASSERT_TRUE(scc_btmap_insert(&btmap_, keys[i_] + 1, 0));                       \
+            }                                                                                       \
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btmap_inspect_invariants(btmap_));                     \
+            for(int i_ = 0; i_ < n_; ++i_) {                                                        \
+                TEST_ASSERT_TRUE(scc_btmap_remove(btmap_, keys[i_]));                               \
+            }                                                                                       \
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btmap_inspect_invariants(btmap_));                     \
+            scc_btmap_free(btmap_);                                                                 \
+        }                                                                                           \
+    } while(0)
+
+void test_scc_btmap_from_sorted(void) {
+    static int keys[OTEST_SIZE];
+    static int vals[OTEST_SIZE];
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        keys[i] = i * 2;
+        vals[i] = -i;
+    }
+    check_from_sorted(3);
+    check_from_sorted(4);
+    check_from_sorted(5);
+    check_from_sorted(6);
+    check_from_sorted(7);
+    check_from_sorted(32);
+
+    scc_btmap(int, int) btmap = scc_btmap_from_sorted(int, int, ocompare, keys, vals, OTEST_SIZE);
+    TEST_ASSERT_TRUE(!!btmap);
+    struct scc_btmap_base *base = scc_btmap_impl_base(btmap);
+    TEST_ASSERT_EQUAL_UINT64(1ull, scc_arena_nchunks(&base->btm_arena));
+    int *val;
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        val = scc_btmap_find(btmap, 2 * i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_INT32(-i, *val);
+    }
+    scc_btmap_free(btmap);
+}
+
+void test_scc_btmap_from_sorted_in(void) {
+    static int keys[OTEST_SIZE];
+    static int vals[OTEST_SIZE];
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        keys[i] = i * 2;
+        vals[i] = -i;
+    }
+    counting_allocator_reset();
+    scc_btmap(int, int) btmap =
+        scc_btmap_with_order_from_sorted_in(int, int, ocompare, 5, keys, vals, OTEST_SIZE, &counting_allocator);
+    TEST_ASSERT_TRUE(!!btmap);
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btmap_inspect_invariants(btmap));
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btmap_insert(&btmap, 2 * i + 1, i));
+    }
+    scc_btmap_free(btmap);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+
+    counting_allocator_reset();
+    btmap = scc_btmap_from_sorted_in(int, int, ocompare, keys, vals, OTEST_SIZE, &counting_allocator);
+    TEST_ASSERT_TRUE(!!btmap);
+    int *val = scc_btmap_find(btmap, 2 * (OTEST_SIZE - 1));
+    TEST_ASSERT_TRUE(!!val);
+    TEST_ASSERT_EQUAL_INT32(-(OTEST_SIZE - 1), *val);
+    scc_btmap_free(btmap);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
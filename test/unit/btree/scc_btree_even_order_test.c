@@ -161,3 +161,734 @@ void test_scc_btree_remove_root(void) {
 
     scc_btree_free(btree);
 }
+
+void test_scc_btree_foreach(void) {
+    scc_btree(int) btree = scc_btree_with_order(int, ecompare, 4);
+    int const *iter;
+    scc_btree_foreach(iter, btree) {
+        TEST_FAIL_MESSAGE("Iteration over empty btree");
+    }
+
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, (i * 7) % ETEST_SIZE));
+    }
+
+    int expected = 0;
+    scc_btree_foreach(iter, btree) {
+        TEST_ASSERT_EQUAL_INT32(expected, *iter);
+        ++expected;
+    }
+    TEST_ASSERT_EQUAL_INT32(ETEST_SIZE, expected);
+
+    /* Breaking out early requires no cleanup */
+    scc_btree_foreach(iter, btree) {
+        if(*iter == ETEST_SIZE / 2) {
+            break;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT32(ETEST_SIZE / 2, *iter);
+    scc_btree_free(btree);
+}
+
+void test_scc_btree_bounds_duplicates(void) {
+    scc_btree(int) btree = scc_btree_with_order(int, ecompare, 4);
+    struct scc_btree_iter iter;
+    TEST_ASSERT_EQUAL_PTR(0, scc_btree_lower_bound(btree, 0, &iter));
+    TEST_ASSERT_EQUAL_PTR(0, scc_btree_iter_next(btree, &iter));
+
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, 2 * i));
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, 2 * (ETEST_SIZE - i - 1)));
+    }
+
+    int const *elem;
+    for(int i = -1; i < 2 * ETEST_SIZE; ++i) {
+        int lower = i < 0 ? 0 : i + (i & 1);
+        elem = scc_btree_lower_bound(btree, i, &iter);
+        if(lower == 2 * ETEST_SIZE) {
+            TEST_ASSERT_EQUAL_PTR(0, elem);
+        }
+        else {
+            TEST_ASSERT_EQUAL_INT32(lower, *elem);
+            if(!(i & 1)) {
+                /* Lower bound is the first of the duplicates */
+                elem = scc_btree_iter_next(btree, &iter);
+                TEST_ASSERT_EQUAL_INT32(lower, *elem);
+            }
+        }
+
+        int upper = i < 0 ? 0 : i + 1 + !(i & 1);
+        elem = scc_btree_upper_bound(btree, i, &iter);
+        if(upper == 2 * ETEST_SIZE) {
+            TEST_ASSERT_EQUAL_PTR(0, elem);
+            continue;
+        }
+        TEST_ASSERT_EQUAL_INT32(upper, *elem);
+        elem = scc_btree_iter_next(btree, &iter);
+        TEST_ASSERT_EQUAL_INT32(upper, *elem);
+    }
+    scc_btree_free(btree);
+}
+
+void test_scc_btree_builtin_compare_i32(void) {
+    scc_btree(int) btree = scc_btree_with_order(int, scc_btcompare_i32, 32);
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, ((i * 7) % ETEST_SIZE) - ETEST_SIZE / 2));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+
+    int const *elem;
+    for(int i = -ETEST_SIZE / 2; i < ETEST_SIZE / 2; ++i) {
+        elem = scc_btree_find(btree, i);
+        TEST_ASSERT_TRUE(!!elem);
+        TEST_ASSERT_EQUAL_INT32(i, *elem);
+    }
+    TEST_ASSERT_FALSE(scc_btree_find(btree, ETEST_SIZE));
+
+    for(int i = -ETEST_SIZE / 2; i < ETEST_SIZE / 2; i += 2) {
+        TEST_ASSERT_TRUE(scc_btree_remove(btree, i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+
+    int expected = -ETEST_SIZE / 2 + 1;
+    scc_btree_foreach(elem, btree) {
+        TEST_ASSERT_EQUAL_INT32(expected, *elem);
+        expected += 2;
+    }
+    scc_btree_free(btree);
+}
+
+void test_scc_btree_builtin_compare_f64(void) {
+    scc_btree(double) btree = scc_btree_with_order(double, scc_btcompare_f64, 12);
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, ((i * 7) % ETEST_SIZE) * 0.5));
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, ((i * 7) % ETEST_SIZE) * 0.5));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+
+    for(int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(!!scc_btree_find(btree, i * 0.5));
+        TEST_ASSERT_FALSE(scc_btree_find(btree, i * 0.5 + 0.25));
+    }
+
+    struct scc_btree_iter iter;
+    double const *elem = scc_btree_lower_bound(btree, 10.0, &iter);
+    TEST_ASSERT_TRUE(!!elem);
+    TEST_ASSERT_EQUAL_INT32(20, (int)(*elem * 2.0));
+    elem = scc_btree_iter_next(btree, &iter);
+    TEST_ASSERT_EQUAL_INT32(20, (int)(*elem * 2.0));
+    elem = scc_btree_iter_next(btree, &iter);
+    TEST_ASSERT_EQUAL_INT32(21, (int)(*elem * 2.0));
+    scc_btree_free(btree);
+}
+
+void test_scc_btree_freeze(void) {
+    for (int n = 0; n < ETEST_SIZE; n += 1 + n / 4) {
+        scc_btree(int) btree = scc_btree_new(int, ecompare);
+        /* Even values only, odd ones are looked up as misses */
+        for (int i = n - 1; i >= 0; --i) {
+            TEST_ASSERT_TRUE(scc_btree_insert(&btree, i * 2));
+        }
+
+        scc_btfrozen(int) frozen = scc_btree_freeze(btree);
+        TEST_ASSERT_TRUE(!!frozen);
+        TEST_ASSERT_EQUAL_UINT64(n, scc_btfrozen_size(frozen));
+        scc_btree_free(btree);
+
+        int const *elem;
+        for (int i = 0; i < n; ++i) {
+            elem = scc_btfrozen_find(frozen, i * 2);
+            TEST_ASSERT_TRUE(!!elem);
+            TEST_ASSERT_EQUAL_INT32(i * 2, *elem);
+            TEST_ASSERT_FALSE(scc_btfrozen_find(frozen, i * 2 + 1));
+            elem = scc_btfrozen_lower_bound(frozen, i * 2 - 1);
+            TEST_ASSERT_TRUE(!!elem);
+            TEST_ASSERT_EQUAL_INT32(i * 2, *elem);
+        }
+        TEST_ASSERT_FALSE(scc_btfrozen_find(frozen, -1));
+        TEST_ASSERT_FALSE(scc_btfrozen_lower_bound(frozen, n * 2 - 1));
+        scc_btfrozen_free(frozen);
+    }
+}
+
+void test_scc_btree_freeze_duplicates(void) {
+    scc_btree(int) btree = scc_btree_new(int, ecompare);
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, i / 4));
+    }
+    scc_btfrozen(int) frozen = scc_btree_freeze(btree);
+    TEST_ASSERT_TRUE(!!frozen);
+    scc_btree_free(btree);
+
+    /* Lower bound is the first of the copies */
+    int const *elem;
+    int const *prev = 0;
+    for (int i = 0; i < ETEST_SIZE / 4; ++i) {
+        elem = scc_btfrozen_lower_bound(frozen, i);
+        TEST_ASSERT_TRUE(!!elem);
+        TEST_ASSERT_EQUAL_INT32(i, *elem);
+        TEST_ASSERT_TRUE(elem != prev);
+        prev = elem;
+    }
+    scc_btfrozen_free(frozen);
+}
+
+void test_scc_btree_freeze_builtin_compare(void) {
+    scc_btree(long long) btree = scc_btree_new(long long, scc_btcompare_i64);
+    for (long long i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, (i * 7) % ETEST_SIZE - ETEST_SIZE / 2));
+    }
+    scc_btfrozen(long long) frozen = scc_btree_freeze(btree);
+    TEST_ASSERT_TRUE(!!frozen);
+    scc_btree_free(btree);
+
+    long long const *elem;
+    for (long long i = -ETEST_SIZE / 2; i < ETEST_SIZE / 2; ++i) {
+        elem = scc_btfrozen_find(frozen, i);
+        TEST_ASSERT_TRUE(!!elem);
+        TEST_ASSERT_TRUE(*elem == i);
+    }
+    TEST_ASSERT_FALSE(scc_btfrozen_find(frozen, ETEST_SIZE));
+    scc_btfrozen_free(frozen);
+}
+
+static scc_btree(int) btree_with_values(int const *values, size_t n) {
+    scc_btree(int) btree = scc_btree_new_dyn(int, ecompare);
+    TEST_ASSERT_TRUE(!!btree);
+    for (size_t i = 0u; i < n; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, values[i]));
+    }
+    return btree;
+}
+
+static void assert_btree_contents(scc_btree(int) btree, int const *expected, size_t n) {
+    TEST_ASSERT_EQUAL_UINT64(n, scc_btree_size(btree));
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+    size_t i = 0u;
+    int const *iter;
+    scc_btree_foreach(iter, btree) {
+        TEST_ASSERT_TRUE(i < n);
+        TEST_ASSERT_EQUAL_INT32(expected[i++], *iter);
+    }
+    TEST_ASSERT_EQUAL_UINT64(n, i);
+}
+
+void test_scc_btree_merge(void) {
+    static int left[ETEST_SIZE];
+    static int right[ETEST_SIZE];
+    static int expected[2 * ETEST_SIZE];
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        left[i] = i * 2;
+        right[i] = i * 3;
+    }
+    size_t n = 0u;
+    for (int i = 0, j = 0; i < ETEST_SIZE || j < ETEST_SIZE;) {
+        if (j == ETEST_SIZE || (i < ETEST_SIZE && left[i] <= right[j])) {
+            expected[n++] = left[i++];
+        }
+        else {
+            expected[n++] = right[j++];
+        }
+    }
+
+    scc_btree(int) dst = btree_with_values(left, ETEST_SIZE);
+    scc_btree(int) src = btree_with_values(right, ETEST_SIZE);
+    TEST_ASSERT_TRUE(scc_btree_merge(dst, src));
+    assert_btree_contents(dst, expected, n);
+    assert_btree_contents(src, right, ETEST_SIZE);
+
+    /* Merged tree remains modifiable */
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_remove(dst, right[i]));
+    }
+    assert_btree_contents(dst, left, ETEST_SIZE);
+
+    scc_btree_free(dst);
+    scc_btree_free(src);
+}
+
+void test_scc_btree_merge_empty(void) {
+    static int values[ETEST_SIZE];
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        values[i] = i;
+    }
+    scc_btree(int) dst = scc_btree_new_dyn(int, ecompare);
+    scc_btree(int) src = btree_with_values(values, ETEST_SIZE);
+    TEST_ASSERT_TRUE(scc_btree_merge(src, dst));
+    assert_btree_contents(src, values, ETEST_SIZE);
+    TEST_ASSERT_TRUE(scc_btree_merge(dst, src));
+    assert_btree_contents(dst, values, ETEST_SIZE);
+    scc_btree_free(dst);
+    scc_btree_free(src);
+}
+
+void test_scc_btree_split(void) {
+    static int values[ETEST_SIZE];
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        values[i] = i / 2;
+    }
+
+    int const keys[] = { -1, 0, 1, ETEST_SIZE / 6, ETEST_SIZE / 2 - 1, ETEST_SIZE };
+    scc_btree(int) right;
+    size_t bound;
+    for (unsigned i = 0u; i < scc_arrsize(keys); ++i) {
+        scc_btree(int) btree = btree_with_values(values, ETEST_SIZE);
+        TEST_ASSERT_TRUE(scc_btree_split(btree, keys[i], &right));
+        for (bound = 0u; bound < ETEST_SIZE && values[bound] < keys[i]; ++bound);
+        assert_btree_contents(btree, values, bound);
+        assert_btree_contents(right, values + bound, ETEST_SIZE - bound);
+
+        /* Both halves remain modifiable */
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, keys[i] - 1));
+        TEST_ASSERT_TRUE(scc_btree_insert(&right, keys[i]));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(right));
+        scc_btree_free(btree);
+        scc_btree_free(right);
+    }
+}
+
+/* Constructors for trees of the orders and kinds exercising the
+ * different paths through split and merge */
+static scc_btree(int) btree_order3(void) {
+    return scc_btree_with_order_dyn(int, ecompare, 3u);
+}
+
+static scc_btree(int) btree_order4(void) {
+    return scc_btree_with_order_dyn(int, ecompare, 4u);
+}
+
+static scc_btree(int) btree_order7(void) {
+    return scc_btree_with_order_dyn(int, ecompare, 7u);
+}
+
+static scc_btree(int) btree_counted_order3(void) {
+    return scc_btree_with_order_counted_dyn(int, ecompare, 3u);
+}
+
+static scc_btree(int) btree_counted_order6(void) {
+    return scc_btree_with_order_counted_dyn(int, ecompare, 6u);
+}
+
+static scc_btree(int) (*const btree_ctors[])(void) = {
+    btree_order3,
+    btree_order4,
+    btree_order7,
+    btree_counted_order3,
+    btree_counted_order6
+};
+
+static scc_btree(int) btree_from(scc_btree(int) (*ctor)(void), int const *values, size_t n) {
+    scc_btree(int) btree = ctor();
+    TEST_ASSERT_TRUE(!!btree);
+    for (size_t i = 0u; i < n; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, values[i]));
+    }
+    return btree;
+}
+
+/* Remove every value in scattered order, checking the invariants
+ * as the tree shrinks */
+static void assert_btree_drains(scc_btree(int) btree, int const *values, size_t n) {
+    size_t const interval = n / 64u + 1u;
+    for (size_t i = 0u; i < n; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_remove(btree, values[(i * 7919u) % n]));
+        if (!(i % interval)) {
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT64(0ull, scc_btree_size(btree));
+}
+
+/* test_scc_btree_split_orders
+ *
+ * Split trees of odd and even order, with and without counts, at
+ * each key in a range covering both ends. Joining the halves back
+ * together must restore the original contents
+ */
+void test_scc_btree_split_orders(void) {
+    enum { NVALUES = 160 };
+    static int values[NVALUES];
+    for (int i = 0; i < NVALUES; ++i) {
+        values[i] = i / 2;
+    }
+
+    scc_btree(int) btree;
+    scc_btree(int) right;
+    scc_btree(int) joined;
+    size_t bound;
+    for (unsigned c = 0u; c < scc_arrsize(btree_ctors); ++c) {
+        for (int key = -1; key <= NVALUES / 2 + 1; ++key) {
+            btree = btree_from(btree_ctors[c], values, NVALUES);
+            TEST_ASSERT_TRUE(scc_btree_split(btree, key, &right));
+            for (bound = 0u; bound < NVALUES && values[bound] < key; ++bound);
+            assert_btree_contents(btree, values, bound);
+            assert_btree_contents(right, values + bound, NVALUES - bound);
+
+            /* Left half prepended to a copy of the right one */
+            joined = scc_btree_clone(right);
+            TEST_ASSERT_TRUE(!!joined);
+            TEST_ASSERT_TRUE(scc_btree_merge(joined, btree));
+            assert_btree_contents(joined, values, NVALUES);
+            assert_btree_drains(joined, values, NVALUES);
+
+            /* Right half appended to the left one */
+            TEST_ASSERT_TRUE(scc_btree_merge(btree, right));
+            assert_btree_contents(btree, values, NVALUES);
+            assert_btree_drains(right, values + bound, NVALUES - bound);
+            assert_btree_drains(btree, values, NVALUES);
+
+            scc_btree_free(joined);
+            scc_btree_free(right);
+            scc_btree_free(btree);
+        }
+    }
+}
+
+/* test_scc_btree_merge_disjoint
+ *
+ * Merge trees of differing heights whose ranges do not interleave,
+ * appending and prepending each to the other. The lower tree is built
+ * in scattered order, leaving nodes on its spines unevenly filled
+ */
+void test_scc_btree_merge_disjoint(void) {
+    static int values[2 * ETEST_SIZE];
+    for (int i = 0; i < 2 * ETEST_SIZE; ++i) {
+        values[i] = i;
+    }
+
+    size_t const sizes[] = { 0u, 1u, 5u, 40u, ETEST_SIZE };
+    scc_btree(int) lower;
+    scc_btree(int) upper;
+    size_t lsize;
+    size_t usize;
+    for (unsigned c = 0u; c < scc_arrsize(btree_ctors); ++c) {
+        for (unsigned i = 0u; i < scc_arrsize(sizes); ++i) {
+            for (unsigned j = 0u; j < scc_arrsize(sizes); ++j) {
+                lsize = sizes[i];
+                usize = sizes[j];
+                lower = btree_from(btree_ctors[c], values, 0u);
+                for (size_t k = 0u; k < lsize; ++k) {
+                    TEST_ASSERT_TRUE(scc_btree_insert(&lower, values[(k * 7919u) % lsize]));
+                }
+                upper = btree_from(btree_ctors[c], values + lsize, usize);
+                TEST_ASSERT_TRUE(scc_btree_merge(lower, upper));
+                assert_btree_contents(lower, values, lsize + usize);
+                assert_btree_contents(upper, values + lsize, usize);
+                scc_btree_free(lower);
+
+                lower = btree_from(btree_ctors[c], values, lsize);
+                TEST_ASSERT_TRUE(scc_btree_merge(upper, lower));
+                assert_btree_contents(upper, values, lsize + usize);
+                assert_btree_contents(lower, values, lsize);
+                assert_btree_drains(upper, values, lsize + usize);
+                scc_btree_free(lower);
+                scc_btree_free(upper);
+            }
+        }
+    }
+}
+
+/* test_scc_btree_merge_gap
+ *
+ * Merge trees whose elements all fall between two adjacent elements
+ * of the destination, some equal to the one preceding the gap. Only
+ * nodes on the path to the gap may be replaced, the elements in all
+ * other nodes of the destination must stay where they were
+ */
+void test_scc_btree_merge_gap(void) {
+    enum { SPAN = 64 };
+    static int values[ETEST_SIZE];
+    static int const *addrs[ETEST_SIZE];
+    static int expected[ETEST_SIZE + SPAN];
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        values[i] = i * SPAN;
+    }
+
+    size_t const gaps[] = { 0u, 1u, ETEST_SIZE / 3, ETEST_SIZE - 2u };
+    int const sizes[] = { 1, 5, 40, SPAN - 1 };
+    scc_btree(int) dst;
+    scc_btree(int) src;
+    size_t n;
+    size_t reused;
+    size_t moved;
+    size_t height;
+    for (unsigned c = 0u; c < scc_arrsize(btree_ctors); ++c) {
+        for (unsigned g = 0u; g < scc_arrsize(gaps); ++g) {
+            for (unsigned k = 0u; k < scc_arrsize(sizes); ++k) {
+                dst = btree_from(btree_ctors[c], values, ETEST_SIZE);
+                src = btree_from(btree_ctors[c], 0, 0u);
+                n = 0u;
+                for (size_t i = 0u; i <= gaps[g]; ++i) {
+                    expected[n++] = values[i];
+                }
+                for (int i = 0; i < sizes[k]; ++i) {
+                    TEST_ASSERT_TRUE(scc_btree_insert(&src, values[gaps[g]] + i));
+                    expected[n++] = values[gaps[g]] + i;
+                }
+                for (size_t i = gaps[g] + 1u; i < ETEST_SIZE; ++i) {
+                    expected[n++] = values[i];
+                }
+
+                for (size_t i = 0u; i < ETEST_SIZE; ++i) {
+                    addrs[i] = scc_btree_find(dst, values[i]);
+                    TEST_ASSERT_TRUE(!!addrs[i]);
+                }
+                TEST_ASSERT_TRUE(scc_btree_merge(dst, src));
+                assert_btree_contents(dst, expected, n);
+                assert_btree_contents(src, expected + gaps[g] + 1u, (size_t)sizes[k]);
+
+                reused = 0u;
+                for (size_t i = 0u; i < ETEST_SIZE; ++i) {
+                    reused += scc_btree_find(dst, values[i]) == addrs[i];
+                }
+                /* Upper bound of the height, nodes having at least two children */
+                for (height = 1u; (1u << height) <= ETEST_SIZE; ++height);
+                moved = 4u * scc_btree_order(dst) * (height + 1u);
+                TEST_ASSERT_GREATER_OR_EQUAL_UINT64(moved < ETEST_SIZE ? ETEST_SIZE - moved : 0u, reused);
+
+                assert_btree_drains(dst, expected, n);
+                scc_btree_free(dst);
+                scc_btree_free(src);
+            }
+        }
+    }
+}
+
+void test_scc_btree_set_operations(void) {
+    /* Each value in [0, ETEST_SIZE / 2) twice on the left, values
+     * in [ETEST_SIZE / 4, ETEST_SIZE) once on the right */
+    static int left[ETEST_SIZE];
+    static int right[3 * ETEST_SIZE / 4];
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        left[i] = i / 2;
+    }
+    for (int i = 0; i < (int)scc_arrsize(right); ++i) {
+        right[i] = ETEST_SIZE / 4 + i;
+    }
+
+    static int expected[2 * ETEST_SIZE];
+    scc_btree(int) lbtree = btree_with_values(left, scc_arrsize(left));
+    scc_btree(int) rbtree = btree_with_values(right, scc_arrsize(right));
+
+    size_t n = 0u;
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        expected[n++] = i;
+        if (i < ETEST_SIZE / 2) {
+            expected[n++] = i;
+        }
+    }
+    scc_btree(int) result = scc_btree_union(lbtree, rbtree);
+    TEST_ASSERT_TRUE(!!result);
+    assert_btree_contents(result, expected, n);
+    scc_btree_free(result);
+
+    n = 0u;
+    for (int i = ETEST_SIZE / 4; i < ETEST_SIZE / 2; ++i) {
+        expected[n++] = i;
+    }
+    result = scc_btree_intersection(lbtree, rbtree);
+    TEST_ASSERT_TRUE(!!result);
+    assert_btree_contents(result, expected, n);
+    scc_btree_free(result);
+
+    n = 0u;
+    for (int i = 0; i < ETEST_SIZE / 2; ++i) {
+        expected[n++] = i;
+        if (i < ETEST_SIZE / 4) {
+            expected[n++] = i;
+        }
+    }
+    result = scc_btree_difference(lbtree, rbtree);
+    TEST_ASSERT_TRUE(!!result);
+    assert_btree_contents(result, expected, n);
+    TEST_ASSERT_TRUE(scc_btree_insert(&result, -1));
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(result));
+    scc_btree_free(result);
+
+    /* Disjoint operands */
+    result = scc_btree_difference(rbtree, lbtree);
+    TEST_ASSERT_TRUE(!!result);
+    assert_btree_contents(result, right + ETEST_SIZE / 4, scc_arrsize(right) - ETEST_SIZE / 4);
+    scc_btree_free(result);
+
+    scc_btree_free(lbtree);
+    scc_btree_free(rbtree);
+}
+
+static void sorted_insert(int *sorted, size_t *n, int value) {
+    size_t i = *n;
+    for (; i && sorted[i - 1u] > value; --i) {
+        sorted[i] = sorted[i - 1u];
+    }
+    sorted[i] = value;
+    ++*n;
+}
+
+static void sorted_remove(int *sorted, size_t *n, size_t index) {
+    for (size_t i = index + 1u; i < *n; ++i) {
+        sorted[i - 1u] = sorted[i];
+    }
+    --*n;
+}
+
+static void assert_order_statistics(scc_btree(int) btree, int const *sorted, size_t n) {
+    TEST_ASSERT_EQUAL_UINT64(n, scc_btree_size(btree));
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+    int const *elem;
+    size_t rank = 0u;
+    for (size_t i = 0u; i < n; ++i) {
+        elem = scc_btree_select(btree, i);
+        TEST_ASSERT_TRUE(!!elem);
+        TEST_ASSERT_EQUAL_INT32(sorted[i], *elem);
+        /* Rank of a duplicate is that of its first copy */
+        if (i && sorted[i - 1u] != sorted[i]) {
+            rank = i;
+        }
+        TEST_ASSERT_EQUAL_UINT64(rank, scc_btree_rank(btree, sorted[i]));
+    }
+    TEST_ASSERT_FALSE(scc_btree_select(btree, n));
+}
+
+void test_scc_btree_counted_insert_remove(void) {
+    static int sorted[ETEST_SIZE];
+    size_t n = 0u;
+    scc_btree(int) btree = scc_btree_new_counted_dyn(int, ecompare);
+    TEST_ASSERT_TRUE(!!btree);
+
+    int value;
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        /* Scattered, with every value present twice */
+        value = (i * 7919) % (ETEST_SIZE / 2);
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, value));
+        sorted_insert(sorted, &n, value);
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+        if (!(i % 97)) {
+            assert_order_statistics(btree, sorted, n);
+        }
+    }
+    assert_order_statistics(btree, sorted, n);
+
+    size_t index;
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        index = ((size_t)i * 104729u) % n;
+        TEST_ASSERT_TRUE(scc_btree_remove(btree, sorted[index]));
+        sorted_remove(sorted, &n, index);
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+        if (!(i % 97)) {
+            assert_order_statistics(btree, sorted, n);
+        }
+    }
+    assert_order_statistics(btree, sorted, n);
+    TEST_ASSERT_FALSE(scc_btree_remove(btree, 0));
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+    scc_btree_free(btree);
+}
+
+void test_scc_btree_counted_quantile(void) {
+    scc_btree(int) btree = scc_btree_with_order_counted_dyn(int, ecompare, 32u);
+    TEST_ASSERT_TRUE(!!btree);
+    TEST_ASSERT_FALSE(scc_btree_quantile(btree, 0.5));
+
+    /* Insert in reverse so that the tree is not trivially balanced */
+    for (int i = 999; i >= 0; --i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, i));
+    }
+    TEST_ASSERT_EQUAL_INT32(0, *(int const *)scc_btree_quantile(btree, 0.0));
+    TEST_ASSERT_EQUAL_INT32(499, *(int const *)scc_btree_quantile(btree, 0.5));
+    TEST_ASSERT_EQUAL_INT32(989, *(int const *)scc_btree_quantile(btree, 0.99));
+    TEST_ASSERT_EQUAL_INT32(998, *(int const *)scc_btree_quantile(btree, 0.999));
+    TEST_ASSERT_EQUAL_INT32(999, *(int const *)scc_btree_quantile(btree, 1.0));
+    TEST_ASSERT_EQUAL_INT32(0, *(int const *)scc_btree_quantile(btree, -1.0));
+    TEST_ASSERT_EQUAL_INT32(999, *(int const *)scc_btree_quantile(btree, 2.0));
+
+    /* Sliding window of the 1000 most recent values */
+    for (int i = 1000; i < 3000; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, i));
+        TEST_ASSERT_TRUE(scc_btree_remove(btree, i - 1000));
+        TEST_ASSERT_EQUAL_INT32(i - 500, *(int const *)scc_btree_quantile(btree, 0.5));
+        TEST_ASSERT_EQUAL_INT32(i - 10, *(int const *)scc_btree_quantile(btree, 0.99));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+    scc_btree_free(btree);
+}
+
+void test_scc_btree_counted_quantile_small(void) {
+    scc_btree(int) btree = scc_btree_with_order_counted_dyn(int, ecompare, 4u);
+    TEST_ASSERT_TRUE(!!btree);
+
+    TEST_ASSERT_TRUE(scc_btree_insert(&btree, 10));
+    TEST_ASSERT_EQUAL_INT32(10, *(int const *)scc_btree_quantile(btree, 0.0));
+    TEST_ASSERT_EQUAL_INT32(10, *(int const *)scc_btree_quantile(btree, 0.5));
+    TEST_ASSERT_EQUAL_INT32(10, *(int const *)scc_btree_quantile(btree, 0.99));
+
+    /* Nearest rank, ceil(q * n) - 1 */
+    for (int i = 20; i <= 40; i += 10) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, i));
+    }
+    TEST_ASSERT_EQUAL_INT32(10, *(int const *)scc_btree_quantile(btree, 0.25));
+    TEST_ASSERT_EQUAL_INT32(20, *(int const *)scc_btree_quantile(btree, 0.26));
+    TEST_ASSERT_EQUAL_INT32(20, *(int const *)scc_btree_quantile(btree, 0.5));
+    TEST_ASSERT_EQUAL_INT32(30, *(int const *)scc_btree_quantile(btree, 0.75));
+    TEST_ASSERT_EQUAL_INT32(40, *(int const *)scc_btree_quantile(btree, 0.99));
+
+    for (int i = 50; i <= 100; i += 10) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, i));
+    }
+    TEST_ASSERT_EQUAL_INT32(50, *(int const *)scc_btree_quantile(btree, 0.5));
+    TEST_ASSERT_EQUAL_INT32(60, *(int const *)scc_btree_quantile(btree, 0.51));
+    TEST_ASSERT_EQUAL_INT32(90, *(int const *)scc_btree_quantile(btree, 0.9));
+    TEST_ASSERT_EQUAL_INT32(100, *(int const *)scc_btree_quantile(btree, 0.99));
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+    scc_btree_free(btree);
+}
+
+void test_scc_btree_counted_bulk_operations(void) {
+    static int left[ETEST_SIZE];
+    static int right[ETEST_SIZE];
+    static int expected[2 * ETEST_SIZE];
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        left[i] = i * 2;
+        right[i] = i * 3;
+    }
+
+    scc_btree(int) dst = scc_btree_new_counted_dyn(int, ecompare);
+    scc_btree(int) src = scc_btree_new_counted_dyn(int, ecompare);
+    size_t n = 0u;
+    for (int i = 0; i < ETEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&dst, left[i]));
+        TEST_ASSERT_TRUE(scc_btree_insert(&src, right[i]));
+        sorted_insert(expected, &n, left[i]);
+        sorted_insert(expected, &n, right[i]);
+    }
+
+    TEST_ASSERT_TRUE(scc_btree_merge(dst, src));
+    assert_order_statistics(dst, expected, n);
+
+    scc_btree(int) copy = scc_btree_clone(dst);
+    TEST_ASSERT_TRUE(!!copy);
+    assert_order_statistics(copy, expected, n);
+
+    scc_btree(int) upper;
+    TEST_ASSERT_TRUE(scc_btree_split(copy, ETEST_SIZE, &upper));
+    size_t bound = scc_btree_size(copy);
+    TEST_ASSERT_EQUAL_UINT64(bound, scc_btree_rank(dst, ETEST_SIZE));
+    assert_order_statistics(copy, expected, bound);
+    assert_order_statistics(upper, expected + bound, n - bound);
+
+    /* Rebuilt trees remain counted when modified */
+    for (size_t i = bound; i < n; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&copy, expected[i]));
+    }
+    assert_order_statistics(copy, expected, n);
+
+    scc_btree(int) diff = scc_btree_difference(dst, src);
+    TEST_ASSERT_TRUE(!!diff);
+    assert_order_statistics(diff, left, ETEST_SIZE);
+
+    scc_btree_free(diff);
+    scc_btree_free(upper);
+    scc_btree_free(copy);
+    scc_btree_free(dst);
+    scc_btree_free(src);
+}
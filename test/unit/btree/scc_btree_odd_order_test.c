@@ -1,7 +1,10 @@
 #include <inspect/btree_inspect.h>
+#include <inspect/counting_allocator.h>
 #include <scc/btree.h>
 #include <scc/mem.h>
 
+#include <stdlib.h>
+
 #include <unity.h>
 
 #ifdef SCC_MUTATION_TEST
@@ -22,6 +25,21 @@ void test_scc_btree_with_order_3_dyn(void) {
     scc_btree_free(btree);
 }
 
+void test_scc_btree_with_order_in(void) {
+    counting_allocator_reset();
+    scc_btree(int) btree = scc_btree_with_order_in(int, ocompare, 5, &counting_allocator);
+    TEST_ASSERT_TRUE(!!btree);
+    for (int i = 0; i < OTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, i));
+    }
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    scc_btree(int) copy = scc_btree_clone(btree);
+    TEST_ASSERT_TRUE(!!copy);
+    scc_btree_free(btree);
+    scc_btree_free(copy);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
 void test_scc_btree_insert_odd_order(void) {
     scc_btree(int) btree = scc_btree_with_order(int, ocompare, 5);
 
@@ -144,3 +162,222 @@ void test_scc_btree_clone(void) {
     scc_btree_free(nbtree);
 
 }
+
+void test_scc_btree_foreach_odd_order(void) {
+    scc_btree(int) btree = scc_btree_with_order(int, ocompare, 3);
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, OTEST_SIZE - i - 1));
+    }
+
+    int expected = 0;
+    int const *iter;
+    scc_btree_foreach(iter, btree) {
+        TEST_ASSERT_EQUAL_INT32(expected, *iter);
+        ++expected;
+    }
+    TEST_ASSERT_EQUAL_INT32(OTEST_SIZE, expected);
+    scc_btree_free(btree);
+}
+
+void test_scc_btree_iterate_from_bound_odd_order(void) {
+    scc_btree(int) btree = scc_btree_with_order(int, ocompare, 5);
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, i * 3));
+    }
+
+    struct scc_btree_iter iter;
+    for(int i = 0; i < OTEST_SIZE * 3; i += 11) {
+        int expected = i + (3 - i % 3) % 3;
+        for(int const *elem = scc_btree_lower_bound(btree, i, &iter); elem; elem = scc_btree_iter_next(btree, &iter)) {
+            TEST_ASSERT_EQUAL_INT32(expected, *elem);
+            expected += 3;
+        }
+        TEST_ASSERT_EQUAL_INT32(OTEST_SIZE * 3, expected);
+    }
+    scc_btree_free(btree);
+}
+
+#define check_from_sorted(order)                                                                    \
+    do {                                                                                            \
+        for(int n_ = 0; n_ < OTEST_SIZE; n_ += 1 + n_ / 8) {                                        \
+            scc_btree(int) btree_ = scc_btree_with_order_from_sorted(int, ocompare, order, values, n_);\
+            TEST_ASSERT_TRUE(!!btree_);                                                             \
+            TEST_ASSERT_EQUAL_UINT64(n_, scc_btree_size(btree_));                                   \
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree_));                     \
+            int expected_ = 0;                                                                      \
+            int const *iter_;                                                                       \
+            scc_btree_foreach(iter_, btree_) {                                                      \
+                TEST_ASSERT_EQUAL_INT32(values[expected_++], *iter_);                               \
+            }                                                                                       \
+            TEST_ASSERT_EQUAL_INT32(n_, expected_);                                                 \
+            /* Tree remains modifiable */                                                           \
+            for(int i_ = 0; i_ < n_; i_ += 2) {                                                     \
+                TEST_ASSERT_TRUE(scc_btree_insert(&btree_, values[i_]));                            \
+            }                                                                                       \
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree_));                     \
+            for(int i_ = 0; i_ < n_; ++i_) {                                                        \
+                TEST_ASSERT_TRUE(scc_btree_remove(btree_, values[i_]));                             \
+            }                                                                                       \
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree_));                     \
+            scc_btree_free(btree_);                                                                 \
+        }                                                                                           \
+    } while(0)
+
+void test_scc_btree_from_sorted(void) {
+    static int values[OTEST_SIZE];
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        /* Runs of duplicates */
+        values[i] = i / 3;
+    }
+    check_from_sorted(3);
+    check_from_sorted(4);
+    check_from_sorted(5);
+    check_from_sorted(6);
+    check_from_sorted(7);
+    check_from_sorted(32);
+}
+
+void test_scc_btree_from_sorted_single_reserve(void) {
+    static int values[OTEST_SIZE];
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        values[i] = i;
+    }
+    scc_btree(int) btree = scc_btree_from_sorted(int, ocompare, values, OTEST_SIZE);
+    TEST_ASSERT_TRUE(!!btree);
+    struct scc_btree_base *base = scc_btree_impl_base(btree);
+    TEST_ASSERT_EQUAL_UINT64(1ull, scc_arena_nchunks(&base->bt_arena));
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(!!scc_btree_find(btree, i));
+    }
+    scc_btree_free(btree);
+}
+
+void test_scc_btree_from_sorted_in(void) {
+    static int values[OTEST_SIZE];
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        values[i] = i;
+    }
+    counting_allocator_reset();
+    scc_btree(int) btree = scc_btree_with_order_from_sorted_in(int, ocompare, 5, values, OTEST_SIZE, &counting_allocator);
+    TEST_ASSERT_TRUE(!!btree);
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    for(int i = 0; i < OTEST_SIZE; i += 2) {
+        TEST_ASSERT_TRUE(scc_btree_remove(btree, i));
+    }
+    scc_btree_free(btree);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+
+    counting_allocator_reset();
+    btree = scc_btree_from_sorted_in(int, ocompare, values, OTEST_SIZE, &counting_allocator);
+    TEST_ASSERT_TRUE(!!btree);
+    TEST_ASSERT_EQUAL_UINT64(OTEST_SIZE, scc_btree_size(btree));
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    scc_btree_free(btree);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
+static void assert_counted(scc_btree(int) btree, int const *sorted, size_t n) {
+    TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+    int const *elem;
+    for(size_t i = 0u; i < n; ++i) {
+        elem = scc_btree_select(btree, i);
+        TEST_ASSERT_TRUE(!!elem);
+        TEST_ASSERT_EQUAL_INT32(sorted[i], *elem);
+        TEST_ASSERT_EQUAL_UINT64(i, scc_btree_rank(btree, sorted[i]));
+    }
+    TEST_ASSERT_FALSE(scc_btree_select(btree, n));
+}
+
+#define check_counted(order)                                                                        \
+    do {                                                                                            \
+        scc_btree(int) btree_ = scc_btree_with_order_counted_dyn(int, ocompare, order);             \
+        TEST_ASSERT_TRUE(!!btree_);                                                                 \
+        for(int i_ = 0; i_ < OTEST_SIZE; ++i_) {                                                    \
+            TEST_ASSERT_TRUE(scc_btree_insert(&btree_, values[i_]));                                \
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree_));                     \
+        }                                                                                           \
+        assert_counted(btree_, sorted, OTEST_SIZE);                                                 \
+        /* Remove every other value, then the rest */                                               \
+        for(int i_ = 0; i_ < OTEST_SIZE; i_ += 2) {                                                 \
+            TEST_ASSERT_TRUE(scc_btree_remove(btree_, values[i_]));                                 \
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree_));                     \
+        }                                                                                           \
+        for(int i_ = 1; i_ < OTEST_SIZE; i_ += 2) {                                                 \
+            TEST_ASSERT_TRUE(scc_btree_remove(btree_, values[i_]));                                 \
+            TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree_));                     \
+        }                                                                                           \
+        TEST_ASSERT_EQUAL_UINT64(0ull, scc_btree_size(btree_));                                     \
+        TEST_ASSERT_FALSE(scc_btree_select(btree_, 0u));                                            \
+        scc_btree_free(btree_);                                                                     \
+    } while(0)
+
+void test_scc_btree_counted_odd_order(void) {
+    static int values[OTEST_SIZE];
+    static int sorted[OTEST_SIZE];
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        /* Permutation of [0, OTEST_SIZE) */
+        values[i] = (int)(((unsigned)i * 7919u) % OTEST_SIZE);
+        sorted[i] = i;
+    }
+    check_counted(3);
+    check_counted(5);
+    check_counted(7);
+    check_counted(31);
+}
+
+void test_scc_btree_counted_from_sorted(void) {
+    static int values[OTEST_SIZE];
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        values[i] = i;
+    }
+    scc_btree(int) btree = scc_btree_with_order_counted_dyn(int, ocompare, 5);
+    scc_btree(int) other = scc_btree_with_order_counted_dyn(int, ocompare, 5);
+    TEST_ASSERT_TRUE(!!btree);
+    TEST_ASSERT_TRUE(!!other);
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&other, values[i]));
+    }
+    /* Merging into an empty tree builds it from sorted values */
+    TEST_ASSERT_TRUE(scc_btree_merge(btree, other));
+    assert_counted(btree, values, OTEST_SIZE);
+    for(int i = OTEST_SIZE - 1; i >= 0; --i) {
+        TEST_ASSERT_TRUE(scc_btree_remove(btree, values[i]));
+        TEST_ASSERT_EQUAL_UINT32(0u, scc_btree_inspect_invariants(btree));
+    }
+    scc_btree_free(btree);
+    scc_btree_free(other);
+}
+
+void test_scc_btree_counted_in(void) {
+    static int values[OTEST_SIZE];
+    static int sorted[OTEST_SIZE];
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        values[i] = (int)(((unsigned)i * 7919u) % OTEST_SIZE);
+        sorted[i] = i;
+    }
+    counting_allocator_reset();
+    scc_btree(int) btree = scc_btree_with_order_counted_in(int, ocompare, 5, &counting_allocator);
+    TEST_ASSERT_TRUE(!!btree);
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, values[i]));
+    }
+    assert_counted(btree, sorted, OTEST_SIZE);
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    scc_btree(int) copy = scc_btree_clone(btree);
+    TEST_ASSERT_TRUE(!!copy);
+    assert_counted(copy, sorted, OTEST_SIZE);
+    scc_btree_free(btree);
+    scc_btree_free(copy);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+
+    counting_allocator_reset();
+    btree = scc_btree_new_counted_in(int, ocompare, &counting_allocator);
+    TEST_ASSERT_TRUE(!!btree);
+    for(int i = 0; i < OTEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_btree_insert(&btree, values[i]));
+    }
+    assert_counted(btree, sorted, OTEST_SIZE);
+    scc_btree_free(btree);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
@@ -1,3 +1,4 @@
+#include <inspect/counting_allocator.h>
 #include <scc/deque.h>
 
 #include <unity.h>
@@ -14,6 +15,22 @@ void test_scc_deque_new_dyn(void) {
     scc_deque_free(deque);
 }
 
+void test_scc_deque_new_in(void) {
+    counting_allocator_reset();
+    scc_deque(unsigned) deque = scc_deque_new_in(unsigned, &counting_allocator);
+    TEST_ASSERT_TRUE(!!deque);
+    size_t cap = scc_deque_capacity(deque);
+    for(unsigned i = 0u; i < 3u * cap; ++i) {
+        TEST_ASSERT_TRUE(scc_deque_push_front(&deque, i));
+    }
+    TEST_ASSERT_TRUE(alloc_counts.allocs + alloc_counts.reallocs > 1u);
+    scc_deque(unsigned) copy = scc_deque_clone(deque);
+    TEST_ASSERT_TRUE(!!copy);
+    scc_deque_free(deque);
+    scc_deque_free(copy);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
 void test_scc_deque_push_back(void) {
     scc_deque(unsigned) deque = scc_deque_new(unsigned);
     size_t cap = scc_deque_capacity(deque);
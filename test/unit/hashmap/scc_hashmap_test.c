@@ -1,11 +1,16 @@
+#include <inspect/counting_allocator.h>
 #include <inspect/hashmap_inspect.h>
 
 #include <scc/hash.h>
 #include <scc/hashmap.h>
 #include <scc/mem.h>
+#include <scc/pages.h>
 
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include <stdlib.h>
 #include <string.h>
 
 #include <unity.h>
@@ -47,6 +52,29 @@ void test_scc_hashmap_with_hash_dyn(void) {
     scc_hashmap_free(map);
 }
 
+/* test_scc_hashmap_new_in
+ *
+ * Create a map using a custom allocator and grow it,
+ * verifying that every table comes from the allocator
+ */
+void test_scc_hashmap_new_in(void) {
+    counting_allocator_reset();
+    scc_hashmap(int, unsigned) map = scc_hashmap_new_in(int, unsigned, eq, &counting_allocator);
+    TEST_ASSERT_TRUE(!!map);
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.allocs);
+    for (int i = 0; i < 1024; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, (unsigned)i));
+    }
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    for (int i = 0; i < 1024; ++i) {
+        unsigned *val = scc_hashmap_find(map, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT32((unsigned)i, *val);
+    }
+    scc_hashmap_free(map);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
 /* test_scc_hashmap_insert_changes_size
  *
  * Repeatedly insert elements in the hash map and
@@ -201,31 +229,28 @@ void test_scc_hashmap_elements_erased_on_remove(void) {
 
 /* test_scc_hashmap_insertion_probe_stop
  *
- * Repeatedly insert and remove values
- * until all slots have been occupied at least
- * once. Insert another value and verify that
- * it does not cause an inifinite loop
+ * Repeatedly insert and remove values and verify
+ * that tombstones are reclaimed before all slots
+ * have been occupied at least once. Vacate all
+ * slots, insert another value and verify that it
+ * does not cause an inifinite loop
  */
 void test_scc_hashmap_insertion_probe_stop(void) {
     scc_hashmap(int, unsigned short) map = scc_hashmap_new(int, unsigned short, eq);
     scc_hashmap_metatype *md = scc_hashmap_inspect_metadata(map);
 
-    /* Insert and remove until all slots have been
-     * used at least once */
-    bool done = false;
-    for(unsigned i = 0u; !done; ++i) {
-        done = true;
+    /* Insert and remove for several times the capacity */
+    for(unsigned i = 0u; i < 4u * scc_hashmap_capacity(map); ++i) {
         TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
         TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
-
-        for(unsigned j = 0u; j < scc_hashmap_capacity(map); ++j) {
-            if(!md[j]) {
-                done = false;
-                break;
-            }
-        }
     }
 
+    /* Tombstones are reclaimed before the empty slots run out */
+    TEST_ASSERT_TRUE(!!memchr(md, 0, scc_hashmap_capacity(map)));
+
+    /* Vacate all slots by hand */
+    memset(md, 0x7f, scc_hashmap_capacity(map) + SCC_HASHMAP_GUARDSZ);
+
     /* Should not cause infinite loop*/
     TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 1, 1));
 
@@ -234,31 +259,28 @@ void test_scc_hashmap_insertion_probe_stop(void) {
 
 /* test_scc_hashmap_find_probe_stop
  *
- * Repeatedly insert and remove values
- * until all slots have been occupied at least
- * once. Run find on the map and verify
- * that it does not cause an infinite loop
+ * Repeatedly insert and remove values and verify
+ * that tombstones are reclaimed before all slots
+ * have been occupied at least once. Vacate all
+ * slots, run find on the map and verify that it
+ * does not cause an infinite loop
  */
 void test_scc_hashmap_find_probe_stop(void) {
     scc_hashmap(int, unsigned short) map = scc_hashmap_new(int, unsigned short, eq);
     scc_hashmap_metatype *md = scc_hashmap_inspect_metadata(map);
 
-    /* Insert and remove until all slots have been
-     * used at least once */
-    bool done = false;
-    for(unsigned i = 0u; !done; ++i) {
-        done = true;
+    /* Insert and remove for several times the capacity */
+    for(unsigned i = 0u; i < 4u * scc_hashmap_capacity(map); ++i) {
         TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
         TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
-
-        for(unsigned j = 0u; j < scc_hashmap_capacity(map); ++j) {
-            if(!md[j]) {
-                done = false;
-                break;
-            }
-        }
     }
 
+    /* Tombstones are reclaimed before the empty slots run out */
+    TEST_ASSERT_TRUE(!!memchr(md, 0, scc_hashmap_capacity(map)));
+
+    /* Vacate all slots by hand */
+    memset(md, 0x7f, scc_hashmap_capacity(map) + SCC_HASHMAP_GUARDSZ);
+
     /* Should not cause infinite loop*/
     TEST_ASSERT_FALSE(scc_hashmap_find(map, 1));
 
@@ -352,3 +374,819 @@ void test_scc_hashmap_clone(void) {
     scc_hashmap_free(map);
     scc_hashmap_free(copy);
 }
+
+/* test_scc_hashmap_find_batch
+ *
+ * Insert a number of values and look up every other
+ * key in the inserted range, along with an equal number
+ * of keys not in the map, in a single batch. Verify that
+ * the returned pointers match those of scc_hashmap_find
+ */
+void test_scc_hashmap_find_batch(void) {
+    enum { TESTSIZE = 533 };
+    scc_hashmap(int, unsigned short) map = scc_hashmap_new(int, unsigned short, eq);
+    for(int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i << 1, (unsigned short)i));
+    }
+
+    int keys[TESTSIZE << 1];
+    unsigned short *vals[TESTSIZE << 1];
+    for(int i = 0; i < (int)scc_arrsize(keys); ++i) {
+        keys[i] = i;
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE, scc_hashmap_find_batch(map, keys, scc_arrsize(keys), vals));
+    for(int i = 0; i < (int)scc_arrsize(keys); ++i) {
+        if(i & 1) {
+            TEST_ASSERT_EQUAL_PTR(0, vals[i]);
+        }
+        else {
+            TEST_ASSERT_TRUE(!!vals[i]);
+            TEST_ASSERT_EQUAL_UINT16((unsigned short)(i >> 1), *vals[i]);
+            TEST_ASSERT_EQUAL_PTR(scc_hashmap_find(map, i), vals[i]);
+        }
+    }
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_find_batch_empty
+ *
+ * Run batch lookup in an empty map, verify that
+ * no keys are found
+ */
+void test_scc_hashmap_find_batch_empty(void) {
+    scc_hashmap(int, int) map = scc_hashmap_new(int, int, eq);
+    int keys[] = { 1, 2, 3 };
+    int *vals[] = { (int *)keys, (int *)keys, (int *)keys };
+    TEST_ASSERT_EQUAL_UINT64(0ull, scc_hashmap_find_batch(map, keys, scc_arrsize(keys), vals));
+    for(unsigned i = 0u; i < scc_arrsize(vals); ++i) {
+        TEST_ASSERT_EQUAL_PTR(0, vals[i]);
+    }
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_incremental_rehash
+ *
+ * Enable incremental rehashing and insert values until
+ * a migration is in progress. Verify that all values
+ * are found while both tables are alive and that the
+ * old table is eventually released
+ */
+void test_scc_hashmap_incremental_rehash(void) {
+    enum { TESTSIZE = 3000 };
+    scc_hashmap(int, unsigned short) map = scc_hashmap_new(int, unsigned short, eq);
+    scc_hashmap_set_incremental(map, true);
+
+    bool migrated = false;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+        TEST_ASSERT_EQUAL_UINT64(i + 1ull, scc_hashmap_size(map));
+        migrated = migrated || scc_hashmap_inspect_base(map)->hm_oldmap;
+    }
+    TEST_ASSERT_TRUE(migrated);
+
+    unsigned short *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_hashmap_find(map, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT16((unsigned short)i, *val);
+    }
+    TEST_ASSERT_FALSE(scc_hashmap_inspect_base(map)->hm_oldmap);
+    TEST_ASSERT_FALSE(!!scc_hashmap_find(map, TESTSIZE));
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_incremental_rehash_mid_migration
+ *
+ * Trigger an incremental rehash and, while the migration
+ * is still in progress, overwrite, remove and look up keys
+ * residing in either of the tables
+ */
+void test_scc_hashmap_incremental_rehash_mid_migration(void) {
+    scc_hashmap(int, unsigned short) map = scc_hashmap_new(int, unsigned short, eq);
+    scc_hashmap_set_incremental(map, true);
+
+    int n;
+    for (n = 0; !scc_hashmap_inspect_base(map)->hm_oldmap; ++n) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, n, n));
+    }
+
+    /* Overwrite values of keys in the old table */
+    for (int i = 0; i < n; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i + 1));
+        TEST_ASSERT_EQUAL_UINT64((size_t)n, scc_hashmap_size(map));
+    }
+
+    unsigned short *val;
+    for (int i = 0; i < n; i += 2) {
+        TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
+    }
+    TEST_ASSERT_EQUAL_UINT64((size_t)(n / 2), scc_hashmap_size(map));
+
+    for (int i = 0; i < n; ++i) {
+        val = scc_hashmap_find(map, i);
+        if (i & 1) {
+            TEST_ASSERT_TRUE(!!val);
+            TEST_ASSERT_EQUAL_UINT16((unsigned short)(i + 1), *val);
+        }
+        else {
+            TEST_ASSERT_FALSE(!!val);
+        }
+    }
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_find_batch_mid_migration
+ *
+ * Look up a batch of keys while a migration is in progress,
+ * some of which still reside in the old table. Verify that
+ * each key is hashed only once
+ */
+void test_scc_hashmap_find_batch_mid_migration(void) {
+    scc_hashmap(int, unsigned short) map = scc_hashmap_new(int, unsigned short, eq);
+    scc_hashmap_set_incremental(map, true);
+
+    /* Large enough for the migration to outlast the lookup */
+    int n = 0;
+    while (!scc_hashmap_inspect_base(map)->hm_oldmap || scc_hashmap_capacity(map) < 8u * SCC_HASHMAP_MIGRATESZ) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, n, n));
+        ++n;
+    }
+
+    int keys[64];
+    unsigned short *vals[scc_arrsize(keys)];
+    for (unsigned i = 0u; i < scc_arrsize(keys); ++i) {
+        keys[i] = (int)i * n / (int)scc_arrsize(keys);
+    }
+
+#ifdef SCC_PERFEVTS
+    struct scc_hashmap_perfevts const before = scc_hashmap_inspect_base(map)->hm_perf;
+#endif
+    TEST_ASSERT_EQUAL_UINT64(scc_arrsize(keys), scc_hashmap_find_batch(map, keys, scc_arrsize(keys), vals));
+    TEST_ASSERT_TRUE(!!scc_hashmap_inspect_base(map)->hm_oldmap);
+#ifdef SCC_PERFEVTS
+    /* Migrated pairs are rehashed, the batch is hashed once */
+    struct scc_hashmap_perfevts const *after = &scc_hashmap_inspect_base(map)->hm_perf;
+    TEST_ASSERT_EQUAL_UINT64(
+        scc_arrsize(keys) + after->ev_n_migrated - before.ev_n_migrated,
+        after->ev_n_hash - before.ev_n_hash
+    );
+#endif
+
+    for (unsigned i = 0u; i < scc_arrsize(keys); ++i) {
+        TEST_ASSERT_TRUE(!!vals[i]);
+        TEST_ASSERT_EQUAL_UINT16((unsigned short)keys[i], *vals[i]);
+    }
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_incremental_rehash_clone
+ *
+ * Clone a hash map with a migration in progress and
+ * verify that the copy contains all pairs
+ */
+void test_scc_hashmap_incremental_rehash_clone(void) {
+    scc_hashmap(int, unsigned short) map = scc_hashmap_new_dyn(int, unsigned short, eq);
+    scc_hashmap_set_incremental(map, true);
+
+    int n;
+    for (n = 0; !scc_hashmap_inspect_base(map)->hm_oldmap; ++n) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, n, n));
+    }
+
+    scc_hashmap(int, unsigned short) copy = scc_hashmap_clone(map);
+    TEST_ASSERT_TRUE(!!copy);
+    TEST_ASSERT_EQUAL_UINT64(scc_hashmap_size(map), scc_hashmap_size(copy));
+    scc_hashmap_free(map);
+
+    unsigned short *val;
+    for (int i = 0; i < n; ++i) {
+        val = scc_hashmap_find(copy, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT16((unsigned short)i, *val);
+    }
+
+    scc_hashmap_free(copy);
+}
+
+static unsigned n_eq_calls;
+
+static bool counting_eq(void const *left, void const *right) {
+    ++n_eq_calls;
+    return eq(left, right);
+}
+
+#ifdef SCC_SIMD_ISA
+extern int scc_simd_support;
+#endif
+
+/* test_scc_hashmap_stored_hash
+ *
+ * Insert values in a hash map storing full hashes using
+ * a hash function whose high bits are always the same.
+ * Verify that the portable probes only invoke the
+ * comparator for keys whose full hashes are equal
+ */
+void test_scc_hashmap_stored_hash(void) {
+    enum { TESTSIZE = 700 };
+#ifdef SCC_SIMD_ISA
+    /* The vectorized probes filter on the metadata tag only */
+    int simd_backup = scc_simd_support;
+    scc_simd_support = 0;
+#endif
+    scc_hashmap(int, unsigned short) map = scc_hashmap_with_stored_hash(int, unsigned short, counting_eq, ident);
+    TEST_ASSERT_NOT_EQUAL_UINT64(0ull, scc_hashmap_inspect_base(map)->hm_hashoff);
+
+    n_eq_calls = 0u;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, n_eq_calls);
+    TEST_ASSERT_NOT_EQUAL_UINT64(0ull, scc_hashmap_inspect_base(map)->hm_hashoff);
+#ifdef SCC_PERFEVTS
+    /* No rehashing of keys when growing */
+    TEST_ASSERT_NOT_EQUAL_UINT64(0ull, scc_hashmap_inspect_base(map)->hm_perf.ev_n_rehashes);
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE, scc_hashmap_inspect_base(map)->hm_perf.ev_n_hash);
+    TEST_ASSERT_EQUAL_UINT64(0ull, scc_hashmap_inspect_base(map)->hm_perf.ev_n_eqs);
+#endif
+
+    unsigned short *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_hashmap_find(map, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT16((unsigned short)i, *val);
+    }
+    TEST_ASSERT_EQUAL_UINT32(TESTSIZE, n_eq_calls);
+
+    n_eq_calls = 0u;
+    TEST_ASSERT_FALSE(!!scc_hashmap_find(map, TESTSIZE));
+    TEST_ASSERT_EQUAL_UINT32(0u, n_eq_calls);
+
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 0, 1));
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE, scc_hashmap_size(map));
+    TEST_ASSERT_EQUAL_UINT32(1u, n_eq_calls);
+
+    scc_hashmap_free(map);
+#ifdef SCC_SIMD_ISA
+    scc_simd_support = simd_backup;
+#endif
+}
+
+/* test_scc_hashmap_stored_hash_remove_clone
+ *
+ * Remove every other key from a dynamically allocated
+ * hash map storing full hashes, clone it and verify
+ * the contents of the copy
+ */
+void test_scc_hashmap_stored_hash_remove_clone(void) {
+    enum { TESTSIZE = 433 };
+    scc_hashmap(int, unsigned short) map = scc_hashmap_with_stored_hash_dyn(int, unsigned short, eq, scc_hash_fnv1a);
+    TEST_ASSERT_TRUE(!!map);
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+    }
+    for (int i = 0; i < TESTSIZE; i += 2) {
+        TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
+    }
+
+    scc_hashmap(int, unsigned short) copy = scc_hashmap_clone(map);
+    TEST_ASSERT_TRUE(!!copy);
+    scc_hashmap_free(map);
+
+    unsigned short *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_hashmap_find(copy, i);
+        TEST_ASSERT_EQUAL(i & 1, !!val);
+        if (val) {
+            TEST_ASSERT_EQUAL_UINT16((unsigned short)i, *val);
+        }
+    }
+
+    scc_hashmap_free(copy);
+}
+
+/* test_scc_hashmap_foreach
+ *
+ * Insert keys, remove some of them and verify that
+ * iteration visits each remaining pair exactly once
+ * and allows for modifying the values
+ */
+void test_scc_hashmap_foreach(void) {
+    enum { TESTSIZE = 300 };
+    scc_hashmap(int, unsigned short) map = scc_hashmap_new(int, unsigned short, eq);
+    scc_hashmap_iter(int, unsigned short) iter;
+
+    unsigned visited = 0u;
+    scc_hashmap_foreach(iter, map) {
+        ++visited;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0u, visited);
+
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+    }
+    for (int i = 0; i < TESTSIZE; i += 3) {
+        TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
+    }
+
+    bool seen[TESTSIZE] = { 0 };
+    scc_hashmap_foreach(iter, map) {
+        TEST_ASSERT_TRUE(*iter.key >= 0 && *iter.key < TESTSIZE);
+        TEST_ASSERT_TRUE(*iter.key % 3);
+        TEST_ASSERT_FALSE(seen[*iter.key]);
+        TEST_ASSERT_EQUAL_UINT16((unsigned short)*iter.key, *iter.value);
+        seen[*iter.key] = true;
+        *iter.value += 1u;
+        ++visited;
+    }
+    TEST_ASSERT_EQUAL_UINT64(scc_hashmap_size(map), visited);
+
+    unsigned short *val;
+    for (int i = 1; i < TESTSIZE; i += 3) {
+        val = scc_hashmap_find(map, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT16((unsigned short)(i + 1), *val);
+    }
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_foreach_sparse
+ *
+ * Iterate over a map with a small number of pairs
+ * scattered across a large capacity, including the
+ * very first slot
+ */
+void test_scc_hashmap_foreach_sparse(void) {
+    enum { TESTSIZE = 4096 };
+    scc_hashmap(int, unsigned) map = scc_hashmap_with_hash(int, unsigned, eq, ident);
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+    }
+    size_t const cap = scc_hashmap_capacity(map);
+    for (int i = 0; i < TESTSIZE; ++i) {
+        if (i != 0 && i != 33 && i != 1000 && i != TESTSIZE - 1) {
+            TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT64(cap, scc_hashmap_capacity(map));
+    TEST_ASSERT_EQUAL_UINT64(4ull, scc_hashmap_size(map));
+
+    scc_hashmap_iter(int, unsigned) iter;
+    int sum = 0;
+    unsigned visited = 0u;
+    scc_hashmap_foreach(iter, map) {
+        TEST_ASSERT_EQUAL_UINT32((unsigned)*iter.key, *iter.value);
+        sum += *iter.key;
+        ++visited;
+    }
+    TEST_ASSERT_EQUAL_UINT32(4u, visited);
+    TEST_ASSERT_EQUAL_INT32(33 + 1000 + TESTSIZE - 1, sum);
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_foreach_incremental_rehash
+ *
+ * Start iterating while an incremental migration is
+ * in progress and verify that all pairs are visited
+ */
+void test_scc_hashmap_foreach_incremental_rehash(void) {
+    scc_hashmap(int, unsigned short) map = scc_hashmap_new(int, unsigned short, eq);
+    scc_hashmap_set_incremental(map, true);
+
+    int n = 0;
+    while (!scc_hashmap_inspect_base(map)->hm_oldmap) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, n, n));
+        ++n;
+    }
+
+    scc_hashmap_iter(int, unsigned short) iter;
+    long long sum = 0;
+    unsigned visited = 0u;
+    scc_hashmap_foreach(iter, map) {
+        sum += *iter.key;
+        ++visited;
+    }
+    TEST_ASSERT_FALSE(scc_hashmap_inspect_base(map)->hm_oldmap);
+    TEST_ASSERT_EQUAL_UINT32((unsigned)n, visited);
+    TEST_ASSERT_EQUAL_INT64(n * (n - 1ll) / 2ll, sum);
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_tombstone_count
+ *
+ * Verify that removals leave tombstones behind and
+ * that reusing a vacated slot consumes the tombstone
+ */
+void test_scc_hashmap_tombstone_count(void) {
+    scc_hashmap(int, unsigned) map = scc_hashmap_with_hash(int, unsigned, eq, ident);
+    struct scc_hashmap_base *base = scc_hashmap_inspect_base(map);
+
+    for (int i = 0; i < 4; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(0ull, base->hm_tombs);
+    TEST_ASSERT_TRUE(scc_hashmap_remove(map, 1));
+    TEST_ASSERT_TRUE(scc_hashmap_remove(map, 2));
+    TEST_ASSERT_EQUAL_UINT64(2ull, base->hm_tombs);
+#ifdef SCC_PERFEVTS
+    TEST_ASSERT_EQUAL_UINT64(2ull, base->hm_perf.ev_n_tombstones);
+#endif
+
+    /* Hashes to the vacated slot 1 */
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 1, 1));
+    TEST_ASSERT_EQUAL_UINT64(1ull, base->hm_tombs);
+
+    scc_hashmap_clear(map);
+    TEST_ASSERT_EQUAL_UINT64(0ull, base->hm_tombs);
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_tombstone_compaction
+ *
+ * Insert and remove keys at the same rate for many times the
+ * capacity of the map and verify that tombstones are reclaimed
+ * by in-place rehashes rather than by growing the map
+ */
+void test_scc_hashmap_tombstone_compaction(void) {
+    enum { LIVE = 20, ROUNDS = 2000 };
+    scc_hashmap(int, unsigned) map = scc_hashmap_new(int, unsigned, eq);
+    for (int i = 0; i < LIVE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+    }
+    size_t const cap = scc_hashmap_capacity(map);
+
+    struct scc_hashmap_base *base;
+    for (int i = LIVE; i < LIVE + ROUNDS; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_remove(map, i - LIVE));
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+        base = scc_hashmap_inspect_base(map);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT64(cap * SCC_HASHMAP_TOMBSTONE_PERCENT / 100u, base->hm_tombs);
+    }
+    TEST_ASSERT_EQUAL_UINT64(cap, scc_hashmap_capacity(map));
+    TEST_ASSERT_EQUAL_UINT64((unsigned long long)LIVE, scc_hashmap_size(map));
+#ifdef SCC_PERFEVTS
+    TEST_ASSERT_GREATER_THAN_UINT64(0ull, base->hm_perf.ev_n_compactions);
+    TEST_ASSERT_EQUAL_UINT64(0ull, base->hm_perf.ev_n_rehashes);
+    TEST_ASSERT_EQUAL_UINT64(base->hm_tombs, base->hm_perf.ev_n_tombstones);
+#endif
+
+    unsigned *val;
+    for (int i = 0; i < LIVE + ROUNDS; ++i) {
+        val = scc_hashmap_find(map, i);
+        TEST_ASSERT_EQUAL(i >= ROUNDS, !!val);
+        if (val) {
+            TEST_ASSERT_EQUAL_UINT32((unsigned)i, *val);
+        }
+    }
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_tombstone_compaction_collisions
+ *
+ * Compact a map in which a large number of keys share
+ * the same start slot and verify that all of them are
+ * still reachable afterwards
+ */
+void test_scc_hashmap_tombstone_compaction_collisions(void) {
+    enum { TESTSIZE = 200 };
+    scc_hashmap(int, unsigned) map = scc_hashmap_with_hash(int, unsigned, eq, ident);
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+    }
+    size_t const cap = scc_hashmap_capacity(map);
+
+    /* Keys congruent modulo capacity collide */
+    for (int i = 0; i < TESTSIZE; ++i) {
+        if (i % 3) {
+            TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
+        }
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, (int)cap * (i % 4 + 1) + i % 8, i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(cap, scc_hashmap_capacity(map));
+
+    unsigned *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_hashmap_find(map, i);
+        TEST_ASSERT_EQUAL(!(i % 3), !!val);
+    }
+    for (int i = 0; i < 8; ++i) {
+        TEST_ASSERT_TRUE(!!scc_hashmap_find(map, (int)cap * (i % 4 + 1) + i));
+    }
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_reserve
+ *
+ * Reserve capacity for a number of pairs, insert that
+ * many and verify that no further rehash occurs
+ */
+void test_scc_hashmap_reserve(void) {
+    enum { TESTSIZE = 1000 };
+    scc_hashmap(int, unsigned) map = scc_hashmap_new(int, unsigned, eq);
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, -1, 1u));
+    TEST_ASSERT_TRUE(scc_hashmap_reserve(&map, TESTSIZE));
+
+    size_t const cap = scc_hashmap_capacity(map);
+    TEST_ASSERT_EQUAL_UINT64(2048ull, cap);
+    TEST_ASSERT_TRUE(!!scc_hashmap_find(map, -1));
+#ifdef SCC_PERFEVTS
+    struct scc_hashmap_base *base = scc_hashmap_inspect_base(map);
+    TEST_ASSERT_EQUAL_UINT64(1ull, base->hm_perf.ev_n_rehashes);
+    TEST_ASSERT_GREATER_THAN_UINT64(base->hm_mdoff + cap, base->hm_perf.ev_bytesz);
+#endif
+
+    /* Already large enough */
+    TEST_ASSERT_TRUE(scc_hashmap_reserve(&map, 10));
+    TEST_ASSERT_EQUAL_UINT64(cap, scc_hashmap_capacity(map));
+
+    TEST_ASSERT_TRUE(scc_hashmap_remove(map, -1));
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(cap, scc_hashmap_capacity(map));
+#ifdef SCC_PERFEVTS
+    base = scc_hashmap_inspect_base(map);
+    TEST_ASSERT_EQUAL_UINT64(1ull, base->hm_perf.ev_n_rehashes);
+#endif
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_arrays_line_aligned
+ *
+ * Rehash a map and verify that the value and metadata
+ * arrays of the new allocation start on line boundaries
+ */
+void test_scc_hashmap_arrays_line_aligned(void) {
+    scc_hashmap(int, unsigned char) map = scc_hashmap_new(int, unsigned char, eq);
+    TEST_ASSERT_TRUE(scc_hashmap_reserve(&map, 1000));
+    struct scc_hashmap_base *base = scc_hashmap_inspect_base(map);
+    TEST_ASSERT_EQUAL_UINT32(SCC_PAGES_HEAP, base->hm_dynalloc);
+    TEST_ASSERT_EQUAL_UINT64(0ull, (uintptr_t)base % SCC_PAGES_LINESZ);
+    TEST_ASSERT_EQUAL_UINT64(0ull, base->hm_valoff % SCC_PAGES_LINESZ);
+    TEST_ASSERT_EQUAL_UINT64(0ull, base->hm_mdoff % SCC_PAGES_LINESZ);
+    TEST_ASSERT_EQUAL_UINT64(0ull, (uintptr_t)scc_hashmap_inspect_metadata(map) % SCC_PAGES_LINESZ);
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_reserve_huge
+ *
+ * Reserve a capacity large enough for the map to be
+ * mapped directly and verify that it is aligned on a
+ * huge page boundary and usable, also when cloned
+ */
+void test_scc_hashmap_reserve_huge(void) {
+    enum { TESTSIZE = 1024 };
+    size_t const cap = SCC_PAGES_HUGE_THRESHOLD / (sizeof(int) + sizeof(unsigned));
+    scc_hashmap(int, unsigned) map = scc_hashmap_new(int, unsigned, eq);
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, (unsigned)i << 1u));
+    }
+    TEST_ASSERT_TRUE(scc_hashmap_reserve(&map, cap));
+
+    struct scc_hashmap_base *base = scc_hashmap_inspect_base(map);
+    TEST_ASSERT_EQUAL_UINT32(SCC_PAGES_MAPPED, base->hm_dynalloc);
+    TEST_ASSERT_EQUAL_UINT64(0ull, (uintptr_t)base % SCC_PAGES_HUGESZ);
+
+    scc_hashmap(int, unsigned) clone = scc_hashmap_clone(map);
+    TEST_ASSERT_TRUE(!!clone);
+    TEST_ASSERT_EQUAL_UINT32(SCC_PAGES_MAPPED, scc_hashmap_inspect_base(clone)->hm_dynalloc);
+
+    unsigned *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_hashmap_find(map, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT32((unsigned)i << 1u, *val);
+        val = scc_hashmap_find(clone, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT32((unsigned)i << 1u, *val);
+    }
+    scc_hashmap_free(clone);
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_shrink_to_fit
+ *
+ * Grow a map, remove most of its pairs and verify
+ * that shrinking it reduces the capacity while
+ * retaining the remaining pairs
+ */
+void test_scc_hashmap_shrink_to_fit(void) {
+    enum { TESTSIZE = 1000, REMAINING = 50 };
+    scc_hashmap(int, unsigned) map = scc_hashmap_new(int, unsigned, eq);
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
+    }
+    size_t const cap = scc_hashmap_capacity(map);
+#ifdef SCC_PERFEVTS
+    size_t const bytesz = scc_hashmap_inspect_base(map)->hm_perf.ev_bytesz;
+#endif
+    for (int i = REMAINING; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(cap, scc_hashmap_capacity(map));
+
+    TEST_ASSERT_TRUE(scc_hashmap_shrink_to_fit(&map));
+    TEST_ASSERT_EQUAL_UINT64(64ull, scc_hashmap_capacity(map));
+    TEST_ASSERT_EQUAL_UINT64((unsigned long long)REMAINING, scc_hashmap_size(map));
+    TEST_ASSERT_EQUAL_UINT64(0ull, scc_hashmap_inspect_base(map)->hm_tombs);
+#ifdef SCC_PERFEVTS
+    TEST_ASSERT_LESS_THAN_UINT64(bytesz, scc_hashmap_inspect_base(map)->hm_perf.ev_bytesz);
+#endif
+
+    unsigned *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_hashmap_find(map, i);
+        TEST_ASSERT_EQUAL(i < REMAINING, !!val);
+        if (val) {
+            TEST_ASSERT_EQUAL_UINT32((unsigned)i, *val);
+        }
+    }
+
+    /* Already minimal */
+    TEST_ASSERT_TRUE(scc_hashmap_shrink_to_fit(&map));
+    TEST_ASSERT_EQUAL_UINT64(64ull, scc_hashmap_capacity(map));
+
+    scc_hashmap_clear(map);
+    TEST_ASSERT_TRUE(scc_hashmap_shrink_to_fit(&map));
+    TEST_ASSERT_EQUAL_UINT64((unsigned long long)SCC_HASHMAP_STACKCAP, scc_hashmap_capacity(map));
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_from
+ *
+ * Build a map from arrays of keys and values and
+ * verify its capacity and contents
+ */
+void test_scc_hashmap_from(void) {
+    enum { TESTSIZE = 1000 };
+    int keys[TESTSIZE];
+    unsigned short vals[TESTSIZE];
+    for (int i = 0; i < TESTSIZE; ++i) {
+        keys[i] = i * 7;
+        vals[i] = (unsigned short)i;
+    }
+
+    scc_hashmap(int, unsigned short) map = scc_hashmap_from(int, unsigned short, eq, keys, vals, TESTSIZE);
+    TEST_ASSERT_TRUE(!!map);
+    TEST_ASSERT_EQUAL_UINT64((unsigned long long)TESTSIZE, scc_hashmap_size(map));
+    TEST_ASSERT_EQUAL_UINT64(2048ull, scc_hashmap_capacity(map));
+    TEST_ASSERT_TRUE(scc_hashmap_inspect_base(map)->hm_dynalloc);
+
+    unsigned short *val;
+    for (int i = 0; i < TESTSIZE * 7; ++i) {
+        val = scc_hashmap_find(map, i);
+        TEST_ASSERT_EQUAL(!(i % 7), !!val);
+        if (val) {
+            TEST_ASSERT_EQUAL_UINT16((unsigned short)(i / 7), *val);
+        }
+    }
+
+    /* Map is fully functional */
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 0, 1234));
+    TEST_ASSERT_EQUAL_UINT64((unsigned long long)TESTSIZE, scc_hashmap_size(map));
+    val = scc_hashmap_find(map, 0);
+    TEST_ASSERT_TRUE(!!val);
+    TEST_ASSERT_EQUAL_UINT16(1234, *val);
+    TEST_ASSERT_TRUE(scc_hashmap_remove(map, 7));
+    TEST_ASSERT_FALSE(scc_hashmap_find(map, 7));
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_from_empty
+ *
+ * Build a map from empty arrays
+ */
+void test_scc_hashmap_from_empty(void) {
+    int key = 0;
+    unsigned val = 0u;
+    scc_hashmap(int, unsigned) map = scc_hashmap_with_hash_from(int, unsigned, eq, ident, &key, &val, 0u);
+    TEST_ASSERT_TRUE(!!map);
+    TEST_ASSERT_EQUAL_UINT64(0ull, scc_hashmap_size(map));
+    TEST_ASSERT_EQUAL_UINT64((unsigned long long)SCC_HASHMAP_STACKCAP, scc_hashmap_capacity(map));
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 1, 2u));
+    unsigned *found = scc_hashmap_find(map, 1);
+    TEST_ASSERT_TRUE(!!found);
+    TEST_ASSERT_EQUAL_UINT32(2u, *found);
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_new_scalar
+ *
+ * Insert 64-bit keys differing only in their most significant
+ * bytes in a map with scalar keys, forcing several rehashes.
+ * Verify that all keys are found, that keys not in the map are
+ * not and that inserting a present key replaces its value
+ */
+void test_scc_hashmap_new_scalar(void) {
+    enum { TESTSIZE = 3000 };
+    scc_hashmap(unsigned long long, unsigned) map = scc_hashmap_new_scalar(unsigned long long, unsigned);
+    TEST_ASSERT_FALSE(scc_hashmap_inspect_base(map)->hm_eq);
+
+    for(unsigned i = 0u; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, (unsigned long long)i << 40u, i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE, scc_hashmap_size(map));
+
+    unsigned *val;
+    for(unsigned i = 0u; i < TESTSIZE; ++i) {
+        val = scc_hashmap_find(map, (unsigned long long)i << 40u);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT32(i, *val);
+        TEST_ASSERT_FALSE(scc_hashmap_find(map, ((unsigned long long)i << 40u) | 1u));
+    }
+
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 0ull, 38u));
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE, scc_hashmap_size(map));
+    val = scc_hashmap_find(map, 0ull);
+    TEST_ASSERT_TRUE(!!val);
+    TEST_ASSERT_EQUAL_UINT32(38u, *val);
+
+    for(unsigned i = 0u; i < TESTSIZE; i += 2u) {
+        TEST_ASSERT_TRUE(scc_hashmap_remove(map, (unsigned long long)i << 40u));
+    }
+    for(unsigned i = 0u; i < TESTSIZE; ++i) {
+        TEST_ASSERT_EQUAL_INT(i & 1u, !!scc_hashmap_find(map, (unsigned long long)i << 40u));
+    }
+
+    scc_hashmap_free(map);
+}
+
+/* test_scc_hashmap_new_scalar_narrow_keys
+ *
+ * Fill maps with 8- and 16-bit scalar keys, packed next to
+ * each other in the key array, and verify that only the
+ * bytes of each key take part in the comparison
+ */
+void test_scc_hashmap_new_scalar_narrow_keys(void) {
+    scc_hashmap(unsigned char, int) cmap = scc_hashmap_new_scalar_dyn(unsigned char, int);
+    TEST_ASSERT_TRUE(!!cmap);
+    for(unsigned i = 0u; i <= UCHAR_MAX; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&cmap, (unsigned char)i, (int)i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(UCHAR_MAX + 1ull, scc_hashmap_size(cmap));
+    for(unsigned i = 0u; i <= UCHAR_MAX; ++i) {
+        int *val = scc_hashmap_find(cmap, (unsigned char)i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_INT32((int)i, *val);
+    }
+    scc_hashmap_free(cmap);
+
+    enum { TESTSIZE = 1200 };
+    scc_hashmap(unsigned short, int) smap = scc_hashmap_new_scalar(unsigned short, int);
+    for(unsigned i = 0u; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&smap, (unsigned short)(i << 3u), (int)i));
+    }
+    for(unsigned i = 0u; i < TESTSIZE << 3u; ++i) {
+        int *val = scc_hashmap_find(smap, (unsigned short)i);
+        TEST_ASSERT_EQUAL_INT(!(i & 7u), !!val);
+        if(val) {
+            TEST_ASSERT_EQUAL_INT32((int)(i >> 3u), *val);
+        }
+    }
+    scc_hashmap_free(smap);
+}
+
+/* test_scc_hashmap_new_scalar_find_batch
+ *
+ * Insert pointer keys in a map with scalar keys and look
+ * up present and absent keys in a single batch
+ */
+void test_scc_hashmap_new_scalar_find_batch(void) {
+    enum { TESTSIZE = 300 };
+    static int objs[TESTSIZE << 1];
+    scc_hashmap(int *, int) map = scc_hashmap_new_scalar(int *, int);
+    for(int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, &objs[i << 1], i));
+    }
+
+    int *keys[TESTSIZE << 1];
+    int *vals[TESTSIZE << 1];
+    for(int i = 0; i < (int)scc_arrsize(keys); ++i) {
+        keys[i] = &objs[i];
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE, scc_hashmap_find_batch(map, keys, scc_arrsize(keys), vals));
+    for(int i = 0; i < (int)scc_arrsize(keys); ++i) {
+        if(i & 1) {
+            TEST_ASSERT_EQUAL_PTR(0, vals[i]);
+        }
+        else {
+            TEST_ASSERT_TRUE(!!vals[i]);
+            TEST_ASSERT_EQUAL_INT32(i >> 1, *vals[i]);
+        }
+    }
+
+    scc_hashmap_free(map);
+}
@@ -1,12 +1,15 @@
+#include <inspect/counting_allocator.h>
 #include <inspect/hashtab_inspect.h>
 
 #include <scc/bug.h>
 #include <scc/hash.h>
 #include <scc/hashtab.h>
 #include <scc/mem.h>
+#include <scc/pages.h>
 
 #include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <unity.h>
@@ -41,6 +44,21 @@ static bool contains(int *tab, int value) {
     return false;
 }
 
+void test_scc_hashtab_new_in(void) {
+    counting_allocator_reset();
+    scc_hashtab(int) tab = scc_hashtab_new_in(int, eq, &counting_allocator);
+    TEST_ASSERT_TRUE(!!tab);
+    for(int i = 0; i < TEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashtab_insert(&tab, i));
+    }
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    scc_hashtab(int) copy = scc_hashtab_clone(tab);
+    TEST_ASSERT_TRUE(!!copy);
+    scc_hashtab_free(tab);
+    scc_hashtab_free(copy);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
 void test_scc_hashtab_new_dyn(void) {
     scc_hashtab(int) hashtab = scc_hashtab_new_dyn(int, eq);
     TEST_ASSERT_TRUE(!!hashtab);
@@ -147,6 +165,50 @@ void test_scc_hashtab_reserve_retains_values(void) {
     scc_hashtab_free(tab);
 }
 
+/* test_scc_hashtab_metadata_line_aligned
+ *
+ * Rehash a table and verify that the metadata array of
+ * the new allocation starts on a line boundary
+ */
+void test_scc_hashtab_metadata_line_aligned(void) {
+    scc_hashtab(int) tab = scc_hashtab_new(int, eq);
+    TEST_ASSERT_TRUE(scc_hashtab_reserve(&tab, 1000u));
+    struct scc_hashtab_base *base = scc_hashtab_inspect_base(tab);
+    TEST_ASSERT_EQUAL_UINT32(SCC_PAGES_HEAP, base->ht_dynalloc);
+    TEST_ASSERT_EQUAL_UINT64(0ull, (uintptr_t)base % SCC_PAGES_LINESZ);
+    TEST_ASSERT_EQUAL_UINT64(0ull, (uintptr_t)scc_hashtab_inspect_metadata(tab) % SCC_PAGES_LINESZ);
+    scc_hashtab_free(tab);
+}
+
+/* test_scc_hashtab_reserve_huge
+ *
+ * Reserve a capacity large enough for the table to be
+ * mapped directly and verify that it is aligned on a
+ * huge page boundary and usable, also when cloned
+ */
+void test_scc_hashtab_reserve_huge(void) {
+    scc_hashtab(int) tab = scc_hashtab_new(int, eq);
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashtab_insert(&tab, i));
+    }
+    TEST_ASSERT_TRUE(scc_hashtab_reserve(&tab, SCC_PAGES_HUGE_THRESHOLD / sizeof(int)));
+
+    struct scc_hashtab_base *base = scc_hashtab_inspect_base(tab);
+    TEST_ASSERT_EQUAL_UINT32(SCC_PAGES_MAPPED, base->ht_dynalloc);
+    TEST_ASSERT_EQUAL_UINT64(0ull, (uintptr_t)base % SCC_PAGES_HUGESZ);
+
+    scc_hashtab(int) clone = scc_hashtab_clone(tab);
+    TEST_ASSERT_TRUE(!!clone);
+    TEST_ASSERT_EQUAL_UINT32(SCC_PAGES_MAPPED, scc_hashtab_inspect_base(clone)->ht_dynalloc);
+
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(!!scc_hashtab_find(tab, i));
+        TEST_ASSERT_TRUE(!!scc_hashtab_find(clone, i));
+    }
+    scc_hashtab_free(clone);
+    scc_hashtab_free(tab);
+}
+
 /* test_scc_hashtab_interleaved_insert_find
  *
  * Perform repeated insertions and, after each insertion,
@@ -315,12 +377,8 @@ void test_scc_hashtab_metadata_address_on_rehash(void) {
     TEST_ASSERT_GREATER_THAN_UINT64(cap, scc_hashtab_capacity(tab));
     unsigned char *md = (unsigned char *)tab + (scc_hashtab_capacity(tab) + 1) * sizeof(int);
 
-    /* Align pointer */
-    unsigned char lb;
-    memcpy(&lb, &md, sizeof(lb));
-    size_t const align = scc_alignof(scc_hashtab_metatype);
-    lb = (lb + align - 1) & ~(align - 1);
-    memcpy(&md, &lb, sizeof(lb));
+    /* Metadata starts on the next line */
+    md = (unsigned char *)scc_align((uintptr_t)md, (uintptr_t)SCC_PAGES_LINESZ);
 
     TEST_ASSERT_EQUAL_PTR(md, scc_hashtab_inspect_metadata(tab));
     scc_hashtab_free(tab);
@@ -425,3 +483,101 @@ void test_scc_hashtab_foreach(void) {
     for (unsigned i = 0u; i < scc_arrsize(found); ++i)
         TEST_ASSERT_TRUE(found[i]);
 }
+
+/* test_scc_hashtab_incremental_rehash
+ *
+ * Enable incremental rehashing and interleave insertions,
+ * lookups and removals while migrations are in progress
+ */
+void test_scc_hashtab_incremental_rehash(void) {
+    scc_hashtab(int) tab = scc_hashtab_new(int, eq);
+    scc_hashtab_set_incremental(tab, true);
+
+    bool migrated = false;
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashtab_insert(&tab, i));
+        TEST_ASSERT_FALSE(scc_hashtab_insert(&tab, i / 2));
+        migrated = migrated || scc_hashtab_inspect_base(tab)->ht_oldtab;
+        TEST_ASSERT_EQUAL_UINT64(i + 1ull, scc_hashtab_size(tab));
+        for (int j = 0; j <= i; ++j) {
+            TEST_ASSERT_TRUE(!!scc_hashtab_find(tab, j));
+        }
+    }
+    TEST_ASSERT_TRUE(migrated);
+
+    for (int i = 0; i < TEST_SIZE; i += 2) {
+        TEST_ASSERT_TRUE(scc_hashtab_remove(tab, i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(TEST_SIZE / 2, scc_hashtab_size(tab));
+
+    int const *elem;
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        elem = scc_hashtab_find(tab, i);
+        TEST_ASSERT_EQUAL(!!(i & 1), !!elem);
+    }
+
+    scc_hashtab_free(tab);
+}
+
+/* test_scc_hashtab_incremental_rehash_foreach
+ *
+ * Start iterating over a hash table with a migration in
+ * progress and verify that all elements are visited
+ */
+void test_scc_hashtab_incremental_rehash_foreach(void) {
+    scc_hashtab(int) tab = scc_hashtab_new(int, eq);
+    scc_hashtab_set_incremental(tab, true);
+
+    int n;
+    for (n = 0; !scc_hashtab_inspect_base(tab)->ht_oldtab; ++n) {
+        TEST_ASSERT_TRUE(scc_hashtab_insert(&tab, n));
+    }
+
+    bool found[SCC_HASHTAB_STACKCAP] = { 0 };
+    TEST_ASSERT_LESS_OR_EQUAL(scc_arrsize(found), n);
+    int const *it;
+    unsigned nvisited = 0u;
+    scc_hashtab_foreach(it, tab) {
+        found[*it] = true;
+        ++nvisited;
+    }
+    TEST_ASSERT_EQUAL_UINT32((unsigned)n, nvisited);
+    TEST_ASSERT_FALSE(scc_hashtab_inspect_base(tab)->ht_oldtab);
+
+    for (int i = 0; i < n; ++i) {
+        TEST_ASSERT_TRUE(found[i]);
+    }
+
+    scc_hashtab_free(tab);
+}
+
+/* test_scc_hashtab_from
+ *
+ * Build a hash table from an array of values and
+ * verify its capacity and contents
+ */
+void test_scc_hashtab_from(void) {
+    enum { TESTSIZE = 1000 };
+    int vals[TESTSIZE];
+    for (int i = 0; i < TESTSIZE; ++i) {
+        vals[i] = i * 3;
+    }
+
+    scc_hashtab(int) tab = scc_hashtab_from(int, eq, vals, TESTSIZE);
+    TEST_ASSERT_TRUE(!!tab);
+    TEST_ASSERT_EQUAL_UINT64((unsigned long long)TESTSIZE, scc_hashtab_size(tab));
+    TEST_ASSERT_EQUAL_UINT64(2048ull, scc_hashtab_capacity(tab));
+
+    for (int i = 0; i < TESTSIZE * 3; ++i) {
+        TEST_ASSERT_EQUAL(!(i % 3), !!scc_hashtab_find(tab, i));
+    }
+
+    /* Table is fully functional */
+    TEST_ASSERT_FALSE(scc_hashtab_insert(&tab, 0));
+    TEST_ASSERT_TRUE(scc_hashtab_insert(&tab, 1));
+    TEST_ASSERT_TRUE(scc_hashtab_remove(tab, 3));
+    TEST_ASSERT_FALSE(scc_hashtab_find(tab, 3));
+    TEST_ASSERT_EQUAL_UINT64((unsigned long long)TESTSIZE, scc_hashtab_size(tab));
+
+    scc_hashtab_free(tab);
+}
@@ -0,0 +1,63 @@
+#include <inspect/counting_allocator.h>
+#include <scc/pages.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <unity.h>
+
+/* test_scc_pages_alloc_heap
+ *
+ * Allocate a small zeroed block and verify that it comes
+ * from the heap and is aligned on a line boundary
+ */
+void test_scc_pages_alloc_heap(void) {
+    enum { BLOCKSZ = 1000 };
+    unsigned char kind = SCC_PAGES_NONE;
+    unsigned char *block = scc_pages_alloc(0, BLOCKSZ, true, &kind);
+    TEST_ASSERT_TRUE(!!block);
+    TEST_ASSERT_EQUAL_UINT32(SCC_PAGES_HEAP, kind);
+    TEST_ASSERT_EQUAL_UINT64(0ull, (uintptr_t)block % SCC_PAGES_LINESZ);
+    for (unsigned i = 0u; i < BLOCKSZ; ++i) {
+        TEST_ASSERT_EQUAL_UINT8(0u, block[i]);
+    }
+    scc_pages_free(0, block, BLOCKSZ, kind);
+}
+
+/* test_scc_pages_alloc_huge
+ *
+ * Allocate a block above the huge page threshold and verify
+ * that it is mapped, zeroed and aligned on a huge page boundary
+ */
+void test_scc_pages_alloc_huge(void) {
+    size_t const size = SCC_PAGES_HUGE_THRESHOLD + 1u;
+    unsigned char kind = SCC_PAGES_NONE;
+    unsigned char *block = scc_pages_alloc(0, size, false, &kind);
+    TEST_ASSERT_TRUE(!!block);
+    TEST_ASSERT_EQUAL_UINT32(SCC_PAGES_MAPPED, kind);
+    TEST_ASSERT_EQUAL_UINT64(0ull, (uintptr_t)block % SCC_PAGES_HUGESZ);
+    TEST_ASSERT_EQUAL_UINT8(0u, block[0]);
+    TEST_ASSERT_EQUAL_UINT8(0u, block[size - 1u]);
+    block[size - 1u] = 0xffu;
+    scc_pages_free(0, block, size, kind);
+}
+
+/* test_scc_pages_alloc_allocator
+ *
+ * Blocks above the huge page threshold are taken from
+ * a user-provided allocator rather than being mapped
+ */
+void test_scc_pages_alloc_allocator(void) {
+    counting_allocator_reset();
+
+    size_t const size = SCC_PAGES_HUGE_THRESHOLD + 1u;
+    unsigned char kind = SCC_PAGES_NONE;
+    unsigned char *block = scc_pages_alloc(&counting_allocator, size, true, &kind);
+    TEST_ASSERT_TRUE(!!block);
+    TEST_ASSERT_EQUAL_UINT32(SCC_PAGES_HEAP, kind);
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.allocs);
+    TEST_ASSERT_EQUAL_UINT8(0u, block[size - 1u]);
+    scc_pages_free(&counting_allocator, block, size, kind);
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.frees);
+}
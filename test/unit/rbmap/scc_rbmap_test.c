@@ -1,3 +1,4 @@
+#include <inspect/counting_allocator.h>
 #include <inspect/rbtree_inspect.h>
 #include <scc/mem.h>
 #include <scc/rbmap.h>
@@ -21,6 +22,21 @@ void test_scc_rbmap_new_dyn(void) {
     scc_rbmap_free(rbmap);
 }
 
+void test_scc_rbmap_new_in(void) {
+    counting_allocator_reset();
+    scc_rbmap(int, int) rbmap = scc_rbmap_new_in(int, int, compare, &counting_allocator);
+    TEST_ASSERT_TRUE(!!rbmap);
+    for(int i = 0; i < TEST_SIZE; i++) {
+        TEST_ASSERT_TRUE(scc_rbmap_insert(&rbmap, i, i));
+    }
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    scc_rbmap(int, int) copy = scc_rbmap_clone(rbmap);
+    TEST_ASSERT_TRUE(!!copy);
+    scc_rbmap_free(rbmap);
+    scc_rbmap_free(copy);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
 void test_scc_rbmap_insert(void) {
     scc_inspect_mask mask;
     scc_rbmap(int, int) rbmap = scc_rbmap_new(int, int, compare);
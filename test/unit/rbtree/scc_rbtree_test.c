@@ -1,7 +1,10 @@
+#include <inspect/counting_allocator.h>
 #include <inspect/rbtree_inspect.h>
 #include <scc/mem.h>
 #include <scc/rbtree.h>
 
+#include <stdlib.h>
+
 #include <unity.h>
 
 #ifdef SCC_MUTATION_TEST
@@ -28,6 +31,18 @@ void test_scc_rbtree_new_dyn(void) {
     scc_rbtree_free(tree);
 }
 
+void test_scc_rbtree_new_in(void) {
+    counting_allocator_reset();
+    scc_rbtree(int) tree = scc_rbtree_new_in(int, compare, &counting_allocator);
+    TEST_ASSERT_TRUE(!!tree);
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_rbtree_insert(&tree, i));
+    }
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u);
+    scc_rbtree_free(tree);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
 void test_scc_rbtree_size(void) {
     scc_rbtree(int) tree = scc_rbtree_new(int, compare);
     TEST_ASSERT_EQUAL_UINT64(0u, scc_rbtree_size(tree));
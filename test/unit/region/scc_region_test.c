@@ -0,0 +1,187 @@
+#include <inspect/counting_allocator.h>
+#include <scc/hashmap.h>
+#include <scc/rbtree.h>
+#include <scc/region.h>
+#include <scc/vec.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unity.h>
+
+static bool eq(void const *left, void const *right) {
+    return *(int const *)left == *(int const *)right;
+}
+
+static int compare(void const *left, void const *right) {
+    return *(int const *)left - *(int const *)right;
+}
+
+/* test_scc_region_alloc_aligned
+ *
+ * Allocate blocks of varying sizes and verify that
+ * they are aligned and do not overlap
+ */
+void test_scc_region_alloc_aligned(void) {
+    struct scc_region region;
+    scc_region_init(&region, 0);
+    unsigned char *prev = 0;
+    for (size_t i = 1u; i < 64u; ++i) {
+        unsigned char *block = scc_region_alloc(&region, i);
+        TEST_ASSERT_TRUE(!!block);
+        TEST_ASSERT_EQUAL_UINT64(0u, (uintptr_t)block % SCC_REGION_ALIGN);
+        memset(block, (int)i, i);
+        if (prev) {
+            TEST_ASSERT_EQUAL_UINT8((unsigned char)(i - 1u), prev[i - 2u]);
+        }
+        prev = block;
+    }
+    TEST_ASSERT_EQUAL_UINT64(1u, scc_region_nchunks(&region));
+    scc_region_release(&region);
+    TEST_ASSERT_EQUAL_UINT64(0u, scc_region_nchunks(&region));
+}
+
+/* test_scc_region_chunks_grow
+ *
+ * Fill the region past its first chunk and verify that
+ * chunks are obtained from the backing allocator
+ */
+void test_scc_region_chunks_grow(void) {
+    counting_allocator_reset();
+    struct scc_region region;
+    scc_region_init(&region, &counting_allocator);
+    for (unsigned i = 0u; i < 4u * SCC_REGION_CHUNKSIZE / 64u; ++i) {
+        TEST_ASSERT_TRUE(!!scc_region_alloc(&region, 64u));
+    }
+    /* Geometric growth, far fewer chunks than the 4 chunks
+     * worth of data would have required at a fixed size */
+    TEST_ASSERT_EQUAL_UINT64(alloc_counts.allocs, scc_region_nchunks(&region));
+    TEST_ASSERT_TRUE(alloc_counts.allocs > 1u && alloc_counts.allocs < 4u);
+    scc_region_release(&region);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
+/* test_scc_region_oversized_block
+ *
+ * Blocks larger than a chunk get a chunk of their own
+ * without discarding the space left in the current one
+ */
+void test_scc_region_oversized_block(void) {
+    struct scc_region region;
+    scc_region_init(&region, 0);
+    unsigned char *small = scc_region_alloc(&region, 16u);
+    TEST_ASSERT_TRUE(!!small);
+    unsigned char *large = scc_region_alloc(&region, SCC_REGION_MAX_CHUNKSIZE * 2u);
+    TEST_ASSERT_TRUE(!!large);
+    memset(large, 0xff, SCC_REGION_MAX_CHUNKSIZE * 2u);
+    TEST_ASSERT_EQUAL_UINT64(2u, scc_region_nchunks(&region));
+    /* Next small block follows the first one */
+    unsigned char *next = scc_region_alloc(&region, 16u);
+    TEST_ASSERT_EQUAL_PTR(small + 16u + SCC_REGION_ALIGN, next);
+    scc_region_release(&region);
+}
+
+/* test_scc_region_reset_reuses_chunk
+ *
+ * Reset the region and verify that the current chunk is
+ * kept and allocated from anew
+ */
+void test_scc_region_reset_reuses_chunk(void) {
+    counting_allocator_reset();
+    struct scc_region region;
+    scc_region_init(&region, &counting_allocator);
+    unsigned char *first = 0;
+    struct scc_region_chunk *current = 0;
+    for (unsigned i = 0u; i < 4u * SCC_REGION_CHUNKSIZE / 64u; ++i) {
+        unsigned char *block = scc_region_alloc(&region, 64u);
+        TEST_ASSERT_TRUE(!!block);
+        if (region.rg_current != current) {
+            /* First block in new chunk */
+            current = region.rg_current;
+            first = block;
+        }
+    }
+    TEST_ASSERT_TRUE(scc_region_nchunks(&region) > 1u);
+    unsigned const allocs = alloc_counts.allocs;
+    scc_region_reset(&region);
+    TEST_ASSERT_EQUAL_UINT64(1u, scc_region_nchunks(&region));
+    TEST_ASSERT_EQUAL_UINT32(allocs - 1u, alloc_counts.frees);
+    /* Retained chunk is allocated from the start */
+    unsigned char *block = scc_region_alloc(&region, 64u);
+    TEST_ASSERT_TRUE(!!block);
+    TEST_ASSERT_EQUAL_PTR(first, block);
+    TEST_ASSERT_EQUAL_UINT32(allocs, alloc_counts.allocs);
+    scc_region_release(&region);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
+/* test_scc_region_realloc
+ *
+ * Grow blocks through the allocator interface, in place when
+ * the block is on top and by copying otherwise
+ */
+void test_scc_region_realloc(void) {
+    struct scc_region region;
+    scc_region_init(&region, 0);
+    struct scc_allocator const *allocator = scc_region_allocator(&region);
+
+    unsigned char *lower = scc_allocator_alloc(allocator, 8u);
+    memset(lower, 0xaa, 8u);
+    unsigned char *upper = scc_allocator_alloc(allocator, 8u);
+    memset(upper, 0xbb, 8u);
+
+    /* On top, grown in place */
+    TEST_ASSERT_EQUAL_PTR(upper, scc_allocator_realloc(allocator, upper, 128u));
+
+    /* Not on top, moved */
+    unsigned char *moved = scc_allocator_realloc(allocator, lower, 64u);
+    TEST_ASSERT_TRUE(moved != lower);
+    for (unsigned i = 0u; i < 8u; ++i) {
+        TEST_ASSERT_EQUAL_UINT8(0xaau, moved[i]);
+        TEST_ASSERT_EQUAL_UINT8(0xbbu, upper[i]);
+    }
+
+    /* Freeing the top block makes its space available again */
+    scc_allocator_free(allocator, moved);
+    TEST_ASSERT_EQUAL_PTR(moved, scc_allocator_alloc(allocator, 32u));
+    scc_region_release(&region);
+}
+
+/* test_scc_region_containers
+ *
+ * Place several containers in a region and drop them all
+ * at once without freeing any of them
+ */
+void test_scc_region_containers(void) {
+    enum { NELEMS = 1024 };
+    counting_allocator_reset();
+    struct scc_region region;
+    scc_region_init(&region, &counting_allocator);
+
+    for (unsigned round = 0u; round < 3u; ++round) {
+        scc_vec(int) vec = scc_vec_new_in(int, scc_region_allocator(&region));
+        scc_hashmap(int, int) map = scc_hashmap_new_in(int, int, eq, scc_region_allocator(&region));
+        scc_rbtree(int) tree = scc_rbtree_new_in(int, compare, scc_region_allocator(&region));
+        TEST_ASSERT_TRUE(vec && map && tree);
+
+        for (int i = 0; i < NELEMS; ++i) {
+            TEST_ASSERT_TRUE(scc_vec_push(&vec, i));
+            TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, -i));
+            TEST_ASSERT_TRUE(scc_rbtree_insert(&tree, i));
+        }
+        for (int i = 0; i < NELEMS; ++i) {
+            TEST_ASSERT_EQUAL_INT32(i, vec[i]);
+            int *val = scc_hashmap_find(map, i);
+            TEST_ASSERT_TRUE(!!val);
+            TEST_ASSERT_EQUAL_INT32(-i, *val);
+            TEST_ASSERT_TRUE(!!scc_rbtree_find(tree, i));
+        }
+        scc_region_reset(&region);
+        TEST_ASSERT_EQUAL_UINT64(1u, scc_region_nchunks(&region));
+    }
+
+    scc_region_release(&region);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
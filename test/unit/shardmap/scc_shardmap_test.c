@@ -0,0 +1,244 @@
+#include <scc/shardmap.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <unity.h>
+
+enum { NTHREADS = 8 };
+
+static bool eq(void const *left, void const *right) {
+    return *(int const *)left == *(int const *)right;
+}
+
+/* test_scc_shardmap_new
+ *
+ * Create a shardmap and verify its size and shard count
+ */
+void test_scc_shardmap_new(void) {
+    scc_shardmap(int, unsigned) smap = scc_shardmap_new(int, unsigned, eq, 16u);
+    TEST_ASSERT_TRUE(!!smap);
+    TEST_ASSERT_EQUAL_UINT64(0ull, scc_shardmap_size(smap));
+    TEST_ASSERT_EQUAL_UINT64(16ull, scc_shardmap_nshards(smap));
+    scc_shardmap_free(smap);
+}
+
+/* test_scc_shardmap_new_invalid_nshards
+ *
+ * Creating a shardmap with a shard count that is
+ * zero or not a power of 2 must fail
+ */
+void test_scc_shardmap_new_invalid_nshards(void) {
+    TEST_ASSERT_FALSE(!!scc_shardmap_new(int, unsigned, eq, 0u));
+    TEST_ASSERT_FALSE(!!scc_shardmap_new(int, unsigned, eq, 3u));
+    TEST_ASSERT_FALSE(!!scc_shardmap_new(int, unsigned, eq, 2u * SCC_SHARDMAP_MAXSHARDS));
+}
+
+/* test_scc_shardmap_insert_find_remove
+ *
+ * Insert, look up and remove keys in a single thread
+ */
+void test_scc_shardmap_insert_find_remove(void) {
+    enum { TESTSIZE = 1024 };
+    scc_shardmap(int, unsigned) smap = scc_shardmap_new(int, unsigned, eq, 8u);
+    unsigned *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_shardmap_insert(smap, i, (unsigned)i * 3u));
+        TEST_ASSERT_EQUAL_UINT64(i + 1ull, scc_shardmap_size(smap));
+    }
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_shardmap_find(smap, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT32((unsigned)i * 3u, *val);
+    }
+    TEST_ASSERT_FALSE(!!scc_shardmap_find(smap, TESTSIZE));
+
+    /* Replace value */
+    TEST_ASSERT_TRUE(scc_shardmap_insert(smap, 0, 38u));
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE, scc_shardmap_size(smap));
+    val = scc_shardmap_find(smap, 0);
+    TEST_ASSERT_TRUE(!!val);
+    TEST_ASSERT_EQUAL_UINT32(38u, *val);
+
+    for (int i = 0; i < TESTSIZE; i += 2) {
+        TEST_ASSERT_TRUE(scc_shardmap_remove(smap, i));
+        TEST_ASSERT_FALSE(scc_shardmap_remove(smap, i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE / 2u, scc_shardmap_size(smap));
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_EQUAL_INT(i & 1, !!scc_shardmap_find(smap, i));
+    }
+    scc_shardmap_free(smap);
+}
+
+/* test_scc_shardmap_new_scalar
+ *
+ * Insert and look up keys in a shardmap with scalar keys
+ */
+void test_scc_shardmap_new_scalar(void) {
+    enum { TESTSIZE = 1024 };
+    scc_shardmap(unsigned long long, int) smap = scc_shardmap_new_scalar(unsigned long long, int, 4u);
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_shardmap_insert(smap, i * 0x10001ull, i));
+    }
+    int *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_shardmap_find(smap, i * 0x10001ull);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_INT32(i, *val);
+    }
+    scc_shardmap_free(smap);
+}
+
+struct worker {
+    void *smap;
+    int first;
+    int count;
+    int failed;
+};
+
+static void *insert_range(void *arg) {
+    struct worker *w = arg;
+    scc_shardmap(int, unsigned) smap = w->smap;
+    unsigned *val;
+    for (int i = w->first; i < w->first + w->count; ++i) {
+        w->failed += !scc_shardmap_insert(smap, i, (unsigned)i + 1u);
+        val = scc_shardmap_find(smap, i);
+        w->failed += !val || *val != (unsigned)i + 1u;
+    }
+    return 0;
+}
+
+static void *remove_range(void *arg) {
+    struct worker *w = arg;
+    scc_shardmap(int, unsigned) smap = w->smap;
+    for (int i = w->first; i < w->first + w->count; i += 2) {
+        w->failed += !scc_shardmap_remove(smap, i);
+    }
+    return 0;
+}
+
+enum { FINDRANGE_OFFSET = 1 << 20 };
+
+static void *find_insert_range(void *arg) {
+    struct worker *w = arg;
+    scc_shardmap(int, unsigned) smap = w->smap;
+    unsigned *val;
+    for (int i = w->first; i < w->first + w->count; ++i) {
+        val = scc_shardmap_find(smap, i);
+        w->failed += !val || *val != (unsigned)i + 1u;
+        w->failed += !scc_shardmap_insert(smap, i + FINDRANGE_OFFSET, (unsigned)i);
+    }
+    return 0;
+}
+
+/* Keys inserted and removed again by find_churn_range */
+enum { CHURNRANGE_OFFSET = 1 << 21 };
+
+static void *find_churn_range(void *arg) {
+    struct worker *w = arg;
+    scc_shardmap(int, unsigned) smap = w->smap;
+    unsigned *val;
+    for (int i = w->first; i < w->first + w->count; ++i) {
+        w->failed += !scc_shardmap_insert(smap, i + CHURNRANGE_OFFSET, 0u);
+        val = scc_shardmap_find(smap, i);
+        w->failed += !val || *val != (unsigned)i + 1u;
+        w->failed += !scc_shardmap_remove(smap, i + CHURNRANGE_OFFSET);
+    }
+    return 0;
+}
+
+static void run_workers(void *smap, void *(*fn)(void *), int count) {
+    scc_shardmap(int, unsigned) handle = smap;
+    pthread_t threads[NTHREADS];
+    struct worker workers[NTHREADS];
+    for (int i = 0; i < NTHREADS; ++i) {
+        workers[i] = (struct worker){
+            .smap = scc_shardmap_attach(handle),
+            .first = i * count,
+            .count = count
+        };
+        TEST_ASSERT_TRUE(!!workers[i].smap);
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], 0, fn, &workers[i]));
+    }
+    for (int i = 0; i < NTHREADS; ++i) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_join(threads[i], 0));
+        TEST_ASSERT_EQUAL_INT(0, workers[i].failed);
+        scc_shardmap_detach(workers[i].smap);
+    }
+}
+
+/* test_scc_shardmap_concurrent_insert_remove
+ *
+ * Insert disjoint key ranges from several threads, each with
+ * a handle of its own, then remove half of the keys concurrently
+ * and verify the contents from the main thread
+ */
+void test_scc_shardmap_concurrent_insert_remove(void) {
+    enum { PERTHREAD = 4096 };
+    scc_shardmap(int, unsigned) smap = scc_shardmap_new(int, unsigned, eq, 4u);
+
+    run_workers(smap, insert_range, PERTHREAD);
+    TEST_ASSERT_EQUAL_UINT64(NTHREADS * PERTHREAD, scc_shardmap_size(smap));
+
+    unsigned *val;
+    for (int i = 0; i < NTHREADS * PERTHREAD; ++i) {
+        val = scc_shardmap_find(smap, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT32((unsigned)i + 1u, *val);
+    }
+
+    run_workers(smap, remove_range, PERTHREAD);
+    TEST_ASSERT_EQUAL_UINT64(NTHREADS * PERTHREAD / 2u, scc_shardmap_size(smap));
+    for (int i = 0; i < NTHREADS * PERTHREAD; ++i) {
+        TEST_ASSERT_EQUAL_INT(i & 1, !!scc_shardmap_find(smap, i));
+    }
+    scc_shardmap_free(smap);
+}
+
+/* test_scc_shardmap_concurrent_find_insert
+ *
+ * Look up keys from several threads while the same threads
+ * insert into the shards being read, forcing them to grow,
+ * and verify the contents from the main thread
+ */
+void test_scc_shardmap_concurrent_find_insert(void) {
+    enum { PERTHREAD = 4096 };
+    scc_shardmap(int, unsigned) smap = scc_shardmap_new(int, unsigned, eq, 4u);
+    for (int i = 0; i < NTHREADS * PERTHREAD; ++i) {
+        TEST_ASSERT_TRUE(scc_shardmap_insert(smap, i, (unsigned)i + 1u));
+    }
+
+    run_workers(smap, find_insert_range, PERTHREAD);
+    TEST_ASSERT_EQUAL_UINT64(2u * NTHREADS * PERTHREAD, scc_shardmap_size(smap));
+
+    unsigned *val;
+    for (int i = 0; i < NTHREADS * PERTHREAD; ++i) {
+        val = scc_shardmap_find(smap, i + FINDRANGE_OFFSET);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT32((unsigned)i, *val);
+    }
+    scc_shardmap_free(smap);
+}
+
+/* test_scc_shardmap_concurrent_find_churn
+ *
+ * Look up keys from several threads while the same threads
+ * insert and remove other keys in the shards being read,
+ * modifying them in place
+ */
+void test_scc_shardmap_concurrent_find_churn(void) {
+    enum { PERTHREAD = 4096 };
+    scc_shardmap(int, unsigned) smap = scc_shardmap_new(int, unsigned, eq, 4u);
+    for (int i = 0; i < NTHREADS * PERTHREAD; ++i) {
+        TEST_ASSERT_TRUE(scc_shardmap_insert(smap, i, (unsigned)i + 1u));
+    }
+
+    run_workers(smap, find_churn_range, PERTHREAD);
+    TEST_ASSERT_EQUAL_UINT64(NTHREADS * PERTHREAD, scc_shardmap_size(smap));
+    for (int i = 0; i < NTHREADS * PERTHREAD; ++i) {
+        TEST_ASSERT_FALSE(!!scc_shardmap_find(smap, i + CHURNRANGE_OFFSET));
+    }
+    scc_shardmap_free(smap);
+}
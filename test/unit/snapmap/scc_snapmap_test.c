@@ -0,0 +1,219 @@
+#include <inspect/hashmap_inspect.h>
+
+#include <scc/hashmap.h>
+#include <scc/snapmap.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <unity.h>
+
+enum { NREADERS = 4 };
+
+static bool eq(void const *left, void const *right) {
+    return *(int const *)left == *(int const *)right;
+}
+
+/* test_scc_snapmap_new
+ *
+ * Create a snapmap and verify that it is empty
+ */
+void test_scc_snapmap_new(void) {
+    scc_snapmap(int, unsigned) smap = scc_snapmap_new(int, unsigned, eq);
+    TEST_ASSERT_TRUE(!!smap);
+    TEST_ASSERT_EQUAL_UINT64(0ull, scc_snapmap_size(smap));
+    TEST_ASSERT_FALSE(!!scc_snapmap_find(smap, 0));
+    TEST_ASSERT_EQUAL_UINT64(0ull, (size_t)smap % SCC_SNAPMAP_LINESZ);
+    scc_snapmap_free(smap);
+}
+
+/* test_scc_snapmap_publish
+ *
+ * Modify a draft and verify that the changes become
+ * visible only once the draft is published
+ */
+void test_scc_snapmap_publish(void) {
+    enum { TESTSIZE = 512 };
+    scc_snapmap(int, unsigned) smap = scc_snapmap_new(int, unsigned, eq);
+    scc_hashmap(int, unsigned) draft = scc_snapmap_edit(smap);
+    TEST_ASSERT_TRUE(!!draft);
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&draft, i, (unsigned)i * 2u));
+    }
+    TEST_ASSERT_EQUAL_UINT64(0ull, scc_snapmap_size(smap));
+    TEST_ASSERT_FALSE(!!scc_snapmap_find(smap, 0));
+
+    scc_snapmap_publish(smap, draft);
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE, scc_snapmap_size(smap));
+
+    unsigned *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_snapmap_find(smap, i);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT32((unsigned)i * 2u, *val);
+    }
+    TEST_ASSERT_FALSE(!!scc_snapmap_find(smap, TESTSIZE));
+
+    /* Removals in a second draft */
+    draft = scc_snapmap_edit(smap);
+    for (int i = 0; i < TESTSIZE; i += 2) {
+        TEST_ASSERT_TRUE(scc_hashmap_remove(draft, i));
+    }
+    TEST_ASSERT_TRUE(!!scc_snapmap_find(smap, 0));
+    scc_snapmap_publish(smap, draft);
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE / 2u, scc_snapmap_size(smap));
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_EQUAL_INT(i & 1, !!scc_snapmap_find(smap, i));
+    }
+    scc_snapmap_free(smap);
+}
+
+/* test_scc_snapmap_discard
+ *
+ * Discarding a draft must leave the published snapshot unchanged
+ */
+void test_scc_snapmap_discard(void) {
+    scc_snapmap(int, unsigned) smap = scc_snapmap_new(int, unsigned, eq);
+    scc_hashmap(int, unsigned) draft = scc_snapmap_edit(smap);
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&draft, 1, 1u));
+    scc_snapmap_publish(smap, draft);
+
+    draft = scc_snapmap_edit(smap);
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&draft, 1, 2u));
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&draft, 2, 2u));
+    scc_snapmap_discard(smap, draft);
+
+    TEST_ASSERT_EQUAL_UINT64(1ull, scc_snapmap_size(smap));
+    unsigned *val = scc_snapmap_find(smap, 1);
+    TEST_ASSERT_TRUE(!!val);
+    TEST_ASSERT_EQUAL_UINT32(1u, *val);
+
+    /* Writer lock released by discard */
+    draft = scc_snapmap_edit(smap);
+    TEST_ASSERT_TRUE(!!draft);
+    scc_snapmap_discard(smap, draft);
+    scc_snapmap_free(smap);
+}
+
+/* test_scc_snapmap_publish_settles_incremental_rehash
+ *
+ * A draft left mid-migration must be published
+ * with all pairs moved to the new table
+ */
+void test_scc_snapmap_publish_settles_incremental_rehash(void) {
+    scc_snapmap(int, unsigned) smap = scc_snapmap_new(int, unsigned, eq);
+    scc_hashmap(int, unsigned) draft = scc_snapmap_edit(smap);
+    scc_hashmap_set_incremental(draft, true);
+    int i;
+    for (i = 0; !scc_hashmap_inspect_base(draft)->hm_oldmap; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&draft, i, (unsigned)i));
+    }
+    scc_snapmap_publish(smap, draft);
+
+    TEST_ASSERT_EQUAL_UINT64((size_t)i, scc_snapmap_size(smap));
+    unsigned *val;
+    for (int j = 0; j < i; ++j) {
+        val = scc_snapmap_find(smap, j);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT32((unsigned)j, *val);
+    }
+    scc_snapmap_free(smap);
+}
+
+/* test_scc_snapmap_new_scalar
+ *
+ * Look up keys in a snapmap with scalar keys
+ */
+void test_scc_snapmap_new_scalar(void) {
+    enum { TESTSIZE = 1024 };
+    scc_snapmap(unsigned short, int) smap = scc_snapmap_new_scalar(unsigned short, int);
+    scc_hashmap(unsigned short, int) draft = scc_snapmap_edit(smap);
+    for (int i = 0; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&draft, (unsigned short)(i * 61), i));
+    }
+    scc_snapmap_publish(smap, draft);
+
+    int *val;
+    for (int i = 0; i < TESTSIZE; ++i) {
+        val = scc_snapmap_find(smap, (unsigned short)(i * 61));
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_INT32(i, *val);
+    }
+    TEST_ASSERT_FALSE(!!scc_snapmap_find(smap, (unsigned short)1));
+    scc_snapmap_free(smap);
+}
+
+struct reader {
+    void *smap;
+    unsigned const *generation;
+    int nkeys;
+    int failed;
+};
+
+/* Each snapshot maps every key to the generation in which it
+ * was published, a reader must never see a generation decrease */
+static void *read_generations(void *arg) {
+    struct reader *r = arg;
+    scc_snapmap(int, unsigned) smap = r->smap;
+    unsigned last = 0u;
+    unsigned *val;
+    for (int i = 0; __atomic_load_n(r->generation, __ATOMIC_ACQUIRE) != ~0u; i = (i + 1) % r->nkeys) {
+        val = scc_snapmap_find(smap, i);
+        if (!val) {
+            ++r->failed;
+            continue;
+        }
+        r->failed += *val < last;
+        last = *val;
+    }
+    return 0;
+}
+
+/* test_scc_snapmap_concurrent_readers
+ *
+ * Repeatedly publish new snapshots while several
+ * threads look up keys without synchronization
+ */
+void test_scc_snapmap_concurrent_readers(void) {
+    enum { NKEYS = 256, NGENERATIONS = 64 };
+    scc_snapmap(int, unsigned) smap = scc_snapmap_new(int, unsigned, eq);
+    scc_hashmap(int, unsigned) draft = scc_snapmap_edit(smap);
+    for (int i = 0; i < NKEYS; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&draft, i, 0u));
+    }
+    scc_snapmap_publish(smap, draft);
+
+    unsigned generation = 0u;
+    pthread_t threads[NREADERS];
+    struct reader readers[NREADERS];
+    for (int i = 0; i < NREADERS; ++i) {
+        readers[i] = (struct reader){
+            .smap = scc_snapmap_attach(smap),
+            .generation = &generation,
+            .nkeys = NKEYS
+        };
+        TEST_ASSERT_TRUE(!!readers[i].smap);
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], 0, read_generations, &readers[i]));
+    }
+
+    for (unsigned g = 1u; g < NGENERATIONS; ++g) {
+        draft = scc_snapmap_edit(smap);
+        TEST_ASSERT_TRUE(!!draft);
+        for (int i = 0; i < NKEYS; ++i) {
+            TEST_ASSERT_TRUE(scc_hashmap_insert(&draft, i, g));
+        }
+        scc_snapmap_publish(smap, draft);
+        __atomic_store_n(&generation, g, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&generation, ~0u, __ATOMIC_RELEASE);
+
+    scc_snapmap(int, unsigned) handle;
+    for (int i = 0; i < NREADERS; ++i) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_join(threads[i], 0));
+        TEST_ASSERT_EQUAL_INT(0, readers[i].failed);
+        handle = readers[i].smap;
+        scc_snapmap_detach(handle);
+    }
+    scc_snapmap_free(smap);
+}
@@ -1,3 +1,4 @@
+#include <inspect/counting_allocator.h>
 #include <scc/stack.h>
 #include <scc/vec.h>
 
@@ -15,6 +16,19 @@ void test_scc_stack_new_dyn(void) {
     scc_stack_free(stack);
 }
 
+void test_scc_stack_new_in(void) {
+    enum { TEST_SIZE = 100 };
+    counting_allocator_reset();
+    scc_stack(int) stack = scc_stack_new_in(int, &counting_allocator);
+    TEST_ASSERT_TRUE(!!stack);
+    for(int i = 0; i < TEST_SIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_stack_push(&stack, i));
+    }
+    TEST_ASSERT_TRUE(alloc_counts.allocs + alloc_counts.reallocs > 1u);
+    scc_stack_free(stack);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
 void test_scc_stack_push(void) {
     enum { TEST_SIZE = 100 };
     scc_stack(int) stack = scc_stack_new(int);
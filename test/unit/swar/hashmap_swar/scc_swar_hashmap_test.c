@@ -42,22 +42,18 @@ void test_scc_swar_hashmap_kill_insert_mutant(void) {
     scc_hashmap(uint32_t, unsigned short) map = scc_hashmap_new(uint32_t, unsigned short, eq);
     scc_hashmap_metatype *md = scc_hashmap_inspect_metadata(map);
 
-    /* Insert and remove until all slots have been
-     * used at least once */
-    bool done = false;
-    for(uint32_t i = 0u; !done; ++i) {
-        done = true;
+    /* Insert and remove for several times the capacity */
+    for(uint32_t i = 0u; i < 4u * scc_hashmap_capacity(map); ++i) {
         TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i, i));
         TEST_ASSERT_TRUE(scc_hashmap_remove(map, i));
-
-        for(unsigned j = 0u; j < scc_hashmap_capacity(map); ++j) {
-            if(!md[j]) {
-                done = false;
-                break;
-            }
-        }
     }
 
+    /* Tombstones are reclaimed before the empty slots run out */
+    TEST_ASSERT_TRUE(!!memchr(md, 0, scc_hashmap_capacity(map)));
+
+    /* Vacate all slots by hand */
+    memset(md, 0x7f, scc_hashmap_capacity(map) + SCC_HASHMAP_GUARDSZ);
+
     /* Should not cause infinite loop */
     TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 1, 1));
 
@@ -80,3 +76,49 @@ void test_scc_swar_hashmap_kill_find_mutant(void) {
     scc_hashmap_free(map);
     restore_simd();
 }
+
+void test_scc_swar_hashmap_new_scalar(void) {
+    enum { TESTSIZE = 1500 };
+    disable_simd();
+    scc_hashmap(uint32_t, unsigned short) map = scc_hashmap_new_scalar(uint32_t, unsigned short);
+
+    for(uint32_t i = 0u; i < TESTSIZE; ++i) {
+        TEST_ASSERT_TRUE(scc_hashmap_insert(&map, i << 20u, (unsigned short)i));
+    }
+    TEST_ASSERT_EQUAL_UINT64(TESTSIZE, scc_hashmap_size(map));
+
+    for(uint32_t i = 0u; i < TESTSIZE; ++i) {
+        unsigned short *val = scc_hashmap_find(map, i << 20u);
+        TEST_ASSERT_TRUE(!!val);
+        TEST_ASSERT_EQUAL_UINT16((unsigned short)i, *val);
+        TEST_ASSERT_FALSE(scc_hashmap_find(map, (i << 20u) | 1u));
+    }
+
+    for(uint32_t i = 1u; i < TESTSIZE; i += 2u) {
+        TEST_ASSERT_TRUE(scc_hashmap_remove(map, i << 20u));
+    }
+    for(uint32_t i = 0u; i < TESTSIZE; ++i) {
+        TEST_ASSERT_EQUAL_INT(!(i & 1u), !!scc_hashmap_find(map, i << 20u));
+    }
+
+    scc_hashmap_free(map);
+    restore_simd();
+}
+
+void test_scc_swar_hashmap_insert_duplicate_past_vacated(void) {
+    disable_simd();
+    scc_hashmap(uint32_t, unsigned short) map = scc_hashmap_with_hash(uint32_t, unsigned short, eq, one);
+
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 1, 1));
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 2, 2));
+    /* Vacated slot precedes the one holding 2 in the probe sequence */
+    TEST_ASSERT_TRUE(scc_hashmap_remove(map, 1));
+
+    TEST_ASSERT_TRUE(scc_hashmap_insert(&map, 2, 3));
+    TEST_ASSERT_EQUAL_UINT64(1ull, scc_hashmap_size(map));
+    TEST_ASSERT_TRUE(scc_hashmap_remove(map, 2));
+    TEST_ASSERT_FALSE(!!scc_hashmap_find(map, 2));
+
+    scc_hashmap_free(map);
+    restore_simd();
+}
@@ -1,5 +1,8 @@
+#include <inspect/counting_allocator.h>
 #include <scc/vec.h>
 
+#include <stdlib.h>
+
 #include <unity.h>
 
 void test_scc_vec_new(void) {
@@ -18,6 +21,31 @@ void test_scc_vec_new_dyn(void) {
     scc_vec_free(vec);
 }
 
+/* test_scc_vec_new_in
+ *
+ * Create a vector using a custom allocator, grow it past
+ * its initial capacity and verify that all memory is
+ * obtained from and returned to the allocator
+ */
+void test_scc_vec_new_in(void) {
+    counting_allocator_reset();
+    scc_vec(int) vec = scc_vec_new_in(int, &counting_allocator);
+    TEST_ASSERT_TRUE(!!vec);
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.allocs);
+    for (int i = 0; i < 1024; ++i) {
+        TEST_ASSERT_TRUE(scc_vec_push(&vec, i));
+    }
+    for (int i = 0; i < 1024; ++i) {
+        TEST_ASSERT_EQUAL_INT32(i, vec[i]);
+    }
+    scc_vec(int) copy = scc_vec_clone(vec);
+    TEST_ASSERT_TRUE(!!copy);
+    scc_vec_free(vec);
+    scc_vec_free(copy);
+    TEST_ASSERT_EQUAL_UINT32(2u, alloc_counts.allocs);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}
+
 void test_scc_vec_size(void) {
     scc_vec(int) vec = scc_vec_new(int);
     TEST_ASSERT_EQUAL_UINT64(0ull, scc_vec_size(vec));
@@ -525,3 +553,19 @@ void test_scc_vec_from_dyn_exact_cap(void) {
     TEST_ASSERT_EQUAL_UINT64(SCC_VEC_STATIC_CAPACITY, scc_vec_capacity(vec));
     scc_vec_free(vec);
 }
+
+void test_scc_vec_from_in(void) {
+    counting_allocator_reset();
+    scc_vec(int) vec = scc_vec_from_in(int, &counting_allocator, 0, 1, 2);
+    TEST_ASSERT_TRUE(!!vec);
+    TEST_ASSERT_EQUAL_UINT8(((unsigned char *)vec)[-1], 1);
+    TEST_ASSERT_EQUAL_UINT32(1u, alloc_counts.allocs);
+    for(int i = 0; i < 3; ++i) {
+        TEST_ASSERT_EQUAL_INT32(i, vec[i]);
+    }
+    for(int i = 0; i < 2 * SCC_VEC_STATIC_CAPACITY; ++i) {
+        TEST_ASSERT_TRUE(scc_vec_push(&vec, i));
+    }
+    scc_vec_free(vec);
+    TEST_ASSERT_EQUAL_UINT32(alloc_counts.allocs, alloc_counts.frees);
+}